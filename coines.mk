@@ -33,7 +33,13 @@ ifeq ($(TARGET),$(filter $(TARGET),MCU_APP20 MCU_APP30))
 
     LDFLAGS += -mthumb -mcpu=cortex-m4 -specs=nano.specs -Wl,--cref -Wl,--check-sections \
                -Wl,--gc-sections -Wl,--entry=Reset_Handler -Wl,--unresolved-symbols=report-all \
-               -Xlinker -Map=$(OBJ_DIR)/build.map -Wl,--start-group -u _printf_float -u _exit -Wl,--end-group
+               -Xlinker -Map=$(OBJ_DIR)/build.map -Wl,--start-group -u _exit -Wl,--end-group
+
+    # Set to 0 to drop floating point support from printf, e.g. when logging with coines_log.h
+    PRINTF_FLOAT ?= 1
+    ifeq ($(PRINTF_FLOAT),1)
+    LDFLAGS += -u _printf_float
+    endif
 
     CROSS_COMPILE = arm-none-eabi-
     # LOCATION ?= FLASH
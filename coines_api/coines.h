@@ -68,6 +68,8 @@ extern "C"
 #define COINES_E_COMM_WRONG_RESPONSE   -10
 /*! coines error code - Not configured */
 #define COINES_E_SPI16BIT_NOT_CONFIGURED -11
+/*! coines error code - Invalid parameter */
+#define COINES_E_INVALID_PARAM         -12
 
 /**********************************************************************************/
 /* data structure declarations  */
@@ -128,6 +130,8 @@ enum coines_sampling_unit
 enum coines_spi_speed
 {
 
+    COINES_SPI_SPEED_32_MHZ = 2, /*< 32 MHz (APP3.0 MCU only, COINES_E_NOT_SUPPORTED elsewhere) */
+    COINES_SPI_SPEED_16_MHZ = 4, /*< 16 MHz (APP3.0 MCU only, COINES_E_NOT_SUPPORTED elsewhere) */
     COINES_SPI_SPEED_10_MHZ = 6, /*< 10 MHz */
     COINES_SPI_SPEED_7_5_MHZ = 8, /*< 7.5 MHz */
     COINES_SPI_SPEED_6_MHZ = 10, /*< 6 MHz */
@@ -300,6 +304,168 @@ enum coines_pin_interrupt_mode
     COINES_PIN_INTERRUPT_FALLING_EDGE /*< Trigger interrupt when pin changes from high to low */
 };
 
+#if defined(PC)
+/*!
+ * @brief Scheduling policy of the host USB event thread
+ */
+enum coines_rt_sched_policy
+{
+    COINES_RT_SCHED_DEFAULT, /*< Inherit the scheduling of the thread opening the interface */
+    COINES_RT_SCHED_FIFO, /*< Real-time first-in first-out (SCHED_FIFO) */
+    COINES_RT_SCHED_RR /*< Real-time round-robin (SCHED_RR) */
+};
+
+/*! Leave a host thread free to run on any CPU */
+#define COINES_RT_CPU_ANY                    (-1)
+
+/*! coines_rt_status flags - real-time scheduling policy/priority of the event thread */
+#define COINES_RT_SCHED                      UINT8_C(0x01)
+/*! coines_rt_status flags - CPU affinity of the event thread */
+#define COINES_RT_EVENT_AFFINITY             UINT8_C(0x02)
+/*! coines_rt_status flags - CPU affinity of the dispatcher thread */
+#define COINES_RT_DISPATCH_AFFINITY          UINT8_C(0x04)
+/*! coines_rt_status flags - process memory locked with mlockall() */
+#define COINES_RT_MEMLOCK                    UINT8_C(0x08)
+/*! coines_rt_status flags - response buffers pre-faulted */
+#define COINES_RT_PREFAULT                   UINT8_C(0x10)
+
+/*!
+ * @brief Real-time tuning of the host communication threads
+ *
+ * The event thread is the internal thread that services USB transfers and fills the
+ * response ring buffers. The dispatcher thread is the application thread that calls
+ * coines_open_comm_intf() and later drains those buffers.
+ */
+struct coines_rt_config
+{
+    enum coines_rt_sched_policy policy; /*< Event thread scheduling policy */
+    int16_t priority; /*< Event thread priority, 0 -> maximum priority of the policy */
+    int16_t event_thread_cpu; /*< CPU for the event thread or COINES_RT_CPU_ANY */
+    int16_t dispatch_thread_cpu; /*< CPU for the dispatcher thread or COINES_RT_CPU_ANY */
+    uint8_t lock_memory; /*< 1 -> lock all current and future pages in RAM */
+    uint8_t prefault_buffers; /*< 1 -> touch the response buffers before the first transfer */
+};
+
+/*!
+ * @brief Real-time tuning actually applied by the last coines_open_comm_intf()
+ */
+struct coines_rt_status
+{
+    uint8_t requested; /*< COINES_RT_* flags requested by the configuration */
+    uint8_t applied; /*< COINES_RT_* flags which took effect */
+    int16_t priority; /*< Priority the event thread runs at, 0 if not real-time */
+    int sched_error; /*< OS error code of the rejected scheduling request, 0 if none */
+    int affinity_error; /*< OS error code of the rejected affinity request, 0 if none */
+    int memlock_error; /*< OS error code of the rejected memory lock request, 0 if none */
+};
+
+/*!
+ * @brief Statistics of a finished traffic capture
+ */
+struct coines_capture_status
+{
+    uint32_t records; /*< Records written to the capture file */
+    uint32_t dropped_records; /*< Records lost because the file writer could not keep up */
+    uint64_t bytes; /*< Size of the capture file */
+};
+
+/*!
+ * @brief Pacing of the responses played back from a capture
+ */
+enum coines_replay_timing
+{
+    COINES_REPLAY_AS_FAST_AS_POSSIBLE, /*< Responses are delivered as soon as their command was sent */
+    COINES_REPLAY_RECORDED_TIMING /*< Responses keep their recorded delay relative to their command */
+};
+
+/*!
+ * @brief Comparison between the commands sent during replay and the recorded commands
+ */
+struct coines_replay_status
+{
+    uint32_t commands_expected; /*< Commands in the capture */
+    uint32_t commands_matched; /*< Commands identical to the recording */
+    uint32_t commands_mismatched; /*< Commands differing from the recording */
+    uint32_t commands_unexpected; /*< Commands sent after the recording ended */
+    uint32_t first_mismatch; /*< Index of the first differing command, UINT32_MAX if none */
+    uint32_t responses_played; /*< Recorded responses delivered */
+    uint32_t responses_skipped; /*< Recorded responses dropped because the next command came earlier */
+};
+
+/*! Number of registers of the built-in simulated sensor */
+#define COINES_SIM_REG_COUNT    256
+
+/*!
+ * @brief Output of the data generator of the built-in simulated sensor
+ */
+enum coines_sim_waveform
+{
+    COINES_SIM_WAVEFORM_CONSTANT, /*< Every channel reads offset */
+    COINES_SIM_WAVEFORM_RAMP, /*< offset + sample index + channel, increments by one per sample */
+    COINES_SIM_WAVEFORM_SINE, /*< offset + amplitude * sin(), channels shifted by period / channels */
+    COINES_SIM_WAVEFORM_NOISE /*< offset + uniform noise in [-amplitude, amplitude] */
+};
+
+/*!
+ * @brief Data generator of the built-in simulated sensor.
+ *        A new sample is written to the data registers at every data ready event.
+ */
+struct coines_sim_generator
+{
+    enum coines_sim_waveform waveform; /*< Generated waveform */
+    uint8_t data_reg; /*< First data register, channels are int16 little endian */
+    uint8_t channels; /*< Number of channels, 0 -> generator disabled */
+    int16_t offset; /*< Offset added to every channel */
+    int16_t amplitude; /*< Amplitude of the sine and noise waveforms */
+    uint32_t period_samples; /*< Period of the sine waveform in samples */
+    uint32_t seed; /*< Seed of the noise waveform */
+};
+
+/*!
+ * @brief Sensor behind the simulated board. Register addresses are the 8 bit address
+ *        (read bit of SPI stripped) or the byte address 2 * word of 16 bit SPI.
+ */
+struct coines_sim_sensor_model
+{
+    void *context; /*< Handed to the callbacks */
+    int16_t (*read)(void *context, uint16_t reg_addr, uint8_t *data, uint16_t count); /*< Register read */
+    int16_t (*write)(void *context, uint16_t reg_addr, const uint8_t *data, uint16_t count); /*< Register write */
+    void (*update)(void *context, uint64_t sample_idx); /*< Data ready event, may be NULL */
+};
+
+/*!
+ * @brief Configuration of the simulated Application Board
+ */
+struct coines_sim_config
+{
+    uint16_t shuttle_id; /*< Board information returned to coines_get_board_info() */
+    uint16_t hardware_id;
+    uint16_t software_id;
+    uint8_t board;
+    uint8_t i2c_addr; /*< I2C address the sensor answers to */
+    uint8_t cs_pin; /*< SPI chip select the sensor answers to (enum coines_multi_io_pin) */
+    uint32_t data_ready_hz; /*< Sensor data rate, also the interrupt streaming rate */
+    uint32_t time_scale; /*< Simulated time runs this many times faster than the host, 0 -> 1 */
+    uint32_t response_delay_us; /*< Board turnaround added to every command response */
+    const uint8_t *reg_init; /*< COINES_SIM_REG_COUNT initial register values of the built-in sensor, NULL -> 0 */
+    struct coines_sim_generator generator; /*< Data generator of the built-in sensor */
+    const struct coines_sim_sensor_model *model; /*< Custom sensor, NULL -> built-in register map */
+};
+
+/*!
+ * @brief Statistics of the simulated board since the last coines_open_comm_intf()
+ */
+struct coines_sim_status
+{
+    uint32_t commands; /*< Commands received */
+    uint32_t unknown_commands; /*< Commands answered with an error because they are not simulated */
+    uint32_t sensor_errors; /*< Accesses to another address or chip select, or with VDDIO off */
+    uint32_t packets; /*< Response and stream packets sent */
+    uint32_t samples_streamed; /*< Stream samples sent */
+    uint32_t samples_dropped; /*< Stream samples lost because the host did not keep up */
+};
+#endif
+
 /**********************************************************************************/
 /* function prototype declarations */
 /**********************************************************************************/
@@ -575,6 +741,12 @@ int16_t coines_trigger_timer(enum coines_timer_config tmr_cfg, enum coines_time_
  * @return Time in milliseconds
  */
 uint32_t coines_get_millis();
+/*!
+ * @brief This API returns the number of microseconds passed since the program started
+ *
+ * @return Time in microseconds
+ */
+uint64_t coines_get_micros(void);
 /*!
  * @brief Attaches a interrupt to a Multi-IO pin
  *
@@ -596,6 +768,363 @@ void coines_attach_interrupt(enum coines_multi_io_pin pin_number,
  */
 void coines_detach_interrupt(enum coines_multi_io_pin pin_number);
 
+#if defined(MCU_APP20) || defined(MCU_APP30)
+/*!
+ * @brief Callback of a time stamped Multi-IO pin interrupt
+ *
+ * @param[in] pin_number : Multi-IO pin
+ * @param[in] timestamp_us : Time of the edge, on the coines_get_micros() time base
+ */
+typedef void (*coines_timed_isr_cb_t)(enum coines_multi_io_pin pin_number, uint64_t timestamp_us);
+/*!
+ * @brief Attaches a interrupt to a Multi-IO pin, passing the time of the edge to the callback
+ *
+ * On APP3.0 the edge captures the time in hardware (GPIOTE -> PPI -> TIMER) for up to 3 pins,
+ * independent of the interrupt latency. Further pins, and all pins on APP2.0, get the time the
+ * interrupt handler was entered. Use coines_detach_interrupt() to detach.
+ *
+ * @param[in] pin_number : Multi-IO pin
+ * @param[in] callback : Function to be called on detection of interrupt
+ * @param[in] int_mode : Trigger modes - change,rising edge,falling edge
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval Any non zero value -> Fail
+ */
+int16_t coines_attach_timed_interrupt(enum coines_multi_io_pin pin_number,
+                                      coines_timed_isr_cb_t callback,
+                                      enum coines_pin_interrupt_mode int_mode);
+
+/*!
+ * @brief Callback of a scheduled task
+ *
+ * @param[in] context : context given to coines_sched_start()
+ */
+typedef void (*coines_sched_cb_t)(void *context);
+
+/*!
+ * @brief Task of the cooperative scheduler, owned by the application (e.g. static)
+ *
+ * The fields are managed by the scheduler, the callback may read due_us and missed.
+ */
+struct coines_sched_task
+{
+    coines_sched_cb_t callback;
+    void *context;
+    uint32_t period_us;                 /*< 0 for a one-shot task */
+    uint64_t deadline;                  /*< Next run, coines_get_micros() time base */
+    uint64_t due_us;                    /*< Time the current run was due */
+    uint32_t missed;                    /*< Periodic runs skipped because the dispatcher was late */
+    struct coines_sched_task *next;
+    uint8_t active;
+};
+
+/*!
+ * @brief Schedules a task, or reschedules it if it is already scheduled
+ *
+ * May be called from interrupt handlers, the callback always runs from coines_sched_dispatch().
+ *
+ * @param[in] task : task
+ * @param[in] delay_us : time until the first run
+ * @param[in] period_us : period of the following runs, 0 to run once
+ * @param[in] callback : function to run
+ * @param[in] context : passed to the callback
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval Any non zero value -> Fail
+ */
+int16_t coines_sched_start(struct coines_sched_task *task,
+                           uint32_t delay_us,
+                           uint32_t period_us,
+                           coines_sched_cb_t callback,
+                           void *context);
+
+/*!
+ * @brief Removes a task from the scheduler
+ *
+ * @param[in] task : task
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval Any non zero value -> Fail
+ */
+int16_t coines_sched_stop(struct coines_sched_task *task);
+
+/*!
+ * @brief Runs the due tasks, then sleeps (WFE) until the next deadline or any interrupt
+ *
+ * Call it in the main loop. Periodic tasks keep their period grid, runs missed while the
+ * dispatcher was late are skipped and counted.
+ */
+void coines_sched_dispatch(void);
+#endif
+
+#if defined(PC)
+/*!
+ * @brief This API is used to configure the real-time tuning of the host communication threads.
+ *
+ * The configuration takes effect on the next coines_open_comm_intf(). Tunings which the OS
+ * rejects (Eg: missing CAP_SYS_NICE or RLIMIT_MEMLOCK) are skipped and reported by
+ * coines_get_realtime_status(), the interface is opened regardless.
+ *
+ * @param[in] rt_config : real-time configuration
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval Any non zero value -> Fail
+ */
+int16_t coines_config_realtime(const struct coines_rt_config *rt_config);
+/*!
+ * @brief This API is used to get the real-time tuning applied by the last coines_open_comm_intf()
+ *
+ * @param[out] rt_status : requested and applied tunings
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval Any non zero value -> Fail
+ */
+int16_t coines_get_realtime_status(struct coines_rt_status *rt_status);
+/*!
+ * @brief This API starts capturing the raw command/response traffic with the board to a file.
+ *
+ * Commands and responses are recorded with nanosecond host timestamps. File I/O is done by a
+ * separate thread and never delays the communication.
+ *
+ * @param[in] file_path : capture file, overwritten if it exists
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval Any non zero value -> Fail
+ */
+int16_t coines_start_capture(const char *file_path);
+/*!
+ * @brief This API stops the traffic capture and flushes the capture file
+ *
+ * @param[out] status : capture statistics, can be NULL
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval Any non zero value -> Fail
+ */
+int16_t coines_stop_capture(struct coines_capture_status *status);
+/*!
+ * @brief This API makes the next coines_open_comm_intf() play back a capture instead of using the board.
+ *
+ * Each command sent is compared with the recorded one and the recorded responses are fed to the
+ * communication layer, so a session can be reproduced and benchmarked without hardware.
+ *
+ * @param[in] file_path : capture file, NULL to go back to the board
+ * @param[in] timing : pacing of the recorded responses
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval Any non zero value -> Fail
+ */
+int16_t coines_config_replay(const char *file_path, enum coines_replay_timing timing);
+/*!
+ * @brief This API gets the comparison between the commands sent and the played back capture
+ *
+ * @param[out] status : replay statistics
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval Any non zero value -> Fail
+ */
+int16_t coines_get_replay_status(struct coines_replay_status *status);
+/*!
+ * @brief This API replaces the board with an in-process simulated Application Board.
+ *        Must be called while the interface is closed and applies from the next
+ *        coines_open_comm_intf(). Replaces a configured capture replay.
+ *
+ * @param[in] config : board and sensor to simulate, NULL to go back to the board
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval Any non zero value -> Fail
+ */
+int16_t coines_config_simulation(const struct coines_sim_config *config);
+/*!
+ * @brief This API gets the statistics of the simulated board
+ *
+ * @param[out] status : simulation statistics
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval Any non zero value -> Fail
+ */
+int16_t coines_get_simulation_status(struct coines_sim_status *status);
+/*!
+ * @brief This API writes the hot path trace recorded so far as Chrome trace_event JSON
+ *        (chrome://tracing, Perfetto). Trace points exist only when the library is built
+ *        with COINES_TRACE, otherwise COINES_E_NOT_SUPPORTED is returned.
+ *
+ * @param[in] file_path : output file
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval Any non zero value -> Fail
+ */
+int16_t coines_export_trace(const char *file_path);
+/*!
+ * @brief This API discards the hot path trace recorded so far
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval Any non zero value -> Fail
+ */
+int16_t coines_reset_trace(void);
+#endif
+
+#if defined(MCU_APP30)
+/*!
+ * @brief Completion callback of an asynchronous sensor bus transfer
+ *
+ * Called from interrupt context. A new transfer can be started from the callback.
+ *
+ * @param[in] result : COINES_SUCCESS or COINES_E_COMM_IO_ERROR
+ * @param[in] context : context passed when the transfer was started
+ */
+typedef void (*coines_xfer_callback_t)(int16_t result, void *context);
+/*!
+ * @brief Sensor bus transfer, see coines_queue_xfer()
+ */
+struct coines_bus_xfer
+{
+    enum coines_sensor_intf intf; /*< Sensor Interface */
+    uint8_t dev_addr; /*< I2C device address or SPI chip select pin (Multi-IO) */
+    uint8_t reg_addr; /*< Register address */
+    uint8_t *reg_data; /*< Data, has to stay valid until the callback */
+    uint16_t count; /*< Number of bytes */
+    uint8_t write; /*< 1 - write, 0 - read */
+    coines_xfer_callback_t callback; /*< Called on completion, can be NULL */
+    void *context; /*< Passed to callback */
+};
+/*!
+ * @brief This API queues a transfer on the shared SPI/I2C sensor bus.
+ *
+ * Transfers are executed back-to-back by EasyDMA in queue order, switching the bus between
+ * SPI and I2C as needed. Transfers queued from interrupt handlers (Eg: coines_attach_interrupt()
+ * callbacks) go ahead of those queued from the main loop.
+ * The descriptor is copied, the data buffer is not.
+ *
+ * @param[in] xfer : Transfer to queue
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval Any non zero value -> Fail (Eg: queue full, bus not configured, streaming active)
+ */
+int16_t coines_queue_xfer(const struct coines_bus_xfer *xfer);
+/*!
+ * @brief This API queues an I2C register write without waiting for its completion.
+ *
+ * The data is sent by EasyDMA from reg_data, which has to stay valid until the transfer completes.
+ * Data outside RAM (Eg: const arrays in flash) is staged through an internal buffer.
+ *
+ * @param[in] dev_addr : Device address for I2C write
+ * @param[in] reg_addr : Starting address for writing the data
+ * @param[in] reg_data : Data to be written
+ * @param[in] count : Number of bytes to write
+ * @param[in] callback : Called on completion, can be NULL
+ * @param[in] context : Passed to callback
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval Any non zero value -> Fail (Eg: queue full)
+ */
+int16_t coines_write_i2c_async(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data, uint16_t count,
+                               coines_xfer_callback_t callback, void *context);
+/*!
+ * @brief This API queues an I2C register read without waiting for its completion.
+ *
+ * The data is received by EasyDMA directly into reg_data (RAM only).
+ *
+ * @param[in] dev_addr : Device address for I2C read
+ * @param[in] reg_addr : Starting address for reading the data
+ * @param[out] reg_data : Data read from the sensor
+ * @param[in] count : Number of bytes to read
+ * @param[in] callback : Called on completion, can be NULL
+ * @param[in] context : Passed to callback
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval Any non zero value -> Fail (Eg: queue full)
+ */
+int16_t coines_read_i2c_async(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data, uint16_t count,
+                              coines_xfer_callback_t callback, void *context);
+/*!
+ * @brief This API queues an SPI register write without waiting for its completion.
+ *
+ * The register address and the data are sent by two EasyDMA transfers with chip select held low.
+ * Data outside RAM (Eg: const arrays in flash) is staged through an internal buffer.
+ *
+ * @param[in] dev_addr : Chip select pin (Multi-IO)
+ * @param[in] reg_addr : Starting address for writing the data
+ * @param[in] reg_data : Data to be written
+ * @param[in] count : Number of bytes to write
+ * @param[in] callback : Called on completion, can be NULL
+ * @param[in] context : Passed to callback
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval Any non zero value -> Fail (Eg: queue full)
+ */
+int16_t coines_write_spi_async(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data, uint16_t count,
+                               coines_xfer_callback_t callback, void *context);
+/*!
+ * @brief This API queues an SPI register read without waiting for its completion.
+ *
+ * The register address is sent and the data received directly into reg_data (RAM only)
+ * by two EasyDMA transfers with chip select held low.
+ *
+ * @param[in] dev_addr : Chip select pin (Multi-IO)
+ * @param[in] reg_addr : Starting address for reading the data
+ * @param[out] reg_data : Data read from the sensor
+ * @param[in] count : Number of bytes to read
+ * @param[in] callback : Called on completion, can be NULL
+ * @param[in] context : Passed to callback
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval Any non zero value -> Fail (Eg: queue full)
+ */
+int16_t coines_read_spi_async(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data, uint16_t count,
+                              coines_xfer_callback_t callback, void *context);
+/*!
+ * @brief This API tells whether sensor bus transfers are in progress or queued
+ *
+ * @return 1 while transfers are in progress or queued, 0 otherwise
+ */
+uint8_t coines_is_xfer_busy(void);
+/*!
+ * @brief This API waits (in low power) for the queued sensor bus transfers to complete
+ *
+ * @return Result of the last transfer
+ * @retval 0 -> Success
+ * @retval Any non zero value -> Fail
+ */
+int16_t coines_wait_xfer(void);
+/*!
+ * @brief This API returns the number of bytes received on USB serial (stdin) and not read yet
+ *
+ * Reading stdin blocks only while nothing is buffered, poll this API to never block.
+ *
+ * @return Number of buffered bytes
+ */
+uint16_t coines_serial_rx_available(void);
+/*!
+ * @brief This API waits until the buffered USB serial output (stdout, stderr) has been sent
+ *
+ * Output is buffered and sent in the background, call fflush(stdout) first to empty the
+ * C library buffer.
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval Any non zero value -> Fail, the port was closed or the API was called from an interrupt handler
+ */
+int16_t coines_flush_serial(void);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,217 @@
+/**
+ * Copyright (C) 2019 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    coines_log.h
+ * @brief   Binary logging with deferred formatting for the MCU targets
+ *
+ * COINES_LOG() takes a printf format string and up to 8 arguments, but formats nothing on the
+ * board. The format string is placed in the `.coines_log` ELF section, which is not loaded,
+ * and only its offset in that section (the format ID), a time stamp and the raw arguments are
+ * sent. The host decoder (util/coines_log_decode) reads the format strings from the ELF file
+ * and prints the text.
+ *
+ * Record layout, little endian:
+ *
+ *  Offset | Size | Content
+ *  -------|------|---------------------------------------------------------
+ *  0      | 1    | COINES_LOG_SYNC
+ *  1      | 1    | Size of the arguments in bytes
+ *  2      | 2    | Format ID
+ *  4      | 4    | Time stamp, lower 32 bits of coines_get_micros()
+ *  8      | 1    | Argument sizes, bit i is set if argument i takes 8 bytes
+ *  9      | n    | Arguments: float and double as float (4 bytes), 64 bit integers as
+ *         |      | 8 bytes, other integers as 4 bytes
+ *
+ * The size of an argument comes from its type, not from the format string: `%d` of an
+ * int64_t and `%lld` of an int are both fine, the decoder takes the size from the record and
+ * ignores the length modifiers (`hh`, `h`, `l`, `ll`, ...). Pointers and strings (`%s`, `%p`)
+ * cannot be logged.
+ *
+ */
+
+/*!
+ * @addtogroup coines_log_api
+ * @{*/
+
+#ifndef COINES_LOG_H_
+#define COINES_LOG_H_
+
+/* C++ Guard macro - To prevent name mangling by C++ compiler */
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**********************************************************************************/
+/* header includes */
+/**********************************************************************************/
+#include <stdint.h>
+#include <string.h>
+#include "coines.h"
+
+/**********************************************************************************/
+/* macro definitions */
+/**********************************************************************************/
+/*! First byte of a log record */
+#define COINES_LOG_SYNC                 0xA5
+/*! Size of the record header */
+#define COINES_LOG_HEADER_SIZE          9
+/*! Maximum number of arguments of COINES_LOG() */
+#define COINES_LOG_MAX_ARGS             8
+/*! Maximum size of a record */
+#define COINES_LOG_MAX_RECORD_SIZE      (COINES_LOG_HEADER_SIZE + (COINES_LOG_MAX_ARGS * 8))
+
+/*!
+ * @brief Logs a message, the arguments are formatted on the host
+ *
+ * @param[in] fmt : printf format string literal
+ * @param[in] ... : up to COINES_LOG_MAX_ARGS integer or floating point arguments
+ */
+#define COINES_LOG(fmt, ...) \
+    do \
+    { \
+        static const char coines_log_fmt_[] __attribute__((section(".coines_log"), used)) = fmt; \
+        coines_log_record_t coines_log_rec_; \
+        coines_log_begin(&coines_log_rec_, coines_log_fmt_); \
+        COINES_LOG_EACH_(COINES_LOG_PUT_, ## __VA_ARGS__) \
+        coines_log_end(&coines_log_rec_); \
+    } while (0)
+
+/* Argument packing, the type of each argument is resolved at compile time */
+#define COINES_LOG_PUT_(x) \
+    __builtin_choose_expr(__builtin_classify_type(x) == 8, \
+                          coines_log_put_f32(&coines_log_rec_, (float)(x)), \
+                          __builtin_choose_expr(sizeof(x) > 4, \
+                                                coines_log_put_u64(&coines_log_rec_, (uint64_t)(x)), \
+                                                coines_log_put_u32(&coines_log_rec_, (uint32_t)(x))));
+
+#define COINES_LOG_CAT_(a, b)           COINES_LOG_CAT2_(a, b)
+#define COINES_LOG_CAT2_(a, b)          a ## b
+#define COINES_LOG_NARGS_(m, ...)       COINES_LOG_NARGS2_(m, ## __VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define COINES_LOG_NARGS2_(_0, _1, _2, _3, _4, _5, _6, _7, _8, n, ...) n
+#define COINES_LOG_EACH_(m, ...)        COINES_LOG_CAT_(COINES_LOG_EACH_, COINES_LOG_NARGS_(m, ## __VA_ARGS__))(m, ## __VA_ARGS__)
+#define COINES_LOG_EACH_0(m)
+#define COINES_LOG_EACH_1(m, a)         m(a)
+#define COINES_LOG_EACH_2(m, a, ...)    m(a) COINES_LOG_EACH_1(m, __VA_ARGS__)
+#define COINES_LOG_EACH_3(m, a, ...)    m(a) COINES_LOG_EACH_2(m, __VA_ARGS__)
+#define COINES_LOG_EACH_4(m, a, ...)    m(a) COINES_LOG_EACH_3(m, __VA_ARGS__)
+#define COINES_LOG_EACH_5(m, a, ...)    m(a) COINES_LOG_EACH_4(m, __VA_ARGS__)
+#define COINES_LOG_EACH_6(m, a, ...)    m(a) COINES_LOG_EACH_5(m, __VA_ARGS__)
+#define COINES_LOG_EACH_7(m, a, ...)    m(a) COINES_LOG_EACH_6(m, __VA_ARGS__)
+#define COINES_LOG_EACH_8(m, a, ...)    m(a) COINES_LOG_EACH_7(m, __VA_ARGS__)
+
+/**********************************************************************************/
+/* data structure declarations */
+/**********************************************************************************/
+
+/*!
+ * @brief Destination of the log records
+ */
+enum coines_log_sink {
+    COINES_LOG_SINK_SERIAL = 0, /*< USB serial port, mixed with printf output */
+    COINES_LOG_SINK_FILE = 1    /*< File on the board flash (APP3.0) */
+};
+
+/*!
+ * @brief Log record under construction
+ */
+typedef struct
+{
+    uint8_t data[COINES_LOG_MAX_RECORD_SIZE];
+    uint8_t len;
+    uint8_t args;
+} coines_log_record_t;
+
+/**********************************************************************************/
+/* function declarations */
+/**********************************************************************************/
+/*!
+ * @brief This API selects where the log records go, the serial port by default
+ *
+ * While logging to a file, a task of coines_sched_dispatch() erases flash blocks in idle time.
+ *
+ * @param[in] sink : destination
+ * @param[in] file_name : log file, for COINES_LOG_SINK_FILE
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval Any non zero value -> Fail
+ */
+int16_t coines_log_config(enum coines_log_sink sink, const char *file_name);
+
+/*!
+ * @brief This API sends a complete log record to the selected sink
+ *
+ * Records are never split. When the sink cannot take a record in an interrupt handler, the
+ * record is dropped.
+ *
+ * @param[in] record : record
+ * @param[in] len : record size
+ */
+void coines_log_write(const void *record, uint16_t len);
+
+/*!
+ * @brief Starts a record
+ */
+static inline void coines_log_begin(coines_log_record_t *rec, const char *fmt)
+{
+    uint16_t id = (uint16_t)(uintptr_t)fmt;
+    uint32_t timestamp = (uint32_t)coines_get_micros();
+
+    rec->data[0] = COINES_LOG_SYNC;
+    memcpy(&rec->data[2], &id, 2);
+    memcpy(&rec->data[4], &timestamp, 4);
+    rec->data[8] = 0;
+    rec->len = COINES_LOG_HEADER_SIZE;
+    rec->args = 0;
+}
+
+/*!
+ * @brief Appends a 32 bit integer argument
+ */
+static inline void coines_log_put_u32(coines_log_record_t *rec, uint32_t value)
+{
+    memcpy(&rec->data[rec->len], &value, 4);
+    rec->len += 4;
+    rec->args++;
+}
+
+/*!
+ * @brief Appends a 64 bit integer argument
+ */
+static inline void coines_log_put_u64(coines_log_record_t *rec, uint64_t value)
+{
+    memcpy(&rec->data[rec->len], &value, 8);
+    rec->len += 8;
+    rec->data[8] |= (uint8_t)(1u << rec->args);
+    rec->args++;
+}
+
+/*!
+ * @brief Appends a floating point argument
+ */
+static inline void coines_log_put_f32(coines_log_record_t *rec, float value)
+{
+    memcpy(&rec->data[rec->len], &value, 4);
+    rec->len += 4;
+    rec->args++;
+}
+
+/*!
+ * @brief Completes the record and sends it
+ */
+static inline void coines_log_end(coines_log_record_t *rec)
+{
+    rec->data[1] = (uint8_t)(rec->len - COINES_LOG_HEADER_SIZE);
+    coines_log_write(rec->data, rec->len);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COINES_LOG_H_ */
+
+/** @}*/
@@ -0,0 +1,129 @@
+/**
+ * Copyright (C) 2019 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    coines_profile.c
+ * @brief   Cycle counting profiling zones for the MCU targets, shared by APP2.0 and APP3.0
+ *
+ */
+
+/*!
+ * @defgroup coines_profile_api coines_profile
+ * @{*/
+
+/**********************************************************************************/
+/* system header includes */
+/**********************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+/**********************************************************************************/
+/* own header files */
+/**********************************************************************************/
+#include "coines_profile.h"
+
+/**********************************************************************************/
+/* global variables */
+/**********************************************************************************/
+/*! Core clock, from the CMSIS system file of the target */
+extern uint32_t SystemCoreClock;
+
+/**********************************************************************************/
+/* static variables */
+/**********************************************************************************/
+static coines_profile_zone_t *zone_list = NULL;
+static coines_profile_zone_t *zone_last = NULL;
+static uint32_t zone_overhead = 0;
+
+/**********************************************************************************/
+/* functions */
+/**********************************************************************************/
+
+/*!
+ * @brief This function clears the statistics of a zone
+ */
+static void zone_clear(coines_profile_zone_t *zone)
+{
+    zone->count = 0;
+    zone->min = UINT32_MAX;
+    zone->max = 0;
+    zone->sum = 0;
+    memset(zone->hist, 0, sizeof(zone->hist));
+}
+
+/*!
+ * @brief This API starts the DWT cycle counter
+ */
+void coines_profile_init(void)
+{
+    uint32_t start;
+
+    COINES_PROFILE_DEMCR |= COINES_PROFILE_DEMCR_TRCENA;
+    COINES_PROFILE_DWT_CYCCNT = 0;
+    COINES_PROFILE_DWT_CTRL |= COINES_PROFILE_DWT_CYCCNTENA;
+
+    /* Cycles counted by an empty zone */
+    start = COINES_PROFILE_DWT_CYCCNT;
+    zone_overhead = COINES_PROFILE_DWT_CYCCNT - start;
+}
+
+/*!
+ * @brief This API adds a zone to the dump
+ */
+void coines_profile_register(coines_profile_zone_t *zone)
+{
+    zone_clear(zone);
+    zone->next = NULL;
+    zone->registered = 1;
+
+    if (zone_last == NULL)
+        zone_list = zone;
+    else
+        zone_last->next = zone;
+    zone_last = zone;
+}
+
+/*!
+ * @brief This API clears the statistics of all zones
+ */
+void coines_profile_reset(void)
+{
+    coines_profile_zone_t *zone;
+
+    for (zone = zone_list; zone != NULL; zone = zone->next)
+    {
+        zone_clear(zone);
+    }
+}
+
+/*!
+ * @brief This API prints the statistics of all zones on stdout
+ *
+ * One line per zone: tag, count, min, max, mean (cycles) and the histogram bins.
+ */
+void coines_profile_dump(void)
+{
+    coines_profile_zone_t *zone;
+    uint32_t bin;
+
+    printf("coines_profile begin %lu %u %lu\r\n", (unsigned long)SystemCoreClock, COINES_PROFILE_HIST_BINS,
+           (unsigned long)zone_overhead);
+
+    for (zone = zone_list; zone != NULL; zone = zone->next)
+    {
+        printf("coines_profile zone %s %lu %lu %lu %lu", zone->tag, (unsigned long)zone->count,
+               (unsigned long)(zone->count ? zone->min : 0), (unsigned long)zone->max,
+               (unsigned long)(zone->count ? (zone->sum / zone->count) : 0));
+        for (bin = 0; bin < COINES_PROFILE_HIST_BINS; bin++)
+        {
+            printf(" %lu", (unsigned long)zone->hist[bin]);
+        }
+        printf("\r\n");
+    }
+
+    printf("coines_profile end\r\n");
+    fflush(stdout);
+}
+
+/** @}*/
@@ -0,0 +1,157 @@
+/**
+ * Copyright (C) 2019 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    coines_profile.h
+ * @brief   Cycle counting profiling zones for the MCU targets
+ *
+ * A zone measures the CPU cycles between COINES_PROFILE_BEGIN(tag) and COINES_PROFILE_END(tag)
+ * with the Cortex-M4 DWT cycle counter, which is started by coines_open_comm_intf().
+ * Each zone keeps count, min, max, mean and a histogram of power of 2 cycle ranges in RAM,
+ * coines_profile_dump() prints them on the USB serial port for util/coines_profile.
+ *
+ * @code
+ * COINES_PROFILE_BEGIN(fifo_read);
+ * coines_read_spi(cs, reg, data, len);
+ * COINES_PROFILE_END(fifo_read);
+ * @endcode
+ *
+ * BEGIN and END of a tag must be in the same block. A zone must not be entered from the main
+ * loop and from interrupt handlers at the same time. Build with COINES_PROFILE_ENABLED=0 to
+ * remove all zones.
+ *
+ */
+
+/*!
+ * @addtogroup coines_profile_api
+ * @{*/
+
+#ifndef COINES_PROFILE_H_
+#define COINES_PROFILE_H_
+
+/* C++ Guard macro - To prevent name mangling by C++ compiler */
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**********************************************************************************/
+/* header includes */
+/**********************************************************************************/
+#include <stdint.h>
+
+/**********************************************************************************/
+/* macro definitions */
+/**********************************************************************************/
+#ifndef COINES_PROFILE_ENABLED
+#define COINES_PROFILE_ENABLED          1
+#endif
+
+/*! Histogram bins, bin n counts durations of 2^n to 2^(n+1)-1 cycles, the last bin all longer ones */
+#define COINES_PROFILE_HIST_BINS        24
+
+/*! ARMv7-M debug registers */
+#define COINES_PROFILE_DEMCR            (*(volatile uint32_t *)0xE000EDFCu)
+#define COINES_PROFILE_DEMCR_TRCENA     (1u << 24)
+#define COINES_PROFILE_DWT_CTRL         (*(volatile uint32_t *)0xE0001000u)
+#define COINES_PROFILE_DWT_CYCCNTENA    (1u << 0)
+#define COINES_PROFILE_DWT_CYCCNT       (*(volatile uint32_t *)0xE0001004u)
+
+#if COINES_PROFILE_ENABLED
+/*!
+ * @brief Starts a profiling zone
+ *
+ * @param[in] tag : zone name, a C identifier
+ */
+#define COINES_PROFILE_BEGIN(tag) \
+    static coines_profile_zone_t coines_profile_zone_ ## tag = { #tag }; \
+    uint32_t coines_profile_start_ ## tag = COINES_PROFILE_DWT_CYCCNT
+
+/*!
+ * @brief Ends a profiling zone
+ *
+ * @param[in] tag : zone name given to COINES_PROFILE_BEGIN()
+ */
+#define COINES_PROFILE_END(tag) \
+    coines_profile_record(&coines_profile_zone_ ## tag, COINES_PROFILE_DWT_CYCCNT - coines_profile_start_ ## tag)
+#else
+#define COINES_PROFILE_BEGIN(tag)       do {} while (0)
+#define COINES_PROFILE_END(tag)         do {} while (0)
+#endif
+
+/**********************************************************************************/
+/* data structure declarations */
+/**********************************************************************************/
+
+/*!
+ * @brief Statistics of a profiling zone
+ */
+typedef struct coines_profile_zone
+{
+    const char *tag;
+    struct coines_profile_zone *next;       /* Registered zones, in order of first use */
+    uint8_t registered;
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t hist[COINES_PROFILE_HIST_BINS];
+} coines_profile_zone_t;
+
+/**********************************************************************************/
+/* function declarations */
+/**********************************************************************************/
+/*!
+ * @brief This API starts the DWT cycle counter, called by coines_open_comm_intf()
+ */
+void coines_profile_init(void);
+
+/*!
+ * @brief This API clears the statistics of all zones
+ */
+void coines_profile_reset(void);
+
+/*!
+ * @brief This API prints the statistics of all zones on stdout
+ *
+ * The block starts with a "coines_profile begin" line and ends with "coines_profile end".
+ */
+void coines_profile_dump(void);
+
+/*!
+ * @brief This API adds a zone to the dump, done at its first use
+ *
+ * @param[in] zone : zone
+ */
+void coines_profile_register(coines_profile_zone_t *zone);
+
+/*!
+ * @brief Adds a measurement to a zone
+ */
+static inline void coines_profile_record(coines_profile_zone_t *zone, uint32_t cycles)
+{
+    uint32_t bin = 31 - (uint32_t)__builtin_clz(cycles | 1);
+
+    if (!zone->registered)
+        coines_profile_register(zone);
+
+    if (bin >= COINES_PROFILE_HIST_BINS)
+        bin = COINES_PROFILE_HIST_BINS - 1;
+
+    zone->count++;
+    zone->sum += cycles;
+    if (cycles < zone->min)
+        zone->min = cycles;
+    if (cycles > zone->max)
+        zone->max = cycles;
+    zone->hist[bin]++;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COINES_PROFILE_H_ */
+
+/** @}*/
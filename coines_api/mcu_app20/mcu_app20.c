@@ -14,6 +14,8 @@
 /**********************************************************************************/
 #include <stddef.h>
 #include "coines.h"
+#include "coines_log.h"
+#include "coines_profile.h"
 #include "mcu_app20.h"
 
 /**********************************************************************************/
@@ -23,9 +25,18 @@ uint32_t serial_connected = false;
 uint32_t baud_rate = 0;
 uint32_t g_millis = 0;
 
+/*! Upper 32 bits of the millisecond counter, incremented when g_millis wraps */
+static volatile uint32_t g_millis_wraps = 0;
+
 typedef void (*ISR_CB)(void);
 
 static ISR_CB isr_cb[9];
+static coines_timed_isr_cb_t isr_timed_cb[9];
+static enum coines_multi_io_pin isr_pin[9];
+
+/*! Scheduled tasks, by deadline */
+static struct coines_sched_task *sched_head = NULL;
+static bool sched_timer_ready = false;
 
 /**********************************************************************************/
 /* static function declaration */
@@ -39,6 +50,11 @@ static ISR_CB isr_cb[9];
  * @return      : None
  */
 static void pioHandler(uint32_t id, uint32_t index);
+static void pin_isr_attach(enum coines_multi_io_pin pin_number, void (*callback)(void),
+		coines_timed_isr_cb_t timed_callback, enum coines_pin_interrupt_mode int_mode);
+static void sched_insert(struct coines_sched_task *task);
+static void sched_remove(struct coines_sched_task *task);
+static bool sched_arm(uint64_t deadline);
 
 /**********************************************************************************/
 /* functions */
@@ -145,6 +161,9 @@ int16_t coines_open_comm_intf(enum coines_comm_intf intf_type)
     /*For coines_get_millis() API*/
     SysTick_Config(sysclk_get_peripheral_hz()/1000);
 
+    /*For COINES_PROFILE_BEGIN/END() zones*/
+    coines_profile_init();
+
     sysclk_enable_peripheral_clock(ID_PIOA);
     sysclk_enable_peripheral_clock(ID_PIOB);
     sysclk_enable_peripheral_clock(ID_PIOC);
@@ -294,6 +313,10 @@ int16_t coines_config_spi_bus(enum coines_spi_bus bus, enum coines_spi_speed spi
     struct spi_device device;
     device.id = 0;
 
+    /* The SPI clock is the peripheral clock divided by spi_speed, 32 and 16 MHz are APP3.0 only */
+    if ((spi_speed == COINES_SPI_SPEED_32_MHZ) || (spi_speed == COINES_SPI_SPEED_16_MHZ))
+        return COINES_E_NOT_SUPPORTED;
+
     sysclk_enable_peripheral_clock(ID_SPI);
     sysclk_disable_peripheral_clock(ID_TWI0);
 
@@ -526,16 +549,43 @@ uint32_t coines_get_millis()
 {
     return g_millis;
 }
+
 /*!
- * @brief This API attaches a interrupt to a Multi-IO pin
+ * @brief This API returns the number of microseconds passed since the board was opened
  *
+ * SysTick has no capture, the sub millisecond part is taken from the SysTick down counter.
  */
-void coines_attach_interrupt(enum coines_multi_io_pin pin_number,
-		void (*callback)(void), enum coines_pin_interrupt_mode int_mode)
+uint64_t coines_get_micros(void)
+{
+    uint32_t ms, wraps, val, load;
+    irqflags_t flags;
+
+    flags = cpu_irq_save();
+    load = SysTick->LOAD;
+    ms = g_millis;
+    wraps = g_millis_wraps;
+    val = SysTick->VAL;
+    /* The counter reloaded but SysTick_Handler did not run yet */
+    if ((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) && (val > load / 2))
+    {
+        if (++ms == 0)
+            wraps++;
+    }
+    cpu_irq_restore(flags);
+
+    return ((((uint64_t)wraps << 32) | ms) * 1000) + (((uint64_t)(load - val) * 1000) / (load + 1));
+}
+
+/*!
+ * @brief This function configures the PIO interrupt of a Multi-IO pin
+ */
+static void pin_isr_attach(enum coines_multi_io_pin pin_number, void (*callback)(void),
+		coines_timed_isr_cb_t timed_callback, enum coines_pin_interrupt_mode int_mode)
 {
     uint32_t mcu_int_mode = 0;
+    uint32_t idx = get_hw_pin(pin_number) - PIO_PC0_IDX;
 
-    pio_set_input(PIOC, get_hw_pin(pin_number) - PIO_PC0_IDX, PIO_INPUT);
+    pio_set_input(PIOC, idx, PIO_INPUT);
 
     if (int_mode == COINES_PIN_INTERRUPT_CHANGE)
         mcu_int_mode = (PIO_IT_FALL_EDGE) & ~(PIO_IT_AIME);
@@ -544,13 +594,40 @@ void coines_attach_interrupt(enum coines_multi_io_pin pin_number,
     if (int_mode == COINES_PIN_INTERRUPT_FALLING_EDGE)
         mcu_int_mode = PIO_IT_FALL_EDGE;
 
-    pio_handler_set(PIOC, ID_PIOC, 1 << (get_hw_pin(pin_number) - PIO_PC0_IDX), mcu_int_mode, pioHandler);
-    isr_cb[get_hw_pin(pin_number) - PIO_PC0_IDX] = callback;
+    pio_handler_set(PIOC, ID_PIOC, 1 << idx, mcu_int_mode, pioHandler);
+    isr_cb[idx] = callback;
+    isr_timed_cb[idx] = timed_callback;
+    isr_pin[idx] = pin_number;
     pio_enable_pin_interrupt(get_hw_pin(pin_number));
 
     NVIC_EnableIRQ(PIOC_IRQn);
 }
 
+/*!
+ * @brief This API attaches a interrupt to a Multi-IO pin
+ *
+ */
+void coines_attach_interrupt(enum coines_multi_io_pin pin_number,
+		void (*callback)(void), enum coines_pin_interrupt_mode int_mode)
+{
+    pin_isr_attach(pin_number, callback, NULL, int_mode);
+}
+
+/*!
+ * @brief This API attaches a interrupt to a Multi-IO pin, the callback gets the event time stamp
+ *
+ */
+int16_t coines_attach_timed_interrupt(enum coines_multi_io_pin pin_number,
+		coines_timed_isr_cb_t callback, enum coines_pin_interrupt_mode int_mode)
+{
+    if (callback == NULL)
+        return COINES_E_NULL_PTR;
+
+    pin_isr_attach(pin_number, NULL, callback, int_mode);
+
+    return COINES_SUCCESS;
+}
+
 /*!
  *
  * @brief	This API detaches a interrupt from a Multi-IO pin
@@ -558,7 +635,11 @@ void coines_attach_interrupt(enum coines_multi_io_pin pin_number,
  */
 void coines_detach_interrupt(enum coines_multi_io_pin pin_number)
 {
+    uint32_t idx = get_hw_pin(pin_number) - PIO_PC0_IDX;
+
     pio_disable_pin_interrupt(get_hw_pin(pin_number));
+    isr_cb[idx] = NULL;
+    isr_timed_cb[idx] = NULL;
 }
 
 /*!
@@ -568,18 +649,257 @@ void coines_detach_interrupt(enum coines_multi_io_pin pin_number)
 static void pioHandler(uint32_t id, uint32_t index)
 {
     int i = 0;
+    uint64_t timestamp;
+
     if (id == ID_PIOC)
+    {
+        /* Taken once at handler entry, shared by all pins of this event */
+        timestamp = coines_get_micros();
         for (i = 0; i < 9; i++)
         {
-            if (index & (1 << i))
+            if (!(index & (1 << i)))
+                continue;
+            if (isr_timed_cb[i] != NULL)
+                isr_timed_cb[i](isr_pin[i], timestamp);
+            else if (isr_cb[i] != NULL)
                 isr_cb[i]();
         }
+    }
+}
+
+/*!
+ * @brief This function inserts a task in the list, after the tasks with the same deadline
+ *
+ * Called with interrupts disabled.
+ */
+static void sched_insert(struct coines_sched_task *task)
+{
+    struct coines_sched_task **link = &sched_head;
+
+    while ((*link != NULL) && ((*link)->deadline <= task->deadline))
+    {
+        link = &(*link)->next;
+    }
+    task->next = *link;
+    *link = task;
+}
+
+/*!
+ * @brief This function removes a task from the list
+ *
+ * Called with interrupts disabled.
+ */
+static void sched_remove(struct coines_sched_task *task)
+{
+    struct coines_sched_task **link = &sched_head;
+
+    while (*link != NULL)
+    {
+        if (*link == task)
+        {
+            *link = task->next;
+            break;
+        }
+        link = &(*link)->next;
+    }
+}
+
+/*!
+ * @brief This function starts the TC0 channel 0 one shot wake up timer, clocked by MCK/32
+ */
+static void sched_timer_init(void)
+{
+    if (sched_timer_ready)
+        return;
+
+    pmc_enable_periph_clk(ID_TC0);
+    TC0->TC_CHANNEL[0].TC_CCR = TC_CCR_CLKDIS;
+    TC0->TC_CHANNEL[0].TC_CMR = TC_CMR_TCCLKS_TIMER_CLOCK3 | TC_CMR_WAVE | TC_CMR_WAVSEL_UP_RC | TC_CMR_CPCSTOP;
+    TC0->TC_CHANNEL[0].TC_IER = TC_IER_CPCS;
+    NVIC_EnableIRQ(TC0_IRQn);
+    sched_timer_ready = true;
+}
+
+/*!
+ * @brief This function starts the wake up timer for the next deadline
+ *
+ * The timer counts at most 0xFFFF ticks (35 ms), a later deadline is armed again at wake up.
+ *
+ * @return false if the deadline already passed
+ */
+static bool sched_arm(uint64_t deadline)
+{
+    uint64_t now = coines_get_micros();
+    uint64_t ticks;
+
+    if (deadline <= now)
+        return false;
+
+    ticks = (((deadline - now) * (sysclk_get_peripheral_hz() / 32)) + 999999) / 1000000;
+    if (ticks > 0xFFFF)
+        ticks = 0xFFFF;
+
+    TC0->TC_CHANNEL[0].TC_RC = (uint32_t)ticks;
+    TC0->TC_CHANNEL[0].TC_CCR = TC_CCR_CLKEN | TC_CCR_SWTRG;
+
+    return true;
+}
+
+/*!
+ * @brief This API schedules a task
+ */
+int16_t coines_sched_start(struct coines_sched_task *task,
+                           uint32_t delay_us,
+                           uint32_t period_us,
+                           coines_sched_cb_t callback,
+                           void *context)
+{
+    irqflags_t flags;
+
+    if ((task == NULL) || (callback == NULL))
+        return COINES_E_NULL_PTR;
+
+    sched_timer_init();
+
+    flags = cpu_irq_save();
+    if (task->active)
+        sched_remove(task);
+    task->callback = callback;
+    task->context = context;
+    task->period_us = period_us;
+    task->deadline = coines_get_micros() + delay_us;
+    task->due_us = task->deadline;
+    task->missed = 0;
+    task->active = 1;
+    sched_insert(task);
+    cpu_irq_restore(flags);
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This API removes a task from the scheduler
+ */
+int16_t coines_sched_stop(struct coines_sched_task *task)
+{
+    irqflags_t flags;
+
+    if (task == NULL)
+        return COINES_E_NULL_PTR;
+
+    flags = cpu_irq_save();
+    if (task->active)
+        sched_remove(task);
+    task->active = 0;
+    cpu_irq_restore(flags);
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This API runs the due tasks, then sleeps until the next deadline or any interrupt
+ */
+void coines_sched_dispatch(void)
+{
+    struct coines_sched_task *task;
+    coines_sched_cb_t callback = NULL;
+    void *context = NULL;
+    uint64_t now = coines_get_micros();
+    uint64_t late;
+    irqflags_t flags;
+    bool sleep;
+
+    do
+    {
+        flags = cpu_irq_save();
+        task = sched_head;
+        if ((task != NULL) && (task->deadline <= now))
+        {
+            sched_head = task->next;
+            task->due_us = task->deadline;
+            callback = task->callback;
+            context = task->context;
+            if (task->period_us != 0)
+            {
+                task->deadline += task->period_us;
+                if (task->deadline <= now)
+                {
+                    /* Keep the period grid, skip the runs missed */
+                    late = (now - task->deadline) / task->period_us + 1;
+                    task->deadline += late * task->period_us;
+                    task->missed += (uint32_t)late;
+                }
+                sched_insert(task);
+            }
+            else
+            {
+                task->active = 0;
+            }
+        }
+        else
+        {
+            task = NULL;
+        }
+        cpu_irq_restore(flags);
+
+        if (task != NULL)
+        {
+            callback(context);
+            now = coines_get_micros();
+        }
+    } while (task != NULL);
+
+    flags = cpu_irq_save();
+    sleep = (sched_head == NULL) || sched_arm(sched_head->deadline);
+    cpu_irq_restore(flags);
+
+    /* An interrupt after arming sets the event register, WFE then returns at once */
+    if (sleep)
+        __WFE();
 }
+
+/*!
+ * @brief This API selects where the log records go, only the serial port is supported
+ */
+int16_t coines_log_config(enum coines_log_sink sink, const char *file_name)
+{
+    if (sink != COINES_LOG_SINK_SERIAL)
+        return COINES_E_NOT_SUPPORTED;
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This API sends a complete log record to the USB serial port
+ */
+void coines_log_write(const void *record, uint16_t len)
+{
+    if (!serial_connected)
+        return;
+
+    /* udi_cdc_write_buf() waits for the USB interrupt, which cannot preempt a handler */
+    if ((__get_IPSR() != 0) && (udi_cdc_get_free_tx_buffer() < len))
+        return;
+
+    (void)udi_cdc_write_buf(record, len);
+}
+
 /*!
  *
  * @brief       : SysTick timer Handler
  */
 void SysTick_Handler(void)
 {
-    g_millis++;
+    if (++g_millis == 0)
+        g_millis_wraps++;
+}
+
+/*!
+ *
+ * @brief       : Scheduler wake up timer Handler
+ */
+void TC0_Handler(void)
+{
+    /* Reading the status clears the RC compare, coines_sched_dispatch() does the rest */
+    (void)TC0->TC_CHANNEL[0].TC_SR;
 }
@@ -8,6 +8,7 @@ ASF_DIR = xdk-asf-3.42.0
 
 C_SRCS_COINES += \
 mcu_app20.c \
+../coines_profile.c \
 $(ASF_DIR)/sam/utils/cmsis/sam4s/source/templates/system_sam4s.c \
 $(ASF_DIR)/sam/utils/cmsis/sam4s/source/templates/gcc/startup_sam4s.c \
 $(ASF_DIR)/sam/drivers/pmc/pmc.c \
@@ -11,13 +11,29 @@
 
 #include <stddef.h>
 #include "coines.h"
+#include "coines_log.h"
+#include "coines_profile.h"
 #include "mcu_app30.h"
 
 uint32_t serial_connected = false;
 uint32_t baud_rate = 0;
 uint32_t g_millis = 0;
 
-volatile bool tx_pending = false;
+/* USB serial rings, indices run free and are reduced modulo the ring size */
+static uint8_t cdc_tx_ring[CDC_TX_RING_SIZE];
+static volatile uint32_t cdc_tx_head = 0;           /* Written by _write() */
+static volatile uint32_t cdc_tx_tail = 0;           /* Advanced on TX done */
+static volatile uint32_t cdc_tx_inflight = 0;       /* Bytes handed to the CDC class, 0 when idle */
+static uint8_t cdc_rx_ring[CDC_RX_RING_SIZE];
+static volatile uint32_t cdc_rx_head = 0;           /* Advanced on RX done */
+static volatile uint32_t cdc_rx_tail = 0;           /* Advanced by _read() */
+static volatile bool cdc_rx_armed = false;
+static uint8_t cdc_rx_packet[NRF_DRV_USBD_EPSIZE];
+
+/* Binary log (coines_log.h) */
+static enum coines_log_sink log_sink = COINES_LOG_SINK_SERIAL;
+static flog_write_file_t log_file;
+static struct coines_sched_task log_gc_task;
 static uint32_t prev_millis = 0;
 
 uint8_t multi_io_map[24] = {
@@ -35,14 +51,67 @@ uint8_t multi_io_map[24] = {
 
 const nrfx_twim_t i2c_instance = NRFX_TWIM_INSTANCE(I2C_SEN_INSTANCE);
 static nrfx_twim_config_t i2c_config = NRFX_TWIM_DEFAULT_CONFIG;
-nrfx_twim_xfer_desc_t i2c_tx_desc;
+static bool i2c_bus_configured = false;
+static bool i2c_bus_ready = false;
 
 const nrfx_spim_t spi_instance = NRFX_SPIM_INSTANCE(SPI_INSTANCE);
+const nrfx_spim_t spi_hs_instance = NRFX_SPIM_INSTANCE(SPI_HS_INSTANCE);
 nrfx_spim_config_t spi_config = NRFX_SPIM_DEFAULT_CONFIG;
-nrfx_spim_xfer_desc_t spi_tx_desc;
+static nrfx_spim_t const *spi_bus = &spi_instance;  /* SPIM1, or SPIM3 above 8 MHz */
+static bool spi_bus_configured = false;
+static bool spi_bus_ready = false;
+static bool spi_hw_cs = false;                      /* Streaming transfers use the SPIM3 CSN */
+
+/* Sensor bus transaction queue, see coines_queue_xfer() */
+static struct coines_bus_xfer bus_queue[BUS_QUEUE_COUNT][BUS_QUEUE_SIZE];
+static volatile uint8_t bus_queue_head[BUS_QUEUE_COUNT];
+static volatile uint8_t bus_queue_tail[BUS_QUEUE_COUNT];
+static struct coines_bus_xfer bus_cur;      /* Transfer on the bus */
+static uint8_t bus_cur_queue;               /* Queue bus_cur was taken from */
+static volatile bool bus_busy = false;
+static volatile int16_t bus_result = COINES_SUCCESS;
+static uint8_t bus_reg_addr;                /* EasyDMA source of the register address */
+static uint32_t bus_cs_pin;
+static uint8_t *bus_data;                   /* SPI data phase still to transfer */
+static uint16_t bus_data_len;
+static bool bus_data_write;
+static bool bus_data_staged;
+static uint8_t bus_staging[BUS_STAGING_SIZE] __ALIGN(4);
 
 static nrfx_gpiote_in_config_t gpio_config = NRFX_GPIOTE_RAW_CONFIG_IN_SENSE_LOTOHI(true);
 
+const nrfx_timer_t micros_timer = NRFX_TIMER_INSTANCE(MICROS_TIMER_INSTANCE);
+static bool micros_ready = false;
+static volatile uint32_t micros_wraps = 0;
+static uint8_t micros_cc_used = 0;          /* Capture channels taken by pin interrupts */
+static struct coines_sched_task *sched_head = NULL; /* Scheduled tasks, by deadline */
+static pin_isr_t pin_isr[NUMBER_OF_PINS];
+
+const nrfx_timer_t stream_tick_timer = NRFX_TIMER_INSTANCE(STREAM_TICK_TIMER_INSTANCE);
+const nrfx_timer_t stream_ts_timer = NRFX_TIMER_INSTANCE(STREAM_TS_TIMER_INSTANCE);
+
+static stream_sensor_t stream_sensor[COINES_MAX_SENSOR_ID];
+static uint8_t stream_sensor_count = 0;
+static enum coines_streaming_mode stream_mode_cfg;
+static bool stream_active = false;
+static volatile bool stream_stopping = false;
+static bool stream_hw_trigger = false;  /* One transfer per sample, started by PPI */
+static bool stream_ts_enabled = false;  /* Time stamp appended to polling samples */
+static bool stream_timers_ready = false;
+static volatile uint32_t stream_ts_wraps = 0;
+static volatile uint32_t stream_pending = 0;
+static volatile bool stream_bus_busy = false;
+static uint8_t stream_cur_sensor;
+static uint8_t stream_cur_block;
+static bool stream_cur_ok;
+static nrf_ppi_channel_t stream_ppi[STREAM_MAX_PPI_CHANNELS];
+static uint8_t stream_ppi_count = 0;
+static nrf_ppi_channel_group_t stream_ppi_group;    /* Trigger channels, off from the end of a transfer until re-armed */
+static bool stream_ppi_group_ready = false;
+static volatile bool stream_rearm_failed = false;   /* The trigger interrupt retries the re-arm, see stream_rearm() */
+static uint8_t stream_buffer[STREAM_BUFFER_SIZE] __ALIGN(4);
+static uint8_t stream_scratch[STREAM_MAX_SAMPLE_SIZE] __ALIGN(4);
+
 flog_write_file_t write_file[MAX_FILE_DESCRIPTORS];
 flog_read_file_t  read_file[MAX_FILE_DESCRIPTORS];
 volatile bool fd_in_use[MAX_FILE_DESCRIPTORS]={},fd_rw[MAX_FILE_DESCRIPTORS]={};
@@ -134,6 +203,158 @@ static void usbd_user_ev_handler(app_usbd_event_type_t event)
             break;
     }
 }
+/*!
+ * @brief This function sends the largest contiguous block of the TX ring, if the CDC class is idle
+ */
+static void cdc_tx_kick(void)
+{
+    uint32_t idx, len;
+
+    CRITICAL_REGION_ENTER();
+    if ((cdc_tx_inflight == 0) && serial_connected && (cdc_tx_head != cdc_tx_tail))
+    {
+        idx = cdc_tx_tail % CDC_TX_RING_SIZE;
+        len = cdc_tx_head - cdc_tx_tail;
+        if (len > (CDC_TX_RING_SIZE - idx))
+            len = CDC_TX_RING_SIZE - idx;
+
+        /* Sent straight from the ring, the bytes stay untouched until TX done */
+        if (app_usbd_cdc_acm_write(&m_app_cdc_acm, &cdc_tx_ring[idx], len) == NRF_SUCCESS)
+            cdc_tx_inflight = len;
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+/*!
+ * @brief This function copies a received packet to the RX ring
+ */
+static void cdc_rx_store(size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        cdc_rx_ring[(cdc_rx_head + i) % CDC_RX_RING_SIZE] = cdc_rx_packet[i];
+    }
+    __DMB();
+    cdc_rx_head += len;
+}
+
+/*!
+ * @brief This function requests the next packet from the host while the RX ring can take it
+ *
+ * When the ring is full the endpoint is left unarmed, the host is then held off by NAK.
+ */
+static void cdc_rx_arm(void)
+{
+    ret_code_t ret;
+
+    CRITICAL_REGION_ENTER();
+    while (!cdc_rx_armed && serial_connected &&
+           ((CDC_RX_RING_SIZE - (cdc_rx_head - cdc_rx_tail)) >= NRF_DRV_USBD_EPSIZE))
+    {
+        ret = app_usbd_cdc_acm_read_any(&m_app_cdc_acm, cdc_rx_packet, NRF_DRV_USBD_EPSIZE);
+        if (ret == NRF_SUCCESS)
+            cdc_rx_store(app_usbd_cdc_acm_rx_size(&m_app_cdc_acm));
+        else if (ret == NRF_ERROR_IO_PENDING)
+            cdc_rx_armed = true;
+        else
+            break;
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+/*!
+ * @brief This function appends a block to the TX ring, entirely or not at all
+ *
+ * Interrupt handlers may print and log too, the ring is therefore filled with interrupts disabled.
+ */
+static bool cdc_tx_append(const uint8_t *data, uint32_t len)
+{
+    bool appended = false;
+    uint32_t idx, n;
+
+    CRITICAL_REGION_ENTER();
+    if ((CDC_TX_RING_SIZE - (cdc_tx_head - cdc_tx_tail)) >= len)
+    {
+        idx = cdc_tx_head % CDC_TX_RING_SIZE;
+        n = CDC_TX_RING_SIZE - idx;
+        if (n > len)
+            n = len;
+
+        memcpy(&cdc_tx_ring[idx], data, n);
+        memcpy(cdc_tx_ring, &data[n], len - n);
+        cdc_tx_head += len;
+        appended = true;
+    }
+    CRITICAL_REGION_EXIT();
+
+    return appended;
+}
+
+/*!
+ * @brief This function appends stdout data to the TX ring
+ *
+ * Waits only while the ring is full. In interrupt handlers, which the USB interrupt cannot
+ * preempt, the data not fitting in the ring is dropped.
+ */
+static int cdc_write(const uint8_t *data, int len)
+{
+    uint32_t done = 0;
+    uint32_t n;
+
+    while ((done < (uint32_t)len) && serial_connected)
+    {
+        /* Packet sized blocks keep the interrupts disabled only briefly */
+        n = (uint32_t)len - done;
+        if (n > NRF_DRV_USBD_EPSIZE)
+            n = NRF_DRV_USBD_EPSIZE;
+
+        if (cdc_tx_append(&data[done], n))
+        {
+            done += n;
+            continue;
+        }
+
+        if (__get_IPSR() != 0)
+            break;
+        cdc_tx_kick();
+        __WFE();
+    }
+
+    cdc_tx_kick();
+
+    return len;
+}
+
+/*!
+ * @brief This function reads stdin data from the RX ring
+ *
+ * Returns what is buffered, up to len. Waits only while the ring is empty, as a read of 0 bytes
+ * means end of file to the C library.
+ */
+static int cdc_read(uint8_t *data, int len)
+{
+    int n = 0;
+
+    while (cdc_rx_head == cdc_rx_tail)
+    {
+        if (!serial_connected || (__get_IPSR() != 0))
+            return 0;
+        __WFE();
+    }
+
+    while ((n < len) && (cdc_rx_tail != cdc_rx_head))
+    {
+        data[n++] = cdc_rx_ring[cdc_rx_tail % CDC_RX_RING_SIZE];
+        cdc_rx_tail++;
+    }
+
+    cdc_rx_arm();
+
+    return n;
+}
+
 /*!
  *
  * @brief       :Event handler for USB CDC ACM
@@ -154,16 +375,26 @@ static void cdc_acm_user_ev_handler(app_usbd_class_inst_t const * p_inst,
     {
         case APP_USBD_CDC_ACM_USER_EVT_PORT_OPEN:
             check_com_port_connection(1);
-            tx_pending = false;
+            cdc_tx_inflight = 0;
+            cdc_rx_armed = false;
+            cdc_rx_arm();
+            cdc_tx_kick();
             break;
         case APP_USBD_CDC_ACM_USER_EVT_PORT_CLOSE:
             check_com_port_connection(0);
-            tx_pending = false;
+            /* Nobody reads the pending output anymore */
+            cdc_tx_tail = cdc_tx_head;
+            cdc_tx_inflight = 0;
             break;
         case APP_USBD_CDC_ACM_USER_EVT_TX_DONE:
-            tx_pending = false;
+            cdc_tx_tail += cdc_tx_inflight;
+            cdc_tx_inflight = 0;
+            cdc_tx_kick();
             break;
         case APP_USBD_CDC_ACM_USER_EVT_RX_DONE:
+            cdc_rx_armed = false;
+            cdc_rx_store(app_usbd_cdc_acm_rx_size(&m_app_cdc_acm));
+            cdc_rx_arm();
             break;
         default:
             break;
@@ -179,10 +410,15 @@ int16_t coines_open_comm_intf(enum coines_comm_intf intf_type)
     };
 
     flog_initialize_params_t params = {
-        .number_of_blocks = 1024,
+        .number_of_blocks = FS_NUM_BLOCKS,
         .pages_per_block = 64,
     };
 
+    /*For COINES_PROFILE_BEGIN/END() zones, started first to profile the bring-up*/
+    coines_profile_init();
+
+    COINES_PROFILE_BEGIN(open_comm_intf);
+
     nrf_drv_clock_init();
     nrf_drv_power_init(NULL);
     nrf_drv_clock_lfclk_request(NULL);
@@ -202,26 +438,18 @@ int16_t coines_open_comm_intf(enum coines_comm_intf intf_type)
     while (!nrf_drv_clock_lfclk_is_running() &&
             !nrf_drv_clock_hfclk_is_running());
 
+    /* The 1-Wire bits are timed by the TIMER1 interrupt, read before any other interrupt is enabled */
     app30_eeprom_init();
-
-    app30_eeprom_read(0x60, multi_io_map, 10);
-
-    flogfs_initialize(&params);
-
-    if (flogfs_mount() == FLOG_FAILURE)
-    {
-        for (uint16_t i = 0; i < 1024; i++)
-            W25N01GW_eraseBlock((i * W25N01GW_BLOCK_SIZE) + 1, W25N01GW_BLOCK_SIZE);
-        flogfs_format();
-    }
-    else
-    {
-        /* Do nothing */
-    }
+    (void)app30_eeprom_read(0x60, multi_io_map, 10);
 
     /*For coines_get_millis() API*/
     SysTick_Config(64000);
 
+    /*For coines_get_micros() API*/
+    (void)micros_timer_init();
+
+    /* USB events are processed in the USB interrupt, the host enumerates the board while the
+     * flash is mounted */
     app_usbd_serial_num_generate();
     app_usbd_init(&usbd_config);
 
@@ -229,6 +457,17 @@ int16_t coines_open_comm_intf(enum coines_comm_intf intf_type)
     app_usbd_class_append(class_cdc_acm);
     app_usbd_power_events_enable();
 
+    COINES_PROFILE_BEGIN(flash_mount);
+    flogfs_initialize(&params);
+
+    /* The format erases only the first block, the allocator erases the others on demand */
+    if (flogfs_mount() == FLOG_FAILURE)
+    {
+        if (flogfs_format() == FLOG_SUCCESS)
+            (void)flogfs_mount();
+    }
+    COINES_PROFILE_END(flash_mount);
+
     nrf_gpio_cfg_output(VDD_PS_EN);
     nrf_gpio_cfg_output(VDDIO_PS_EN);
     nrf_gpio_cfg_output(VDD_SEL);
@@ -239,9 +478,12 @@ int16_t coines_open_comm_intf(enum coines_comm_intf intf_type)
 
     nrfx_gpiote_init();
 
+    COINES_PROFILE_END(open_comm_intf);
+
+    /* Woken up by the USB interrupt or SysTick */
     while (!(serial_connected || nrf_gpio_pin_read(SWITCH2) == 0))
     {
-        nrf_delay_ms(100);
+        __WFE();
     }
 
     return COINES_SUCCESS;
@@ -252,8 +494,101 @@ int16_t coines_open_comm_intf(enum coines_comm_intf intf_type)
  */
 int16_t coines_close_comm_intf(enum coines_comm_intf intf_type)
 {
+    coines_start_stop_streaming(COINES_STREAMING_MODE_POLLING, COINES_STREAMING_STOP);
+    stream_sensor_count = 0;
+    fflush(stdout);
+    (void)coines_log_config(COINES_LOG_SINK_SERIAL, NULL);
+    /* Files written by the application, the log file is covered above */
+    (void)flogfs_checkpoint();
+    (void)coines_flush_serial();
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This API returns the number of bytes received on USB serial and not read yet
+ */
+uint16_t coines_serial_rx_available(void)
+{
+    return (uint16_t)(cdc_rx_head - cdc_rx_tail);
+}
+
+/*!
+ * @brief This API waits until the buffered USB serial output has been sent
+ */
+int16_t coines_flush_serial(void)
+{
+    while (cdc_tx_head != cdc_tx_tail)
+    {
+        if (!serial_connected || (__get_IPSR() != 0))
+            return COINES_E_COMM_IO_ERROR;
+        cdc_tx_kick();
+        __WFE();
+    }
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This API selects where the log records go
+ */
+int16_t coines_log_config(enum coines_log_sink sink, const char *file_name)
+{
+    if (log_sink == COINES_LOG_SINK_FILE)
+    {
+        log_sink = COINES_LOG_SINK_SERIAL;
+        (void)coines_sched_stop(&log_gc_task);
+        flogfs_close_write(&log_file);
+        /* The next mount starts from here instead of scanning the flash */
+        (void)flogfs_checkpoint();
+    }
+
+    if (sink == COINES_LOG_SINK_FILE)
+    {
+        if (file_name == NULL)
+            return COINES_E_NULL_PTR;
+        if (flogfs_open_write(&log_file, file_name) != FLOG_SUCCESS)
+            return COINES_E_FAILURE;
+        /* Keeps erased blocks ready, so the log writes do not wait for erases */
+        (void)coines_sched_start(&log_gc_task, LOG_GC_PERIOD_US, LOG_GC_PERIOD_US, log_gc_tick, NULL);
+    }
+    log_sink = sink;
+
     return COINES_SUCCESS;
 }
+
+/*!
+ * @brief This function runs the flash garbage collection from coines_sched_dispatch() while logging
+ */
+static void log_gc_tick(void *context)
+{
+    (void)context;
+    (void)flogfs_gc(FS_ERASE_US);
+}
+
+/*!
+ * @brief This API sends a complete log record to the selected sink
+ *
+ * The flash file system cannot be used from interrupt handlers, their records are dropped
+ * when logging to a file.
+ */
+void coines_log_write(const void *record, uint16_t len)
+{
+    if (log_sink == COINES_LOG_SINK_FILE)
+    {
+        if (__get_IPSR() == 0)
+            (void)flogfs_write(&log_file, record, len);
+        return;
+    }
+
+    while (!cdc_tx_append(record, len))
+    {
+        if (!serial_connected || (__get_IPSR() != 0))
+            return;
+        cdc_tx_kick();
+        __WFE();
+    }
+    cdc_tx_kick();
+}
 /*!
  *  @brief This API is used to get the board information.
  */
@@ -356,11 +691,101 @@ int16_t coines_set_shuttleboard_vdd_vddio_config(uint16_t vdd_millivolt, uint16_
     return COINES_SUCCESS;
 
 }
+/*!
+ * @brief This API connects the SPIM driver to the sensor bus pins with the saved configuration
+ */
+static int16_t spi_bus_init(void)
+{
+    /* Only SPIM3 runs faster than 8 MHz */
+    spi_hw_cs = (spi_config.frequency == NRF_SPIM_FREQ_16M) || (spi_config.frequency == NRF_SPIM_FREQ_32M);
+    spi_bus = spi_hw_cs ? &spi_hs_instance : &spi_instance;
+
+    spi_bus_ready = (nrfx_spim_init(spi_bus, &spi_config, spi_evt_handler, NULL) == NRFX_SUCCESS);
+    if (!spi_bus_ready)
+        return COINES_E_FAILURE;
+
+    if (spi_hw_cs)
+    {
+        /* High drive keeps the 16/32 MHz edges sharp */
+        nrf_gpio_cfg(spi_config.sck_pin, NRF_GPIO_PIN_DIR_OUTPUT, NRF_GPIO_PIN_INPUT_CONNECT,
+                     NRF_GPIO_PIN_NOPULL, NRF_GPIO_PIN_H0H1, NRF_GPIO_PIN_NOSENSE);
+        nrf_gpio_cfg(spi_config.mosi_pin, NRF_GPIO_PIN_DIR_OUTPUT, NRF_GPIO_PIN_INPUT_DISCONNECT,
+                     NRF_GPIO_PIN_NOPULL, NRF_GPIO_PIN_H0H1, NRF_GPIO_PIN_NOSENSE);
+    }
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This API connects the TWIM driver to the sensor bus pins with the saved configuration
+ */
+static int16_t i2c_bus_init(void)
+{
+    // Make SDO Pin Low
+    nrf_gpio_cfg_output(SPI_SEN_MISO);
+    nrf_gpio_pin_clear(SPI_SEN_MISO);
+
+    nrf_gpio_cfg_input(SPI_I2C_SEN_SCK, NRF_GPIO_PIN_PULLUP);
+    nrf_gpio_cfg_input(SPI_I2C_SEN_MOSI, NRF_GPIO_PIN_PULLUP);
+
+    nrf_gpio_cfg(i2c_config.sda, NRF_GPIO_PIN_DIR_INPUT, NRF_GPIO_PIN_INPUT_CONNECT,
+                 NRF_GPIO_PIN_PULLUP, NRF_GPIO_PIN_H0D1, NRF_GPIO_PIN_NOSENSE);
+
+    nrf_gpio_cfg(i2c_config.scl, NRF_GPIO_PIN_DIR_INPUT, NRF_GPIO_PIN_INPUT_CONNECT,
+                 NRF_GPIO_PIN_PULLUP, NRF_GPIO_PIN_H0D1, NRF_GPIO_PIN_NOSENSE);
+
+    i2c_bus_ready = (nrfx_twim_init(&i2c_instance, &i2c_config, i2c_evt_handler, NULL) == NRFX_SUCCESS);
+    if (!i2c_bus_ready)
+        return COINES_E_FAILURE;
+
+    nrfx_twim_enable(&i2c_instance);
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This API hands the shared sensor bus pins to the SPIM or the TWIM driver
+ *
+ * Called between transfers only, the driver of the other interface is released.
+ */
+static int16_t bus_select(enum coines_sensor_intf intf)
+{
+    if (intf == COINES_SENSOR_INTF_SPI)
+    {
+        if (spi_bus_ready)
+            return COINES_SUCCESS;
+        if (!spi_bus_configured)
+            return COINES_E_FAILURE;
+        if (i2c_bus_ready)
+        {
+            nrfx_twim_uninit(&i2c_instance);
+            i2c_bus_ready = false;
+        }
+        return spi_bus_init();
+    }
+    else
+    {
+        if (i2c_bus_ready)
+            return COINES_SUCCESS;
+        if (!i2c_bus_configured)
+            return COINES_E_FAILURE;
+        if (spi_bus_ready)
+        {
+            nrfx_spim_uninit(spi_bus);
+            spi_bus_ready = false;
+        }
+        return i2c_bus_init();
+    }
+}
+
 /*!
  *  @brief This API is used to configure the SPI bus
  */
 int16_t coines_config_spi_bus(enum coines_spi_bus bus, enum coines_spi_speed spi_speed, enum coines_spi_mode spi_mode)
 {
+    if (bus_busy || stream_active)
+        return COINES_E_FAILURE;
+
     spi_config.miso_pin = SPI_SEN_MISO;
     spi_config.mosi_pin = SPI_I2C_SEN_MOSI;
     spi_config.sck_pin = SPI_I2C_SEN_SCK;
@@ -395,15 +820,25 @@ int16_t coines_config_spi_bus(enum coines_spi_bus bus, enum coines_spi_speed spi
             COINES_NRF_SPEED_MAP(5_MHZ,4M);
             COINES_NRF_SPEED_MAP(6_MHZ,4M);
             COINES_NRF_SPEED_MAP(7_5_MHZ,4M);
-            COINES_NRF_SPEED_MAP(10_MHZ,4M);
+            COINES_NRF_SPEED_MAP(10_MHZ,8M);
+
+            COINES_NRF_SPEED_MAP(16_MHZ,16M);
+            COINES_NRF_SPEED_MAP(32_MHZ,32M);
 
             default:
             spi_config.frequency = NRF_SPIM_FREQ_2M;
         }
 
-    nrfx_spim_init(&spi_instance, &spi_config, NULL, NULL);
+    spi_bus_configured = true;
 
-    return COINES_SUCCESS;
+    /* Apply the new configuration */
+    if (spi_bus_ready)
+    {
+        nrfx_spim_uninit(spi_bus);
+        spi_bus_ready = false;
+    }
+
+    return bus_select(COINES_SENSOR_INTF_SPI);
 }
 /*!
  *  @brief This API is used to configure the I2C bus
@@ -411,208 +846,1563 @@ int16_t coines_config_spi_bus(enum coines_spi_bus bus, enum coines_spi_speed spi
 int16_t coines_config_i2c_bus(enum coines_i2c_bus bus,
         enum coines_i2c_mode i2c_mode)
 {
-    // Make SDO Pin Low
-    nrf_gpio_cfg_output(SPI_SEN_MISO);
-    nrf_gpio_pin_clear(SPI_SEN_MISO);
-
-    nrf_gpio_cfg_input(SPI_I2C_SEN_SCK, NRF_GPIO_PIN_PULLUP);
-    nrf_gpio_cfg_input(SPI_I2C_SEN_MOSI, NRF_GPIO_PIN_PULLUP);
+    if (bus_busy || stream_active)
+        return COINES_E_FAILURE;
 
     i2c_config.sda = I2C_SEN_SDA;
     i2c_config.scl = I2C_SEN_SCL;
 
-    nrf_gpio_cfg(i2c_config.sda, NRF_GPIO_PIN_DIR_INPUT, NRF_GPIO_PIN_INPUT_CONNECT,
-                 NRF_GPIO_PIN_PULLUP, NRF_GPIO_PIN_H0D1, NRF_GPIO_PIN_NOSENSE);
+    if (i2c_mode == COINES_I2C_STANDARD_MODE)
+        i2c_config.frequency = NRF_TWIM_FREQ_100K;
+    else
+        i2c_config.frequency = NRF_TWIM_FREQ_400K;
 
-    nrf_gpio_cfg(i2c_config.scl, NRF_GPIO_PIN_DIR_INPUT, NRF_GPIO_PIN_INPUT_CONNECT,
-                 NRF_GPIO_PIN_PULLUP, NRF_GPIO_PIN_H0D1, NRF_GPIO_PIN_NOSENSE);
+    i2c_bus_configured = true;
 
-    nrfx_twim_init(&i2c_instance, &i2c_config, NULL, NULL);
+    /* Apply the new configuration */
+    if (i2c_bus_ready)
+    {
+        nrfx_twim_uninit(&i2c_instance);
+        i2c_bus_ready = false;
+    }
 
-    nrfx_twim_enable(&i2c_instance);
+    return bus_select(COINES_SENSOR_INTF_I2C);
+}
 
-    if (i2c_mode == COINES_I2C_STANDARD_MODE)
-        nrf_twim_frequency_set(i2c_instance.p_twim, NRF_TWIM_FREQ_100K);
+/*!
+ * @brief This API starts the next data phase of an SPI transfer, chip select is already low
+ */
+static nrfx_err_t bus_spi_data_phase(void)
+{
+    nrfx_spim_xfer_desc_t desc = NRFX_SPIM_XFER_TRX(NULL, 0, NULL, 0);
+    uint16_t len = bus_data_len;
+
+    if (bus_data_write)
+    {
+        if (bus_data_staged)
+        {
+            if (len > BUS_STAGING_SIZE)
+                len = BUS_STAGING_SIZE;
+            memcpy(bus_staging, bus_data, len);
+            desc.p_tx_buffer = bus_staging;
+        }
+        else
+        {
+            desc.p_tx_buffer = bus_data;
+        }
+        desc.tx_length = len;
+    }
     else
-        nrf_twim_frequency_set(i2c_instance.p_twim, NRF_TWIM_FREQ_400K);
+    {
+        desc.p_rx_buffer = bus_data;
+        desc.rx_length = len;
+    }
 
-    return COINES_SUCCESS;
+    bus_data += len;
+    bus_data_len -= len;
+
+    return nrfx_spim_xfer(spi_bus, &desc, 0);
 }
+
 /*!
- *  @brief This API is used to write the data in I2C communication.
+ * @brief This API starts an SPI transfer, the register address followed by the data phase
  */
-int8_t coines_write_i2c(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data,
-        uint16_t count)
+static nrfx_err_t bus_spi_start(const struct coines_bus_xfer *xfer)
 {
+    nrfx_spim_xfer_desc_t desc = NRFX_SPIM_XFER_TX(&bus_reg_addr, 1);
     nrfx_err_t error;
 
-    uint8_t buffer[count + 1];
+    bus_reg_addr = xfer->reg_addr;
+    bus_cs_pin = multi_io_map[xfer->dev_addr];
+    bus_data = xfer->reg_data;
+    bus_data_len = xfer->count;
+    bus_data_write = (xfer->write != 0);
+    bus_data_staged = bus_data_write && (xfer->count != 0) && !nrfx_is_in_ram(xfer->reg_data);
 
-    buffer[0] = reg_addr;
-    memcpy(&buffer[1], reg_data, count);
+    nrf_gpio_cfg_output(bus_cs_pin);
+    nrf_gpio_pin_write(bus_cs_pin, 0);
+    error = nrfx_spim_xfer(spi_bus, &desc, 0);
+    if (error != NRFX_SUCCESS)
+        nrf_gpio_pin_write(bus_cs_pin, 1);
 
-    nrfx_twim_xfer_desc_t write_desc = NRFX_TWIM_XFER_DESC_TX(dev_addr,buffer,count+1);
-
-    error = nrfx_twim_xfer(&i2c_instance, &write_desc, NRFX_TWIM_FLAG_TX_POSTINC);
-
-    while (nrfx_twim_is_busy(&i2c_instance));
-
-    if (error == NRFX_SUCCESS)
-        return COINES_SUCCESS;
-    else
-        return COINES_E_FAILURE;
+    return error;
 }
+
 /*!
- *  @brief This API is used to read the data in I2C communication.
+ * @brief This API starts an I2C transfer, the register address followed by the data
  */
-int8_t coines_read_i2c(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data,
-        uint16_t count)
+static nrfx_err_t bus_i2c_start(const struct coines_bus_xfer *xfer)
 {
-    nrfx_err_t error;
-
-    nrfx_twim_xfer_desc_t read_desc = NRFX_TWIM_XFER_DESC_TXRX(dev_addr,&reg_addr,1,reg_data,count);
+    nrfx_twim_xfer_desc_t desc;
+    uint8_t *data = xfer->reg_data;
 
-    error = nrfx_twim_xfer(&i2c_instance, &read_desc, NRFX_TWIM_FLAG_RX_POSTINC | NRFX_TWIM_FLAG_REPEATED_XFER);
+    bus_reg_addr = xfer->reg_addr;
 
-    while (nrfx_twim_is_busy(&i2c_instance));
+    /* The register address and the data are sent in one transfer, data outside RAM is staged as a whole */
+    if (xfer->write && (xfer->count != 0) && !nrfx_is_in_ram(data))
+    {
+        memcpy(bus_staging, data, xfer->count);
+        data = bus_staging;
+    }
 
-    if (error == NRFX_SUCCESS)
-        return COINES_SUCCESS;
+    if (!xfer->write)
+        desc = (nrfx_twim_xfer_desc_t)NRFX_TWIM_XFER_DESC_TXRX(xfer->dev_addr, &bus_reg_addr, 1, data, xfer->count);
+    else if (xfer->count != 0)
+        desc = (nrfx_twim_xfer_desc_t)NRFX_TWIM_XFER_DESC_TXTX(xfer->dev_addr, &bus_reg_addr, 1, data, xfer->count);
     else
-        return COINES_E_FAILURE;
+        desc = (nrfx_twim_xfer_desc_t)NRFX_TWIM_XFER_DESC_TX(xfer->dev_addr, &bus_reg_addr, 1);
+
+    return nrfx_twim_xfer(&i2c_instance, &desc, 0);
 }
+
 /*!
- *  @brief This API is used to read the data in SPI communication.
+ * @brief This API starts the queued transfers until one is on the bus or the queue is empty
+ *
+ * Transfers queued from interrupt context are served first. The bus is claimed and the
+ * transfer started in one critical region, so a handler never sees bus_busy without a
+ * transfer that will end.
  */
-int8_t coines_write_spi(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data,
-        uint16_t count)
+static void bus_queue_kick(void)
 {
+    struct coines_bus_xfer failed;
     nrfx_err_t error;
-    uint8_t buffer[count + 1];
-
-    uint32_t pin_num = multi_io_map[dev_addr];
-    if (pin_num == 0 || pin_num == 0xff)
-        return COINES_E_FAILURE;
-    else
-        nrf_gpio_cfg_output(pin_num);
+    uint8_t q;
+    bool start;
 
-    buffer[0] = reg_addr;
-    memcpy(&buffer[1], reg_data, count);
+    for (;;)
+    {
+        start = false;
+        error = NRFX_SUCCESS;
 
-    spi_tx_desc.p_tx_buffer = buffer;
-    spi_tx_desc.tx_length = count + 1;
-    spi_tx_desc.p_rx_buffer = NULL;
-    spi_tx_desc.rx_length = 0;
+        CRITICAL_REGION_ENTER();
+        if (!bus_busy && !stream_active)
+        {
+            for (q = 0; q < BUS_QUEUE_COUNT; q++)
+            {
+                if (bus_queue_tail[q] != bus_queue_head[q])
+                {
+                    bus_cur = bus_queue[q][bus_queue_tail[q]];
+                    bus_cur_queue = q;
+                    bus_queue_tail[q] = (bus_queue_tail[q] + 1) % BUS_QUEUE_SIZE;
+                    bus_busy = true;
+                    start = true;
+                    break;
+                }
+            }
+        }
 
-    nrf_gpio_pin_write(pin_num, 0);
-    error = nrfx_spim_xfer(&spi_instance, &spi_tx_desc, 0);
-    nrf_gpio_pin_write(pin_num, 1);
+        if (start)
+        {
+            error = NRFX_ERROR_INTERNAL;
+            if (bus_select(bus_cur.intf) == COINES_SUCCESS)
+            {
+                if (bus_cur.intf == COINES_SENSOR_INTF_SPI)
+                    error = bus_spi_start(&bus_cur);
+                else
+                    error = bus_i2c_start(&bus_cur);
+            }
+
+            if (error != NRFX_SUCCESS)
+            {
+                failed = bus_cur;
+                bus_result = COINES_E_COMM_IO_ERROR;
+                bus_busy = false;
+            }
+        }
+        CRITICAL_REGION_EXIT();
+
+        if (error == NRFX_SUCCESS)
+            return;
+
+        if (failed.callback != NULL)
+            failed.callback(COINES_E_COMM_IO_ERROR, failed.context);
+    }
+}
+
+/*!
+ * @brief This API stops a transfer which did not end and releases the driver of the bus
+ *
+ * The next bus_select() initializes the driver again. Called with interrupts disabled.
+ */
+static void bus_reset(void)
+{
+    if (spi_bus_ready)
+    {
+        nrfx_spim_uninit(spi_bus);
+        nrf_spim_event_clear(spi_bus->p_reg, NRF_SPIM_EVENT_END);
+        NVIC_ClearPendingIRQ(nrfx_get_irq_number(spi_bus->p_reg));
+        spi_bus_ready = false;
+    }
+
+    if (i2c_bus_ready)
+    {
+        nrfx_twim_uninit(&i2c_instance);
+        nrf_twim_event_clear(i2c_instance.p_twim, NRF_TWIM_EVENT_STOPPED);
+        nrf_twim_event_clear(i2c_instance.p_twim, NRF_TWIM_EVENT_ERROR);
+        NVIC_ClearPendingIRQ(nrfx_get_irq_number(i2c_instance.p_twim));
+        i2c_bus_ready = false;
+    }
+}
+
+/*!
+ * @brief This API resets the bus and fails the transfer on it and all queued transfers
+ */
+static void bus_abort(void)
+{
+    struct coines_bus_xfer xfer;
+    bool found;
+    uint8_t q;
+
+    CRITICAL_REGION_ENTER();
+    found = bus_busy;
+    xfer = bus_cur;
+    bus_reset();
+    bus_result = COINES_E_COMM_IO_ERROR;
+    bus_busy = false;
+    CRITICAL_REGION_EXIT();
+
+    if (found && (xfer.callback != NULL))
+        xfer.callback(COINES_E_COMM_IO_ERROR, xfer.context);
+
+    do
+    {
+        found = false;
+        CRITICAL_REGION_ENTER();
+        for (q = 0; q < BUS_QUEUE_COUNT; q++)
+        {
+            if (bus_queue_tail[q] != bus_queue_head[q])
+            {
+                xfer = bus_queue[q][bus_queue_tail[q]];
+                bus_queue_tail[q] = (bus_queue_tail[q] + 1) % BUS_QUEUE_SIZE;
+                found = true;
+                break;
+            }
+        }
+        CRITICAL_REGION_EXIT();
+
+        if (found && (xfer.callback != NULL))
+            xfer.callback(COINES_E_COMM_IO_ERROR, xfer.context);
+    } while (found);
+}
+
+/*!
+ * @brief This API ends the transfer on the bus, calls its callback and starts the next one
+ */
+static void bus_done(int16_t result)
+{
+    coines_xfer_callback_t callback = bus_cur.callback;
+    void *context = bus_cur.context;
+
+    bus_result = result;
+    bus_busy = false;
+    __SEV();
+
+    if (callback != NULL)
+        callback(result, context);
+
+    bus_queue_kick();
+}
+
+/*!
+ * @brief This API runs the pending sensor bus interrupt when waiting in an interrupt handler
+ *
+ * The bus interrupt cannot preempt a handler of the same or higher priority.
+ */
+static void bus_poll(void)
+{
+    IRQn_Type irqn;
+
+    if (spi_bus_ready)
+    {
+        irqn = nrfx_get_irq_number(spi_bus->p_reg);
+        if (NVIC_GetPendingIRQ(irqn))
+        {
+            NVIC_ClearPendingIRQ(irqn);
+            if (spi_hw_cs)
+                NRFX_CONCAT_3(nrfx_spim_, SPI_HS_INSTANCE, _irq_handler)();
+            else
+                NRFX_CONCAT_3(nrfx_spim_, SPI_INSTANCE, _irq_handler)();
+        }
+    }
+
+    if (i2c_bus_ready)
+    {
+        irqn = nrfx_get_irq_number(i2c_instance.p_twim);
+        if (NVIC_GetPendingIRQ(irqn))
+        {
+            NVIC_ClearPendingIRQ(irqn);
+            NRFX_CONCAT_3(nrfx_twim_, I2C_SEN_INSTANCE, _irq_handler)();
+        }
+    }
+}
+
+/*!
+ * @brief Completion callback of the blocking read/write APIs
+ */
+static void bus_sync_done(int16_t result, void *context)
+{
+    volatile int16_t *sync_result = (volatile int16_t *)context;
+
+    *sync_result = result;
+}
+
+/*!
+ * @brief This API queues a transfer and waits for its completion
+ *
+ * An interrupt handler cannot wait for a transfer of the main loop, which it preempted. A
+ * transfer not done within the timeout resets the bus and fails all queued transfers.
+ */
+static int16_t bus_sync_xfer(enum coines_sensor_intf intf, uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data,
+                             uint16_t count, uint8_t write)
+{
+    volatile int16_t result = 1;    /* Pending */
+    uint32_t timeout_us = BUS_SYNC_TIMEOUT_US + ((uint32_t)count * BUS_SYNC_TIMEOUT_US_PER_BYTE);
+    uint64_t start_us;
+    struct coines_bus_xfer xfer = {
+        .intf = intf,
+        .dev_addr = dev_addr,
+        .reg_addr = reg_addr,
+        .reg_data = reg_data,
+        .count = count,
+        .write = write,
+        .callback = bus_sync_done,
+        .context = (void *)&result
+    };
+
+    if ((__get_IPSR() != 0) && bus_busy && (bus_cur_queue == BUS_QUEUE_THREAD))
+        return COINES_E_FAILURE;
+
+    start_us = coines_get_micros();
+    if (coines_queue_xfer(&xfer) != COINES_SUCCESS)
+        return COINES_E_FAILURE;
+
+    /* SysTick wakes __WFE() every millisecond to check the timeout */
+    while (result == 1)
+    {
+        if ((coines_get_micros() - start_us) > timeout_us)
+        {
+            bus_abort();
+            break;
+        }
+
+        if (__get_IPSR() != 0)
+            bus_poll();
+        else
+            __WFE();
+    }
+
+    return (result == COINES_SUCCESS) ? COINES_SUCCESS : COINES_E_FAILURE;
+}
+
+/*!
+ *  @brief This API queues a sensor bus transfer
+ */
+int16_t coines_queue_xfer(const struct coines_bus_xfer *xfer)
+{
+    uint32_t pin_num;
+    uint8_t q;
+    uint8_t next;
+    int16_t rslt = COINES_SUCCESS;
+
+    if (xfer == NULL)
+        return COINES_E_NULL_PTR;
+
+    if ((xfer->count != 0) && (xfer->reg_data == NULL))
+        return COINES_E_NULL_PTR;
+
+    /* EasyDMA cannot receive into flash */
+    if (!xfer->write && (xfer->count != 0) && !nrfx_is_in_ram(xfer->reg_data))
+        return COINES_E_FAILURE;
+
+    if (xfer->intf == COINES_SENSOR_INTF_SPI)
+    {
+        pin_num = multi_io_map[xfer->dev_addr];
+        if (!spi_bus_configured || pin_num == 0 || pin_num == 0xff)
+            return COINES_E_FAILURE;
+    }
+    else
+    {
+        if (!i2c_bus_configured)
+            return COINES_E_FAILURE;
+        if (xfer->write && (xfer->count > BUS_STAGING_SIZE) && !nrfx_is_in_ram(xfer->reg_data))
+            return COINES_E_NOT_SUPPORTED;
+    }
+
+    q = (__get_IPSR() != 0) ? BUS_QUEUE_IRQ : BUS_QUEUE_THREAD;
+
+    CRITICAL_REGION_ENTER();
+    next = (bus_queue_head[q] + 1) % BUS_QUEUE_SIZE;
+    /* The sensor bus is owned by the streaming engine */
+    if (stream_active || (next == bus_queue_tail[q]))
+    {
+        rslt = COINES_E_FAILURE;
+    }
+    else
+    {
+        bus_queue[q][bus_queue_head[q]] = *xfer;
+        bus_queue_head[q] = next;
+    }
+    CRITICAL_REGION_EXIT();
+
+    if (rslt == COINES_SUCCESS)
+        bus_queue_kick();
+
+    return rslt;
+}
+/*!
+ *  @brief This API starts an I2C register write without waiting for its completion.
+ */
+int16_t coines_write_i2c_async(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data, uint16_t count,
+                               coines_xfer_callback_t callback, void *context)
+{
+    struct coines_bus_xfer xfer = { COINES_SENSOR_INTF_I2C, dev_addr, reg_addr, reg_data, count, 1, callback, context };
+
+    return coines_queue_xfer(&xfer);
+}
+/*!
+ *  @brief This API starts an I2C register read without waiting for its completion.
+ */
+int16_t coines_read_i2c_async(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data, uint16_t count,
+                              coines_xfer_callback_t callback, void *context)
+{
+    struct coines_bus_xfer xfer = { COINES_SENSOR_INTF_I2C, dev_addr, reg_addr, reg_data, count, 0, callback, context };
+
+    return coines_queue_xfer(&xfer);
+}
+/*!
+ *  @brief This API starts an SPI register write without waiting for its completion.
+ */
+int16_t coines_write_spi_async(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data, uint16_t count,
+                               coines_xfer_callback_t callback, void *context)
+{
+    struct coines_bus_xfer xfer = { COINES_SENSOR_INTF_SPI, dev_addr, reg_addr, reg_data, count, 1, callback, context };
+
+    return coines_queue_xfer(&xfer);
+}
+/*!
+ *  @brief This API starts an SPI register read without waiting for its completion.
+ */
+int16_t coines_read_spi_async(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data, uint16_t count,
+                              coines_xfer_callback_t callback, void *context)
+{
+    struct coines_bus_xfer xfer = { COINES_SENSOR_INTF_SPI, dev_addr, reg_addr, reg_data, count, 0, callback, context };
+
+    return coines_queue_xfer(&xfer);
+}
+/*!
+ *  @brief This API tells whether sensor bus transfers are in progress or queued
+ */
+uint8_t coines_is_xfer_busy(void)
+{
+    uint8_t q;
+
+    if (bus_busy)
+        return 1;
+
+    for (q = 0; q < BUS_QUEUE_COUNT; q++)
+    {
+        if (bus_queue_tail[q] != bus_queue_head[q])
+            return 1;
+    }
+
+    return 0;
+}
+/*!
+ *  @brief This API waits for the queued sensor bus transfers to complete
+ */
+int16_t coines_wait_xfer(void)
+{
+    while (coines_is_xfer_busy())
+    {
+        if (__get_IPSR() != 0)
+            bus_poll();
+        else
+            __WFE();
+    }
+
+    return bus_result;
+}
+/*!
+ *  @brief This API is used to write the data in I2C communication.
+ */
+int8_t coines_write_i2c(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data,
+        uint16_t count)
+{
+    return bus_sync_xfer(COINES_SENSOR_INTF_I2C, dev_addr, reg_addr, reg_data, count, 1);
+}
+/*!
+ *  @brief This API is used to read the data in I2C communication.
+ */
+int8_t coines_read_i2c(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data,
+        uint16_t count)
+{
+    return bus_sync_xfer(COINES_SENSOR_INTF_I2C, dev_addr, reg_addr, reg_data, count, 0);
+}
+/*!
+ *  @brief This API is used to write the data in SPI communication.
+ */
+int8_t coines_write_spi(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data,
+        uint16_t count)
+{
+    return bus_sync_xfer(COINES_SENSOR_INTF_SPI, dev_addr, reg_addr, reg_data, count, 1);
+}
+/*!
+ *  @brief This API is used to read the data in SPI communication.
+ */
+int8_t coines_read_spi(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data,
+        uint16_t count)
+{
+    return bus_sync_xfer(COINES_SENSOR_INTF_SPI, dev_addr, reg_addr, reg_data, count, 0);
+}
+/*!
+ *  @brief This API is used for introducing a delay in milliseconds
+ */
+void coines_delay_msec(uint32_t delay_ms)
+{
+    nrf_delay_ms(delay_ms);
+}
+
+/*!
+ *  @brief This API is used for introducing a delay in microseconds
+ */
+void coines_delay_usec(uint32_t delay_us)
+{
+    nrf_delay_us(delay_us);
+}
+
+/*!
+ * @brief This API initializes the sample clock and the time stamp timers
+ */
+static int16_t stream_timers_init(void)
+{
+    nrfx_timer_config_t timer_config = {
+        .frequency = NRF_TIMER_FREQ_1MHz,
+        .mode = NRF_TIMER_MODE_TIMER,
+        .bit_width = NRF_TIMER_BIT_WIDTH_32,
+        .interrupt_priority = STREAM_IRQ_PRIORITY,
+        .p_context = NULL
+    };
+
+    if (stream_timers_ready)
+        return COINES_SUCCESS;
+
+    if (nrfx_timer_init(&stream_ts_timer, &timer_config, stream_ts_timer_handler) != NRFX_SUCCESS)
+        return COINES_E_FAILURE;
+
+    if (nrfx_timer_init(&stream_tick_timer, &timer_config, stream_tick_timer_handler) != NRFX_SUCCESS)
+    {
+        nrfx_timer_uninit(&stream_ts_timer);
+        return COINES_E_FAILURE;
+    }
+
+    /* COMPARE0 at 0 marks every wrap of the 32 bit time stamp counter */
+    nrfx_timer_compare(&stream_ts_timer, STREAM_TS_CC_WRAP, 0, true);
+
+    stream_timers_ready = true;
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This API extends a 32 bit time stamp captured in hardware to 64 bit
+ *
+ * Called from the streaming handlers, which have the priority of the wrap interrupt.
+ */
+static uint64_t stream_timestamp(nrf_timer_cc_channel_t cc_channel)
+{
+    uint32_t captured = nrfx_timer_capture_get(&stream_ts_timer, cc_channel);
+    uint32_t now = nrfx_timer_capture(&stream_ts_timer, STREAM_TS_CC_NOW);
+    uint32_t wraps = stream_ts_wraps;
+
+    /* Wrap not handled yet by the timer interrupt */
+    if (nrf_timer_event_check(stream_ts_timer.p_reg, nrf_timer_compare_event_get(STREAM_TS_CC_WRAP)) &&
+        (now < 0x80000000))
+        wraps++;
+
+    /* Captured before the last wrap */
+    if ((captured > now) && (wraps > 0))
+        wraps--;
+
+    return ((uint64_t)wraps << 32) | captured;
+}
+
+/*!
+ * @brief This API places the ring buffer and computes the slot layout of a sensor
+ */
+static void stream_layout(stream_sensor_t *sensor, uint8_t *ring, uint32_t ring_size)
+{
+    uint8_t dummy = (sensor->config.intf == COINES_SENSOR_INTF_SPI) ? 1 : 0;
+    uint16_t rx_len = 0;
+
+    for (uint8_t i = 0; i < sensor->blocks.no_of_blocks; i++)
+    {
+        sensor->tx_addr[i] = dummy ? (sensor->blocks.reg_start_addr[i] | 0x80) : sensor->blocks.reg_start_addr[i];
+        sensor->rx_offset[i] = rx_len;
+        rx_len += dummy + sensor->blocks.no_of_data_bytes[i];
+    }
+
+    sensor->rx_len = rx_len;
+    sensor->slot_size = (STREAM_SLOT_HEADER_SIZE + rx_len + 3) & ~3;
+    sensor->ring = ring;
+    sensor->slots = ring_size / sensor->slot_size;
+    sensor->head = 0;
+    sensor->tail = 0;
+    sensor->packet_count = 0;
+    sensor->dropped = 0;
+    sensor->tick_count = 0;
+}
+
+/*!
+ * @brief This API selects the slot receiving the next sample of a sensor
+ *
+ * When the ring is full the sample is received into the scratch slot and dropped.
+ */
+static void stream_begin_sample(stream_sensor_t *sensor)
+{
+    if (((sensor->head + 1) % sensor->slots) == sensor->tail)
+        sensor->slot = stream_scratch;
+    else
+        sensor->slot = &sensor->ring[sensor->head * sensor->slot_size];
+}
+
+/*!
+ * @brief This API sets up the EasyDMA transfer of one block of the current sample
+ *
+ * With hold, the transfer is only prepared and started by PPI.
+ */
+static nrfx_err_t stream_xfer(stream_sensor_t *sensor, uint8_t block, bool hold)
+{
+    uint8_t *rx = &sensor->slot[STREAM_SLOT_HEADER_SIZE + sensor->rx_offset[block]];
+    uint8_t len = sensor->blocks.no_of_data_bytes[block];
+
+    if (sensor->config.intf == COINES_SENSOR_INTF_SPI)
+    {
+        nrfx_spim_xfer_desc_t desc = NRFX_SPIM_XFER_TRX(&sensor->tx_addr[block], 1, rx, len + 1);
+
+        /* SPIM3 drives the chip select of the sensor in hardware */
+        if (spi_hw_cs)
+            nrf_spim_csn_configure(spi_bus->p_reg, sensor->cs_pin, NRF_SPIM_CSN_POL_LOW, SPI_HS_CSN_DURATION);
+
+        /* STARTED tells coines_start_stop_streaming() whether the prepared transfer was triggered */
+        nrf_spim_event_clear(spi_bus->p_reg, NRF_SPIM_EVENT_STARTED);
+        return nrfx_spim_xfer(spi_bus, &desc,
+                              NRFX_SPIM_FLAG_REPEATED_XFER | (hold ? NRFX_SPIM_FLAG_HOLD_XFER : 0));
+    }
+    else
+    {
+        nrfx_twim_xfer_desc_t desc =
+            NRFX_TWIM_XFER_DESC_TXRX(sensor->config.dev_addr, &sensor->tx_addr[block], 1, rx, len);
+
+        nrf_twim_event_clear(i2c_instance.p_twim, NRF_TWIM_EVENT_TXSTARTED);
+        return nrfx_twim_xfer(&i2c_instance, &desc,
+                              NRFX_TWIM_FLAG_REPEATED_XFER | (hold ? NRFX_TWIM_FLAG_HOLD_XFER : 0));
+    }
+}
+
+/*!
+ * @brief This API stores the packet counter and time stamp of a received sample and publishes it
+ */
+static void stream_commit(stream_sensor_t *sensor, bool ok)
+{
+    uint32_t counter = ++sensor->packet_count;
+    uint64_t timestamp = stream_timestamp(sensor->ts_cc);
+
+    if (!ok || sensor->slot == stream_scratch)
+    {
+        sensor->dropped++;
+        return;
+    }
+
+    memcpy(&sensor->slot[0], &counter, 4);
+    memcpy(&sensor->slot[4], &timestamp, 8);
+    __DMB();
+    sensor->head = (sensor->head + 1) % sensor->slots;
+}
+
+/*!
+ * @brief This API turns the interrupt of the trigger of a single transfer per sample on or off
+ */
+static void stream_trigger_int(bool enable)
+{
+    if (stream_mode_cfg == COINES_STREAMING_MODE_POLLING)
+    {
+        if (enable)
+            nrfx_timer_compare_int_enable(&stream_tick_timer, NRF_TIMER_CC_CHANNEL0);
+        else
+            nrfx_timer_compare_int_disable(&stream_tick_timer, NRF_TIMER_CC_CHANNEL0);
+    }
+    else
+    {
+        /* Enabling the event again does not turn its interrupt off */
+        nrfx_gpiote_in_event_disable(stream_sensor[0].int_pin);
+        nrfx_gpiote_in_event_enable(stream_sensor[0].int_pin, enable);
+    }
+}
+
+/*!
+ * @brief This API points EasyDMA to the next slot and turns the trigger back on
+ *
+ * If the transfer cannot be prepared, the trigger interrupt is turned on instead and the
+ * next trigger tries again. Every trigger until then is a dropped sample.
+ */
+static void stream_rearm(stream_sensor_t *sensor)
+{
+    stream_begin_sample(sensor);
+    if (stream_xfer(sensor, 0, true) == NRFX_SUCCESS)
+    {
+        if (stream_rearm_failed)
+        {
+            stream_rearm_failed = false;
+            stream_trigger_int(false);
+        }
+        (void)nrfx_ppi_group_enable(stream_ppi_group);
+        return;
+    }
+
+    stream_bus_busy = false;
+    if (!stream_rearm_failed)
+    {
+        stream_rearm_failed = true;
+        stream_trigger_int(true);
+    }
+}
+
+/*!
+ * @brief This API starts the transfer of the current block when the sample is read block by block
+ */
+static void stream_start_block(void)
+{
+    stream_sensor_t *sensor = &stream_sensor[stream_cur_sensor];
+
+    if ((sensor->config.intf == COINES_SENSOR_INTF_SPI) && !spi_hw_cs)
+        nrf_gpio_pin_clear(sensor->cs_pin);
+
+    if (stream_xfer(sensor, stream_cur_block, false) != NRFX_SUCCESS)
+    {
+        if ((sensor->config.intf == COINES_SENSOR_INTF_SPI) && !spi_hw_cs)
+            nrf_gpio_pin_set(sensor->cs_pin);
+        stream_commit(sensor, false);
+        stream_bus_busy = false;
+    }
+}
+
+/*!
+ * @brief This API starts reading the next pending sensor if the bus is free
+ */
+static void stream_kick(void)
+{
+    uint8_t idx;
+
+    while (!stream_bus_busy && (stream_pending != 0) && !stream_stopping)
+    {
+        for (idx = 0; (stream_pending & (1u << idx)) == 0; idx++)
+            ;
+
+        stream_pending &= ~(1u << idx);
+        stream_cur_sensor = idx;
+        stream_cur_block = 0;
+        stream_cur_ok = true;
+        stream_bus_busy = true;
+        stream_begin_sample(&stream_sensor[idx]);
+        stream_start_block();
+    }
+}
+
+/*!
+ * @brief This API handles the end of a streaming transfer
+ */
+static void stream_xfer_done(bool ok)
+{
+    stream_sensor_t *sensor = &stream_sensor[stream_cur_sensor];
+
+    if (stream_hw_trigger)
+    {
+        /* Chip select was released and the trigger turned off by PPI. EasyDMA points to
+         * the next slot before the trigger is back on, a trigger in between is dropped. */
+        stream_commit(sensor, ok);
+        if (stream_stopping)
+        {
+            stream_bus_busy = false;
+            return;
+        }
+
+        stream_rearm(sensor);
+        return;
+    }
+
+    if ((sensor->config.intf == COINES_SENSOR_INTF_SPI) && !spi_hw_cs)
+        nrf_gpio_pin_set(sensor->cs_pin);
+
+    stream_cur_ok = stream_cur_ok && ok;
+    if (stream_cur_ok && (++stream_cur_block < sensor->blocks.no_of_blocks))
+    {
+        stream_start_block();
+        return;
+    }
+
+    stream_commit(sensor, stream_cur_ok);
+    stream_bus_busy = false;
+    stream_kick();
+}
+
+/*!
+ * @brief This API connects an event to a task (and a fork task) through a PPI channel
+ *
+ * A gated channel is in the trigger group, which the end of a transfer turns off.
+ */
+static int16_t stream_ppi_connect(uint32_t eep, uint32_t tep, uint32_t fork_tep, bool gated)
+{
+    nrf_ppi_channel_t channel;
+
+    if ((stream_ppi_count >= STREAM_MAX_PPI_CHANNELS) || (nrfx_ppi_channel_alloc(&channel) != NRFX_SUCCESS))
+        return COINES_E_FAILURE;
+
+    stream_ppi[stream_ppi_count++] = channel;
+    nrfx_ppi_channel_assign(channel, eep, tep);
+    if (fork_tep != 0)
+        nrfx_ppi_channel_fork_assign(channel, fork_tep);
+    if (gated && (nrfx_ppi_channel_include_in_group(channel, stream_ppi_group) != NRFX_SUCCESS))
+        return COINES_E_FAILURE;
+    nrfx_ppi_channel_enable(channel);
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This API releases the PPI channels used for streaming
+ */
+static void stream_ppi_release(void)
+{
+    if (stream_ppi_group_ready)
+    {
+        (void)nrfx_ppi_group_clear(stream_ppi_group);
+        (void)nrfx_ppi_group_free(stream_ppi_group);
+        stream_ppi_group_ready = false;
+    }
+
+    while (stream_ppi_count > 0)
+    {
+        stream_ppi_count--;
+        nrfx_ppi_channel_disable(stream_ppi[stream_ppi_count]);
+        nrfx_ppi_channel_free(stream_ppi[stream_ppi_count]);
+    }
+}
+
+/*!
+ * @brief This API returns the event starting a sample of a sensor
+ */
+static uint32_t stream_trigger_event(stream_sensor_t *sensor)
+{
+    if (stream_mode_cfg == COINES_STREAMING_MODE_POLLING)
+        return nrfx_timer_compare_event_address_get(&stream_tick_timer, NRF_TIMER_CC_CHANNEL0);
+    else
+        return nrfx_gpiote_in_event_addr_get(sensor->int_pin);
+}
+
+/*!
+ * @brief This API wires the triggers of the configured sensors
+ *
+ * A single transfer per sample is started by PPI without CPU. The end of the transfer turns
+ * the trigger off in hardware until stream_xfer_done() has pointed EasyDMA to the next slot.
+ * Otherwise the trigger captures the time stamp in hardware and the sensor blocks are chained
+ * by the handlers.
+ */
+static int16_t stream_triggers_init(void)
+{
+    stream_sensor_t *sensor = &stream_sensor[0];
+    nrfx_gpiote_out_config_t cs_config = NRFX_GPIOTE_CONFIG_OUT_TASK_TOGGLE(true);
+    nrfx_gpiote_in_config_t drdy_config = NRFX_GPIOTE_RAW_CONFIG_IN_SENSE_LOTOHI(true);
+    uint32_t capture;
+    uint32_t group_off;
+    int16_t rslt = COINES_SUCCESS;
+
+    if (stream_mode_cfg == COINES_STREAMING_MODE_INTERRUPT)
+    {
+        for (uint8_t i = 0; i < stream_sensor_count; i++)
+        {
+            if (nrfx_gpiote_in_init(stream_sensor[i].int_pin, &drdy_config, stream_drdy_handler) != NRFX_SUCCESS)
+                return COINES_E_FAILURE;
+        }
+    }
+
+    if (stream_hw_trigger)
+    {
+        capture = nrfx_timer_capture_task_address_get(&stream_ts_timer, sensor->ts_cc);
+        stream_cur_sensor = 0;
+        stream_begin_sample(sensor);
+        if (stream_xfer(sensor, 0, true) != NRFX_SUCCESS)
+            return COINES_E_FAILURE;
+
+        if (nrfx_ppi_group_alloc(&stream_ppi_group) != NRFX_SUCCESS)
+            return COINES_E_FAILURE;
+        stream_ppi_group_ready = true;
+        group_off = nrfx_ppi_task_addr_group_disable_get(stream_ppi_group);
+
+        if ((sensor->config.intf == COINES_SENSOR_INTF_SPI) && spi_hw_cs)
+        {
+            rslt |= stream_ppi_connect(stream_trigger_event(sensor), nrfx_spim_start_task_get(spi_bus), capture,
+                                       true);
+            rslt |= stream_ppi_connect(nrfx_spim_end_event_get(spi_bus), group_off, 0, false);
+        }
+        else if (sensor->config.intf == COINES_SENSOR_INTF_SPI)
+        {
+            if (nrfx_gpiote_out_init(sensor->cs_pin, &cs_config) != NRFX_SUCCESS)
+                return COINES_E_FAILURE;
+            nrfx_gpiote_out_task_enable(sensor->cs_pin);
+
+            rslt |= stream_ppi_connect(stream_trigger_event(sensor),
+                                       nrfx_gpiote_clr_task_addr_get(sensor->cs_pin),
+                                       nrfx_spim_start_task_get(spi_bus),
+                                       true);
+            rslt |= stream_ppi_connect(stream_trigger_event(sensor), capture, 0, true);
+            rslt |= stream_ppi_connect(nrfx_spim_end_event_get(spi_bus),
+                                       nrfx_gpiote_set_task_addr_get(sensor->cs_pin), group_off, false);
+        }
+        else
+        {
+            rslt |= stream_ppi_connect(stream_trigger_event(sensor),
+                                       nrfx_twim_start_task_get(&i2c_instance, NRFX_TWIM_XFER_TXRX),
+                                       capture,
+                                       true);
+            rslt |= stream_ppi_connect(nrfx_twim_stopped_event_get(&i2c_instance), group_off, 0, false);
+        }
+
+        if (rslt == COINES_SUCCESS)
+            rslt = (nrfx_ppi_group_enable(stream_ppi_group) == NRFX_SUCCESS) ? COINES_SUCCESS : COINES_E_FAILURE;
+    }
+    else if (stream_mode_cfg == COINES_STREAMING_MODE_POLLING)
+    {
+        rslt |= stream_ppi_connect(stream_trigger_event(sensor),
+                                   nrfx_timer_capture_task_address_get(&stream_ts_timer, STREAM_TS_CC_TICK), 0,
+                                   false);
+    }
+    else
+    {
+        for (uint8_t i = 0; i < stream_sensor_count; i++)
+        {
+            rslt |= stream_ppi_connect(stream_trigger_event(&stream_sensor[i]),
+                                       nrfx_timer_capture_task_address_get(&stream_ts_timer, stream_sensor[i].ts_cc),
+                                       0,
+                                       false);
+        }
+    }
+
+    return (rslt == COINES_SUCCESS) ? COINES_SUCCESS : COINES_E_FAILURE;
+}
+
+/*!
+ * @brief This API releases the triggers and pins used for streaming
+ */
+static void stream_triggers_uninit(void)
+{
+    stream_ppi_release();
+
+    for (uint8_t i = 0; i < stream_sensor_count; i++)
+    {
+        if (stream_mode_cfg == COINES_STREAMING_MODE_INTERRUPT)
+            nrfx_gpiote_in_uninit(stream_sensor[i].int_pin);
+
+        if (stream_sensor[i].config.intf == COINES_SENSOR_INTF_SPI)
+        {
+            if (stream_hw_trigger && !spi_hw_cs)
+                nrfx_gpiote_out_uninit(stream_sensor[i].cs_pin);
+            nrf_gpio_cfg_output(stream_sensor[i].cs_pin);
+            nrf_gpio_pin_set(stream_sensor[i].cs_pin);
+        }
+    }
+
+    /* Chip select goes back to GPIO control for the register read/write APIs */
+    if (spi_hw_cs && (stream_sensor[0].config.intf == COINES_SENSOR_INTF_SPI))
+        nrf_spim_csn_configure(spi_bus->p_reg, NRF_SPIM_PIN_NOT_CONNECTED, NRF_SPIM_CSN_POL_LOW,
+                               SPI_HS_CSN_DURATION);
+}
+
+/*!
+ * @brief This API stops streaming after the sample on the bus is received
+ *
+ * A transfer which does not end within STREAM_STOP_TIMEOUT_US is aborted.
+ */
+static void stream_stop(void)
+{
+    uint32_t wait_us = 0;
+
+    if (!stream_active)
+        return;
+
+    if (stream_mode_cfg == COINES_STREAMING_MODE_POLLING)
+    {
+        nrfx_timer_disable(&stream_tick_timer);
+        nrfx_timer_compare_int_disable(&stream_tick_timer, NRF_TIMER_CC_CHANNEL0);
+    }
+    else
+    {
+        for (uint8_t i = 0; i < stream_sensor_count; i++)
+            nrfx_gpiote_in_event_disable(stream_sensor[i].int_pin);
+    }
+
+    stream_stopping = true;
+    stream_pending = 0;
+    if (stream_hw_trigger)
+    {
+        if (stream_sensor[0].config.intf == COINES_SENSOR_INTF_SPI)
+            stream_bus_busy = nrf_spim_event_check(spi_bus->p_reg, NRF_SPIM_EVENT_STARTED);
+        else
+            stream_bus_busy = nrf_twim_event_check(i2c_instance.p_twim, NRF_TWIM_EVENT_TXSTARTED);
+    }
+
+    while (stream_bus_busy && (wait_us < STREAM_STOP_TIMEOUT_US))
+    {
+        nrf_delay_us(1);
+        wait_us++;
+    }
+
+    if (stream_bus_busy)
+    {
+        CRITICAL_REGION_ENTER();
+        bus_reset();
+        stream_bus_busy = false;
+        CRITICAL_REGION_EXIT();
+    }
+
+    stream_triggers_uninit();
+    stream_active = false;
+    stream_stopping = false;
+}
+
+/*!
+ * @brief This API starts streaming of the configured sensors
+ */
+static int16_t stream_start(enum coines_streaming_mode stream_mode)
+{
+    stream_sensor_t *sensor;
+    uint32_t ring_size;
+    uint32_t tick_us = UINT32_MAX;
+    uint32_t pin_num;
+
+    if ((stream_sensor_count == 0) || stream_active || bus_busy)
+        return COINES_E_FAILURE;
+
+    /* SPI and I2C share the sensor bus pins */
+    for (uint8_t i = 1; i < stream_sensor_count; i++)
+    {
+        if (stream_sensor[i].config.intf != stream_sensor[0].config.intf)
+            return COINES_E_NOT_SUPPORTED;
+    }
+
+    if (!((stream_sensor[0].config.intf == COINES_SENSOR_INTF_SPI) ? spi_bus_configured : i2c_bus_configured))
+        return COINES_E_FAILURE;
+
+    if (stream_timers_init() != COINES_SUCCESS)
+        return COINES_E_FAILURE;
+
+    ring_size = (STREAM_BUFFER_SIZE / stream_sensor_count) & ~3u;
+    for (uint8_t i = 0; i < stream_sensor_count; i++)
+    {
+        sensor = &stream_sensor[i];
+        stream_layout(sensor, &stream_buffer[i * ring_size], ring_size);
+        if (sensor->slots < 2)
+            return COINES_E_FAILURE;
+
+        if (sensor->config.intf == COINES_SENSOR_INTF_SPI)
+        {
+            pin_num = multi_io_map[sensor->config.cs_pin];
+            if (pin_num == 0 || pin_num == 0xff)
+                return COINES_E_FAILURE;
+            sensor->cs_pin = pin_num;
+            nrf_gpio_cfg_output(pin_num);
+            nrf_gpio_pin_set(pin_num);
+        }
+
+        if (stream_mode == COINES_STREAMING_MODE_INTERRUPT)
+        {
+            pin_num = multi_io_map[sensor->config.int_pin];
+            if (pin_num == 0 || pin_num == 0xff)
+                return COINES_E_FAILURE;
+            sensor->int_pin = pin_num;
+            sensor->ts_cc = STREAM_TS_CC_SENSOR(i);
+        }
+        else
+        {
+            sensor->period_us = sensor->config.sampling_time;
+            if (sensor->config.sampling_units == COINES_SAMPLING_TIME_IN_MILLI_SEC)
+                sensor->period_us *= 1000;
+            if (sensor->period_us == 0)
+                return COINES_E_FAILURE;
+            if (sensor->period_us < tick_us)
+                tick_us = sensor->period_us;
+            sensor->ts_cc = STREAM_TS_CC_TICK;
+        }
+    }
+
+    /* Slower sensors are sampled at every n-th tick of the fastest one */
+    if (stream_mode == COINES_STREAMING_MODE_POLLING)
+    {
+        for (uint8_t i = 0; i < stream_sensor_count; i++)
+            stream_sensor[i].divider = (stream_sensor[i].period_us + (tick_us / 2)) / tick_us;
+    }
+
+    stream_mode_cfg = stream_mode;
+    stream_hw_trigger = (stream_sensor_count == 1) && (stream_sensor[0].blocks.no_of_blocks == 1);
+    stream_rearm_failed = false;
+    stream_pending = 0;
+    stream_bus_busy = false;
+    stream_stopping = false;
+
+    /* Take the bus over from the transaction queue */
+    CRITICAL_REGION_ENTER();
+    if (!bus_busy)
+        stream_active = true;
+    CRITICAL_REGION_EXIT();
+
+    if (!stream_active)
+        return COINES_E_FAILURE;
+
+    if (bus_select(stream_sensor[0].config.intf) != COINES_SUCCESS)
+    {
+        stream_active = false;
+        return COINES_E_FAILURE;
+    }
+
+    if (stream_triggers_init() != COINES_SUCCESS)
+    {
+        stream_stop();
+        return COINES_E_FAILURE;
+    }
+
+    if (!nrfx_timer_is_enabled(&stream_ts_timer))
+        nrfx_timer_enable(&stream_ts_timer);
+
+    if (stream_mode == COINES_STREAMING_MODE_POLLING)
+    {
+        nrfx_timer_extended_compare(&stream_tick_timer,
+                                    NRF_TIMER_CC_CHANNEL0,
+                                    nrfx_timer_us_to_ticks(&stream_tick_timer, tick_us),
+                                    NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK,
+                                    !stream_hw_trigger);
+        nrfx_timer_clear(&stream_tick_timer);
+        nrfx_timer_enable(&stream_tick_timer);
+    }
+    else
+    {
+        for (uint8_t i = 0; i < stream_sensor_count; i++)
+            nrfx_gpiote_in_event_enable(stream_sensor[i].int_pin, !stream_hw_trigger);
+    }
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This API is used to send the streaming settings to the board.
+ */
+int16_t coines_config_streaming(uint8_t channel_id, struct coines_streaming_config *stream_config,
+        struct coines_streaming_blocks *data_blocks)
+{
+    stream_sensor_t *sensor;
+
+    if ((stream_config == NULL) || (data_blocks == NULL))
+        return COINES_E_NULL_PTR;
+
+    if (stream_active || (stream_sensor_count >= COINES_MAX_SENSOR_ID))
+        return COINES_E_FAILURE;
+
+    if ((data_blocks->no_of_blocks == 0) || (data_blocks->no_of_blocks > STREAM_MAX_BLOCKS))
+        return COINES_E_FAILURE;
+
+    for (uint8_t i = 0; i < data_blocks->no_of_blocks; i++)
+    {
+        if (data_blocks->no_of_data_bytes[i] == 0)
+            return COINES_E_FAILURE;
+    }
+
+    sensor = &stream_sensor[stream_sensor_count++];
+    sensor->config = *stream_config;
+    sensor->blocks = *data_blocks;
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This API is used to send the streaming settings to the board.
+ */
+int16_t coines_start_stop_streaming(enum coines_streaming_mode stream_mode, uint8_t start_stop)
+{
+    if (start_stop == COINES_STREAMING_START)
+        return stream_start(stream_mode);
 
-    if (error == NRFX_SUCCESS)
-        return COINES_SUCCESS;
-    else
-        return COINES_E_FAILURE;
+    stream_stop();
+    return COINES_SUCCESS;
 }
+
 /*!
- *  @brief This API is used to read the data in SPI communication.
+ * @brief This API is used to read the streaming sensor data.
  */
-int8_t coines_read_spi(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data,
-        uint16_t count)
+int16_t coines_read_stream_sensor_data(uint8_t sensor_id, uint32_t number_of_samples, uint8_t *data,
+                                       uint32_t *valid_samples_count)
 {
-    nrfx_err_t error;
-    uint8_t buffer[count + 1];
+    stream_sensor_t *sensor;
+    uint8_t dummy;
+    uint8_t *slot;
+    uint32_t counter;
+    uint64_t timestamp;
+    uint32_t count = 0;
+    bool with_counter;
+    bool with_timestamp;
+
+    if ((data == NULL) || (valid_samples_count == NULL))
+        return COINES_E_NULL_PTR;
 
-    uint32_t pin_num = multi_io_map[dev_addr];
-    if (pin_num == 0 || pin_num == 0xff)
+    if ((sensor_id == 0) || (sensor_id > stream_sensor_count))
+        return COINES_E_FAILURE;
+
+    sensor = &stream_sensor[sensor_id - 1];
+    dummy = (sensor->config.intf == COINES_SENSOR_INTF_SPI) ? 1 : 0;
+    with_counter = (stream_mode_cfg == COINES_STREAMING_MODE_INTERRUPT);
+    with_timestamp = with_counter ? (sensor->config.int_timestamp != 0) : stream_ts_enabled;
+
+    while ((count < number_of_samples) && (sensor->tail != sensor->head))
+    {
+        __DMB();
+        slot = &sensor->ring[sensor->tail * sensor->slot_size];
+        memcpy(&counter, &slot[0], 4);
+        memcpy(&timestamp, &slot[4], 8);
+
+        /* Same sample layout as the DD firmware, big endian counter and time stamp */
+        if (with_counter)
+        {
+            *data++ = (uint8_t)(counter >> 24);
+            *data++ = (uint8_t)(counter >> 16);
+            *data++ = (uint8_t)(counter >> 8);
+            *data++ = (uint8_t)counter;
+        }
+
+        for (uint8_t i = 0; i < sensor->blocks.no_of_blocks; i++)
+        {
+            memcpy(data, &slot[STREAM_SLOT_HEADER_SIZE + sensor->rx_offset[i] + dummy],
+                   sensor->blocks.no_of_data_bytes[i]);
+            data += sensor->blocks.no_of_data_bytes[i];
+        }
+
+        if (with_timestamp)
+        {
+            for (int8_t shift = 40; shift >= 0; shift -= 8)
+                *data++ = (uint8_t)(timestamp >> shift);
+        }
+
+        __DMB();
+        sensor->tail = (sensor->tail + 1) % sensor->slots;
+        count++;
+    }
+
+    *valid_samples_count = count;
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This API is used to trigger the timer in firmware and enable or disable system time stamp
+ */
+int16_t coines_trigger_timer(enum coines_timer_config tmr_cfg, enum coines_time_stamp_config ts_cfg)
+{
+    if (stream_timers_init() != COINES_SUCCESS)
         return COINES_E_FAILURE;
-    else
-        nrf_gpio_cfg_output(pin_num);
 
-    buffer[0] = reg_addr;
+    switch (tmr_cfg)
+    {
+        case COINES_TIMER_START:
+            if (!nrfx_timer_is_enabled(&stream_ts_timer))
+                nrfx_timer_enable(&stream_ts_timer);
+            else
+                nrfx_timer_resume(&stream_ts_timer);
+            break;
+        case COINES_TIMER_STOP:
+            nrfx_timer_pause(&stream_ts_timer);
+            break;
+        case COINES_TIMER_RESET:
+            nrfx_timer_clear(&stream_ts_timer);
+            stream_ts_wraps = 0;
+            break;
+        default:
+            return COINES_E_NOT_SUPPORTED;
+    }
 
-    spi_tx_desc.p_tx_buffer = &reg_addr;
-    spi_tx_desc.tx_length = 1;
-    spi_tx_desc.p_rx_buffer = buffer;
-    spi_tx_desc.rx_length = count + 1;
+    stream_ts_enabled = (ts_cfg == COINES_TIMESTAMP_ENABLE);
+
+    return COINES_SUCCESS;
+}
 
-    nrf_gpio_pin_write(pin_num, 0);
-    error = nrfx_spim_xfer(&spi_instance, &spi_tx_desc, 0);
-    nrf_gpio_pin_write(pin_num, 1);
+/*!
+ * @brief This API returns the number of milliseconds passed since the program started
+ */
+uint32_t coines_get_millis()
+{
+    return g_millis;
+}
 
-    memcpy(reg_data, &buffer[1], count);
+/*!
+ * @brief This API starts the free running time base of coines_get_micros()
+ */
+static int16_t micros_timer_init(void)
+{
+    nrfx_timer_config_t timer_config = {
+        .frequency = NRF_TIMER_FREQ_1MHz,
+        .mode = NRF_TIMER_MODE_TIMER,
+        .bit_width = NRF_TIMER_BIT_WIDTH_32,
+        .interrupt_priority = MICROS_IRQ_PRIORITY,
+        .p_context = NULL
+    };
 
-    if (error == NRFX_SUCCESS)
+    if (micros_ready)
         return COINES_SUCCESS;
-    else
+
+    if (nrfx_timer_init(&micros_timer, &timer_config, micros_timer_handler) != NRFX_SUCCESS)
         return COINES_E_FAILURE;
+
+    /* COMPARE0 at 0 marks every wrap of the 32 bit counter */
+    nrfx_timer_compare(&micros_timer, MICROS_CC_WRAP, 0, true);
+    nrfx_timer_enable(&micros_timer);
+
+    micros_ready = true;
+    return COINES_SUCCESS;
 }
+
 /*!
- *  @brief This API is used for introducing a delay in milliseconds
+ * @brief This API extends a 32 bit value of the time base to 64 bit
+ *
+ * Called with interrupts disabled or at the priority of the wrap interrupt.
  */
-void coines_delay_msec(uint32_t delay_ms)
+static uint64_t micros_extend(uint32_t captured)
 {
-    nrf_delay_ms(delay_ms);
+    uint32_t now = nrfx_timer_capture(&micros_timer, MICROS_CC_NOW);
+    uint32_t wraps = micros_wraps;
+
+    /* Wrap not handled yet by the timer interrupt */
+    if (nrf_timer_event_check(micros_timer.p_reg, nrf_timer_compare_event_get(MICROS_CC_WRAP)) &&
+        (now < 0x80000000))
+        wraps++;
+
+    /* Captured before the last wrap */
+    if ((captured > now) && (wraps > 0))
+        wraps--;
+
+    return ((uint64_t)wraps << 32) | captured;
 }
 
 /*!
- *  @brief This API is used for introducing a delay in microseconds
+ * @brief This API returns the number of microseconds passed since the program started
  */
-void coines_delay_usec(uint32_t delay_us)
+uint64_t coines_get_micros(void)
 {
-    nrf_delay_us(delay_us);
+    uint64_t micros;
+
+    if (micros_timer_init() != COINES_SUCCESS)
+        return 0;
+
+    CRITICAL_REGION_ENTER();
+    micros = micros_extend(nrfx_timer_capture(&micros_timer, MICROS_CC_NOW));
+    CRITICAL_REGION_EXIT();
+
+    return micros;
 }
 
 /*!
- * @brief This API is used to send the streaming settings to the board.
+ * @brief This function inserts a task in the list, after the tasks with the same deadline
+ *
+ * Called with interrupts disabled.
  */
-int16_t coines_config_streaming(uint8_t channel_id, struct coines_streaming_config *stream_config,
-        struct coines_streaming_blocks *data_blocks)
+static void sched_insert(struct coines_sched_task *task)
 {
-    return COINES_E_NOT_SUPPORTED;
+    struct coines_sched_task **link = &sched_head;
+
+    while ((*link != NULL) && ((*link)->deadline <= task->deadline))
+    {
+        link = &(*link)->next;
+    }
+    task->next = *link;
+    *link = task;
 }
 
 /*!
- * @brief This API is used to send the streaming settings to the board.
+ * @brief This function removes a task from the list
+ *
+ * Called with interrupts disabled.
  */
-int16_t coines_start_stop_streaming(enum coines_streaming_mode stream_mode, uint8_t start_stop)
+static void sched_remove(struct coines_sched_task *task)
 {
-    return COINES_E_NOT_SUPPORTED;
+    struct coines_sched_task **link = &sched_head;
+
+    while (*link != NULL)
+    {
+        if (*link == task)
+        {
+            *link = task->next;
+            break;
+        }
+        link = &(*link)->next;
+    }
 }
 
 /*!
- * @brief This API is used to read the streaming sensor data.
+ * @brief This function sets the time base compare to the next deadline
+ *
+ * A deadline more than 2^32 us away matches early, the dispatcher then arms it again.
+ *
+ * @return false if the deadline passed while arming, the compare would not match in time
  */
-int16_t coines_read_stream_sensor_data(uint8_t sensor_id, uint32_t number_of_samples, uint8_t *data,
-                                       uint32_t *valid_samples_count)
+static bool sched_arm(uint64_t deadline)
 {
-    return COINES_E_NOT_SUPPORTED;
+    nrfx_timer_compare(&micros_timer, MICROS_CC_SCHED, (uint32_t)deadline, true);
+
+    return coines_get_micros() < deadline;
 }
 
 /*!
- * @brief This API is used to trigger the timer in firmware and enable or disable system time stamp
+ * @brief This API schedules a task
  */
-int16_t coines_trigger_timer(enum coines_timer_config tmr_cfg, enum coines_time_stamp_config ts_cfg)
+int16_t coines_sched_start(struct coines_sched_task *task,
+                           uint32_t delay_us,
+                           uint32_t period_us,
+                           coines_sched_cb_t callback,
+                           void *context)
 {
-    return COINES_E_NOT_SUPPORTED;
+    if ((task == NULL) || (callback == NULL))
+        return COINES_E_NULL_PTR;
+
+    if (micros_timer_init() != COINES_SUCCESS)
+        return COINES_E_FAILURE;
+
+    CRITICAL_REGION_ENTER();
+    if (task->active)
+        sched_remove(task);
+    task->callback = callback;
+    task->context = context;
+    task->period_us = period_us;
+    task->deadline = coines_get_micros() + delay_us;
+    task->due_us = task->deadline;
+    task->missed = 0;
+    task->active = 1;
+    sched_insert(task);
+    CRITICAL_REGION_EXIT();
+
+    return COINES_SUCCESS;
 }
 
 /*!
- * @brief This API returns the number of milliseconds passed since the program started
+ * @brief This API removes a task from the scheduler
  */
-uint32_t coines_get_millis()
+int16_t coines_sched_stop(struct coines_sched_task *task)
 {
-    return g_millis;
+    if (task == NULL)
+        return COINES_E_NULL_PTR;
+
+    CRITICAL_REGION_ENTER();
+    if (task->active)
+        sched_remove(task);
+    task->active = 0;
+    CRITICAL_REGION_EXIT();
+
+    return COINES_SUCCESS;
 }
 
 /*!
- * @brief Attaches a interrupt to a Multi-IO pin
+ * @brief This API runs the due tasks, then sleeps until the next deadline or any interrupt
  */
-void coines_attach_interrupt(enum coines_multi_io_pin pin_number, void (*callback)(void),
-        enum coines_pin_interrupt_mode int_mode)
+void coines_sched_dispatch(void)
+{
+    struct coines_sched_task *task;
+    coines_sched_cb_t callback = NULL;
+    void *context = NULL;
+    uint64_t now = coines_get_micros();
+    uint64_t late;
+    bool sleep;
+
+    do
+    {
+        CRITICAL_REGION_ENTER();
+        task = sched_head;
+        if ((task != NULL) && (task->deadline <= now))
+        {
+            sched_head = task->next;
+            task->due_us = task->deadline;
+            callback = task->callback;
+            context = task->context;
+            if (task->period_us != 0)
+            {
+                task->deadline += task->period_us;
+                if (task->deadline <= now)
+                {
+                    /* Keep the period grid, skip the runs missed */
+                    late = (now - task->deadline) / task->period_us + 1;
+                    task->deadline += late * task->period_us;
+                    task->missed += (uint32_t)late;
+                }
+                sched_insert(task);
+            }
+            else
+            {
+                task->active = 0;
+            }
+        }
+        else
+        {
+            task = NULL;
+        }
+        CRITICAL_REGION_EXIT();
+
+        if (task != NULL)
+        {
+            callback(context);
+            now = coines_get_micros();
+        }
+    } while (task != NULL);
+
+    CRITICAL_REGION_ENTER();
+    sleep = (sched_head == NULL) || sched_arm(sched_head->deadline);
+    CRITICAL_REGION_EXIT();
+
+    /* An interrupt after arming sets the event register, WFE then returns at once */
+    if (sleep)
+        __WFE();
+}
+
+/*!
+ * @brief This API releases the interrupt attached to a pin
+ */
+static void pin_isr_detach(uint32_t pin_num)
+{
+    pin_isr_t *isr = &pin_isr[pin_num];
+
+    if ((isr->callback == NULL) && (isr->timed_callback == NULL))
+        return;
+
+    nrfx_gpiote_in_event_disable(pin_num);
+    nrfx_gpiote_in_uninit(pin_num);
+
+    if (isr->cc < MICROS_CC_PIN_COUNT)
+    {
+        nrfx_ppi_channel_disable(isr->ppi);
+        nrfx_ppi_channel_free(isr->ppi);
+        micros_cc_used &= ~(1u << isr->cc);
+    }
+
+    isr->callback = NULL;
+    isr->timed_callback = NULL;
+}
+
+/*!
+ * @brief This API attaches an interrupt to a pin
+ *
+ * With a timed callback, the edge captures the time base through PPI while a capture channel is free.
+ */
+static int16_t pin_isr_attach(enum coines_multi_io_pin pin_number, void (*callback)(void),
+                              coines_timed_isr_cb_t timed_callback, enum coines_pin_interrupt_mode int_mode)
 {
     uint32_t pin_num = multi_io_map[pin_number];
+    pin_isr_t *isr;
+    uint8_t cc;
+
     if (pin_num == 0 || pin_num == 0xff)
-        return;
+        return COINES_E_FAILURE;
+
+    /* Attaching again replaces the callback */
+    pin_isr_detach(pin_num);
 
     if (int_mode == COINES_PIN_INTERRUPT_CHANGE)
         gpio_config.sense = NRF_GPIOTE_POLARITY_TOGGLE;
@@ -621,10 +2411,55 @@ void coines_attach_interrupt(enum coines_multi_io_pin pin_number, void (*callbac
     if (int_mode == COINES_PIN_INTERRUPT_FALLING_EDGE)
         gpio_config.sense = NRF_GPIOTE_POLARITY_HITOLO;
 
-    nrfx_gpiote_in_init(pin_num, &gpio_config, gpioHandler);
+    if (nrfx_gpiote_in_init(pin_num, &gpio_config, gpioHandler) != NRFX_SUCCESS)
+        return COINES_E_FAILURE;
+
+    isr = &pin_isr[pin_num];
+    isr->pin_number = pin_number;
+    isr->cc = MICROS_CC_PIN_COUNT;
+
+    if ((timed_callback != NULL) && (micros_timer_init() == COINES_SUCCESS))
+    {
+        for (cc = 0; (cc < MICROS_CC_PIN_COUNT) && (micros_cc_used & (1u << cc)); cc++)
+            ;
+
+        if ((cc < MICROS_CC_PIN_COUNT) && (nrfx_ppi_channel_alloc(&isr->ppi) == NRFX_SUCCESS))
+        {
+            nrfx_ppi_channel_assign(isr->ppi,
+                                    nrfx_gpiote_in_event_addr_get(pin_num),
+                                    nrfx_timer_capture_task_address_get(&micros_timer, MICROS_CC_PIN(cc)));
+            nrfx_ppi_channel_enable(isr->ppi);
+            micros_cc_used |= (1u << cc);
+            isr->cc = cc;
+        }
+    }
+
+    isr->callback = callback;
+    isr->timed_callback = timed_callback;
     nrfx_gpiote_in_event_enable(pin_num, true);
-    isr_cb[pin_number] = callback;
 
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief Attaches a interrupt to a Multi-IO pin
+ */
+void coines_attach_interrupt(enum coines_multi_io_pin pin_number, void (*callback)(void),
+        enum coines_pin_interrupt_mode int_mode)
+{
+    (void)pin_isr_attach(pin_number, callback, NULL, int_mode);
+}
+
+/*!
+ * @brief Attaches a interrupt to a Multi-IO pin, passing the time of the edge to the callback
+ */
+int16_t coines_attach_timed_interrupt(enum coines_multi_io_pin pin_number, coines_timed_isr_cb_t callback,
+        enum coines_pin_interrupt_mode int_mode)
+{
+    if (callback == NULL)
+        return COINES_E_NULL_PTR;
+
+    return pin_isr_attach(pin_number, NULL, callback, int_mode);
 }
 
 /*!
@@ -640,9 +2475,7 @@ void coines_detach_interrupt(enum coines_multi_io_pin pin_number)
         return;
 
     /* Cleanup */
-    isr_cb[pin_number] = NULL;
-    nrfx_gpiote_in_uninit(pin_num);
-    nrfx_gpiote_in_event_disable(pin_num);
+    pin_isr_detach(pin_num);
 }
 
 
@@ -651,11 +2484,135 @@ void coines_detach_interrupt(enum coines_multi_io_pin pin_number)
  */
 static void gpioHandler(nrfx_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
 {
-    for (int i = 0; i < 24; i++)
+    pin_isr_t *isr = &pin_isr[pin];
+    uint64_t timestamp;
+
+    if (isr->timed_callback != NULL)
+    {
+        /* Pins without a capture channel get the time the handler runs */
+        if (isr->cc < MICROS_CC_PIN_COUNT)
+            timestamp = micros_extend(nrfx_timer_capture_get(&micros_timer, MICROS_CC_PIN(isr->cc)));
+        else
+            timestamp = micros_extend(nrfx_timer_capture(&micros_timer, MICROS_CC_NOW));
+
+        isr->timed_callback(isr->pin_number, timestamp);
+    }
+    else if (isr->callback != NULL)
+    {
+        isr->callback();
+    }
+}
+
+/*!
+ * @brief SPIM handler, the transfer belongs to streaming or to the asynchronous API
+ */
+static void spi_evt_handler(nrfx_spim_evt_t const * p_event, void * p_context)
+{
+    if (stream_active)
+    {
+        stream_xfer_done(true);
+        return;
+    }
+
+    if (bus_data_len != 0)
+    {
+        if (bus_spi_data_phase() == NRFX_SUCCESS)
+            return;
+        nrf_gpio_pin_write(bus_cs_pin, 1);
+        bus_done(COINES_E_COMM_IO_ERROR);
+        return;
+    }
+
+    nrf_gpio_pin_write(bus_cs_pin, 1);
+    bus_done(COINES_SUCCESS);
+}
+
+/*!
+ * @brief TWIM handler, the transfer belongs to streaming or to the asynchronous API
+ */
+static void i2c_evt_handler(nrfx_twim_evt_t const * p_event, void * p_context)
+{
+    if (stream_active)
+    {
+        stream_xfer_done(p_event->type == NRFX_TWIM_EVT_DONE);
+        return;
+    }
+
+    bus_done((p_event->type == NRFX_TWIM_EVT_DONE) ? COINES_SUCCESS : COINES_E_COMM_IO_ERROR);
+}
+
+/*!
+ * @brief Data ready handler of interrupt streaming, when samples are read block by block
+ */
+static void stream_drdy_handler(nrfx_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
+{
+    /* With a single transfer per sample only on after a failed re-arm, the sample is lost */
+    if (stream_hw_trigger)
+    {
+        if (stream_rearm_failed && !stream_stopping)
+        {
+            stream_sensor[0].dropped++;
+            stream_rearm(&stream_sensor[0]);
+        }
+        return;
+    }
+
+    for (uint8_t i = 0; i < stream_sensor_count; i++)
+    {
+        if (stream_sensor[i].int_pin == pin)
+            stream_pending |= (1u << i);
+    }
+
+    stream_kick();
+}
+
+/*!
+ * @brief Sample clock handler of polling streaming, when samples are read block by block
+ */
+static void stream_tick_timer_handler(nrf_timer_event_t event_type, void * p_context)
+{
+    /* With a single transfer per sample only on after a failed re-arm, the sample is lost */
+    if (stream_hw_trigger)
+    {
+        if (stream_rearm_failed && !stream_stopping)
+        {
+            stream_sensor[0].dropped++;
+            stream_rearm(&stream_sensor[0]);
+        }
+        return;
+    }
+
+    for (uint8_t i = 0; i < stream_sensor_count; i++)
     {
-        if (pin == multi_io_map[i] && isr_cb[i] != NULL)
-            isr_cb[i]();
+        if (++stream_sensor[i].tick_count >= stream_sensor[i].divider)
+        {
+            stream_sensor[i].tick_count = 0;
+            stream_pending |= (1u << i);
+        }
     }
+
+    stream_kick();
+}
+
+/*!
+ * @brief Time base handler of coines_get_micros(), counts the wraps of the 32 bit counter
+ */
+static void micros_timer_handler(nrf_timer_event_t event_type, void * p_context)
+{
+    if (event_type == nrf_timer_compare_event_get(MICROS_CC_WRAP))
+        micros_wraps++;
+    else if (event_type == nrf_timer_compare_event_get(MICROS_CC_SCHED))
+        /* Only wakes coines_sched_dispatch(), which arms the next deadline */
+        nrfx_timer_compare_int_disable(&micros_timer, MICROS_CC_SCHED);
+}
+
+/*!
+ * @brief Time stamp timer handler, counts the wraps of the 32 bit counter
+ */
+static void stream_ts_timer_handler(nrf_timer_event_t event_type, void * p_context)
+{
+    if (event_type == nrf_timer_compare_event_get(STREAM_TS_CC_WRAP))
+        stream_ts_wraps++;
 }
 
 /*!
@@ -683,12 +2640,7 @@ int __attribute__((weak)) _write(int fd, const void *buffer, int len)
     }
 
     if((fd == 1 || fd == 2) && serial_connected == true)
-    {
-        while (tx_pending);
-        app_usbd_cdc_acm_write(&m_app_cdc_acm, buffer, len);
-        tx_pending = true;
-        return len;
-    }
+        return cdc_write(buffer, len);
     else if (fd >= 3)
         return flogfs_write(&write_file[fd - 3], buffer, len);
     else
@@ -705,8 +2657,7 @@ int __attribute__((weak)) _read(int fd, void *buffer, int len)
 
     if (fd == 0)
     {
-        app_usbd_cdc_acm_read(&m_app_cdc_acm, buffer, len);
-        return len;
+        return cdc_read(buffer, len);
     }
     else
     {
@@ -24,9 +24,12 @@
 #include "nrf_drv_power.h"
 #include "nrfx_spim.h"
 #include "nrfx_twim.h"
+#include "nrfx_timer.h"
+#include "nrfx_ppi.h"
 
 #include "app_error.h"
 #include "app_util.h"
+#include "app_util_platform.h"
 #include "app_usbd_core.h"
 #include "app_usbd.h"
 #include "app_usbd_string_desc.h"
@@ -55,6 +58,8 @@
 #define I2C_SEN_SCL					NRF_GPIO_PIN_MAP(0,16)
 
 #define SPI_INSTANCE				1
+#define SPI_HS_INSTANCE				3 /* SPIM3, 16 MHz and 32 MHz with hardware chip select */
+#define SPI_HS_CSN_DURATION			4 /* Chip select setup/hold in 64 MHz cycles (62.5 ns) */
 #define SPI_I2C_SEN_SCK				NRF_GPIO_PIN_MAP(0, 16) /* Sharing I2C with SPI Pins*/
 #define SPI_I2C_SEN_MOSI			NRF_GPIO_PIN_MAP(0, 6) /* Sharing I2C with SPI Pins*/
 #define SPI_SEN_MISO				NRF_GPIO_PIN_MAP(0, 15)
@@ -68,6 +73,9 @@
 #define CDC_ACM_DATA_EPIN       NRF_DRV_USBD_EPIN1
 #define CDC_ACM_DATA_EPOUT      NRF_DRV_USBD_EPOUT1
 
+#define CDC_TX_RING_SIZE        4096 /* stdout/stderr, power of 2 */
+#define CDC_RX_RING_SIZE        512  /* stdin, power of 2, at least 2 packets */
+
 #define MCU_LED_R               NRF_GPIO_PIN_MAP(0,7)
 #define MCU_LED_G               NRF_GPIO_PIN_MAP(0,11)
 #define MCU_LED_B               NRF_GPIO_PIN_MAP(0,12)
@@ -76,6 +84,82 @@
 #define SWITCH2                 NRF_GPIO_PIN_MAP(0,25)
 
 #define LED_BLINK_MAX_DELAY     (64)
+
+#define BUS_STAGING_SIZE            256 /* Write data outside RAM is copied here for EasyDMA */
+#define BUS_QUEUE_SIZE              16  /* Entries per queue, one is kept free */
+#define BUS_QUEUE_IRQ               0   /* Transfers queued from interrupt handlers, served first */
+#define BUS_QUEUE_THREAD            1   /* Transfers queued from the main loop */
+#define BUS_QUEUE_COUNT             2
+#define BUS_SYNC_TIMEOUT_US         100000  /* Wait of a blocking transfer, plus BUS_SYNC_TIMEOUT_US_PER_BYTE */
+#define BUS_SYNC_TIMEOUT_US_PER_BYTE 100    /* One byte at 100 kHz I2C takes 90 us */
+
+#define MICROS_TIMER_INSTANCE       4   /* Free running 1 MHz time base of coines_get_micros(), never paused */
+#define MICROS_IRQ_PRIORITY         6   /* Same as GPIOTE, pin time stamps are extended without preemption */
+#define MICROS_CC_WRAP              NRF_TIMER_CC_CHANNEL0
+#define MICROS_CC_NOW               NRF_TIMER_CC_CHANNEL1
+#define MICROS_CC_PIN(n)            ((nrf_timer_cc_channel_t)(NRF_TIMER_CC_CHANNEL2 + (n)))
+#define MICROS_CC_PIN_COUNT         3   /* Pin interrupts with a time stamp captured in hardware */
+#define MICROS_CC_SCHED             NRF_TIMER_CC_CHANNEL5 /* Next deadline of the scheduler */
+
+#define LOG_GC_PERIOD_US            10000 /* Flash garbage collection while logging to a file, one erase per run */
+
+#define STREAM_TICK_TIMER_INSTANCE  2   /* Sample clock of polling streaming */
+#define STREAM_TS_TIMER_INSTANCE    3   /* Free running 1 MHz time stamp counter */
+#define STREAM_IRQ_PRIORITY         6   /* Same as SPIM/TWIM/GPIOTE, streaming handlers never preempt each other */
+
+#define STREAM_TS_CC_WRAP           NRF_TIMER_CC_CHANNEL0
+#define STREAM_TS_CC_TICK           NRF_TIMER_CC_CHANNEL1
+#define STREAM_TS_CC_SENSOR(n)      ((nrf_timer_cc_channel_t)(NRF_TIMER_CC_CHANNEL2 + (n)))
+#define STREAM_TS_CC_NOW            NRF_TIMER_CC_CHANNEL5
+
+#define STREAM_BUFFER_SIZE          (32 * 1024)
+#define STREAM_MAX_BLOCKS           10
+#define STREAM_SLOT_HEADER_SIZE     12  /* Packet counter (4 bytes) + time stamp (8 bytes) */
+#define STREAM_MAX_SAMPLE_SIZE      (STREAM_SLOT_HEADER_SIZE + (STREAM_MAX_BLOCKS * 256))
+#define STREAM_MAX_PPI_CHANNELS     4
+#define STREAM_STOP_TIMEOUT_US      500000  /* Longest sample, 10 blocks of 256 bytes at 100 kHz I2C, takes ~230 ms */
+
+/*!
+ * @brief Interrupt attached to a pin, indexed by the nRF pin number
+ */
+typedef struct
+{
+    void (*callback)(void);
+    coines_timed_isr_cb_t timed_callback;
+    enum coines_multi_io_pin pin_number;
+    uint8_t cc;                             /* Capture channel index, MICROS_CC_PIN_COUNT if none */
+    nrf_ppi_channel_t ppi;                  /* GPIOTE IN event -> TIMER capture */
+} pin_isr_t;
+
+/*!
+ * @brief Streaming state of one sensor
+ *
+ * Samples are received by EasyDMA into slots of the ring buffer.
+ * A slot is the slot header followed by the bytes received for each block,
+ * including the dummy byte clocked in while sending the register address on SPI.
+ */
+typedef struct
+{
+    struct coines_streaming_config config;
+    struct coines_streaming_blocks blocks;
+    uint8_t tx_addr[STREAM_MAX_BLOCKS];     /* Register address of each block, EasyDMA source */
+    uint16_t rx_offset[STREAM_MAX_BLOCKS];  /* Offset of each block in the slot data */
+    uint16_t rx_len;                        /* Bytes received per sample */
+    uint16_t slot_size;
+    uint8_t *ring;
+    uint32_t slots;
+    uint8_t *slot;                          /* Slot receiving the current sample */
+    volatile uint32_t head;                 /* Written by the transfer handler */
+    volatile uint32_t tail;                 /* Written by coines_read_stream_sensor_data() */
+    uint32_t packet_count;
+    volatile uint32_t dropped;
+    uint32_t cs_pin;
+    uint32_t int_pin;
+    uint32_t period_us;
+    uint32_t divider;                       /* Polling: sample every divider-th tick */
+    uint32_t tick_count;
+    nrf_timer_cc_channel_t ts_cc;
+} stream_sensor_t;
 /**********************************************************************************/
 /* functions */
 /**********************************************************************************/
@@ -92,10 +176,22 @@ APP_USBD_CDC_ACM_GLOBAL_DEF(m_app_cdc_acm,
         APP_USBD_CDC_COMM_PROTOCOL_NONE
         );
 
-typedef void (*ISR_CB)(void);
-static ISR_CB isr_cb[24];
 static void gpioHandler(nrfx_gpiote_pin_t pin, nrf_gpiote_polarity_t action);
 
+static void spi_evt_handler(nrfx_spim_evt_t const * p_event, void * p_context);
+static void i2c_evt_handler(nrfx_twim_evt_t const * p_event, void * p_context);
+static void stream_drdy_handler(nrfx_gpiote_pin_t pin, nrf_gpiote_polarity_t action);
+static void stream_tick_timer_handler(nrf_timer_event_t event_type, void * p_context);
+static void stream_ts_timer_handler(nrf_timer_event_t event_type, void * p_context);
+static int16_t micros_timer_init(void);
+static void micros_timer_handler(nrf_timer_event_t event_type, void * p_context);
+static void sched_insert(struct coines_sched_task *task);
+static void sched_remove(struct coines_sched_task *task);
+static bool sched_arm(uint64_t deadline);
+static void cdc_tx_kick(void);
+static void cdc_rx_arm(void);
+static void log_gc_tick(void *context);
+
 /****** Reserved Memory Area for performing application switch - 16 bytes******/
 #define  MAGIC_LOCATION         (0x2003FFF4)
 #define  MAGIC_INFO_ADDR        ((int8_t *)(MAGIC_LOCATION))
@@ -11,6 +11,7 @@ ASM_SRCS_COINES = $(nRF5_SDK_DIR)/modules/nrfx/mdk/gcc_startup_nrf52840.S \
 
 C_SRCS_COINES += \
 mcu_app30.c \
+../coines_profile.c \
 support/ds28e05/ds28e05.c \
 support/eeprom/app30_eeprom.c \
 support/FLogFs/src/flogfs.c \
@@ -22,6 +23,7 @@ $(nRF5_SDK_DIR)/modules/nrfx/drivers/src/nrfx_clock.c  \
 $(nRF5_SDK_DIR)/modules/nrfx/drivers/src/nrfx_gpiote.c \
 $(nRF5_SDK_DIR)/modules/nrfx/drivers/src/nrfx_power.c  \
 $(nRF5_SDK_DIR)/modules/nrfx/drivers/src/nrfx_power_clock.c \
+$(nRF5_SDK_DIR)/modules/nrfx/drivers/src/nrfx_ppi.c \
 $(nRF5_SDK_DIR)/modules/nrfx/drivers/src/nrfx_spim.c  \
 $(nRF5_SDK_DIR)/modules/nrfx/drivers/src/nrfx_systick.c \
 $(nRF5_SDK_DIR)/modules/nrfx/drivers/src/nrfx_timer.c \
@@ -58,6 +58,14 @@ either expressed or implied, of the FLogFS Project.
 //! @{
 //! The maximum file name length allowed
 #define FLOG_MAX_FNAME_LEN (32)
+//! The number of files whose block chain is indexed for seeks and file sizes
+#define FLOG_FILE_INDEX_FILES (2)
+//! Block positions kept per indexed file (even). A seek follows at most
+//! (blocks in the file / FLOG_FILE_INDEX_ENTRIES) + 1 block links
+#define FLOG_FILE_INDEX_ENTRIES (64)
+//! Files in the in-RAM filename index (a power of two). Beyond 3/4 of it, the
+//! lookups scan the inode table
+#define FLOG_NAME_INDEX_SIZE (256)
 //! @}
 
 #include "flogfs_conf.h"
@@ -110,6 +118,18 @@ typedef struct {
 
 typedef flog_inode_iterator_t flogfs_ls_iterator_t;
 
+/*!
+ * @brief Block counts of the file system
+ */
+typedef struct {
+    //! Blocks which can be allocated
+    flog_block_idx_t free_blocks;
+    //! Blocks of invalidated files, which flog_delete_invalidated_block() erases
+    flog_block_idx_t invalidated_blocks;
+    //! Blocks holding files and the inode table
+    flog_block_idx_t used_blocks;
+} flogfs_block_usage_t;
+
 #define FLOG_RESULT(x) ((x) ? FLOG_SUCCESS : FLOG_FAILURE)
 
 /*!
@@ -185,9 +205,28 @@ flog_result_t flogfs_format();
 
 /*!
  @brief Mount the FLogFS filesystem and prepare it for use
+
+ After flogfs_unmount() or flogfs_checkpoint() the mount starts from the
+ checkpoint record and reads only a few pages. Otherwise the inode table is
+ scanned and the first allocation and block count scan the blocks.
  */
 flog_result_t flogfs_mount();
 
+/*!
+ @brief Write a checkpoint record of the allocation state, for a fast mount
+ @retval FLOG_FAILURE if not mounted or a file is open for writing
+
+ The blocks of invalidated files are erased first. The next change of the file
+ system outdates the record. Nothing is written if the record is up to date.
+ */
+flog_result_t flogfs_checkpoint();
+
+/*!
+ @brief Unmount the filesystem cleanly, writing a checkpoint record
+ @retval FLOG_FAILURE if a file is open for writing
+ */
+flog_result_t flogfs_unmount();
+
 /*!
  @brief Open a file to read
  @param file The file structure to use
@@ -279,30 +318,67 @@ void flogfs_start_ls(flogfs_ls_iterator_t *iter);
  */
 uint_fast8_t flogfs_ls_iterate(flogfs_ls_iterator_t *iter, char *fname_dst);
 
+/*!
+ @brief Read another filename and the size of the file, without opening it
+ @param[out] fname_dst A destination to copy the filename
+ @param[out] size The size of the file
+ @retval 1 Successful
+ @retval 0 This is the end of the data
+
+ The size comes from the filename index. It is looked up on flash the first
+ time after the mount, and kept current by the writes afterwards.
+ */
+uint_fast8_t flogfs_ls_iterate_size(flogfs_ls_iterator_t *iter, char *fname_dst, uint32_t *size);
+
 /*!
  @brief Unlock the inode table when done listing
  */
 void flogfs_stop_ls(flogfs_ls_iterator_t *iter);
 
 /*!
- @brief Remove a file from the filesystem
+ @brief Remove a file from the filesystem, leaving the erase of its blocks to
+ the garbage collection
  Note: This done as part of SOLTEAM-851 task
  @param filename The name of the file
  */
 flog_result_t flogfs_invalidate(char const *filename);
 
 /*!
- @brief Delete the invalidated file blocks
- Note: This done as part of SOLTEAM-851 task, this function has to be called after
- flog_invalidate_file_block in flogfs_invlaidate function called .
+ @brief Erase the blocks of all invalidated files now
+ Note: This done as part of SOLTEAM-851 task. flogfs_gc() erases them a few at a
+ time instead.
  */
 void flog_delete_invalidated_block(void);
 
+/*!
+ @brief Run the garbage collection in idle time
+ @param budget_us The time to spend, in microseconds of the flash timing
+                  estimates FS_ERASE_US and FS_PAGE_READ_US
+ @returns The number of blocks of invalidated files still to erase
+
+ The blocks of invalidated files are erased one at a time, in the order of the
+ invalidations. When none is left, the blocks for the next allocations are
+ claimed, erasing blocks of an earlier format. The last erase started is left
+ running on the flash, so a budget of FS_ERASE_US returns without waiting.
+ An allocation which finds no free block erases the queued blocks itself.
+ */
+uint32_t flogfs_gc(uint32_t budget_us);
+
 /*!
  @brief Returns the available free space in the memory
+
+ The free blocks are counted by a scan on the first call after the mount and
+ kept current by the file system afterwards.
  */
 uint32_t flogfs_available_space();
 
+/*!
+ @brief Get the number of free, invalidated and used blocks
+ @param[out] usage The block counts
+ @retval FLOG_FAILURE if the file system is not mounted
+ */
+flog_result_t flogfs_block_usage(flogfs_block_usage_t *usage);
+
 
 typedef struct flogfs_walk_inode_block_state_t {
     flog_sector_idx_t sector;
@@ -53,13 +53,19 @@ either expressed or implied, of the FLogFS Project.
 #define FS_SECTOR_SIZE       (512)
 #define FS_SECTORS_PER_PAGE  (4)
 #define FS_PAGES_PER_BLOCK   (64)
-#define FS_NUM_BLOCKS        (1024)
+#define FS_NUM_BLOCKS        (2048)
 //! @}
 
 #define FS_SECTORS_PER_BLOCK (FS_SECTORS_PER_PAGE * FS_PAGES_PER_BLOCK)
 
 //! The number of blocks to preallocate
 #define FS_PREALLOCATE_SIZE  (10)
+
+//! @name Flash timing estimates for the time budget of flogfs_gc()
+//! @{
+#define FS_ERASE_US          (2000)
+#define FS_PAGE_READ_US      (60)
+//! @}
 #define FS_INODE0_MAX_BLOCK (32)
 
 //! @} // FLogConf
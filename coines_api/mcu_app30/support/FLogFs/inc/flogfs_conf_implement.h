@@ -38,6 +38,7 @@ either expressed or implied, of the FLogFS Project.
 #include "flogfs.h"
 #include "w25n01gwtbig.h"
 #include <stdlib.h>
+#include <string.h>
 
 
 typedef uint8_t flash_spare_t[59];
@@ -48,14 +49,17 @@ typedef uint8_t fs_lock_t;
 
 static inline void fs_lock_initialize(fs_lock_t * lock){
 	//chMtxInit(lock);
+	(void)lock;
 }
 
 static inline void fs_lock(fs_lock_t * lock){
 	//chMtxLock(lock);
+	(void)lock;
 }
 
 static inline void fs_unlock(fs_lock_t * lock){
 	//chMtxUnlock();
+	(void)lock;
 }
 
 static flash_spare_t flog_spare_buffer;
@@ -63,9 +67,167 @@ static uint16_t flash_block;
 static uint16_t flash_page;
 static uint8_t have_metadata;
 static uint8_t page_open;
+/* Writes are loaded into the page buffer of the chip and programmed by flash_commit() */
+static uint8_t page_loaded;
+static uint32_t loaded_page;
+/* Page read into the page buffer of the chip last, reads from it skip the page read */
+static uint8_t buffer_valid;
+static uint32_t buffer_page;
+/* Read-ahead of flogfs_read(): once a read went through one page and moves on to the next, the
+ * whole page with its spare area is read to RAM in one transfer, and the chip reads the page
+ * after it meanwhile */
+#define FLASH_NO_PAGE 0xFFFFFFFF
+static uint8_t read_ahead;
+static uint8_t ahead_valid;
+static uint32_t ahead_page;
+static uint32_t ahead_last_page;
+static uint8_t ahead_sequential;
+static uint8_t ahead_buffer[W25N01GW_PAGE_SIZE + W25N01GW_SPARE_SIZE];
+
+/*!
+ @brief Page number of the open page on the chip, the page numbers go on from one die of a
+ W25M to the next
+ */
+static inline uint32_t flash_page_number(){
+	return flash_page + ((uint32_t)flash_block * FS_PAGES_PER_BLOCK);
+}
+
+/*!
+ @brief Program the page buffer of the chip, if writes are waiting in it
+
+ The program runs on the chip while FLogFS and the application go on, the next flash
+ command to the same die waits for its end. The other die of a W25M takes commands
+ meanwhile.
+ */
+static inline flog_result_t flash_program_loaded(){
+	if(!page_loaded)
+	{
+		return FLOG_SUCCESS;
+	}
+	page_loaded = 0;
+	return FLOG_RESULT(W25N01GW_startProgramExecute(loaded_page) == W25N01GW_WRITE_SUCCESS);
+}
+
+/*!
+ @brief Load data into the page buffer of the chip for the open page
+ */
+static inline void flash_load(uint8_t const * src, uint16_t column, uint16_t n){
+	uint32_t page = flash_page_number();
+
+	if(page_loaded && (loaded_page != page))
+	{
+		(void)flash_program_loaded();
+	}
+	W25N01GW_selectDie(page / W25N01GW_PAGES_PER_DIE);
+	// The first load of a page sets the rest of the buffer to 0xFF, which programs nothing
+	W25N01GW_loadProgramData(src, n, column, !page_loaded);
+	page_loaded = 1;
+	loaded_page = page;
+	buffer_valid = 0;
+	if(ahead_page == page)
+	{
+		ahead_valid = 0;
+	}
+}
+
+/*!
+ @brief Read the open page into the page buffer of the chip, unless it is there already
+ */
+static inline flog_result_t flash_buffer_open_page(){
+	uint32_t page = flash_page_number();
+
+	// A page read replaces the page buffer
+	(void)flash_program_loaded();
+	if(buffer_valid && (buffer_page == page))
+	{
+		// An erase may have selected the other die since
+		W25N01GW_selectDie(page / W25N01GW_PAGES_PER_DIE);
+		return FLOG_SUCCESS;
+	}
+	buffer_valid = (W25N01GW_pageRead(page) == W25N01GW_READ_SUCCESS);
+	buffer_page = page;
+	return FLOG_RESULT(buffer_valid);
+}
+
+/*!
+ @brief Read from the open page, through the read-ahead page while it is on
+ */
+static inline flog_result_t flash_read_page(uint8_t * dst, uint16_t column, uint16_t n){
+	uint32_t page = flash_page_number();
+
+	if(read_ahead && (page != ahead_last_page))
+	{
+		// A read that already went through a whole page moved on to the next one: all of it is used
+		if(ahead_sequential && (page == ahead_last_page + 1) && !(ahead_valid && (ahead_page == page)))
+		{
+			ahead_valid = 0;
+			if(!flash_buffer_open_page() ||
+			   (W25N01GW_readBuffer(ahead_buffer, sizeof(ahead_buffer), 0) != W25N01GW_READ_SUCCESS))
+			{
+				return FLOG_FAILURE;
+			}
+			ahead_valid = 1;
+			ahead_page = page;
+
+			// The chip reads the next page of the block while this one is used
+			if(flash_page + 1 < FS_PAGES_PER_BLOCK)
+			{
+				W25N01GW_startPageRead(page + 1);
+				buffer_page = page + 1;
+			}
+		}
+		ahead_sequential = (page == ahead_last_page + 1);
+		ahead_last_page = page;
+	}
+	if(!read_ahead)
+	{
+		// Any other read, such as opening the next file, ends the sequence
+		ahead_last_page = FLASH_NO_PAGE;
+		ahead_sequential = 0;
+	}
+	else if(ahead_valid && (ahead_page == page))
+	{
+		memcpy(dst, &ahead_buffer[column], n);
+		return FLOG_SUCCESS;
+	}
+
+	// Random access, or the first page of a sequential read: just the bytes asked for
+	if(!flash_buffer_open_page())
+	{
+		return FLOG_FAILURE;
+	}
+	return FLOG_RESULT(W25N01GW_readBuffer(dst, n, column) == W25N01GW_READ_SUCCESS);
+}
+
+/*!
+ @brief Turn the read-ahead on for sequential file reads, off for everything else
+ */
+static inline void flash_read_ahead(uint8_t enable){
+	read_ahead = enable;
+}
+
+/*!
+ @brief Blocks of the chip, of all dies of a W25M
+ */
+static inline uint16_t flash_number_of_blocks(){
+	return W25N01GW_NO_OF_BLOCKS * W25N01GW_getDieCount();
+}
+
+/*!
+ @brief Blocks of one die, the dies program and erase in parallel
+ */
+static inline uint16_t flash_blocks_per_die(){
+	return W25N01GW_NO_OF_BLOCKS;
+}
 
 static inline flog_result_t flash_initialize(){
 	page_open = 0;
+	page_loaded = 0;
+	buffer_valid = 0;
+	ahead_valid = 0;
+	ahead_last_page = FLASH_NO_PAGE;
+	ahead_sequential = 0;
+	read_ahead = 0;
 	if(W25N01GW_Init()==W25N01GW_INITIALIZED)
 	{
 		return FLOG_SUCCESS;
@@ -98,13 +260,41 @@ static inline void flash_close_page(){
 	//flash.unlock();
 }
 
+/*!
+ @brief Start the erase of a block, the next access to its die waits for its end
+ */
+static inline void flash_start_erase_block(uint16_t block){
+	(void)flash_program_loaded();
+	if(buffer_page / FS_PAGES_PER_BLOCK == block)
+	{
+		buffer_valid = 0;
+	}
+	if(ahead_page / FS_PAGES_PER_BLOCK == block)
+	{
+		ahead_valid = 0;
+	}
+	(void)W25N01GW_startEraseBlock(block);
+}
+
+/*!
+ @brief Check for a program, erase or page read running on the flash
+ */
+static inline uint8_t flash_busy(){
+	return W25N01GW_isBusy();
+}
+
+/*!
+ @brief Wait for the end of a started erase
+ @retval FLOG_FAILURE if the erase failed, when nothing else used the flash
+ since it was started
+ */
+static inline flog_result_t flash_erase_result(){
+	return FLOG_RESULT(W25N01GW_eraseResult() == W25N01GW_ERASE_SUCCESS);
+}
+
 static inline flog_result_t flash_erase_block(uint16_t block){
-	W25N01GW_errorCode_t rslt;
-	rslt = W25N01GW_eraseBlock((block*W25N01GW_BLOCK_SIZE)+1,W25N01GW_BLOCK_SIZE);
-	if(rslt == W25N01GW_ERASE_SUCCESS)
-		return FLOG_SUCCESS;
-	else
-		return FLOG_FAILURE;
+	flash_start_erase_block(block);
+	return flash_erase_result();
 }
 
 static inline flog_result_t flash_get_spares(){
@@ -137,7 +327,7 @@ static inline void flash_set_bad_block(){
  */
 static inline void flash_commit(){
 	page_open = 0;
-//	flash.page_commit();
+	(void)flash_program_loaded();
 }
 
 /*!
@@ -149,29 +339,13 @@ static inline void flash_commit(){
  @return The success or failure of the operation
  */
 static inline flog_result_t flash_read_sector(uint8_t * dst, uint8_t sector, uint16_t offset, uint16_t n){
-//	if(W25N01GW_read(dst,n,( FS_SECTOR_SIZE * sector) + offset) == W25N01GW_READ_SUCCESS)
 	sector = sector%FS_SECTORS_PER_PAGE;
-	uint32_t read_loc =(flash_block*FS_SECTOR_SIZE*FS_PAGES_PER_BLOCK*FS_SECTORS_PER_PAGE)+( flash_page*FS_SECTORS_PER_PAGE*FS_SECTOR_SIZE )+( FS_SECTOR_SIZE * sector) + offset;
-	if(W25N01GW_read(dst,n,read_loc) == W25N01GW_READ_SUCCESS)
-	{
-		return FLOG_SUCCESS;
-	}
-	else
-	{
-		return FLOG_FAILURE;
-	}
+	return flash_read_page(dst, (FS_SECTOR_SIZE * sector) + offset, n);
 }
 
 static inline flog_result_t flash_read_spare(uint8_t * dst, uint8_t sector){
 	sector = sector%FS_SECTORS_PER_PAGE;
-	if(W25N01GW_read_spare(dst,4,flash_page+(flash_block*64), 0x800+sector * 0x10) == W25N01GW_READ_SUCCESS)
-	{
-		return FLOG_SUCCESS;
-	}
-	else
-	{
-		return FLOG_FAILURE;
-	}
+	return flash_read_page(dst, 0x800 + (sector * 0x10), 4);
 }
 
 /*!
@@ -183,9 +357,7 @@ static inline flog_result_t flash_read_spare(uint8_t * dst, uint8_t sector){
  */
 static inline void flash_write_sector(uint8_t const * src, uint8_t sector, uint16_t offset, uint16_t n){
 	sector = sector%FS_SECTORS_PER_PAGE;
-	uint32_t write_loc =(flash_block*FS_SECTOR_SIZE*FS_PAGES_PER_BLOCK*FS_SECTORS_PER_PAGE)+( flash_page*FS_SECTORS_PER_PAGE*FS_SECTOR_SIZE )+( FS_SECTOR_SIZE * sector) + offset;
-	W25N01GW_write(src,n, write_loc);
-//	W25N01GW_write(src,n, FS_SECTOR_SIZE * sector + offset);
+	flash_load(src, (FS_SECTOR_SIZE * sector) + offset, n);
 }
 
 
@@ -196,25 +368,21 @@ static inline void flash_write_sector(uint8_t const * src, uint8_t sector, uint1
  @note This doesn't commit the transaction
  */
 static inline void flash_write_spare(uint8_t const * src, uint8_t sector){
-	//flash.page_write_continued(src, 0x804 + sector * 0x10, 4);
-	//W25N01GW_write(src,4, (FS_SECTOR_SIZE * sector*0x10));
-	uint8_t buff[4];
 	sector = sector%FS_SECTORS_PER_PAGE;
-	W25N01GW_read_spare(buff,4,flash_page+(flash_block*64), 0x800+sector * 0x10);
-	W25N01GW_write_spare(src,4,flash_page+(flash_block*64), 0x800+sector * 0x10);
-	W25N01GW_read_spare(buff,4,flash_page+(flash_block*64), 0x800+sector * 0x10);
+	flash_load(src, 0x800 + (sector * 0x10), 4);
 }
 
 void flash_debug_warn(char const *f, ...){
-
+	(void)f;
 }
 
 void flash_debug_error(char const *f, ...){
-
+	(void)f;
 }
 void flash_debug_panic() {
 }
 void flash_high_level(flog_high_level_event_t hle) {
+	(void)hle;
 }
 
 uint32_t flash_random(uint32_t max) {
@@ -99,7 +99,8 @@ typedef enum {
     FLOG_BLOCK_TYPE_UNALLOCATED = 0xff,
     #endif
     FLOG_BLOCK_TYPE_INODE = 1,
-    FLOG_BLOCK_TYPE_FILE = 2
+    FLOG_BLOCK_TYPE_FILE = 2,
+    FLOG_BLOCK_TYPE_CHECKPOINT = 3
 } flog_block_type_t;
 
 //! @name Invalid values
@@ -225,6 +226,46 @@ typedef struct {
 
 //! @}
 
+//! @defgroup FLogCheckpointBlockStructs Checkpoint block structures
+//! @brief Descriptions of the data in the checkpoint block
+//! @{
+
+static char const flog_checkpoint_key[] = "Cubs";
+
+/*!
+ @brief The allocation state of the file system at a clean unmount
+
+ A record takes the first sector of a page, the pages after the first one are
+ filled in order. The second sector of the page is programmed when the file
+ system changes after the record was written.
+ */
+typedef struct {
+    char key[sizeof(flog_checkpoint_key)];
+    uint32_t version;
+    flog_block_idx_t inode0;
+    flog_timestamp_t timestamp;
+    uint32_t max_file_id;
+    //! The allocation order depends on the blocks of the flash
+    flog_block_idx_t number_of_blocks;
+    flog_block_idx_t allocate_head;
+    //! The block counts below are valid
+    uint8_t counted;
+    flog_block_idx_t total_blocks;
+    flog_block_idx_t free_blocks;
+    uint16_t prealloc_n;
+    flog_block_idx_t prealloc_block[FS_PREALLOCATE_SIZE];
+    flog_block_age_t prealloc_age[FS_PREALLOCATE_SIZE];
+    //! Checksum of everything above
+    uint32_t checksum;
+} flog_checkpoint_t;
+
+typedef struct {
+    uint8_t type_id;
+    uint8_t nothing[3];
+} flog_checkpoint_init_sector_spare_t;
+
+//! @}
+
 //! @name Special sector indices
 //! @{
 typedef enum {
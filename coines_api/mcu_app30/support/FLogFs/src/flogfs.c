@@ -88,6 +88,55 @@ typedef struct {
     flog_block_idx_t first_block;
 } flog_file_find_result_t;
 
+/*!
+ @brief The block chain of a file, as far as it has been followed
+
+ Complete blocks never change, so the file offset each one starts at stays
+ valid until the file is deleted. Every stride-th block is kept, the stride
+ doubles when the entries are full.
+ */
+typedef struct {
+    //! The file, FLOG_FILE_ID_INVALID if the index is unused
+    flog_file_id_t file_id;
+    flog_block_idx_t first_block;
+    //! Blocks of the chain from one entry to the next
+    uint16_t stride;
+    //! The number of entries
+    uint16_t n;
+    //! The number of blocks known to be complete
+    uint16_t blocks;
+    //! The block after them and the file offset it starts at
+    flog_block_idx_t end_block;
+    uint32_t end_position;
+    //! Last use, the least recently used index is taken for a new file
+    uint32_t used;
+    //! Block (i * stride) of the chain and the file offset it starts at
+    flog_block_idx_t block[FLOG_FILE_INDEX_ENTRIES];
+    uint32_t position[FLOG_FILE_INDEX_ENTRIES];
+} flog_file_index_t;
+
+/*!
+ @brief A file in the filename index
+
+ Only a hash of the name is kept, a match is confirmed by the name in the inode
+ entry of the file.
+ */
+typedef struct {
+    //! The file, FLOG_FILE_ID_INVALID if the entry is free
+    flog_file_id_t file_id;
+    //! The bytes of the file on flash, FLOG_FILE_SIZE_UNKNOWN until needed
+    uint32_t size;
+    flog_block_idx_t first_block;
+    //! The inode entry of the file
+    flog_block_idx_t inode_block;
+    flog_sector_idx_t inode_sector;
+    uint16_t hash;
+} flog_name_index_entry_t;
+
+//! The file of an entry was deleted, lookups go on past it
+#define FLOG_NAME_INDEX_DELETED ((flog_file_id_t)(-2))
+#define FLOG_FILE_SIZE_UNKNOWN ((uint32_t)(-1))
+
 /*!
  @brief The complete FLogFS state structure
  */
@@ -136,20 +185,84 @@ typedef struct {
     //! The one dirty_block
     //! @note This may only be accessed under @ref flogfs_t::allocate_lock
     flog_dirty_block_t dirty_block;
-    //! The moving allocator head
+    //! The moving allocator head, a position in the allocation order of
+    //! flog_allocate_order()
     flog_block_idx_t allocate_head;
+    //! Blocks of one die of the flash
+    flog_block_idx_t blocks_per_die;
+
+    //! Filename index of all files
+    //! @note This must be protected under @ref flogfs_t::lock
+    struct {
+        flog_name_index_entry_t entries[FLOG_NAME_INDEX_SIZE];
+        //! Entries taken, deleted ones included
+        uint16_t used;
+        //! The index is built, a mount from a checkpoint leaves that to the
+        //! first lookup
+        uint_fast8_t built;
+        //! Every file is in the index, a name not found there does not exist
+        uint_fast8_t complete;
+        //! The entry found last
+        flog_name_index_entry_t *last;
+        //! The first free inode entry, where the next file goes
+        flog_inode_iterator_t inode_end;
+    } names;
+
+    //! Block chains of recently opened files
+    //! @note This must be protected under @ref flogfs_t::lock
+    flog_file_index_t file_index[FLOG_FILE_INDEX_FILES];
+    uint32_t file_index_uses;
+
+    //! Block counts, taken by a scan after the mount and kept current by the
+    //! allocation and deletion of blocks afterwards
+    //! @note This must be protected under @ref flogfs_t::allocate_lock
+    struct {
+        uint_fast8_t counted;
+        //! Blocks which can be allocated
+        flog_block_idx_t total;
+        //! Blocks which are free, erased or to be erased on allocation
+        flog_block_idx_t free;
+        //! Blocks of invalidated files, not erased yet
+        flog_block_idx_t invalidated;
+    } block_counts;
+
+    //! Garbage collection of the blocks of invalidated files, found on flash
+    //! again by a mount without a checkpoint
+    //! @note This must be protected under @ref flogfs_t::delete_lock
+    struct {
+        //! Blocks to erase, a ring in the order of the invalidations
+        flog_block_idx_t queue[FS_NUM_BLOCKS];
+        uint16_t head;
+        uint16_t n;
+        //! A block is erasing in the background, its statistics are written
+        //! when the erase has ended
+        uint_fast8_t erasing;
+        //! The block erasing is an invalidated one, not one of an earlier format
+        uint_fast8_t erase_invalidated;
+        flog_block_idx_t erase_block;
+        flog_block_age_t erase_age;
+        //! The next block checked for the preallocation list, a position in
+        //! the allocation order
+        flog_block_idx_t sweep;
+        //! Blocks checked since one was found for the preallocation list
+        flog_block_idx_t swept;
+    } gc;
+
+    //! The checkpoint block and its newest record
+    //! @note This must be protected under @ref flogfs_t::lock
+    struct {
+        //! FLOG_BLOCK_IDX_INVALID until one is claimed
+        flog_block_idx_t block;
+        //! The page of the newest record, 0 if there is none
+        flog_page_index_t page;
+        //! Nothing changed on flash since the newest record was written
+        uint_fast8_t clean;
+    } checkpoint;
 
     //! Initialized parameters.
     flog_initialize_params_t params;
 } flogfs_t;
 
-/* Note: This done as part of SOLTEAM-851 task, deletion of block is separated. */
-typedef struct {
-    flog_block_idx_t block_idx[FS_NUM_BLOCKS];
-    uint16_t invalid_block_count;
-} flog_invalidated_block_t;
-
-static flog_invalidated_block_t flog_invalidated_block;
 
 //! A single static instance
 static flogfs_t flogfs;
@@ -224,6 +337,80 @@ static void flog_close_sector();
 
 static flog_result_t flogfs_read_calc_file_size(flog_read_file_t *file);
 
+/*!
+ @brief Get the block index of a file, if there is one
+ @retval NULL if the file is not indexed
+ */
+static flog_file_index_t *flog_file_index_lookup(flog_file_id_t file_id, flog_block_idx_t first_block);
+
+/*!
+ @brief Get the block index of a file, taking the least recently used one if the
+ file is not indexed yet
+ */
+static flog_file_index_t *flog_file_index_get(flog_file_id_t file_id, flog_block_idx_t first_block);
+
+/*!
+ @brief Forget the block index of a file which is deleted
+ */
+static void flog_file_index_drop(flog_file_id_t file_id);
+
+/*!
+ @brief Find the block of a file holding an offset
+ @param index The block index of the file, extended by the blocks followed
+ @param position The file offset, a block ending at it is taken. Use
+                 UINT32_MAX for the last block.
+ @param[out] block The block holding the offset, or the last block
+ @param[out] block_start The file offset that block starts at
+ @param[out] block_bytes The bytes in that block, 0 for the last block
+ */
+static flog_result_t flog_file_index_find(flog_file_index_t *index, uint32_t position, flog_block_idx_t *block,
+                                          uint32_t *block_start, flog_block_nbytes_t *block_bytes);
+
+/*!
+ @brief Get the offset of the data in a file sector
+ */
+static inline uint16_t flog_file_sector_data_offset(flog_sector_idx_t sector);
+
+/*!
+ @brief Build the filename index from the inode table
+ */
+static void flog_name_index_build();
+
+/*!
+ @brief Add a file to the filename index
+ @retval FLOG_FAILURE if the index is full
+ */
+static flog_result_t flog_name_index_add(char const *filename, flog_file_id_t file_id, flog_block_idx_t first_block,
+                                         flog_inode_iterator_t const *inode, uint32_t size);
+
+/*!
+ @brief Add a new file to the filename index, rebuilding it when it is full
+ @param inode The inode entry written for the file
+ */
+static void flog_name_index_create(char const *filename, flog_file_id_t file_id, flog_block_idx_t first_block,
+                                   flog_inode_iterator_t const *inode);
+
+/*!
+ @brief Remove a deleted file from the filename index
+ */
+static void flog_name_index_remove(flog_file_id_t file_id);
+
+/*!
+ @brief Update the size of a file in the filename index after a commit
+ */
+static void flog_name_index_set_size(flog_file_id_t file_id, uint32_t size);
+
+/*!
+ @brief Get the filename index entry of a file
+ @retval NULL if the file is not in the index
+ */
+static flog_name_index_entry_t *flog_name_index_entry(flog_file_id_t file_id);
+
+/*!
+ @brief Get the size of a file on flash, from the filename index if known there
+ */
+static flog_result_t flog_file_size(flog_file_id_t file_id, flog_block_idx_t first_block, uint32_t *size);
+
 /*!
  @brief Initialize an inode iterator
  @param[in,out] iter The iterator structure
@@ -285,6 +472,12 @@ static uint_fast8_t flog_prealloc_contains(flog_block_idx_t block);
 
 static flog_result_t flog_prealloc_initialize();
 
+/*!
+ @brief Find the newest version in the block statistics of all blocks
+ @return The version, 0 if no block has valid statistics
+ */
+static uint32_t flog_find_newest_version();
+
 static flog_result_t flog_prealloc_prime();
 
 /*!
@@ -292,8 +485,50 @@ static flog_result_t flog_prealloc_prime();
  @param base The first block in the chain
  */
 static void flog_invalidate_chain(flog_block_idx_t base, flog_file_id_t file_id);
-/* Note: This done as part of SOLTEAM-851 task, deletion of block is separated. */
-static void flog_invalidate_file_block(flog_block_idx_t block, flog_file_id_t file_id);
+
+/*!
+ @brief Queue the blocks of an invalidated file for the garbage collection
+ @param block The first block of the file
+ @returns The last block of the file
+ */
+static flog_block_idx_t flog_gc_queue_chain(flog_block_idx_t block, flog_file_id_t file_id);
+
+/*!
+ @brief Queue the blocks of the invalidated files again, the queue was lost
+ with the RAM
+ */
+static void flog_gc_recover();
+
+/*!
+ @brief Start the erase of a block in the background
+ @param age The age of the block, kept in its statistics after the erase
+ @param invalidated The block is one of an invalidated file
+ */
+static void flog_gc_start_erase(flog_block_idx_t block, flog_block_age_t age, uint_fast8_t invalidated);
+
+/*!
+ @brief Take the next queued block and start its erase
+ */
+static void flog_gc_erase_next_start();
+
+/*!
+ @brief Write the statistics of a block after its erase in the background
+ @param wait Wait for the erase to end
+ @retval 0 The erase is still running
+ */
+static uint_fast8_t flog_gc_finish_erase(uint_fast8_t wait);
+
+/*!
+ @brief Erase the next queued block, waiting for it
+ */
+static void flog_gc_erase_next();
+
+/*!
+ @brief Check the next block for the preallocation list, erasing a block of an
+ earlier format in the background
+ @retval 1 An erase was started
+ */
+static uint_fast8_t flog_gc_sweep();
 
 /*!
  @brief Check for a dirty block and flush it to allow for a new allocation
@@ -310,6 +545,51 @@ static void flog_block_statistics_write(flog_block_idx_t block, flog_block_stati
 
 static void flog_block_statistics_read(flog_block_idx_t block, flog_block_statistics_sector_with_key_t *stat);
 
+/*!
+ @brief Count the free blocks on flash, taking the block counts
+ */
+static void flog_block_counts_scan();
+
+/*!
+ @brief Make the file system state of the last checkpoint record, if it is
+ valid
+ @retval FLOG_FAILURE if the mount has to inspect the file system
+ */
+static flog_result_t flog_checkpoint_load();
+
+/*!
+ @brief Write a checkpoint record of the current file system state
+ */
+static flog_result_t flog_checkpoint_write();
+
+/*!
+ @brief Mark the last checkpoint record outdated before the file system changes
+ */
+static void flog_checkpoint_dirty();
+
+/*!
+ @brief Take a free block near the inode table for the checkpoint records
+ @param inode0 The first inode block, which is not taken
+ @return The block, FLOG_BLOCK_IDX_INVALID if none is free
+ */
+static flog_block_idx_t flog_checkpoint_claim(flog_block_idx_t inode0);
+
+/*!
+ @brief Erase the checkpoint block and mark it as one
+ */
+static flog_result_t flog_checkpoint_block_prepare(flog_block_idx_t block);
+
+/*!
+ @brief Write a checkpoint record, erasing the queued blocks first
+ @note This requires the FS lock, \ref flogfs_t::lock
+ */
+static flog_result_t flog_checkpoint_take();
+
+/*!
+ @brief Build the filename index, if a mount from a checkpoint left it out
+ */
+static void flog_name_index_ensure();
+
 static uint_fast8_t invalid_block(flog_block_statistics_sector_with_key_t *sector) {
     return memcmp(sector->key, flog_block_statistics_key, sizeof(flog_block_statistics_key)) != 0;
 }
@@ -368,6 +648,9 @@ static flog_result_t unlock_and_fail() {
 //! @}
 
 flog_result_t flogfs_initialize(flog_initialize_params_t *params) {
+    // Nothing is kept from before, as after a reset
+    memset(&flogfs, 0, sizeof(flogfs));
+
     fs_lock_initialize(&flogfs.allocate_lock);
     fs_lock_initialize(&flogfs.lock);
     fs_lock_initialize(&flogfs.delete_lock);
@@ -380,12 +663,29 @@ flog_result_t flogfs_initialize(flog_initialize_params_t *params) {
 
     flogfs.params = *params;
 
-    return flash_initialize();
+    if (FLOG_FAILURE == flash_initialize()) {
+        return FLOG_FAILURE;
+    }
+
+    // The flash tells how many dies it has, a W25M has two W25N dies
+    flogfs.params.number_of_blocks = MIN(flogfs.params.number_of_blocks, flash_number_of_blocks());
+    flogfs.params.number_of_blocks = MIN(flogfs.params.number_of_blocks, FS_NUM_BLOCKS);
+    flogfs.blocks_per_die = flash_blocks_per_die();
+
+    return FLOG_SUCCESS;
 }
 
+/*!
+ @details
+ ### Internals
+ Only the first inode block is erased. It gets a new version, so all other
+ blocks look like blocks of an older version and are erased on demand when
+ flog_prealloc_prime() claims them for allocation.
+ */
 flog_result_t flogfs_format() {
     flog_block_idx_t block;
     flog_block_idx_t first_valid = FLOG_BLOCK_IDX_INVALID;
+    uint32_t newest_version;
 
     union {
         flog_inode_init_sector_t main_buffer;
@@ -403,6 +703,17 @@ flog_result_t flogfs_format() {
         flogfs.state = FLOG_STATE_RESET;
     }
 
+    // The queued blocks become blocks of an earlier format, erased when claimed
+    if (flogfs.gc.erasing) {
+        (void)flash_erase_result();
+        flogfs.gc.erasing = 0;
+    }
+    flogfs.gc.n = 0;
+    flogfs.gc.head = 0;
+    // The checkpoint block becomes a block of an earlier format as well
+    flogfs.checkpoint.block = FLOG_BLOCK_IDX_INVALID;
+    flogfs.checkpoint.clean = 0;
+
     for (block = FS_FIRST_BLOCK; block < flogfs.params.number_of_blocks; block++) {
         flog_open_page(block, 0);
         if (FLOG_SUCCESS == flash_block_is_bad()) {
@@ -414,6 +725,9 @@ flog_result_t flogfs_format() {
         if (invalid_block(&statistics_sector)) {
             statistics_sector.header.age = 0;
             memcpy(statistics_sector.key, flog_block_statistics_key, sizeof(flog_block_statistics_key));
+            // Blocks of an earlier format must look older, wherever they are
+            newest_version = flog_find_newest_version() + 1;
+            flogfs.version = MAX(flogfs.version, newest_version);
             statistics_sector.header.version = flogfs.version;
         }
         else {
@@ -454,6 +768,10 @@ flog_result_t flogfs_format() {
 
     flash_commit();
 
+    // Later on the blocks near the inode table may all be taken by files
+    flogfs.checkpoint.block = flog_checkpoint_claim(first_valid);
+    flogfs.checkpoint.page = 0;
+
     flash_high_level(FLOG_FORMAT_END);
 
     flog_unlock_fs();
@@ -478,13 +796,28 @@ flog_result_t flog_prealloc_initialize() {
     return FLOG_SUCCESS;
 }
 
+/*!
+ @brief Block at a position of the allocation order
+
+ Consecutive positions are on different dies of the flash, so a file written
+ block after block has its next block on a die which is not busy with the
+ program or erase of the last one.
+ */
+static flog_block_idx_t flog_allocate_order(flog_block_idx_t position) {
+    flog_block_idx_t dies = flogfs.params.number_of_blocks / flogfs.blocks_per_die;
+
+    if ((dies < 2) || (flogfs.params.number_of_blocks % flogfs.blocks_per_die)) {
+        return position;
+    }
+    return (position % dies) * flogfs.blocks_per_die + (position / dies);
+}
+
 flog_result_t flog_prealloc_prime() {
     flog_block_statistics_sector_with_key_t statistics_sector;
     flog_inode_init_sector_spare_t inode_spare;
     flog_block_idx_t block;
     flog_result_t fr;
     uint16_t tries = FS_NUM_BLOCKS+1;
-    uint16_t i=0;
 
     flog_lock_fs();
     flash_lock();
@@ -496,11 +829,12 @@ flog_result_t flog_prealloc_prime() {
     while (!flog_prealloc_is_full() && --tries > 0) {
 	/* Commenting this as the random() always generates a similar sequence when it is called.
 	Hence sometimes it ends up such that the pre allocation buffer remains empty and other operations (file create etc) do not follow.
-	Need to implement a more optimised way. Currently it scans through all 1024 blocks to find out which is empty
+	Need to implement a more optimised way. The scan goes on after the block checked last, kept in the checkpoint, and
+	wraps around over all blocks
 	*/
        // block = flash_random(flogfs.params.number_of_blocks);
-        block = i;
-        i++;
+        block = flog_allocate_order(flogfs.allocate_head);
+        flogfs.allocate_head = (flogfs.allocate_head + 1) % flogfs.params.number_of_blocks;
 
         if (block == 0) {
             continue;
@@ -511,6 +845,11 @@ flog_result_t flog_prealloc_prime() {
             continue;
         }
 
+        // Its statistics are written when the erase in the background ends
+        if (flogfs.gc.erasing && (block == flogfs.gc.erase_block)) {
+            continue;
+        }
+
         if (FLOG_FAILURE == flash_open_page(block, 0)) {
             flash_debug_warn("%d: Unable to open", block);
             continue;
@@ -567,10 +906,18 @@ flog_result_t flog_prealloc_prime() {
     return FLOG_SUCCESS;
 }
 
+/*!
+ @brief Find the first inode block of the newest version and take its version
+ and its checkpoint block
+ */
 static flog_block_idx_t flogfs_find_first_inode() {
     flog_block_statistics_sector_with_key_t statistics_sector;
     flog_inode_init_sector_spare_t inode_spare;
     flog_block_idx_t block;
+    flog_block_idx_t inode0 = FLOG_BLOCK_IDX_INVALID;
+    uint32_t checkpoint_version = 0;
+
+    flogfs.checkpoint.block = FLOG_BLOCK_IDX_INVALID;
 
     for (block = FS_FIRST_BLOCK; block < FS_INODE0_MAX_BLOCK; block++) {
         if (!flash_open_page(block, 0)) {
@@ -585,38 +932,58 @@ static flog_block_idx_t flogfs_find_first_inode() {
         flash_read_spare((uint8_t *)&inode_spare, FLOG_INIT_SECTOR);
         flog_close_sector();
 
-        if (invalid_block_or_older_version(&statistics_sector)) {
+        if (invalid_block(&statistics_sector)) {
             continue;
         }
 
-        // TODO: Previous if we found two inode0 blocks we would compare
-        // timestamps. Should we be guarding against that?
-        if (inode_spare.type_id == FLOG_BLOCK_TYPE_INODE) {
-            if (inode_spare.inode_index == 0) {
-                return block;
+        // An inode0 left by an earlier format has an older version
+        if ((inode_spare.type_id == FLOG_BLOCK_TYPE_INODE) && (inode_spare.inode_index == 0)) {
+            if ((inode0 == FLOG_BLOCK_IDX_INVALID) || (statistics_sector.header.version > flogfs.version)) {
+                inode0 = block;
+                flogfs.version = statistics_sector.header.version;
             }
         }
+        // The checkpoint block is claimed among the same blocks
+        else if ((inode_spare.type_id == FLOG_BLOCK_TYPE_CHECKPOINT) &&
+                 (statistics_sector.header.version >= checkpoint_version)) {
+            flogfs.checkpoint.block = block;
+            checkpoint_version = statistics_sector.header.version;
+        }
     }
 
-    return FLOG_BLOCK_IDX_INVALID;
+    if ((inode0 == FLOG_BLOCK_IDX_INVALID) || (checkpoint_version != flogfs.version)) {
+        flogfs.checkpoint.block = FLOG_BLOCK_IDX_INVALID;
+    }
+
+    return inode0;
 }
 
-static flog_result_t flogfs_inspect() {
-    flog_inode_iterator_t inode_iter;
-    flog_inode_file_allocation_header_t allocation;
+static uint32_t flog_find_newest_version() {
+    flog_block_statistics_sector_with_key_t statistics_sector;
+    flog_block_idx_t block;
+    uint32_t newest = 0;
 
-    for (flog_inode_iterator_initialize(&inode_iter, flogfs.inode0); ; flog_inode_iterator_next(&inode_iter)) {
-        flog_open_sector(inode_iter.block, inode_iter.sector);
-        flash_read_sector((uint8_t *)&allocation, inode_iter.sector, 0, sizeof(flog_inode_file_allocation_header_t));
-        if (invalid_inode_file_allocation_header(&allocation)) {
-            break;
+    for (block = FS_FIRST_BLOCK; block < flogfs.params.number_of_blocks; block++) {
+        flog_open_page(block, 0);
+        if (FLOG_SUCCESS == flash_block_is_bad()) {
+            continue;
         }
+        flog_block_statistics_read(block, &statistics_sector);
+        flog_close_sector();
 
-        if (allocation.file_id > flogfs.max_file_id) {
-            flogfs.max_file_id = allocation.file_id;
+        if (!invalid_block(&statistics_sector) && (statistics_sector.header.version > newest)) {
+            newest = statistics_sector.header.version;
         }
     }
 
+    return newest;
+}
+
+static flog_result_t flogfs_inspect() {
+    // Also finds the largest file ID
+    flog_name_index_build();
+    flog_gc_recover();
+
     return FLOG_SUCCESS;
 }
 
@@ -640,19 +1007,26 @@ flog_result_t flogfs_mount() {
     flogfs.write_head = NULL;
     flogfs.dirty_block.block = FLOG_BLOCK_IDX_INVALID;
     flogfs.dirty_block.file = NULL;
+    for (uint_fast8_t i = 0; i < FLOG_FILE_INDEX_FILES; i++) {
+        flogfs.file_index[i].file_id = FLOG_FILE_ID_INVALID;
+    }
+    // The blocks are counted on the first query
+    flogfs.block_counts.counted = 0;
+    // The preallocation list starts empty, the sweep checks every block again
+    flogfs.gc.swept = 0;
     flogfs.inode0 = flogfs_find_first_inode();
 
     if (flogfs.inode0 == FLOG_BLOCK_IDX_INVALID) {
         return unlock_and_fail();
     }
 
-    if (!flogfs_inspect()) {
-        return unlock_and_fail();
-    }
-
+    // The list is primed by the first allocation, which may have to erase
+    // blocks of an earlier format
     flog_prealloc_initialize();
 
-    if (!flog_prealloc_prime()) {
+    // A clean unmount left the state to start from, otherwise it is found on
+    // flash
+    if (!flog_checkpoint_load() && !flogfs_inspect()) {
         return unlock_and_fail();
     }
 
@@ -663,6 +1037,42 @@ flog_result_t flogfs_mount() {
     return FLOG_SUCCESS;
 }
 
+flog_result_t flogfs_checkpoint() {
+    flog_result_t fr;
+
+    flog_lock_fs();
+
+    if ((flogfs.state != FLOG_STATE_MOUNTED) || (flogfs.write_head != NULL)) {
+        flog_unlock_fs();
+        return FLOG_FAILURE;
+    }
+
+    fr = flog_checkpoint_take();
+
+    flog_unlock_fs();
+    return fr;
+}
+
+flog_result_t flogfs_unmount() {
+    flog_lock_fs();
+
+    if (flogfs.state != FLOG_STATE_MOUNTED) {
+        flog_unlock_fs();
+        return FLOG_SUCCESS;
+    }
+    if (flogfs.write_head != NULL) {
+        flog_unlock_fs();
+        return FLOG_FAILURE;
+    }
+
+    // Without a checkpoint the next mount inspects the file system
+    (void)flog_checkpoint_take();
+    flogfs.state = FLOG_STATE_RESET;
+
+    flog_unlock_fs();
+    return FLOG_SUCCESS;
+}
+
 flog_result_t flogfs_fsck() {
     flog_lock_fs();
 
@@ -711,9 +1121,10 @@ flog_result_t flogfs_open_read(flog_read_file_t *file, char const *filename) {
         file->sector = FLOG_INIT_SECTOR;
         file->offset = sizeof(flog_file_init_sector_header_t);
     } else {
-        flog_open_sector(file->block, 1);
-        flash_read_spare((uint8_t *)&file_sector_spare, 1);
+        // Data is in the next sector, as in flogfs_read() at the start of a block
         file->sector = flog_increment_sector(FLOG_INIT_SECTOR);
+        flog_open_sector(file->block, file->sector);
+        flash_read_spare((uint8_t *)&file_sector_spare, file->sector);
         file->offset = 0;
     }
 
@@ -789,6 +1200,8 @@ uint32_t flogfs_read(flog_read_file_t *file, uint8_t *dst, uint32_t nbytes) {
 
     flog_lock_fs();
     flash_lock();
+    // Sequential reads use every sector and spare of a page
+    flash_read_ahead(1);
 
     while (nbytes) {
         if (file->sector_remaining_bytes == 0) {
@@ -848,16 +1261,7 @@ uint32_t flogfs_read(flog_read_file_t *file, uint8_t *dst, uint32_t nbytes) {
             }
 
             file->sector_remaining_bytes = file_sector_spare.nbytes;
-            switch (file->sector) {
-            case FLOG_TAIL_SECTOR:
-                file->offset = sizeof(flog_file_tail_sector_header_t);
-                break;
-            case FLOG_INIT_SECTOR:
-                file->offset = sizeof(flog_file_init_sector_header_t);
-                break;
-            default:
-                file->offset = 0;
-            }
+            file->offset = flog_file_sector_data_offset(file->sector);
         }
 
         // Figure out how many to read
@@ -878,6 +1282,7 @@ uint32_t flogfs_read(flog_read_file_t *file, uint8_t *dst, uint32_t nbytes) {
     }
 
 done:
+    flash_read_ahead(0);
     flash_unlock();
     flog_unlock_fs();
 
@@ -929,8 +1334,6 @@ uint32_t flogfs_write_file_size(flog_write_file_t *file) {
 typedef struct flogfs_walk_file_state_t {
     flog_block_idx_t block;
     flog_sector_idx_t sector;
-    uint_fast8_t last_block;
-    flog_file_tail_sector_header_t *tail_header;
     flog_file_sector_spare_t *sector_spare;
 } flogfs_walk_file_state_t;
 
@@ -946,6 +1349,8 @@ typedef flog_read_walk_file_result_t (*file_walk_file_fn_t)(flogfs_walk_file_sta
 static flog_read_walk_file_result_t flogfs_read_walk_sectors(flog_read_file_t *file, flogfs_walk_file_state_t *state, file_walk_file_fn_t walk, void *arg) {
     flog_file_sector_spare_t file_sector_spare;
 
+    (void)file;
+
     state->sector = FLOG_INIT_SECTOR;
     state->sector_spare = &file_sector_spare;
 
@@ -985,86 +1390,192 @@ static flog_read_walk_file_result_t flogfs_read_walk_sectors(flog_read_file_t *f
     return FLOG_WALK_CONTINUE;
 }
 
-static flog_result_t flogfs_read_walk_file(flog_read_file_t *file, file_walk_file_fn_t walk, void *arg) {
-    flog_file_tail_sector_header_t tail_header;
-    flogfs_walk_file_state_t state;
-    state.block = file->first_block;
-    state.tail_header = &tail_header;
+static flog_file_index_t *flog_file_index_lookup(flog_file_id_t file_id, flog_block_idx_t first_block) {
+    flog_file_index_t *index;
 
-    while (1) {
-        state.sector_spare = nullptr;
+    for (index = flogfs.file_index; index < flogfs.file_index + FLOG_FILE_INDEX_FILES; index++) {
+        if ((index->file_id == file_id) && (index->first_block == first_block)) {
+            index->used = ++flogfs.file_index_uses;
+            return index;
+        }
+    }
 
-        flog_open_sector(state.block, FLOG_TAIL_SECTOR);
-        flash_read_sector((uint8_t *)&tail_header, FLOG_TAIL_SECTOR, 0, sizeof(flog_file_tail_sector_header_t));
-        state.last_block = invalid_file_tail_sector_header(&tail_header);
+    return NULL;
+}
 
-        switch (walk(&state, arg)) {
-        case FLOG_WALK_FAILURE: {
-            return FLOG_FAILURE;
-        }
-        case FLOG_WALK_STOP: {
-            return FLOG_SUCCESS;
-        }
-        case FLOG_WALK_CONTINUE: {
-            switch (flogfs_read_walk_sectors(file, &state, walk, arg)) {
-            case FLOG_WALK_FAILURE: {
-                return FLOG_FAILURE;
-            }
-            case FLOG_WALK_STOP: {
-                return FLOG_SUCCESS;
-            }
-            case FLOG_WALK_CONTINUE: {
-                break;
-            }
-            default: {
-                assert(false);
+static flog_file_index_t *flog_file_index_get(flog_file_id_t file_id, flog_block_idx_t first_block) {
+    flog_file_index_t *index, *oldest;
+
+    index = flog_file_index_lookup(file_id, first_block);
+    if (index) {
+        return index;
+    }
+
+    oldest = flogfs.file_index;
+    for (index = flogfs.file_index; index < flogfs.file_index + FLOG_FILE_INDEX_FILES; index++) {
+        if ((index->file_id == FLOG_FILE_ID_INVALID) || (index->used < oldest->used)) {
+            oldest = index;
+            if (index->file_id == FLOG_FILE_ID_INVALID) {
                 break;
             }
-            }
-            break;
-        }
-        case FLOG_WALK_SKIP_BLOCK: {
-            break;
-        }
         }
+    }
 
-        if (state.last_block) {
-            break;
-        }
+    oldest->file_id = file_id;
+    oldest->first_block = first_block;
+    oldest->stride = 1;
+    oldest->n = 1;
+    oldest->blocks = 0;
+    oldest->end_block = first_block;
+    oldest->end_position = 0;
+    oldest->used = ++flogfs.file_index_uses;
+    oldest->block[0] = first_block;
+    oldest->position[0] = 0;
 
-        if (state.block == tail_header.universal.next_block) {
-            return FLOG_FAILURE;
+    return oldest;
+}
+
+static void flog_file_index_drop(flog_file_id_t file_id) {
+    flog_file_index_t *index;
+
+    for (index = flogfs.file_index; index < flogfs.file_index + FLOG_FILE_INDEX_FILES; index++) {
+        if (index->file_id == file_id) {
+            index->file_id = FLOG_FILE_ID_INVALID;
         }
-        state.block = tail_header.universal.next_block;
     }
-
-    return FLOG_SUCCESS;
 }
 
-flog_read_walk_file_result_t file_size_calculator_walk(flogfs_walk_file_state_t *state, void *arg) {
-    if (state->sector_spare != nullptr) {
-        *((uint32_t *)arg) += state->sector_spare->nbytes;
+/*!
+ @brief Add the next complete block of the chain to an index
+ */
+static void flog_file_index_append(flog_file_index_t *index, flog_block_idx_t block, uint32_t position) {
+    uint16_t i;
+
+    index->blocks++;
+    index->end_block = block;
+    index->end_position = position;
+
+    if (index->blocks % index->stride) {
+        return;
     }
-    else {
-        if (!state->last_block) {
-            *((uint32_t *)arg) += state->tail_header->bytes_in_block;
-            return FLOG_WALK_SKIP_BLOCK;
-        }
+    if (index->n == FLOG_FILE_INDEX_ENTRIES) {
+        // Keep every other entry
+        for (i = 0; i < FLOG_FILE_INDEX_ENTRIES / 2; i++) {
+            index->block[i] = index->block[2 * i];
+            index->position[i] = index->position[2 * i];
+        }
+        index->n = FLOG_FILE_INDEX_ENTRIES / 2;
+        index->stride *= 2;
     }
-
-    return FLOG_WALK_CONTINUE;
+    index->block[index->n] = block;
+    index->position[index->n] = position;
+    index->n++;
 }
 
-static flog_result_t flogfs_read_calc_file_size(flog_read_file_t *file) {
-    file->file_size = 0;
-    return flogfs_read_walk_file(file, file_size_calculator_walk, &file->file_size);
-}
+static flog_result_t flog_file_index_find(flog_file_index_t *index, uint32_t position, flog_block_idx_t *block,
+                                          uint32_t *block_start, flog_block_nbytes_t *block_bytes) {
+    flog_file_tail_sector_header_t tail_header;
+    uint16_t number, low, high, mid;
 
-typedef struct file_seek_t {
-    flog_result_t status;
-    uint32_t position;
-    uint32_t desired;
-    flog_block_idx_t block;
+    // Start at the last known block which starts before the offset
+    if (position > index->end_position) {
+        number = index->blocks;
+        *block = index->end_block;
+        *block_start = index->end_position;
+    } else {
+        low = 0;
+        high = index->n - 1;
+        while (low < high) {
+            mid = (low + high + 1) / 2;
+            if (index->position[mid] < position) {
+                low = mid;
+            } else {
+                high = mid - 1;
+            }
+        }
+        number = low * index->stride;
+        *block = index->block[low];
+        *block_start = index->position[low];
+    }
+
+    while (1) {
+        flog_open_sector(*block, FLOG_TAIL_SECTOR);
+        flash_read_sector((uint8_t *)&tail_header, FLOG_TAIL_SECTOR, 0, sizeof(flog_file_tail_sector_header_t));
+        if (invalid_file_tail_sector_header(&tail_header)) {
+            *block_bytes = 0;
+            return FLOG_SUCCESS;
+        }
+        if (position <= *block_start + tail_header.bytes_in_block) {
+            *block_bytes = tail_header.bytes_in_block;
+            return FLOG_SUCCESS;
+        }
+
+        if (*block == tail_header.universal.next_block) {
+            return FLOG_FAILURE;
+        }
+        *block = tail_header.universal.next_block;
+        *block_start += tail_header.bytes_in_block;
+        number++;
+        if (number > index->blocks) {
+            flog_file_index_append(index, *block, *block_start);
+        }
+    }
+}
+
+static inline uint16_t flog_file_sector_data_offset(flog_sector_idx_t sector) {
+    switch (sector) {
+    case FLOG_TAIL_SECTOR:
+        return sizeof(flog_file_tail_sector_header_t);
+    case FLOG_INIT_SECTOR:
+        return sizeof(flog_file_init_sector_header_t);
+    default:
+        return 0;
+    }
+}
+
+flog_read_walk_file_result_t file_size_calculator_walk(flogfs_walk_file_state_t *state, void *arg) {
+    *((uint32_t *)arg) += state->sector_spare->nbytes;
+
+    return FLOG_WALK_CONTINUE;
+}
+
+static flog_result_t flog_file_size(flog_file_id_t file_id, flog_block_idx_t first_block, uint32_t *size) {
+    flog_name_index_entry_t *entry;
+    flogfs_walk_file_state_t state;
+    flog_block_nbytes_t block_bytes;
+
+    entry = flog_name_index_entry(file_id);
+    if (entry && (entry->size != FLOG_FILE_SIZE_UNKNOWN)) {
+        *size = entry->size;
+        return FLOG_SUCCESS;
+    }
+
+    // Complete blocks come from the index, only the sectors of the last one are read
+    if (!flog_file_index_find(flog_file_index_get(file_id, first_block), UINT32_MAX,
+                              &state.block, size, &block_bytes) ||
+        (flogfs_read_walk_sectors(nullptr, &state, file_size_calculator_walk, size) == FLOG_WALK_FAILURE)) {
+        return FLOG_FAILURE;
+    }
+
+    if (entry) {
+        entry->size = *size;
+    }
+    return FLOG_SUCCESS;
+}
+
+static flog_result_t flogfs_read_calc_file_size(flog_read_file_t *file) {
+    return flog_file_size(file->id, file->first_block, &file->file_size);
+}
+
+//! The bytes in a file block with every sector full
+#define FLOG_FILE_FULL_BLOCK_NBYTES \
+    ((flogfs.params.pages_per_block * FS_SECTORS_PER_PAGE - 1) * FS_SECTOR_SIZE - \
+     sizeof(flog_file_init_sector_header_t) - sizeof(flog_file_tail_sector_header_t))
+
+typedef struct file_seek_t {
+    flog_result_t status;
+    uint32_t position;
+    uint32_t desired;
     flog_sector_idx_t sector;
     uint16_t offset;
     uint16_t bytes_remaining;
@@ -1072,39 +1583,58 @@ typedef struct file_seek_t {
 
 flog_read_walk_file_result_t file_seek_walk(flogfs_walk_file_state_t *state, void *arg) {
     file_seek_t *seek = (file_seek_t *)arg;
+    uint32_t end_of_sector = seek->position + state->sector_spare->nbytes;
 
-    seek->block = state->block;
     seek->sector = state->sector;
 
-    if (state->sector_spare == nullptr) {
-        if (state->last_block) {
-            return FLOG_WALK_CONTINUE;
-        }
-        uint32_t end_of_block = seek->position + state->tail_header->bytes_in_block;
-        if (seek->desired > end_of_block) {
-            seek->position = end_of_block;
-            return FLOG_WALK_SKIP_BLOCK;
-        }
+    if (seek->desired > end_of_sector) {
+        seek->position = end_of_sector;
+        return FLOG_WALK_CONTINUE;
     }
-    else {
-        uint32_t end_of_sector = seek->position + state->sector_spare->nbytes;
-        if (seek->desired > end_of_sector) {
-            seek->position = end_of_sector;
-            return FLOG_WALK_CONTINUE;
-        }
-        else {
-            seek->status = FLOG_SUCCESS;
-            seek->offset = (seek->desired - seek->position);
-            seek->bytes_remaining = state->sector_spare->nbytes - seek->offset;
-            return FLOG_WALK_STOP;
-        }
+
+    seek->status = FLOG_SUCCESS;
+    seek->offset = (seek->desired - seek->position);
+    seek->bytes_remaining = state->sector_spare->nbytes - seek->offset;
+    return FLOG_WALK_STOP;
+}
+
+/*!
+ @brief Find the sector of an offset in a block with every sector full, without
+ reading it
+ */
+static void file_seek_full_block(file_seek_t *seek) {
+    uint32_t data = seek->desired - seek->position;
+    uint32_t first = FS_SECTOR_SIZE - sizeof(flog_file_init_sector_header_t);
+    uint32_t middle = (flogfs.params.pages_per_block * FS_SECTORS_PER_PAGE) - FS_SECTORS_PER_PAGE + 1;
+    uint32_t k;
+
+    if (data <= first) {
+        seek->sector = FLOG_INIT_SECTOR;
+        seek->offset = data;
+        seek->bytes_remaining = first - data;
+        return;
     }
 
-    return FLOG_WALK_CONTINUE;
+    // The sectors between the init and the tail sector: 2, then 4 to the last
+    data -= first;
+    k = (data - 1) / FS_SECTOR_SIZE;
+    if (k < middle) {
+        seek->sector = (k == 0) ? FLOG_FILE_FIRST_DATA_SECTOR : (flog_sector_idx_t)(FLOG_TAIL_SECTOR + k);
+        seek->offset = data - (k * FS_SECTOR_SIZE);
+        seek->bytes_remaining = FS_SECTOR_SIZE - seek->offset;
+        return;
+    }
+
+    data -= middle * FS_SECTOR_SIZE;
+    seek->sector = FLOG_TAIL_SECTOR;
+    seek->offset = data;
+    seek->bytes_remaining = FS_SECTOR_SIZE - sizeof(flog_file_tail_sector_header_t) - data;
 }
 
 flog_result_t flogfs_read_seek(flog_read_file_t *file, uint32_t position) {
     file_seek_t seek;
+    flogfs_walk_file_state_t state;
+    flog_block_nbytes_t block_bytes;
     flog_result_t fr = FLOG_SUCCESS;
 
     flog_lock_fs();
@@ -1116,21 +1646,30 @@ flog_result_t flogfs_read_seek(flog_read_file_t *file, uint32_t position) {
 
     flash_lock();
 
-    seek.position = 0;
     seek.desired = position;
-    seek.block = file->first_block;
-    seek.sector = FLOG_INIT_SECTOR;
     seek.status = FLOG_FAILURE;
 
-    if (!flogfs_read_walk_file(file, file_seek_walk, &seek)) {
+    // Go to the block holding the position through the index, then through its sectors
+    if (!flog_file_index_find(flog_file_index_get(file->id, file->first_block), position,
+                              &state.block, &seek.position, &block_bytes)) {
+        fr = FLOG_FAILURE;
+    }
+    else if (block_bytes == FLOG_FILE_FULL_BLOCK_NBYTES) {
+        file_seek_full_block(&seek);
+    }
+    else if (flogfs_read_walk_sectors(file, &state, file_seek_walk, &seek) == FLOG_WALK_FAILURE) {
         fr = FLOG_FAILURE;
     }
     else {
         fr = seek.status;
-        file->block = seek.block;
+    }
+
+    if (fr == FLOG_SUCCESS) {
+        file->block = state.block;
         file->sector = seek.sector;
-        file->offset = seek.offset;
+        file->offset = flog_file_sector_data_offset(seek.sector) + seek.offset;
         file->sector_remaining_bytes = seek.bytes_remaining;
+        file->read_head = position;
     }
 
     flash_unlock();
@@ -1148,6 +1687,7 @@ flog_result_t flogfs_open_write(flog_write_file_t *file, char const *filename) {
     flog_block_alloc_t alloc_block;
     flog_file_find_result_t find_result;
     flog_file_sector_spare_t file_sector_spare;
+    flog_block_nbytes_t block_bytes;
     union {
         flog_inode_file_allocation_t allocation;
         flog_file_init_sector_header_t file_init_sector_header;
@@ -1163,6 +1703,8 @@ flog_result_t flogfs_open_write(flog_write_file_t *file, char const *filename) {
 
     flash_lock();
 
+    flog_checkpoint_dirty();
+
     find_result = flog_find_file(filename, &inode_iter);
 
     file->base_threshold = 0;
@@ -1174,20 +1716,13 @@ flog_result_t flogfs_open_write(flog_write_file_t *file, char const *filename) {
         file->block = find_result.first_block;
         file->id = find_result.file_id;
         file->sector = FLOG_INIT_SECTOR;
-        // Count bytes from 0
-        file->file_size = 0;
         // Iterate to the end of the file
-        // First check each terminated block
-        while (1) {
-            flog_open_sector(file->block, FLOG_TAIL_SECTOR);
-            flash_read_sector((uint8_t *)&buffer_union.file_tail_sector_header, FLOG_TAIL_SECTOR, 0, sizeof(flog_file_tail_sector_header_t));
-            if (invalid_file_tail_sector_header(&buffer_union.file_tail_sector_header)) {
-                // This block is incomplete
-                break;
-            }
-            file->block = buffer_union.file_tail_sector_header.universal.next_block;
-            file->file_size += buffer_union.file_tail_sector_header.bytes_in_block;
+        // The terminated blocks and the bytes in them come from the index
+        if (!flog_file_index_find(flog_file_index_get(file->id, find_result.first_block), UINT32_MAX,
+                                  &file->block, &file->file_size, &block_bytes)) {
+            goto failure;
         }
+        file->bytes_in_block = 0;
         // Now file->block is the first incomplete block
         // Scan it sector-by-sector
         while (1) {
@@ -1206,6 +1741,7 @@ flog_result_t flogfs_open_write(flog_write_file_t *file, char const *filename) {
                 break;
             }
             file->file_size += file_sector_spare.nbytes;
+            file->bytes_in_block += file_sector_spare.nbytes;
             file->sector = flog_increment_sector(file->sector);
         }
     } else {
@@ -1241,6 +1777,8 @@ flog_result_t flogfs_open_write(flog_write_file_t *file, char const *filename) {
         flash_write_sector((uint8_t *)&buffer_union.allocation, inode_iter.sector, 0, sizeof(flog_inode_file_allocation_t));
         flash_commit();
 
+        flog_name_index_create(filename, flogfs.max_file_id, alloc_block.block, &inode_iter);
+
         file->block = alloc_block.block;
         file->block_age = alloc_block.age;
         file->id = flogfs.max_file_id;
@@ -1320,6 +1858,7 @@ flog_result_t flogfs_rm(char const *filename) {
     flog_inode_iterator_t inode_iter;
     flog_block_idx_t block, next_block;
     flog_inode_file_invalidation_t invalidation;
+    flog_file_index_t *index;
 
     flog_lock_fs();
     flash_lock();
@@ -1329,8 +1868,13 @@ flog_result_t flogfs_rm(char const *filename) {
         goto failure;
     }
 
-    // Navigate to the end to find the last block
-    block = find_result.first_block;
+    flog_checkpoint_dirty();
+
+    // Navigate to the end to find the last block, from the last one an index knows
+    index = flog_file_index_lookup(find_result.file_id, find_result.first_block);
+    block = index ? index->end_block : find_result.first_block;
+    flog_file_index_drop(find_result.file_id);
+    flog_name_index_remove(find_result.file_id);
     while (1) {
         next_block = flog_universal_get_next_block(block);
         if (next_block == FLOG_BLOCK_IDX_INVALID) {
@@ -1361,23 +1905,24 @@ void flogfs_start_ls(flogfs_ls_iterator_t *iter) {
     flog_inode_iterator_initialize(iter, flogfs.inode0);
 }
 
-uint_fast8_t flogfs_ls_iterate(flogfs_ls_iterator_t *iter, char *fname_dst) {
-    union {
-        flog_inode_file_allocation_header_t allocation;
-        flog_inode_file_invalidation_t invalidation;
-    } buffer_union;
+/*!
+ @brief Read the next file of the inode table
+ @param[out] allocation The allocation header of the file
+ */
+static uint_fast8_t flog_ls_next(flogfs_ls_iterator_t *iter, char *fname_dst, flog_inode_file_allocation_header_t *allocation) {
+    flog_inode_file_invalidation_t invalidation;
 
     while (1) {
         flog_open_sector(iter->block, iter->sector);
-        flash_read_sector((uint8_t *)&buffer_union.allocation, iter->sector, 0, sizeof(flog_inode_file_allocation_header_t));
-        if (invalid_file_id(buffer_union.allocation.file_id)) {
+        flash_read_sector((uint8_t *)allocation, iter->sector, 0, sizeof(flog_inode_file_allocation_header_t));
+        if (invalid_file_id(allocation->file_id)) {
             // Nothing here. Done.
             return 0;
         }
         // Now check to see if it's valid
         flog_open_sector(iter->block, iter->sector + 1);
-        flash_read_sector((uint8_t *)&buffer_union.invalidation, iter->sector + 1, 0, sizeof(flog_inode_file_invalidation_t));
-        if (invalid_timestamp(buffer_union.invalidation.header.timestamp)) {
+        flash_read_sector((uint8_t *)&invalidation, iter->sector + 1, 0, sizeof(flog_inode_file_invalidation_t));
+        if (invalid_timestamp(invalidation.header.timestamp)) {
             // This file's good
             // Now check to see if it's valid
             // Go read the filename
@@ -1390,30 +1935,389 @@ uint_fast8_t flogfs_ls_iterate(flogfs_ls_iterator_t *iter, char *fname_dst) {
             flog_inode_iterator_next(iter);
         }
     }
-}
+}
+
+uint_fast8_t flogfs_ls_iterate(flogfs_ls_iterator_t *iter, char *fname_dst) {
+    flog_inode_file_allocation_header_t allocation;
+
+    return flog_ls_next(iter, fname_dst, &allocation);
+}
+
+uint_fast8_t flogfs_ls_iterate_size(flogfs_ls_iterator_t *iter, char *fname_dst, uint32_t *size) {
+    flog_inode_file_allocation_header_t allocation;
+    uint_fast8_t more;
+
+    flog_lock_fs();
+    flash_lock();
+
+    more = flog_ls_next(iter, fname_dst, &allocation);
+    if (more && !flog_file_size(allocation.file_id, allocation.first_block, size)) {
+        *size = 0;
+    }
+
+    flash_unlock();
+    flog_unlock_fs();
+    return more;
+}
+
+void flogfs_stop_ls(flogfs_ls_iterator_t *iter) {
+    (void)iter;
+}
+
+uint32_t flogfs_available_space() {
+    flogfs_block_usage_t usage;
+
+    if (!flogfs_block_usage(&usage)) {
+        return 0;
+    }
+
+    return ((uint32_t)usage.free_blocks * FS_PAGES_PER_BLOCK * FS_SECTORS_PER_PAGE * FS_SECTOR_SIZE);
+}
+
+flog_result_t flogfs_block_usage(flogfs_block_usage_t *usage) {
+    flog_lock_fs();
+
+    if (flogfs.state != FLOG_STATE_MOUNTED) {
+        flog_unlock_fs();
+        return FLOG_FAILURE;
+    }
+
+    flash_lock();
+    flog_lock_allocate();
+
+    if (!flogfs.block_counts.counted) {
+        flog_block_counts_scan();
+    }
+
+    usage->free_blocks = flogfs.block_counts.free;
+    usage->invalidated_blocks = flogfs.block_counts.invalidated;
+    usage->used_blocks = flogfs.block_counts.total - flogfs.block_counts.free - flogfs.block_counts.invalidated;
+
+    flog_unlock_allocate();
+    flash_unlock();
+    flog_unlock_fs();
+    return FLOG_SUCCESS;
+}
+
+/*!
+ @details
+ ### Internals
+ A block is free when flog_prealloc_prime() would claim it: it is not bad and
+ either unallocated or left by an earlier format. The invalidated blocks look
+ used on flash, the ones queued for the garbage collection are counted as
+ invalidated.
+ */
+static void flog_block_counts_scan() {
+    flog_block_statistics_sector_with_key_t statistics_sector;
+    flog_inode_init_sector_spare_t inode_spare;
+
+    flogfs.block_counts.total = 0;
+    flogfs.block_counts.free = 0;
+    flogfs.block_counts.invalidated = flogfs.gc.n + (flogfs.gc.erasing && flogfs.gc.erase_invalidated);
+
+    // Block 0 is never allocated, as in flog_prealloc_prime()
+    for (flog_block_idx_t block = 1; block < flogfs.params.number_of_blocks; block++) {
+        if (FLOG_FAILURE == flash_open_page(block, 0)) {
+            continue;
+        }
+        if (FLOG_SUCCESS == flash_block_is_bad()) {
+            continue;
+        }
+        flash_read_sector((uint8_t *)&statistics_sector, FLOG_BLOCK_STATISTICS_SECTOR, 0,
+                          sizeof(flog_block_statistics_sector_with_key_t));
+        flash_read_spare((uint8_t *)&inode_spare, FLOG_INIT_SECTOR);
+
+        flogfs.block_counts.total++;
+        if (flogfs.gc.erasing && flogfs.gc.erase_invalidated && (block == flogfs.gc.erase_block)) {
+            continue;
+        }
+        if (invalid_block_or_older_version(&statistics_sector) ||
+            (inode_spare.type_id == FLOG_BLOCK_TYPE_UNALLOCATED)) {
+            flogfs.block_counts.free++;
+        }
+    }
+    // The pages were opened around the cache status
+    flog_close_sector();
+
+    flogfs.block_counts.counted = 1;
+}
+
+/*!
+ @brief Checksum of a checkpoint record, FNV-1a over everything but the checksum
+ */
+static uint32_t flog_checkpoint_checksum(flog_checkpoint_t const *record) {
+    uint8_t const *bytes = (uint8_t const *)record;
+    uint32_t hash = 2166136261u;
+
+    for (uint16_t i = 0; i < sizeof(flog_checkpoint_t) - sizeof(uint32_t); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+/*!
+ @brief Check whether a page of the checkpoint block holds a record
+ */
+static uint_fast8_t flog_checkpoint_page_used(flog_page_index_t page) {
+    flog_checkpoint_t record;
+    uint8_t const *bytes = (uint8_t const *)&record;
+
+    flog_open_page(flogfs.checkpoint.block, page);
+    flash_read_sector((uint8_t *)&record, page * FS_SECTORS_PER_PAGE, 0, sizeof(flog_checkpoint_t));
+
+    for (uint16_t i = 0; i < sizeof(flog_checkpoint_t); i++) {
+        if (bytes[i] != FS_ERASE_CHAR) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*!
+ @details
+ ### Internals
+ The records fill the pages in order, so the newest one is found by a binary
+ search. It is taken when it belongs to this format and inode table and the
+ file system was not changed after it was written.
+ */
+static flog_result_t flog_checkpoint_load() {
+    flog_checkpoint_t record;
+    uint32_t dirty;
+    flog_page_index_t low = 1;
+    flog_page_index_t high = flogfs.params.pages_per_block;
+    flog_page_index_t middle;
+
+    flogfs.checkpoint.page = 0;
+    flogfs.checkpoint.clean = 0;
+
+    if (flogfs.checkpoint.block == FLOG_BLOCK_IDX_INVALID) {
+        return FLOG_FAILURE;
+    }
+
+    // The pages from low up are free, the ones below hold records
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if (flog_checkpoint_page_used(middle)) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    flogfs.checkpoint.page = low - 1;
+    if (flogfs.checkpoint.page == 0) {
+        flog_close_sector();
+        return FLOG_FAILURE;
+    }
+
+    flog_open_page(flogfs.checkpoint.block, flogfs.checkpoint.page);
+    flash_read_sector((uint8_t *)&record, flogfs.checkpoint.page * FS_SECTORS_PER_PAGE, 0, sizeof(flog_checkpoint_t));
+    flash_read_sector((uint8_t *)&dirty, flogfs.checkpoint.page * FS_SECTORS_PER_PAGE + 1, 0, sizeof(dirty));
+    flog_close_sector();
+
+    if (memcmp(record.key, flog_checkpoint_key, sizeof(flog_checkpoint_key)) ||
+        (record.checksum != flog_checkpoint_checksum(&record)) || (record.version != flogfs.version) ||
+        (record.inode0 != flogfs.inode0) || (dirty != 0xFFFFFFFF) || (record.prealloc_n > FS_PREALLOCATE_SIZE) ||
+        (record.number_of_blocks != flogfs.params.number_of_blocks) ||
+        (record.allocate_head >= flogfs.params.number_of_blocks)) {
+        return FLOG_FAILURE;
+    }
+
+    flogfs.t = MAX(flogfs.t, record.timestamp);
+    flogfs.max_file_id = record.max_file_id;
+    flogfs.allocate_head = record.allocate_head;
+    for (uint16_t i = 0; i < record.prealloc_n; i++) {
+        flog_prealloc_push(record.prealloc_block[i], record.prealloc_age[i]);
+    }
+    if (record.counted) {
+        flogfs.block_counts.total = record.total_blocks;
+        flogfs.block_counts.free = record.free_blocks;
+        flogfs.block_counts.invalidated = 0;
+        flogfs.block_counts.counted = 1;
+    }
+
+    // The filename index is built by the first lookup
+    flogfs.names.built = 0;
+    flogfs.checkpoint.clean = 1;
+
+    return FLOG_SUCCESS;
+}
+
+/*!
+ @details
+ ### Internals
+ The queue of invalidated blocks only lives in RAM, so it is erased first and
+ the record does not have to hold it.
+ */
+static flog_result_t flog_checkpoint_take() {
+    flog_result_t fr = FLOG_SUCCESS;
+
+    flash_lock();
+
+    if (!flogfs.checkpoint.clean) {
+        flog_lock_delete();
+        while (flogfs.gc.n || flogfs.gc.erasing) {
+            flog_gc_erase_next();
+        }
+        flog_unlock_delete();
+
+        flog_lock_allocate();
+        fr = flog_checkpoint_write();
+        flog_unlock_allocate();
+    }
+
+    flash_unlock();
+    return fr;
+}
+
+static flog_result_t flog_checkpoint_write() {
+    flog_checkpoint_t record;
+    flog_block_alloc_t *entry;
+    flog_sector_idx_t sector;
+
+    if (flogfs.checkpoint.block == FLOG_BLOCK_IDX_INVALID) {
+        flogfs.checkpoint.block = flog_checkpoint_claim(flogfs.inode0);
+        flogfs.checkpoint.page = 0;
+    }
+    else if (flogfs.checkpoint.page + 1 >= flogfs.params.pages_per_block) {
+        // The block is full, it starts over
+        if (!flog_checkpoint_block_prepare(flogfs.checkpoint.block)) {
+            flogfs.checkpoint.block = FLOG_BLOCK_IDX_INVALID;
+        }
+        flogfs.checkpoint.page = 0;
+    }
+    if (flogfs.checkpoint.block == FLOG_BLOCK_IDX_INVALID) {
+        flash_debug_error("flog_checkpoint_write: no block");
+        return FLOG_FAILURE;
+    }
+
+    // The padding is part of the checksum
+    memset(&record, 0, sizeof(record));
+    memcpy(record.key, flog_checkpoint_key, sizeof(flog_checkpoint_key));
+    record.version = flogfs.version;
+    record.inode0 = flogfs.inode0;
+    record.timestamp = flogfs.t;
+    record.max_file_id = flogfs.max_file_id;
+    record.number_of_blocks = flogfs.params.number_of_blocks;
+    record.allocate_head = flogfs.allocate_head;
+    record.counted = flogfs.block_counts.counted;
+    record.total_blocks = flogfs.block_counts.total;
+    record.free_blocks = flogfs.block_counts.free;
+    for (entry = flogfs.prealloc.available; entry != NULL; entry = entry->next) {
+        record.prealloc_block[record.prealloc_n] = entry->block;
+        record.prealloc_age[record.prealloc_n++] = entry->age;
+    }
+    // A block taken for allocation but never opened is still unallocated
+    for (entry = flogfs.prealloc.pending; entry != NULL; entry = entry->next) {
+        record.prealloc_block[record.prealloc_n] = entry->block;
+        record.prealloc_age[record.prealloc_n++] = entry->age;
+        record.free_blocks++;
+    }
+    record.checksum = flog_checkpoint_checksum(&record);
+
+    flogfs.checkpoint.page++;
+    sector = flogfs.checkpoint.page * FS_SECTORS_PER_PAGE;
+    flog_open_sector(flogfs.checkpoint.block, sector);
+    flash_write_sector((uint8_t const *)&record, sector, 0, sizeof(record));
+    flash_commit();
+    flog_close_sector();
+
+    flogfs.checkpoint.clean = 1;
+    return FLOG_SUCCESS;
+}
+
+static void flog_checkpoint_dirty() {
+    uint32_t const dirty = 0;
+    flog_sector_idx_t sector;
+
+    if (!flogfs.checkpoint.clean) {
+        return;
+    }
+    flogfs.checkpoint.clean = 0;
+
+    sector = flogfs.checkpoint.page * FS_SECTORS_PER_PAGE + 1;
+    flog_open_sector(flogfs.checkpoint.block, sector);
+    flash_write_sector((uint8_t const *)&dirty, sector, 0, sizeof(dirty));
+    flash_commit();
+    flog_close_sector();
+}
+
+static flog_result_t flog_checkpoint_block_prepare(flog_block_idx_t block) {
+    flog_block_statistics_sector_with_key_t statistics_sector;
+    flog_checkpoint_init_sector_spare_t spare;
+
+    flog_block_statistics_read(block, &statistics_sector);
+    flog_close_sector();
+
+    if (invalid_block(&statistics_sector)) {
+        statistics_sector.header.age = 0;
+    }
+    statistics_sector.header.next_block = FLOG_BLOCK_IDX_INVALID;
+    statistics_sector.header.next_age = FLOG_BLOCK_AGE_INVALID;
+    statistics_sector.header.timestamp = ++flogfs.t;
+    statistics_sector.header.version = flogfs.version;
+    memcpy(statistics_sector.key, flog_block_statistics_key, sizeof(flog_block_statistics_key));
+
+    if (FLOG_FAILURE == flash_erase_block(block)) {
+        return FLOG_FAILURE;
+    }
+
+    flog_block_statistics_write(block, &statistics_sector);
+
+    memset(&spare, FS_ERASE_CHAR, sizeof(spare));
+    spare.type_id = FLOG_BLOCK_TYPE_CHECKPOINT;
+    flog_open_sector(block, FLOG_INIT_SECTOR);
+    flash_write_spare((uint8_t const *)&spare, FLOG_INIT_SECTOR);
+    flash_commit();
+    flog_close_sector();
+
+    return FLOG_SUCCESS;
+}
+
+/*!
+ @details
+ ### Internals
+ The mount finds the checkpoint block while it looks for inode0, so it is one
+ of the blocks below FS_INODE0_MAX_BLOCK. Only a free block is taken, as
+ flog_prealloc_prime() would take it.
+ */
+static flog_block_idx_t flog_checkpoint_claim(flog_block_idx_t inode0) {
+    flog_block_statistics_sector_with_key_t statistics_sector;
+    flog_inode_init_sector_spare_t inode_spare;
+    flog_block_idx_t last = MIN(FS_INODE0_MAX_BLOCK, flogfs.params.number_of_blocks);
+
+    // Block 0 is never allocated, as in flog_prealloc_prime()
+    for (flog_block_idx_t block = 1; block < last; block++) {
+        if ((block == inode0) || flog_prealloc_contains(block) ||
+            (flogfs.gc.erasing && (block == flogfs.gc.erase_block))) {
+            continue;
+        }
+        if ((FLOG_FAILURE == flash_open_page(block, 0)) || (FLOG_SUCCESS == flash_block_is_bad())) {
+            continue;
+        }
+        flash_read_sector((uint8_t *)&statistics_sector, FLOG_BLOCK_STATISTICS_SECTOR, 0,
+                          sizeof(flog_block_statistics_sector_with_key_t));
+        flash_read_spare((uint8_t *)&inode_spare, FLOG_INIT_SECTOR);
+        flog_close_sector();
+
+        if (!invalid_block_or_older_version(&statistics_sector) &&
+            (inode_spare.type_id != FLOG_BLOCK_TYPE_UNALLOCATED)) {
+            continue;
+        }
+        if (!flog_checkpoint_block_prepare(block)) {
+            continue;
+        }
+        if (flogfs.block_counts.counted) {
+            flogfs.block_counts.free--;
+        }
+        return block;
+    }
+    flog_close_sector();
 
-void flogfs_stop_ls(flogfs_ls_iterator_t *iter) {
+    return FLOG_BLOCK_IDX_INVALID;
 }
 
-uint32_t flogfs_available_space(){
-     uint16_t i=0;
-     flog_inode_init_sector_spare_t inode_spare;
-     uint16_t no_of_free_blocks = 0;
-
-
-     for(i=0;i<FS_NUM_BLOCKS;i++)
-     {
-         flash_open_page(i, 0);
-         flash_read_spare((uint8_t *)&inode_spare, FLOG_INIT_SECTOR);
-         /* Check if the block is occupied */
-         if(inode_spare.type_id == 0xFF){
-             no_of_free_blocks++;
-         }
-
-     }
-
-    return (no_of_free_blocks*FS_PAGES_PER_BLOCK*FS_SECTORS_PER_PAGE*FS_SECTOR_SIZE);
-}
 flog_result_t flog_commit_file_sector(flog_write_file_t *file, uint8_t const *data, flog_sector_nbytes_t n) {
     flog_file_sector_spare_t file_sector_spare;
 
@@ -1472,6 +2376,7 @@ flog_result_t flog_commit_file_sector(flog_write_file_t *file, uint8_t const *da
         file->offset = sizeof(flog_file_init_sector_header_t);
         file->bytes_in_block = 0;
         file->file_size += n;
+        flog_name_index_set_size(file->id, file->file_size);
 
         return FLOG_SUCCESS;
     } else {
@@ -1520,6 +2425,7 @@ flog_result_t flog_commit_file_sector(flog_write_file_t *file, uint8_t const *da
         file->bytes_in_block += n;
         file->sector_remaining_bytes = FS_SECTOR_SIZE - file->offset;
         file->file_size += n;
+        flog_name_index_set_size(file->id, file->file_size);
         return FLOG_SUCCESS;
     }
 }
@@ -1655,7 +2561,6 @@ flog_result_t flog_walk(file_walk_fn_t walk_fn, void *arg) {
 flog_result_t flogfs_invalidate(char const *filename) {
     flog_file_find_result_t find_result;
     flog_inode_iterator_t inode_iter;
-    flog_block_idx_t block, next_block;
     flog_inode_file_invalidation_t invalidation;
 
     flog_lock_fs();
@@ -1666,24 +2571,18 @@ flog_result_t flogfs_invalidate(char const *filename) {
         goto failure;
     }
 
-    // Navigate to the end to find the last block
-    block = find_result.first_block;
-    while (1) {
-        next_block = flog_universal_get_next_block(block);
-        if (next_block == FLOG_BLOCK_IDX_INVALID) {
-            break;
-        }
-        block = next_block;
-    }
+    flog_checkpoint_dirty();
 
-    invalidation.header.last_block = block;
+    flog_file_index_drop(find_result.file_id);
+    flog_name_index_remove(find_result.file_id);
+
+    // The walk to the last block queues the blocks, they are erased later
+    invalidation.header.last_block = flog_gc_queue_chain(find_result.first_block, find_result.file_id);
     invalidation.header.timestamp = ++flogfs.t;
     flog_open_sector(inode_iter.block, inode_iter.sector + 1);
     flash_write_sector((uint8_t *)&invalidation, inode_iter.sector + 1, 0, sizeof(flog_inode_file_invalidation_t));
     flash_commit();
 
-    flog_invalidate_file_block(find_result.first_block, find_result.file_id);
-
     flash_unlock();
     flog_unlock_fs();
     return FLOG_SUCCESS;
@@ -1694,80 +2593,270 @@ failure:
     return FLOG_FAILURE;
 }
 
-void flog_delete_invalidated_block(void)
-{
-    uint16_t index = 0;
-    for(index = 0; index < flog_invalidated_block.invalid_block_count; index++)
-    {
-        flash_erase_block(flog_invalidated_block.block_idx[index]);
+void flog_delete_invalidated_block(void) {
+    flog_lock_fs();
+    flash_lock();
+    flog_lock_delete();
+
+    while (flogfs.gc.n || flogfs.gc.erasing) {
+        flog_gc_erase_next();
     }
-    flog_invalidated_block.invalid_block_count = 0;
-}
 
+    flog_unlock_delete();
+    flash_unlock();
+    flog_unlock_fs();
+}
 
-static void flog_invalidate_file_block(flog_block_idx_t block, flog_file_id_t file_id) {
-    flog_file_tail_sector_header_t file_tail_sector;
-    flog_block_statistics_sector_with_key_t block_statistics;
-    flog_block_idx_t num_freed = 0;
+/*!
+ @details
+ ### Internals
+ The time budget is spent on estimates: FS_ERASE_US for each erase started and
+ FS_PAGE_READ_US for each block swept. An erase started by an earlier call is
+ only waited for while the budget lasts. The last erase started is left running
+ on the flash, the next access to the flash waits for it.
+ */
+uint32_t flogfs_gc(uint32_t budget_us) {
+    uint32_t spent = 0;
+    uint32_t left;
 
-    flog_invalidated_block.invalid_block_count = 0;
+    flog_lock_fs();
 
-    union {
-        flog_file_init_sector_header_t init_sector;
-    } init_buffer_union;
+    if (flogfs.state != FLOG_STATE_MOUNTED) {
+        flog_unlock_fs();
+        return 0;
+    }
 
+    flash_lock();
     flog_lock_delete();
 
-    while (block != FLOG_BLOCK_IDX_INVALID) {
-        switch (flog_get_block_type(block)) {
-        case FLOG_BLOCK_TYPE_UNALLOCATED: {
-            flog_block_statistics_read(block, &block_statistics);
-            block = FLOG_BLOCK_IDX_INVALID;
+    while (1) {
+        if (flogfs.gc.erasing && !flog_gc_finish_erase(spent < budget_us)) {
             break;
         }
-        case FLOG_BLOCK_TYPE_FILE: {
-            flog_open_sector(block, FLOG_INIT_SECTOR);
-            flash_read_sector((uint8_t *)&init_buffer_union.init_sector, FLOG_INIT_SECTOR, 0, sizeof(flog_file_init_sector_header_t));
-            if (is_file_init_sector_header_for_file(&init_buffer_union.init_sector, file_id)) {
-                flog_open_sector(block, FLOG_TAIL_SECTOR);
-                flash_read_sector((uint8_t *)&file_tail_sector, FLOG_TAIL_SECTOR, 0, sizeof(flog_file_tail_sector_header_t));
-                block_statistics.header.age = init_buffer_union.init_sector.age;
-                block_statistics.header.next_block = file_tail_sector.universal.next_block;
-                block_statistics.header.next_age = file_tail_sector.universal.next_age;
-                block_statistics.header.timestamp = ++flogfs.t;
-                block_statistics.header.version = flogfs.version;
-                flog_close_sector();
 
-                /****************************************************************************/
-                /* Note: This done as part of SOLTEAM-851 task, deletion of block is separated.
-                Invalidation of File is only done here.
-                Invalidated block and index count is updated */
-                //flash_erase_block(block);
-                flog_invalidated_block.block_idx[flog_invalidated_block.invalid_block_count] = block;
-                flog_invalidated_block.invalid_block_count++;
-                /****************************************************************************/
-                // TODO: Add these to prealloc?
+        if (flogfs.gc.n) {
+            if (spent + FS_ERASE_US > budget_us) {
+                break;
+            }
+            spent += FS_ERASE_US;
+            flog_gc_erase_next_start();
+        }
+        else if (!flog_prealloc_is_full() && (flogfs.gc.swept < flogfs.params.number_of_blocks)) {
+            // A block swept may need an erase, which is left running
+            if (spent + FS_PAGE_READ_US > budget_us) {
+                break;
+            }
+            spent += FS_PAGE_READ_US;
+            if (flog_gc_sweep()) {
+                spent += FS_ERASE_US;
+            }
+        }
+        else {
+            break;
+        }
+    }
 
-                flog_block_statistics_write(block, &block_statistics);
+    left = flogfs.gc.n + (flogfs.gc.erasing && flogfs.gc.erase_invalidated);
 
-                num_freed += 1;
+    flog_unlock_delete();
+    flash_unlock();
+    flog_unlock_fs();
+    return left;
+}
 
-                block = block_statistics.header.next_block;
-            }
-            else {
-                assert(false);
-            }
+/*!
+ @details
+ ### Internals
+ The blocks are erased from the last one back, so the first block of a file
+ keeps its init sector until the whole chain is erased. After a reset the walk
+ from it stops at the first block which was erased, or erased and taken by
+ another file.
+ */
+static flog_block_idx_t flog_gc_queue_chain(flog_block_idx_t block, flog_file_id_t file_id) {
+    flog_file_init_sector_header_t init_sector;
+    flog_block_idx_t last_block = block;
+    flog_block_idx_t first = flogfs.gc.n;
+    flog_block_idx_t last;
+    flog_block_idx_t swap;
+
+    flog_lock_delete();
+
+    while (block != FLOG_BLOCK_IDX_INVALID) {
+        // A block allocated for the file but never written is free already
+        if (flog_get_block_type(block) != FLOG_BLOCK_TYPE_FILE) {
             break;
         }
-        default: {
-            assert(0);
+        flog_open_sector(block, FLOG_INIT_SECTOR);
+        flash_read_sector((uint8_t *)&init_sector, FLOG_INIT_SECTOR, 0, sizeof(flog_file_init_sector_header_t));
+        if (!is_file_init_sector_header_for_file(&init_sector, file_id)) {
             break;
         }
+
+        assert(flogfs.gc.n < FS_NUM_BLOCKS);
+        flogfs.gc.queue[(flogfs.gc.head + flogfs.gc.n) % FS_NUM_BLOCKS] = block;
+        flogfs.gc.n++;
+        if (flogfs.block_counts.counted) {
+            flogfs.block_counts.invalidated++;
         }
+
+        last_block = block;
+        block = flog_universal_get_next_block(block);
+    }
+
+    // The chain was queued first to last, it is erased last to first
+    for (last = flogfs.gc.n; first + 1 < last; first++, last--) {
+        swap = flogfs.gc.queue[(flogfs.gc.head + first) % FS_NUM_BLOCKS];
+        flogfs.gc.queue[(flogfs.gc.head + first) % FS_NUM_BLOCKS] =
+            flogfs.gc.queue[(flogfs.gc.head + last - 1) % FS_NUM_BLOCKS];
+        flogfs.gc.queue[(flogfs.gc.head + last - 1) % FS_NUM_BLOCKS] = swap;
     }
 
     flog_unlock_delete();
+    return last_block;
+}
+
+/*!
+ @details
+ ### Internals
+ An invalidated file is queued when its first block still carries its init
+ sector, see flog_gc_queue_chain(). Otherwise its blocks were all erased.
+ */
+static void flog_gc_recover() {
+    flog_inode_iterator_t inode_iter;
+    flog_inode_file_allocation_header_t allocation;
+    flog_inode_file_invalidation_t invalidation;
+
+    // The blocks still queued in RAM are found again
+    flogfs.gc.n = 0;
+    flogfs.gc.head = 0;
+
+    for (flog_inode_iterator_initialize(&inode_iter, flogfs.inode0); ; flog_inode_iterator_next(&inode_iter)) {
+        flog_open_sector(inode_iter.block, inode_iter.sector);
+        flash_read_sector((uint8_t *)&allocation, inode_iter.sector, 0, sizeof(flog_inode_file_allocation_header_t));
+        if (invalid_inode_file_allocation_header(&allocation)) {
+            break;
+        }
+
+        flog_open_sector(inode_iter.block, inode_iter.sector + 1);
+        flash_read_sector((uint8_t *)&invalidation, inode_iter.sector + 1, 0, sizeof(flog_timestamp_t));
+        if (!invalid_inode_file_invalidation(&invalidation) && !invalid_block_index(allocation.first_block) &&
+            (allocation.first_block < flogfs.params.number_of_blocks)) {
+            (void)flog_gc_queue_chain(allocation.first_block, allocation.file_id);
+        }
+    }
+    flog_close_sector();
+}
+
+static void flog_gc_start_erase(flog_block_idx_t block, flog_block_age_t age, uint_fast8_t invalidated) {
+    flog_close_sector();
+    flash_start_erase_block(block);
+    flogfs.gc.erasing = 1;
+    flogfs.gc.erase_invalidated = invalidated;
+    flogfs.gc.erase_block = block;
+    flogfs.gc.erase_age = age;
+}
+
+static void flog_gc_erase_next_start() {
+    flog_file_init_sector_header_t init_sector;
+    flog_block_idx_t block = flogfs.gc.queue[flogfs.gc.head];
+
+    flogfs.gc.head = (flogfs.gc.head + 1) % FS_NUM_BLOCKS;
+    flogfs.gc.n--;
+
+    flog_open_sector(block, FLOG_INIT_SECTOR);
+    flash_read_sector((uint8_t *)&init_sector, FLOG_INIT_SECTOR, 0, sizeof(flog_file_init_sector_header_t));
+    flog_gc_start_erase(block, init_sector.age, 1);
+}
+
+static uint_fast8_t flog_gc_finish_erase(uint_fast8_t wait) {
+    flog_block_statistics_sector_with_key_t statistics_sector;
+    flog_block_idx_t block = flogfs.gc.erase_block;
+
+    if (!wait && flash_busy()) {
+        return 0;
+    }
+
+    flogfs.gc.erasing = 0;
+    if (flogfs.gc.erase_invalidated && flogfs.block_counts.counted) {
+        flogfs.block_counts.invalidated--;
+    }
+
+    if (!flash_erase_result()) {
+        flash_debug_error("flog_gc_finish_erase: %d", block);
+        return 1;
+    }
+
+    statistics_sector.header.age = flogfs.gc.erase_age;
+    statistics_sector.header.next_block = FLOG_BLOCK_IDX_INVALID;
+    statistics_sector.header.next_age = FLOG_BLOCK_AGE_INVALID;
+    statistics_sector.header.timestamp = ++flogfs.t;
+    statistics_sector.header.version = flogfs.version;
+    memcpy(statistics_sector.key, flog_block_statistics_key, sizeof(flog_block_statistics_key));
+    flog_block_statistics_write(block, &statistics_sector);
+
+    if (flogfs.gc.erase_invalidated && flogfs.block_counts.counted) {
+        flogfs.block_counts.free++;
+    }
+
+    // The erased block is ready for the next allocation
+    if (!flog_prealloc_is_full() && !flog_prealloc_contains(block)) {
+        flog_prealloc_push(block, statistics_sector.header.age);
+    }
+
+    return 1;
+}
+
+static void flog_gc_erase_next() {
+    if (flogfs.gc.erasing) {
+        (void)flog_gc_finish_erase(1);
+    }
+    if (flogfs.gc.n) {
+        flog_gc_erase_next_start();
+        (void)flog_gc_finish_erase(1);
+    }
+}
+
+/*!
+ @details
+ ### Internals
+ This claims blocks as flog_prealloc_prime() does, one per call. The blocks of
+ an earlier format are erased in the background, so the allocations after a
+ format do not wait for erases.
+ */
+static uint_fast8_t flog_gc_sweep() {
+    flog_block_statistics_sector_with_key_t statistics_sector;
+    flog_inode_init_sector_spare_t inode_spare;
+    flog_block_idx_t block = flog_allocate_order(flogfs.gc.sweep);
+
+    flogfs.gc.sweep = (flogfs.gc.sweep + 1) % flogfs.params.number_of_blocks;
+    flogfs.gc.swept++;
+
+    // Block 0 is never allocated, as in flog_prealloc_prime()
+    if ((block == 0) || flog_prealloc_contains(block)) {
+        return 0;
+    }
+    if ((FLOG_FAILURE == flash_open_page(block, 0)) || (FLOG_SUCCESS == flash_block_is_bad())) {
+        flog_close_sector();
+        return 0;
+    }
+    flash_read_sector((uint8_t *)&statistics_sector, FLOG_BLOCK_STATISTICS_SECTOR, 0,
+                      sizeof(flog_block_statistics_sector_with_key_t));
+    flash_read_spare((uint8_t *)&inode_spare, FLOG_INIT_SECTOR);
+    flog_close_sector();
+
+    if (invalid_block_or_older_version(&statistics_sector)) {
+        flogfs.gc.swept = 0;
+        flog_gc_start_erase(block, invalid_block(&statistics_sector) ? 0 : statistics_sector.header.age, 0);
+        return 1;
+    }
+    if (inode_spare.type_id == FLOG_BLOCK_TYPE_UNALLOCATED) {
+        flogfs.gc.swept = 0;
+        flog_prealloc_push(block, statistics_sector.header.age);
+    }
+
+    return 0;
 }
+
 /***************************************End***********************************************/
 
 static flog_result_t flog_flush_write(flog_write_file_t *file) {
@@ -1879,6 +2968,7 @@ static void flog_prealloc_push(flog_block_idx_t block, flog_block_age_t age) {
 static flog_block_alloc_t flog_prealloc_pop(int32_t threshold) {
     flog_block_alloc_t *entry;
 
+    (void)threshold;
     flash_debug_warn("Pop");
 
     assert(flogfs.prealloc.available != NULL);
@@ -2071,6 +3161,7 @@ static void flog_invalidate_chain(flog_block_idx_t block, flog_file_id_t file_id
                 block_statistics.header.next_age = file_tail_sector.universal.next_age;
                 block_statistics.header.timestamp = ++flogfs.t;
                 block_statistics.header.version = flogfs.version;
+                memcpy(block_statistics.key, flog_block_statistics_key, sizeof(flog_block_statistics_key));
                 flog_close_sector();
 
                 flash_erase_block(block);
@@ -2078,6 +3169,9 @@ static void flog_invalidate_chain(flog_block_idx_t block, flog_file_id_t file_id
                 // TODO: Add these to prealloc?
 
                 flog_block_statistics_write(block, &block_statistics);
+                if (flogfs.block_counts.counted) {
+                    flogfs.block_counts.free++;
+                }
 
                 num_freed += 1;
 
@@ -2120,6 +3214,17 @@ static uint_fast8_t flog_prealloc_is_full() {
 static flog_block_alloc_t flog_allocate_block(int32_t threshold) {
     flog_block_alloc_t block;
 
+    flog_checkpoint_dirty();
+
+    if (flog_prealloc_is_empty()) {
+        flog_prealloc_prime();
+    }
+
+    // The blocks of invalidated files are erased now when nothing else is free
+    while (flog_prealloc_is_empty() && (flogfs.gc.n || flogfs.gc.erasing)) {
+        flog_gc_erase_next();
+    }
+
     if (flog_prealloc_is_empty()) {
         flash_debug_error("flog_allocate_block: flog_prealloc_is_empty");
         block.block = FLOG_BLOCK_IDX_INVALID;
@@ -2132,6 +3237,9 @@ static flog_block_alloc_t flog_allocate_block(int32_t threshold) {
             flog_prealloc_prime();
         }
         if (block.block != FLOG_BLOCK_IDX_INVALID) {
+            if (flogfs.block_counts.counted) {
+                flogfs.block_counts.free--;
+            }
             return block;
         }
 
@@ -2152,6 +3260,200 @@ static flog_sector_idx_t flog_increment_sector(flog_sector_idx_t sector) {
     return sector + 1;
 }
 
+/*!
+ @brief Hash of a filename for the filename index
+ */
+static uint16_t flog_name_hash(char const *filename) {
+    uint32_t hash = 2166136261u;
+    uint_fast8_t i;
+
+    // FNV-1a, folded to 16 bits
+    for (i = 0; (i < FLOG_MAX_FNAME_LEN) && filename[i]; i++) {
+        hash = (hash ^ (uint8_t)filename[i]) * 16777619u;
+    }
+
+    return (uint16_t)(hash ^ (hash >> 16));
+}
+
+static flog_result_t flog_name_index_add(char const *filename, flog_file_id_t file_id, flog_block_idx_t first_block,
+                                         flog_inode_iterator_t const *inode, uint32_t size) {
+    flog_name_index_entry_t *entry;
+    uint16_t hash = flog_name_hash(filename);
+    uint16_t slot = hash % FLOG_NAME_INDEX_SIZE;
+
+    if (flogfs.names.used >= (FLOG_NAME_INDEX_SIZE / 4) * 3) {
+        return FLOG_FAILURE;
+    }
+
+    while (1) {
+        entry = &flogfs.names.entries[slot];
+        if (entry->file_id == FLOG_FILE_ID_INVALID) {
+            flogfs.names.used++;
+            break;
+        }
+        if (entry->file_id == FLOG_NAME_INDEX_DELETED) {
+            break;
+        }
+        slot = (slot + 1) % FLOG_NAME_INDEX_SIZE;
+    }
+
+    entry->file_id = file_id;
+    entry->size = size;
+    entry->first_block = first_block;
+    entry->inode_block = inode->block;
+    entry->inode_sector = inode->sector;
+    entry->hash = hash;
+    return FLOG_SUCCESS;
+}
+
+/*!
+ @details
+ The inode table is scanned once, as flog_find_file() would for a name which
+ does not exist. Deleted files are left out. If the files don't fit, the index
+ is incomplete and flog_find_file() falls back to the scan.
+ */
+static void flog_name_index_build() {
+    flog_inode_iterator_t inode_iter;
+    flog_inode_file_allocation_t allocation;
+    flog_inode_file_invalidation_t invalidation;
+    uint16_t i;
+
+    for (i = 0; i < FLOG_NAME_INDEX_SIZE; i++) {
+        flogfs.names.entries[i].file_id = FLOG_FILE_ID_INVALID;
+    }
+    flogfs.names.used = 0;
+    flogfs.names.built = 1;
+    flogfs.names.complete = 1;
+    flogfs.names.last = nullptr;
+
+    for (flog_inode_iterator_initialize(&inode_iter, flogfs.inode0); ; flog_inode_iterator_next(&inode_iter)) {
+        flog_open_sector(inode_iter.block, inode_iter.sector);
+        flash_read_sector((uint8_t *)&allocation.header, inode_iter.sector, 0, sizeof(flog_inode_file_allocation_header_t));
+        if (invalid_inode_file_allocation_header(&allocation.header)) {
+            break;
+        }
+
+        if (allocation.header.file_id > flogfs.max_file_id) {
+            flogfs.max_file_id = allocation.header.file_id;
+        }
+        // The timestamps go on after the newest one of the inode table
+        flogfs.t = MAX(flogfs.t, allocation.header.timestamp);
+
+        flog_open_sector(inode_iter.block, inode_iter.sector + 1);
+        flash_read_sector((uint8_t *)&invalidation, inode_iter.sector + 1, 0, sizeof(flog_timestamp_t));
+        if (!invalid_inode_file_invalidation(&invalidation)) {
+            flogfs.t = MAX(flogfs.t, invalidation.header.timestamp);
+            continue;
+        }
+
+        // Only the names of files which exist
+        flog_open_sector(inode_iter.block, inode_iter.sector);
+        flash_read_sector((uint8_t *)allocation.filename, inode_iter.sector, sizeof(flog_inode_file_allocation_header_t), FLOG_MAX_FNAME_LEN);
+        allocation.filename[FLOG_MAX_FNAME_LEN - 1] = '\0';
+        if (!flog_name_index_add(allocation.filename, allocation.header.file_id, allocation.header.first_block,
+                                 &inode_iter, FLOG_FILE_SIZE_UNKNOWN)) {
+            flogfs.names.complete = 0;
+        }
+    }
+
+    flogfs.names.inode_end = inode_iter;
+}
+
+static void flog_name_index_ensure() {
+    if (!flogfs.names.built) {
+        flog_name_index_build();
+    }
+}
+
+static flog_name_index_entry_t *flog_name_index_entry(flog_file_id_t file_id) {
+    flog_name_index_entry_t *entry;
+
+    flog_name_index_ensure();
+
+    if (flogfs.names.last && (flogfs.names.last->file_id == file_id)) {
+        return flogfs.names.last;
+    }
+
+    for (entry = flogfs.names.entries; entry < flogfs.names.entries + FLOG_NAME_INDEX_SIZE; entry++) {
+        if (entry->file_id == file_id) {
+            flogfs.names.last = entry;
+            return entry;
+        }
+    }
+
+    return nullptr;
+}
+
+static void flog_name_index_remove(flog_file_id_t file_id) {
+    flog_name_index_entry_t *entry = flog_name_index_entry(file_id);
+
+    if (entry) {
+        entry->file_id = FLOG_NAME_INDEX_DELETED;
+    }
+}
+
+static void flog_name_index_set_size(flog_file_id_t file_id, uint32_t size) {
+    flog_name_index_entry_t *entry = flog_name_index_entry(file_id);
+
+    if (entry) {
+        entry->size = size;
+    }
+}
+
+static void flog_name_index_create(char const *filename, flog_file_id_t file_id, flog_block_idx_t first_block,
+                                   flog_inode_iterator_t const *inode) {
+    flogfs.names.inode_end = *inode;
+    flog_inode_iterator_next(&flogfs.names.inode_end);
+
+    if (flogfs.names.complete && !flog_name_index_add(filename, file_id, first_block, inode, 0)) {
+        // Drop the deleted files, the new one is in the inode table already
+        flog_name_index_build();
+    }
+}
+
+/*!
+ @brief Find a file in the filename index
+ @details
+ Every entry with the hash of the name is checked against the name in its
+ inode entry. Should a name be in the table twice, the older file is taken
+ like the scan of the inode table does.
+ */
+static flog_file_find_result_t flog_name_index_find(char const *filename, flog_inode_iterator_t *iter) {
+    flog_name_index_entry_t *entry, *found = nullptr;
+    char name[FLOG_MAX_FNAME_LEN];
+    flog_file_find_result_t result;
+    uint16_t hash = flog_name_hash(filename);
+    uint16_t slot = hash % FLOG_NAME_INDEX_SIZE;
+
+    for (entry = &flogfs.names.entries[slot]; entry->file_id != FLOG_FILE_ID_INVALID;
+         slot = (slot + 1) % FLOG_NAME_INDEX_SIZE, entry = &flogfs.names.entries[slot]) {
+        if ((entry->file_id == FLOG_NAME_INDEX_DELETED) || (entry->hash != hash) ||
+            (found && (found->file_id < entry->file_id))) {
+            continue;
+        }
+
+        flog_open_sector(entry->inode_block, entry->inode_sector);
+        flash_read_sector((uint8_t *)name, entry->inode_sector, sizeof(flog_inode_file_allocation_header_t), FLOG_MAX_FNAME_LEN);
+        if (strncmp(filename, name, FLOG_MAX_FNAME_LEN) == 0) {
+            found = entry;
+        }
+    }
+
+    if (found == nullptr) {
+        // A new file goes here
+        *iter = flogfs.names.inode_end;
+        result.first_block = FLOG_BLOCK_IDX_INVALID;
+        return result;
+    }
+
+    flogfs.names.last = found;
+    iter->block = found->inode_block;
+    iter->sector = found->inode_sector;
+    result.first_block = found->first_block;
+    result.file_id = found->file_id;
+    return result;
+}
+
 static flog_file_find_result_t flog_find_file(char const *filename, flog_inode_iterator_t *iter) {
     union {
         flog_inode_file_allocation_t allocation;
@@ -2160,6 +3462,12 @@ static flog_file_find_result_t flog_find_file(char const *filename, flog_inode_i
 
     flog_file_find_result_t found;
 
+    flog_name_index_ensure();
+
+    if (flogfs.names.complete) {
+        return flog_name_index_find(filename, iter);
+    }
+
     for (flog_inode_iterator_initialize(iter, flogfs.inode0); ; flog_inode_iterator_next(iter)) {
         flog_open_sector(iter->block, iter->sector);
         flash_read_sector((uint8_t *)&buffer_union.allocation, iter->sector, 0, sizeof(flog_inode_file_allocation_t));
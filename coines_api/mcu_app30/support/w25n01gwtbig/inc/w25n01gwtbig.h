@@ -31,10 +31,13 @@ extern "C"
 #define W25N01GW_NO_OF_BLOCKS	1024//No.of Blocks in variant W25N01GWTBIG
 #define W25N01GW_SECTOR_SIZE	512 //Size of the sector
 #define W25N01GW_PAGE_SIZE 		(W25N01GW_NO_OF_SEC*W25N01GW_SECTOR_SIZE) //Size of the page
+#define W25N01GW_SPARE_SIZE		64 //Size of the spare area of a page, following the page data
 #define W25N01GW_BLOCK_SIZE 	(W25N01GW_NO_OF_PAGES*W25N01GW_PAGE_SIZE) //Size of the block
-#define W25N01GW_FLASH_SIZE		(W25N01GW_BLOCK_SIZE*W25N01GW_NO_OF_BLOCKS) //Size of the flash
-#define W25N01GW_TOTAL_SECTORS	(W25N01GW_NO_OF_SEC*W25N01GW_NO_OF_PAGES*W25N01GW_NO_OF_BLOCKS) //Total no. of sectors
+#define W25N01GW_FLASH_SIZE		(W25N01GW_BLOCK_SIZE*W25N01GW_NO_OF_BLOCKS) //Size of the flash, of one die of a W25M
+#define W25N01GW_TOTAL_SECTORS	(W25N01GW_NO_OF_SEC*W25N01GW_NO_OF_PAGES*W25N01GW_NO_OF_BLOCKS) //Total no. of sectors, of one die
 #define W25N01GW_SECTORS_PER_BLOCK	(W25N01GW_NO_OF_PAGES*W25N01GW_NO_OF_SEC) //No. of sectors per block
+#define W25N01GW_MAX_DIES		2 //No. of dies of the stacked W25M02GW
+#define W25N01GW_PAGES_PER_DIE	(W25N01GW_NO_OF_PAGES*W25N01GW_NO_OF_BLOCKS) //Page numbers of the next die start here
 
 /*
  * @brief	Enum for defining W25N01GW errorCode
@@ -109,6 +112,14 @@ typedef struct W25N01GW_memoryParams_s
     uint16_t eraseBlockUnits;
 } W25N01GW_memoryParams_t;
 
+/**
+ * @brief Called from interrupt context when a program, erase or page read has ended
+ *
+ * @param[in] status : status register at the end of the operation
+ * @param[in] context : context of W25N01GW_setReadyCallback
+ */
+typedef void (*W25N01GW_readyCallback_t)(uint8_t status, void* context);
+
 /**********************************************************************************/
 /* function declarations */
 /**********************************************************************************/
@@ -130,6 +141,26 @@ W25N01GW_errorCode_t W25N01GW_Init();
  * @return      : W25N01GW errorCode
  */
 W25N01GW_errorCode_t W25N01GW_getDeviceInitStatus(void);
+/*!
+ *
+ * @brief       : API to get the number of dies, 2 for the W25M02GW. The page and block numbers
+ *                of the APIs go on from one die to the next, the dies work in parallel.
+ *
+ * @param[in]   : void
+ *
+ * @return      : number of dies
+ */
+uint8_t W25N01GW_getDieCount(void);
+/*!
+ *
+ * @brief       : API to select the die of the page buffer used by W25N01GW_readBuffer and
+ *                W25N01GW_loadProgramData. The APIs with a page or block number select its die.
+ *
+ * @param[in]   : die
+ *
+ * @return      : None
+ */
+void W25N01GW_selectDie(uint8_t die);
 /*!
  *
  * @brief       : API to erase block
@@ -139,6 +170,27 @@ W25N01GW_errorCode_t W25N01GW_getDeviceInitStatus(void);
  * @return      : W25N01GW errorCode
  */
 W25N01GW_errorCode_t W25N01GW_eraseBlock(uint32_t pos, uint32_t len);
+/*!
+ *
+ * @brief       : API to start the erase of a block, without waiting for its end.
+ *                The next command to its die waits for it, W25N01GW_eraseResult returns its status.
+ *
+ * @param[in]   : block number
+ *
+ * @return      : W25N01GW errorCode
+ */
+W25N01GW_errorCode_t W25N01GW_startEraseBlock(uint16_t blockNum);
+/*!
+ *
+ * @brief       : API to wait for the end of an erase started by W25N01GW_startEraseBlock.
+ *                The status is the one of the last operation of its die, a later program or
+ *                page read there replaces it.
+ *
+ * @param[in]   : void
+ *
+ * @return      : W25N01GW errorCode
+ */
+W25N01GW_errorCode_t W25N01GW_eraseResult(void);
 /*!
  *
  * @brief       : API to read
@@ -149,6 +201,36 @@ W25N01GW_errorCode_t W25N01GW_eraseBlock(uint32_t pos, uint32_t len);
  */
 W25N01GW_errorCode_t W25N01GW_read(uint8_t* dataPtr, uint32_t noOfbytesToRead,
                                    uint32_t readLoc);
+/*!
+ *
+ * @brief       : API to read a page into the data buffer of the device
+ *
+ * @param[in]   : page number
+ *
+ * @return      : W25N01GW errorCode
+ */
+W25N01GW_errorCode_t W25N01GW_pageRead(uint32_t pageNum);
+/*!
+ *
+ * @brief       : API to start the read of a page into the data buffer of the device, without
+ *                waiting for its end. The next command to its die waits for it.
+ *
+ * @param[in]   : page number
+ *
+ * @return      : W25N01GW errorCode
+ */
+W25N01GW_errorCode_t W25N01GW_startPageRead(uint32_t pageNum);
+/*!
+ *
+ * @brief       : API to read from the data buffer of the selected die, the page read last. Fails
+ *                with W25N01GW_ECC_FAILURE when that page read reported ECC errors
+ *
+ * @param[in]   : data pointer, No. of bytes to read and page offset (up to the end of the spare area)
+ *
+ * @return      : W25N01GW errorCode
+ */
+W25N01GW_errorCode_t W25N01GW_readBuffer(uint8_t* dataPtr, uint16_t noOfbytesToRead,
+                                         uint16_t pageOff);
 /*!
  *
  * @brief       : API to read spare
@@ -159,7 +241,7 @@ W25N01GW_errorCode_t W25N01GW_read(uint8_t* dataPtr, uint32_t noOfbytesToRead,
  */
 W25N01GW_errorCode_t W25N01GW_read_spare(uint8_t* dataPtr,
                                          int8_t noOfbytesToRead,
-                                         uint16_t pageNum, uint16_t pageOff);
+                                         uint32_t pageNum, uint16_t pageOff);
 /*!
  *
  * @brief       : API to write the spare
@@ -170,7 +252,7 @@ W25N01GW_errorCode_t W25N01GW_read_spare(uint8_t* dataPtr,
  */
 W25N01GW_errorCode_t W25N01GW_write_spare(const uint8_t* dataPtr,
                                           uint8_t noOfbytesToWrite,
-                                          uint16_t pageNum, uint16_t pageOff);
+                                          uint32_t pageNum, uint16_t pageOff);
 /*!
  *
  * @brief       : API to write
@@ -182,6 +264,68 @@ W25N01GW_errorCode_t W25N01GW_write_spare(const uint8_t* dataPtr,
 W25N01GW_errorCode_t W25N01GW_write(const uint8_t* dataPtr,
                                     uint32_t noOfbytesToWrite,
                                     uint32_t writeLoc);
+/*!
+ *
+ * @brief       : API to load data into the page buffer of the selected die, without programming it
+ *
+ * @param[in]   : data pointer, No. of bytes to load, page offset (up to the end of the spare area)
+ *                and resetBuffer, 1 for the first load of a page: the page buffer is set to 0xFF
+ *                first, so bytes which are not loaded leave the flash unchanged
+ *
+ * @return      : W25N01GW errorCode
+ */
+W25N01GW_errorCode_t W25N01GW_loadProgramData(const uint8_t* dataPtr,
+                                              uint16_t noOfbytesToLoad,
+                                              uint16_t pageOff,
+                                              uint8_t resetBuffer);
+/*!
+ *
+ * @brief       : API to program the page buffer into a page and wait for the end of the program
+ *
+ * @param[in]   : page number
+ *
+ * @return      : W25N01GW errorCode
+ */
+W25N01GW_errorCode_t W25N01GW_programExecute(uint32_t pageNum);
+/*!
+ *
+ * @brief       : API to start the program of the page buffer into a page, without waiting for its end.
+ *                The next command to its die waits for it, W25N01GW_waitReady returns its status.
+ *
+ * @param[in]   : page number
+ *
+ * @return      : W25N01GW errorCode
+ */
+W25N01GW_errorCode_t W25N01GW_startProgramExecute(uint32_t pageNum);
+/*!
+ *
+ * @brief       : API to check whether a program, erase or page read is running on any die.
+ *                The status is polled on a timer in the background, this API does not access the bus.
+ *
+ * @param[in]   : void
+ *
+ * @return      : 1 while busy, else 0
+ */
+uint8_t W25N01GW_isBusy(void);
+/*!
+ *
+ * @brief       : API to wait for the end of the programs, erases and page reads running on all dies.
+ *                The MCU sleeps until the background poll sees the device ready.
+ *
+ * @param[in]   : void
+ *
+ * @return      : status register at the end of the last operation
+ */
+uint8_t W25N01GW_waitReady(void);
+/*!
+ *
+ * @brief       : API to set the callback run when a program, erase or page read has ended
+ *
+ * @param[in]   : callback, NULL for none, and its context
+ *
+ * @return      : None
+ */
+void W25N01GW_setReadyCallback(W25N01GW_readyCallback_t callback, void* context);
 /*!
  *
  * @brief       : API for read register
@@ -27,7 +27,8 @@
 #include <stdlib.h>
 
 #include "nrf_gpio.h"
-#include "nrf_drv_spi.h"
+#include "nrfx_spim.h"
+#include "nrfx_timer.h"
 #include "w25n01gwtbig.h"
 
 #define SPI_MOSI_PIN_FLASH      NRF_GPIO_PIN_MAP(0,20)
@@ -37,10 +38,12 @@
 #define SPI_HOLD_PIN_FLASH      NRF_GPIO_PIN_MAP(0, 23)
 #define SPI_WP_PIN_FLASH        NRF_GPIO_PIN_MAP(0, 22)
 
-#define SPI_INSTANCE  2                                           /**< SPI instance index. */
-//static const nrf_drv_spi_t spi = {.inst_idx = 3,.use_easy_dma=true};
-static const nrf_drv_spi_t spi = NRF_DRV_SPI_INSTANCE(SPI_INSTANCE);
-nrf_drv_spi_config_t spi_config_flash = NRF_DRV_SPI_DEFAULT_CONFIG;
+#define SPI_INSTANCE  2                                           /**< SPIM instance index. */
+#define TIMER_INSTANCE  0                                         /**< Timer of the status polls while the flash is busy. */
+static const nrfx_spim_t spi = NRFX_SPIM_INSTANCE(SPI_INSTANCE);
+static const nrfx_timer_t poll_timer = NRFX_TIMER_INSTANCE(TIMER_INSTANCE);
+nrfx_spim_config_t spi_config_flash = NRFX_SPIM_DEFAULT_CONFIG;
+static bool spi_ready = false;
 static volatile bool spi_xfer_done;
 
 
@@ -57,6 +60,7 @@ static volatile bool spi_xfer_done;
 #define W25N01GW_CMD_PAGE_DATA_RD        0x13
 #define W25N01GW_CMD_RD_DATA             0x03
 #define W25N01GW_CMD_FAST_RD             0x0B
+#define W25N01GW_CMD_DIE_SELECT          0xC2
 
 
 
@@ -77,17 +81,65 @@ static volatile bool spi_xfer_done;
 #define W25N01GW_RD_SREG_CMD_LEN 0x02
 #define W25N01GW_MIN_RCV_BYTES_LEN  0x03/*First two bytes will receive nothing */
 
+/* Typical busy times of the data sheet (ECC off). The status is first read after them, then
+ * every W25N01GW_POLL_DIV-th of them */
+#define W25N01GW_T_RD_US        25
+#define W25N01GW_T_PROG_US      250
+#define W25N01GW_T_BERS_US      2000
+#define W25N01GW_POLL_DIV       4
+#define W25N01GW_POLL_MIN_US    10
+
+/* EasyDMA reads from RAM only, data in flash is sent through this buffer */
+#define W25N01GW_STAGING_SIZE   64
+
 
 #define W25N01GW_DEVICE_ID 0xBA21
 #define W25M01GW_DEVICE_ID 0xBB21
 #define W25N01GW_MANUFACTURER_ID 0xEF
 W25N01GW_errorCode_t W25N01GW_initStatus = W25N01GW_UNINITIALIZED;
 
+/* Program, erase or page read running on a die, polled in the background by poll_timer. The
+ * W25M stacks W25N01GW dies behind one chip select, the die select command routes the commands
+ * to one die while the others go on with their operations */
+static uint8_t die_count = 1;
+static volatile uint8_t die_busy = 0;                   /* Bit per die */
+static volatile uint8_t die_status[W25N01GW_MAX_DIES];
+static uint32_t die_poll_us[W25N01GW_MAX_DIES];
+static volatile uint8_t chip_die = 0;                   /* Die selected on the chip */
+static uint8_t target_die = 0;                          /* Die of the next command */
+static uint8_t last_die = 0;                            /* Die of the last operation started */
+static uint8_t erase_die = 0;
+/* A command is on the bus, the background poll waits for its end */
+static volatile bool bus_owned = false;
+static volatile bool flash_polling = false;
+static volatile uint8_t poll_dies;                      /* Dies still to poll in this round */
+static volatile uint8_t poll_die;
+static volatile bool poll_selecting;
+static W25N01GW_readyCallback_t ready_callback = NULL;
+static void *ready_context = NULL;
+static uint8_t poll_cmd[W25N01GW_RD_SREG_CMD_LEN] = { W25N01GW_CMD_RD_REG, W25N01GW_STATUS_REG_ADDR };
+static uint8_t poll_select_cmd[2] = { W25N01GW_CMD_DIE_SELECT, 0 };
+static uint8_t poll_rx[W25N01GW_MIN_RCV_BYTES_LEN];
+static uint8_t select_cmd[2] = { W25N01GW_CMD_DIE_SELECT, 0 };
+static uint8_t staging[W25N01GW_STAGING_SIZE];
+
 //Return '1' if the bit value at position y within x is '1' and '0' if it's 0 by ANDing x with a bit mask where the bit in y's position is '1' and '0' elsewhere and comparing it to all 0's.  Returns '1' in least significant bit position if the value of the bit is '1', '0' if it was '0'.
 #define READ(x,y) ((0u == (x & (1<<y)))?0u:1u)
 /**********************************************************************************/
 /* static function declaration */
 /**********************************************************************************/
+static void flash_sleep(void);
+static void spi_xfer(const uint8_t* tx, uint16_t tx_len, uint8_t* rx, uint16_t rx_len);
+static void flash_command(const uint8_t* cmd, uint8_t cmd_len, const uint8_t* tx, uint16_t tx_len,
+                          uint8_t* rx, uint16_t rx_len);
+static void poll_arm(uint32_t delay_us);
+static uint32_t poll_interval(uint8_t dies);
+static void poll_start(void);
+static void poll_next(void);
+static uint8_t die_wait(uint8_t die);
+static uint16_t page_select(uint32_t pageNum);
+static void flash_start_busy(uint32_t busy_us);
+static uint8_t flash_page_read(uint32_t pageNum);
 
 /**********************************************************************************/
 /* functions */
@@ -95,58 +147,402 @@ W25N01GW_errorCode_t W25N01GW_initStatus = W25N01GW_UNINITIALIZED;
 
 /**********************************************************************************/
 
-void spi_event_handler(nrfx_spim_evt_t const * p_event,
+/*!
+ * @brief Ends a transfer, or the status read of a poll: the flash is ready or the next poll is armed
+ */
+static void spi_event_handler(nrfx_spim_evt_t const * p_event,
                         void * p_context)
 {
-    spi_xfer_done = true;
+    uint8_t status;
+
+    (void)p_event;
+    (void)p_context;
+
+    if (!flash_polling)
+    {
+        spi_xfer_done = true;
+        __SEV();
+        return;
+    }
+
+    nrf_gpio_pin_set(SPI_CS_PIN_FLASH);
+    if (poll_selecting)
+    {
+        /* The die is selected, its status read follows */
+        poll_selecting = false;
+        chip_die = poll_die;
+        poll_start();
+        return;
+    }
+
+    status = poll_rx[W25N01GW_MIN_RCV_BYTES_LEN-1];
+    poll_dies &= ~(1u << poll_die);
+    if (!(status & W25N01GW_BUSY_STAT))
+    {
+        die_status[poll_die] = status;
+        die_busy &= ~(1u << poll_die);
+        __SEV();
+
+        if (ready_callback != NULL)
+        {
+            ready_callback(status, ready_context);
+        }
+    }
+
+    poll_next();
 }
+
+/*!
+ * @brief Starts a round of status reads of the busy dies, the SPIM is idle while the flash is busy
+ */
+static void poll_timer_handler(nrf_timer_event_t event_type, void * p_context)
+{
+    (void)event_type;
+    (void)p_context;
+
+    if (bus_owned)
+    {
+        poll_arm(poll_interval(die_busy));
+        return;
+    }
+
+    flash_polling = true;
+    poll_dies = die_busy;
+    poll_next();
+}
+
+/*!
+ * @brief Starts the die select or the status read of the die polled now
+ */
+static void poll_start(void)
+{
+    nrfx_spim_xfer_desc_t status_desc = NRFX_SPIM_XFER_TRX(poll_cmd, W25N01GW_RD_SREG_CMD_LEN,
+                                                           poll_rx, W25N01GW_MIN_RCV_BYTES_LEN);
+    nrfx_spim_xfer_desc_t select_desc = NRFX_SPIM_XFER_TRX(poll_select_cmd, sizeof(poll_select_cmd), NULL, 0);
+
+    poll_select_cmd[1] = poll_die;
+    nrf_gpio_pin_clear(SPI_CS_PIN_FLASH);
+    if (nrfx_spim_xfer(&spi, poll_selecting ? &select_desc : &status_desc, 0) != NRFX_SUCCESS)
+    {
+        nrf_gpio_pin_set(SPI_CS_PIN_FLASH);
+        poll_selecting = false;
+        flash_polling = false;
+        poll_arm(poll_interval(die_busy));
+    }
+}
+
+/*!
+ * @brief Polls the next die of the round, or ends the round and arms the next one
+ */
+static void poll_next(void)
+{
+    uint8_t die;
+
+    for (die = 0; die < die_count; die++)
+    {
+        if (poll_dies & (1u << die))
+        {
+            poll_die = die;
+            poll_selecting = (die != chip_die);
+            poll_start();
+            return;
+        }
+    }
+
+    flash_polling = false;
+    if (die_busy)
+    {
+        poll_arm(poll_interval(die_busy));
+    }
+}
+
+/*!
+ * @brief Shortest poll interval of the given dies
+ */
+static uint32_t poll_interval(uint8_t dies)
+{
+    uint32_t interval_us = UINT32_MAX;
+    uint8_t die;
+
+    for (die = 0; die < die_count; die++)
+    {
+        if (dies & (1u << die))
+        {
+            interval_us = MIN(interval_us, die_poll_us[die]);
+        }
+    }
+
+    return (interval_us == UINT32_MAX) ? W25N01GW_POLL_MIN_US : interval_us;
+}
+
+/*!
+ * @brief Waits for the next SPIM or timer event
+ *
+ * The driver interrupts cannot preempt an interrupt handler of the same or higher priority,
+ * they are run from here then.
+ */
+static void flash_sleep(void)
+{
+    IRQn_Type irqn;
+
+    if (__get_IPSR() == 0)
+    {
+        __WFE();
+        return;
+    }
+
+    irqn = nrfx_get_irq_number(spi.p_reg);
+    if (NVIC_GetPendingIRQ(irqn))
+    {
+        NVIC_ClearPendingIRQ(irqn);
+        NRFX_CONCAT_3(nrfx_spim_, SPI_INSTANCE, _irq_handler)();
+    }
+
+    irqn = nrfx_get_irq_number(poll_timer.p_reg);
+    if (NVIC_GetPendingIRQ(irqn))
+    {
+        NVIC_ClearPendingIRQ(irqn);
+        NRFX_CONCAT_3(nrfx_timer_, TIMER_INSTANCE, _irq_handler)();
+    }
+}
+
+/*!
+ * @brief One EasyDMA transfer, chip select is driven by the caller
+ */
+static void spi_xfer(const uint8_t* tx, uint16_t tx_len, uint8_t* rx, uint16_t rx_len)
+{
+    nrfx_spim_xfer_desc_t desc = NRFX_SPIM_XFER_TRX(tx, tx_len, rx, rx_len);
+
+    spi_xfer_done = false;
+    if (nrfx_spim_xfer(&spi, &desc, 0) != NRFX_SUCCESS)
+    {
+        return;
+    }
+    while (!spi_xfer_done)
+    {
+        flash_sleep();
+    }
+}
+
+/*!
+ * @brief One command to the target die: the command bytes, then the data sent from tx or
+ *        received into rx
+ *
+ * Chip select stays low between the two transfers, so the data goes to and from the buffer
+ * of the caller without a copy. Waits for the end of a running program, erase or page read of
+ * the die first, the other dies go on. The die is selected if the poll or an earlier command
+ * selected another one.
+ */
+static void flash_command(const uint8_t* cmd, uint8_t cmd_len, const uint8_t* tx, uint16_t tx_len,
+                          uint8_t* rx, uint16_t rx_len)
+{
+    uint16_t len;
+
+    (void)die_wait(target_die);
+
+    bus_owned = true;
+    while (flash_polling)
+    {
+        flash_sleep();
+    }
+
+    if ((die_count > 1) && (chip_die != target_die))
+    {
+        select_cmd[1] = target_die;
+        nrf_gpio_pin_clear(SPI_CS_PIN_FLASH);
+        spi_xfer(select_cmd, sizeof(select_cmd), NULL, 0);
+        nrf_gpio_pin_set(SPI_CS_PIN_FLASH);
+        chip_die = target_die;
+    }
+
+    nrf_gpio_pin_clear(SPI_CS_PIN_FLASH);
+    spi_xfer(cmd, cmd_len, NULL, 0);
+
+    if ((tx_len != 0) && nrfx_is_in_ram(tx))
+    {
+        spi_xfer(tx, tx_len, NULL, 0);
+    }
+    else
+    {
+        while (tx_len != 0)
+        {
+            len = MIN(tx_len, W25N01GW_STAGING_SIZE);
+            memcpy(staging, tx, len);
+            spi_xfer(staging, len, NULL, 0);
+            tx += len;
+            tx_len -= len;
+        }
+    }
+
+    if (rx_len != 0)
+    {
+        spi_xfer(NULL, 0, rx, rx_len);
+    }
+
+    nrf_gpio_pin_set(SPI_CS_PIN_FLASH);
+    bus_owned = false;
+}
+
+/*!
+ * @brief Arms the one shot status poll
+ */
+static void poll_arm(uint32_t delay_us)
+{
+    nrfx_timer_clear(&poll_timer);
+    nrfx_timer_extended_compare(&poll_timer, NRF_TIMER_CC_CHANNEL0,
+                                nrfx_timer_us_to_ticks(&poll_timer, delay_us),
+                                NRF_TIMER_SHORT_COMPARE0_STOP_MASK, true);
+    nrfx_timer_resume(&poll_timer);
+}
+
+/*!
+ * @brief Marks the target die busy after a program, erase or page read, and polls it in the
+ *        background
+ */
+static void flash_start_busy(uint32_t busy_us)
+{
+    uint8_t others = die_busy;
+
+    die_poll_us[target_die] = MAX(busy_us / W25N01GW_POLL_DIV, W25N01GW_POLL_MIN_US);
+    die_busy = others | (1u << target_die);
+    last_die = target_die;
+
+    /* A die busy already is polled at its interval still */
+    poll_arm(others ? MIN(busy_us, poll_interval(others)) : busy_us);
+}
+
+/*!
+ * @brief Waits for the end of the operation running on a die
+ *
+ * @return status register of the die at the end of its last operation
+ */
+static uint8_t die_wait(uint8_t die)
+{
+    while (die_busy & (1u << die))
+    {
+        flash_sleep();
+    }
+
+    return die_status[die];
+}
+
+/*!
+ * @brief Makes the die of a page the target of the next commands
+ *
+ * @return page number within the die
+ */
+static uint16_t page_select(uint32_t pageNum)
+{
+    target_die = (uint8_t)(pageNum / W25N01GW_PAGES_PER_DIE);
+
+    return (uint16_t)(pageNum % W25N01GW_PAGES_PER_DIE);
+}
+
+/*!
+ * @brief Reads a page into the data buffer of its die
+ *
+ * @return status register at the end of the read
+ */
+static uint8_t flash_page_read(uint32_t pageNum)
+{
+    (void)W25N01GW_startPageRead(pageNum);
+
+    return die_wait(target_die);
+}
+
 W25N01GW_errorCode_t W25N01GW_Init()
 {
     W25N01GW_errorCode_t ret_code = W25N01GW_INITIALIZATION_FAILED;
     uint8_t reg_val = 0;
     W25N01GW_deviceInfo_t info;
-
+    nrfx_timer_config_t timer_config = {
+        .frequency = NRF_TIMER_FREQ_1MHz,
+        .mode = NRF_TIMER_MODE_TIMER,
+        .bit_width = NRF_TIMER_BIT_WIDTH_32,
+        .interrupt_priority = NRFX_SPIM_DEFAULT_CONFIG_IRQ_PRIORITY, /* Same as the SPIM, the handlers do not preempt each other */
+        .p_context = NULL
+    };
+
+    if (spi_ready)
+    {
+        (void)W25N01GW_waitReady();
+        nrfx_timer_uninit(&poll_timer);
+        nrfx_spim_uninit(&spi);
+        spi_ready = false;
+    }
 
     spi_config_flash.miso_pin = SPI_MISO_PIN_FLASH;
     spi_config_flash.mosi_pin = SPI_MOSI_PIN_FLASH;
     spi_config_flash.sck_pin  = SPI_CLK_PIN_FLASH;
-    spi_config_flash.ss_pin = SPI_CS_PIN_FLASH;
-    spi_config_flash.frequency = NRF_DRV_SPI_FREQ_4M;
+    spi_config_flash.ss_pin = NRFX_SPIM_PIN_NOT_USED; /* Held low across the command and data transfers */
+    spi_config_flash.frequency = NRF_SPIM_FREQ_4M;
 
 
+    nrf_gpio_pin_set(SPI_CS_PIN_FLASH);
+    nrf_gpio_cfg_output(SPI_CS_PIN_FLASH);
     nrf_gpio_cfg_output(SPI_HOLD_PIN_FLASH);
     nrf_gpio_cfg_output(SPI_WP_PIN_FLASH);
     nrf_gpio_pin_set(SPI_HOLD_PIN_FLASH);
     nrf_gpio_pin_set(SPI_WP_PIN_FLASH);
 
 
-    if(nrf_drv_spi_init(&spi, &spi_config_flash,NULL, NULL))
+    if(nrfx_spim_init(&spi, &spi_config_flash, spi_event_handler, NULL) != NRFX_SUCCESS)
     {
         ret_code = W25N01GW_ERROR;
         return ret_code;
     }
-
-    /*Wait until all the device is powered up */
-    while((W25N01GW_readReg(W25N01GW_STATUS_REG_ADDR))&W25N01GW_BUSY_STAT)
+    if(nrfx_timer_init(&poll_timer, &timer_config, poll_timer_handler) != NRFX_SUCCESS)
     {
-        ;
+        nrfx_spim_uninit(&spi);
+        ret_code = W25N01GW_ERROR;
+        return ret_code;
     }
+    nrfx_timer_enable(&poll_timer);
+    nrfx_timer_pause(&poll_timer);
+    flash_polling = false;
+    spi_ready = true;
+
+    /* No die select until the ID tells the chip, the commands go to the die selected on it */
+    die_count = 1;
+    chip_die = 0;
+    target_die = 0;
+
+    /*Wait until all the device is powered up */
+    flash_start_busy(W25N01GW_T_RD_US);
+    (void)W25N01GW_waitReady();
 
     W25N01GW_getManufactureAndDevId(&info);
 
     if (((info.deviceId == W25N01GW_DEVICE_ID)||(info.deviceId == W25M01GW_DEVICE_ID)) && (info.mfgId == W25N01GW_MANUFACTURER_ID))
     {
-        /*Initalise the Protection register*/
-        W25N01GW_writeReg(W25N01GW_PROTECT_REG_ADDR,0);
+        /* The W25M02GW stacks two dies, the die selected before a reset of the MCU is unknown */
+        if (info.deviceId == W25M01GW_DEVICE_ID)
+        {
+            die_count = W25N01GW_MAX_DIES;
+            chip_die = W25N01GW_MAX_DIES;
+        }
+        else
+        {
+            die_count = 1;
+            chip_die = 0;
+        }
+
+        /* Every die has its own registers */
+        for (target_die = 0; target_die < die_count; target_die++)
+        {
+            /*Initalise the Protection register*/
+            W25N01GW_writeReg(W25N01GW_PROTECT_REG_ADDR,0);
 
 
-        /*Initalise the Config register
-         * 1)Read from Config Register.
-         * 2)Set the ECC-E and BUF
-         * */
-        reg_val = W25N01GW_readReg(W25N01GW_CONFIG_REG_ADDR);
+            /*Initalise the Config register
+             * 1)Read from Config Register.
+             * 2)Set the ECC-E and BUF
+             * */
+            reg_val = W25N01GW_readReg(W25N01GW_CONFIG_REG_ADDR);
 
-        W25N01GW_writeReg(W25N01GW_CONFIG_REG_ADDR,(reg_val | W25N01GW_REG_CONF_BUF) & ~(W25N01GW_REG_CONF_ECCE));
+            W25N01GW_writeReg(W25N01GW_CONFIG_REG_ADDR,(reg_val | W25N01GW_REG_CONF_BUF) & ~(W25N01GW_REG_CONF_ECCE));
+        }
+        target_die = 0;
         W25N01GW_initStatus = W25N01GW_INITIALIZED;
         ret_code = W25N01GW_INITIALIZED;
 
@@ -158,17 +554,54 @@ W25N01GW_errorCode_t W25N01GW_Init()
     return ret_code;
 
 }
+
+uint8_t W25N01GW_isBusy(void)
+{
+    return die_busy ? 1 : 0;
+}
+
+uint8_t W25N01GW_waitReady(void)
+{
+    while (die_busy)
+    {
+        flash_sleep();
+    }
+
+    return die_status[last_die];
+}
+
+uint8_t W25N01GW_getDieCount(void)
+{
+    return die_count;
+}
+
+void W25N01GW_selectDie(uint8_t die)
+{
+    if (die < die_count)
+    {
+        target_die = die;
+    }
+}
+
+void W25N01GW_setReadyCallback(W25N01GW_readyCallback_t callback, void* context)
+{
+    /* The poll may end while the callback is replaced, it never sees a half set pair */
+    ready_callback = NULL;
+    ready_context = context;
+    ready_callback = callback;
+}
+
 uint8_t W25N01GW_readReg(W25N01GW_reg_t reg)
 {
     uint8_t cmdBuffer[W25N01GW_RD_SREG_CMD_LEN] = { 0 };
-    uint8_t recv_buff[W25N01GW_MIN_RCV_BYTES_LEN] = {0};
+    uint8_t reg_val = 0;
 
     cmdBuffer[0] = W25N01GW_CMD_RD_REG;
     cmdBuffer[1] = reg;
 
-    nrf_drv_spi_transfer(&spi,&cmdBuffer[0],W25N01GW_RD_SREG_CMD_LEN,&recv_buff[0],W25N01GW_MIN_RCV_BYTES_LEN);
+    flash_command(cmdBuffer, W25N01GW_RD_SREG_CMD_LEN, NULL, 0, &reg_val, 1);
 
-    return recv_buff[W25N01GW_MIN_RCV_BYTES_LEN-1];
+    return reg_val;
 
 }
 
@@ -181,17 +614,13 @@ void W25N01GW_writeReg(W25N01GW_reg_t reg,uint8_t reg_value)
     cmdBuffer[1] = reg;
     cmdBuffer[2] = reg_value;
 
-    nrf_drv_spi_transfer(&spi,&cmdBuffer[0],3,NULL,0);
+    flash_command(cmdBuffer, 3, NULL, 0, NULL, 0);
 
 }
 
 W25N01GW_errorCode_t W25N01GW_eraseBlock(uint32_t pos,uint32_t len)
 {
-    uint8_t cmdBuffer[4] = { 0 };
-
     W25N01GW_errorCode_t res = W25N01GW_ERROR;
-    uint16_t pageNum = 0;
-    uint8_t reg_value = 0;
     pos = pos-1;
 
     if (pos%W25N01GW_BLOCK_SIZE != 0 || len%W25N01GW_BLOCK_SIZE != 0) {
@@ -200,29 +629,10 @@ W25N01GW_errorCode_t W25N01GW_eraseBlock(uint32_t pos,uint32_t len)
       }
     while(len>0)
     {
-        pageNum = pos/W25N01GW_PAGE_SIZE;
-
-        /* Enable write */
-        cmdBuffer[0] = W25N01GW_CMD_WR_ENABLE;
-
-        nrf_drv_spi_transfer(&spi,&cmdBuffer[0],1,NULL,0);
-
-
-        /*Block Erase*/
-        cmdBuffer[0] = W25N01GW_CMD_128KB_BLCK_ERASE;
-        cmdBuffer[1] = 0; // Dummy Cycle
-        cmdBuffer[2] = ((pageNum >> 8) & 0xff);     //Page Address
-        cmdBuffer[3] = (pageNum & 0xff);        //Page Address
-
-        nrf_drv_spi_transfer(&spi,&cmdBuffer[0],4,NULL,0);
+        (void)W25N01GW_startEraseBlock(pos/W25N01GW_BLOCK_SIZE);
 
         /*Wait until all the requested blocks are erase*/
-        while((reg_value=W25N01GW_readReg(W25N01GW_STATUS_REG_ADDR))&W25N01GW_BUSY_STAT)
-        {
-            ;
-        }
-
-        if((reg_value&W25N01GW_PFAIL_STAT)||(reg_value&W25N01GW_EFAIL_STAT))
+        if(W25N01GW_eraseResult() != W25N01GW_ERASE_SUCCESS)
         {
             return W25N01GW_ERASE_FAILURE;
         }
@@ -237,56 +647,125 @@ W25N01GW_errorCode_t W25N01GW_eraseBlock(uint32_t pos,uint32_t len)
 
 }
 
+W25N01GW_errorCode_t W25N01GW_startEraseBlock(uint16_t blockNum)
+{
+    uint8_t cmdBuffer[4] = { 0 };
+    uint16_t pageNum = page_select((uint32_t)blockNum * W25N01GW_NO_OF_PAGES);
+
+    erase_die = target_die;
+
+    /* Enable write */
+    cmdBuffer[0] = W25N01GW_CMD_WR_ENABLE;
+
+    flash_command(cmdBuffer, 1, NULL, 0, NULL, 0);
+
+    /*Block Erase*/
+    cmdBuffer[0] = W25N01GW_CMD_128KB_BLCK_ERASE;
+    cmdBuffer[1] = 0; // Dummy Cycle
+    cmdBuffer[2] = ((pageNum >> 8) & 0xff);     //Page Address
+    cmdBuffer[3] = (pageNum & 0xff);        //Page Address
+
+    flash_command(cmdBuffer, 4, NULL, 0, NULL, 0);
+    flash_start_busy(W25N01GW_T_BERS_US);
+
+    return W25N01GW_ERASE_SUCCESS;
+}
+
+W25N01GW_errorCode_t W25N01GW_eraseResult(void)
+{
+    uint8_t reg_value = die_wait(erase_die);
+
+    if((reg_value&W25N01GW_PFAIL_STAT)||(reg_value&W25N01GW_EFAIL_STAT))
+    {
+        return W25N01GW_ERASE_FAILURE;
+    }
+
+    return W25N01GW_ERASE_SUCCESS;
+}
+
 
-W25N01GW_errorCode_t W25N01GW_pageRead(uint16_t pageNum)
+W25N01GW_errorCode_t W25N01GW_startPageRead(uint32_t page)
 {
-    uint8_t dummy_byte=0;
     uint8_t cmdBuffer[4] = { 0 };
+    uint16_t pageNum = page_select(page);
 
     cmdBuffer[0] = W25N01GW_CMD_PAGE_DATA_RD;
-    cmdBuffer[1] = dummy_byte;
+    cmdBuffer[1] = 0;//Dummy byte
     cmdBuffer[2] = ((pageNum >> 8) & 0xff);     //Page Address
     cmdBuffer[3] = (pageNum & 0xff);        //Page Address
 
-    nrf_drv_spi_transfer(&spi,&cmdBuffer[0],4,NULL,0);
+    flash_command(cmdBuffer, 4, NULL, 0, NULL, 0);
+    flash_start_busy(W25N01GW_T_RD_US);
 
-    /*Wait until Ready*/
-    while(W25N01GW_readReg(W25N01GW_STATUS_REG_ADDR)&W25N01GW_BUSY_STAT)
+    return W25N01GW_READ_SUCCESS;
+}
+
+W25N01GW_errorCode_t W25N01GW_pageRead(uint32_t pageNum)
+{
+    if(flash_page_read(pageNum)&(W25N01GW_ECC0_STAT|W25N01GW_ECC1_STAT))
     {
-        ;
+        return W25N01GW_ECC_FAILURE;
     }
     return W25N01GW_READ_SUCCESS;
 }
 
-W25N01GW_errorCode_t W25N01GW_read_spare(uint8_t* dataPtr,int8_t noOfbytesToRead,uint16_t pageNum,uint16_t pageOff)
+W25N01GW_errorCode_t W25N01GW_readBuffer(uint8_t* dataPtr, uint16_t noOfbytesToRead, uint16_t pageOff)
 {
     uint8_t cmdBuffer[4] = { 0 };
 
-    uint8_t dummy_byte=0,reg_val = 0;
+    if(dataPtr==NULL)
+    {
+        return W25N01GW_ERR_BUFFER_INVALID;
+    }
+    if(noOfbytesToRead==0)
+    {
+        return W25N01GW_ERR_BYTE_LEN_INVALID;
+    }
+    if((uint32_t)pageOff+noOfbytesToRead > W25N01GW_PAGE_SIZE+W25N01GW_SPARE_SIZE)
+    {
+        return W25N01GW_ERR_LOCATION_INVALID;
+    }
+
+    cmdBuffer[0] = W25N01GW_CMD_RD_DATA;
+    cmdBuffer[1] = ((pageOff >> 8) & 0xff);
+    cmdBuffer[2] = (pageOff & 0xff);
+    cmdBuffer[3] = 0;//Dummy byte
+
+    /* The status of the page read that filled the buffer, also one started by W25N01GW_startPageRead */
+    if(die_wait(target_die)&(W25N01GW_ECC0_STAT|W25N01GW_ECC1_STAT))
+    {
+        return W25N01GW_ECC_FAILURE;
+    }
+    flash_command(cmdBuffer, 4, NULL, 0, dataPtr, noOfbytesToRead);
+
+    return W25N01GW_READ_SUCCESS;
+}
+
+W25N01GW_errorCode_t W25N01GW_read_spare(uint8_t* dataPtr,int8_t noOfbytesToRead,uint32_t pageNum,uint16_t pageOff)
+{
+    uint8_t cmdBuffer[4] = { 0 };
 
-    uint8_t rcv_buff[256] = {0};
+    uint8_t dummy_byte=0,reg_val = 0;
 
     if(dataPtr==NULL)
     {
         return W25N01GW_ERR_BUFFER_INVALID;
     }
-    if(noOfbytesToRead==0)
+    if(noOfbytesToRead<=0)
     {
         return W25N01GW_ERR_BYTE_LEN_INVALID;
     }
     /*Page read*/
-    W25N01GW_pageRead(pageNum);
+    reg_val = flash_page_read(pageNum);
     /* Read to the data buffer*/
     cmdBuffer[0] = W25N01GW_CMD_RD_DATA;
     cmdBuffer[3] = dummy_byte;
     cmdBuffer[1] = ((pageOff >> 8) & 0xff);
     cmdBuffer[2] = (pageOff & 0xff);
 
-    nrf_drv_spi_transfer(&spi,&cmdBuffer[0],4,rcv_buff,noOfbytesToRead+4);
+    flash_command(cmdBuffer, 4, NULL, 0, dataPtr, noOfbytesToRead);
 
-    memcpy(dataPtr,&rcv_buff[4],noOfbytesToRead);
-    reg_val = W25N01GW_readReg(W25N01GW_STATUS_REG_ADDR);
-    if((reg_val&W25N01GW_ECC0_STAT)||(reg_val&W25N01GW_ECC0_STAT))
+    if(reg_val&(W25N01GW_ECC0_STAT|W25N01GW_ECC1_STAT))
     {
         return W25N01GW_ECC_FAILURE;
     }
@@ -297,13 +776,11 @@ W25N01GW_errorCode_t W25N01GW_read_spare(uint8_t* dataPtr,int8_t noOfbytesToRead
 W25N01GW_errorCode_t W25N01GW_read(uint8_t* dataPtr, uint32_t noOfbytesToRead, uint32_t readLoc)
 {
     uint8_t cmdBuffer[4] = { 0 };
-    uint16_t pageNum=0,pageOff=0;
+    uint32_t pageNum=0;
+    uint16_t pageOff=0;
     uint16_t rd_len_page = 0;
-    uint8_t rd_len = 0;
     uint8_t dummy_byte=0,reg_val = 0;
 
-    uint8_t rcv_buff[256] = {0};
-
     if(dataPtr==NULL)
     {
         return W25N01GW_ERR_BUFFER_INVALID;
@@ -312,7 +789,7 @@ W25N01GW_errorCode_t W25N01GW_read(uint8_t* dataPtr, uint32_t noOfbytesToRead, u
     {
         return W25N01GW_ERR_BYTE_LEN_INVALID;
     }
-    if(readLoc>W25N01GW_FLASH_SIZE)
+    if(readLoc>W25N01GW_FLASH_SIZE*die_count)
     {
         return W25N01GW_ERR_LOCATION_INVALID;
     }
@@ -323,33 +800,24 @@ W25N01GW_errorCode_t W25N01GW_read(uint8_t* dataPtr, uint32_t noOfbytesToRead, u
         pageNum = readLoc/(W25N01GW_PAGE_SIZE);
         pageOff = readLoc%(W25N01GW_PAGE_SIZE);
 
-        rd_len_page = MIN(noOfbytesToRead, W25N01GW_PAGE_SIZE-pageOff+1);
+        rd_len_page = MIN(noOfbytesToRead, (uint32_t)(W25N01GW_PAGE_SIZE-pageOff));
 
         /*Page read*/
-        W25N01GW_pageRead(pageNum);
+        reg_val |= flash_page_read(pageNum);
 
-        /* Read to the data buffer*/
+        /* Read the rest of the page in one transfer, straight into the caller's buffer */
         cmdBuffer[0] = W25N01GW_CMD_RD_DATA;
+        cmdBuffer[1] = ((pageOff >> 8) & 0xff);
+        cmdBuffer[2] = (pageOff & 0xff);
         cmdBuffer[3] = dummy_byte;
 
-        while(rd_len_page>0)
-        {
-            dataPtr += rd_len;
-            cmdBuffer[1] = ((pageOff >> 8) & 0xff);
-            cmdBuffer[2] = (pageOff & 0xff);
-            rd_len = MIN(rd_len_page,251);//Since every read cycle has four dummy bytes added in front.
-            //Driver supports maximum reading of 256 bytes. Hence update the page Offset and read 256 bytes in a cycle.
-            nrf_drv_spi_transfer(&spi,&cmdBuffer[0],4,rcv_buff,rd_len+4);
-            memcpy(dataPtr,&rcv_buff[4],rd_len);
-            rd_len_page -= rd_len;
-            pageOff += rd_len;
-            noOfbytesToRead -=rd_len;
-            readLoc += rd_len;
-        }
+        flash_command(cmdBuffer, 4, NULL, 0, dataPtr, rd_len_page);
 
+        dataPtr += rd_len_page;
+        noOfbytesToRead -= rd_len_page;
+        readLoc += rd_len_page;
     }
-    reg_val = W25N01GW_readReg(W25N01GW_STATUS_REG_ADDR);
-    if((reg_val&W25N01GW_ECC0_STAT)||(reg_val&W25N01GW_ECC0_STAT))
+    if(reg_val&(W25N01GW_ECC0_STAT|W25N01GW_ECC1_STAT))
     {
         return W25N01GW_ECC_FAILURE;
     }
@@ -357,12 +825,9 @@ W25N01GW_errorCode_t W25N01GW_read(uint8_t* dataPtr, uint32_t noOfbytesToRead, u
     return W25N01GW_READ_SUCCESS;
 }
 
-W25N01GW_errorCode_t W25N01GW_write_spare(const uint8_t* dataPtr,uint8_t noOfbytesToWrite,uint16_t pageNum,uint16_t pageOff)
+W25N01GW_errorCode_t W25N01GW_write_spare(const uint8_t* dataPtr,uint8_t noOfbytesToWrite,uint32_t pageNum,uint16_t pageOff)
 {
     uint8_t cmdBuffer[4] = { 0 };
-    uint8_t dummy_byte = 0;
-    uint8_t tx_buf[3+128] = {0};
-    uint8_t reg_value=0;
 
     if(dataPtr==NULL)
     {
@@ -372,39 +837,21 @@ W25N01GW_errorCode_t W25N01GW_write_spare(const uint8_t* dataPtr,uint8_t noOfbyt
     {
         return W25N01GW_ERR_BYTE_LEN_INVALID;
     }
+    (void)page_select(pageNum);
 
     /* Enable write */
     cmdBuffer[0] = W25N01GW_CMD_WR_ENABLE;
 
-    nrf_drv_spi_transfer(&spi,&cmdBuffer[0],1,NULL,0);
+    flash_command(cmdBuffer, 1, NULL, 0, NULL, 0);
 
 
     /*Load the program into Databuffer*/
-      tx_buf[0] = W25N01GW_CMD_RANDM_PRGM_DATA;
-      tx_buf[1] = (pageOff) >> 8;
-      tx_buf[2] = (pageOff) & 0xff;
-      memcpy(tx_buf + 3, dataPtr, noOfbytesToWrite);
-      nrf_drv_spi_transfer(&spi,&tx_buf[0],3 + noOfbytesToWrite,NULL,0);
-
-       /*Execute the program*/
-        cmdBuffer[0] = W25N01GW_CMD_PRGM_EXEC;
-        cmdBuffer[1] = dummy_byte;//Dummy byte
-        cmdBuffer[2] = ((pageNum >> 8) & 0xff);
-        cmdBuffer[3] = (pageNum & 0xff);
-
-        nrf_drv_spi_transfer(&spi,&cmdBuffer[0],4,NULL,0);
-
-        /*Wait until data is written to the flash*/
-        while((reg_value=W25N01GW_readReg(W25N01GW_STATUS_REG_ADDR))&W25N01GW_BUSY_STAT)
-        {
-            ;
-        }
-        if(reg_value&W25N01GW_PFAIL_STAT)
-        {
-            return W25N01GW_WRITE_FAILURE;
-        }
+    cmdBuffer[0] = W25N01GW_CMD_RANDM_PRGM_DATA;
+    cmdBuffer[1] = (pageOff) >> 8;
+    cmdBuffer[2] = (pageOff) & 0xff;
+    flash_command(cmdBuffer, 3, dataPtr, noOfbytesToWrite, NULL, 0);
 
-    return W25N01GW_WRITE_SUCCESS;
+    return W25N01GW_programExecute(pageNum);
 
 }
 
@@ -413,18 +860,11 @@ W25N01GW_errorCode_t W25N01GW_write_spare(const uint8_t* dataPtr,uint8_t noOfbyt
 W25N01GW_errorCode_t W25N01GW_write(const uint8_t* dataPtr, uint32_t noOfbytesToWrite, uint32_t writeLoc)
 {
     uint8_t cmdBuffer[4] = { 0 };
-    uint16_t pageNum=0,pageOff=0;
+    uint32_t pageNum=0;
+    uint16_t pageOff=0;
     uint16_t wr_len_page = 0;
-    uint8_t dummy_byte = 0;
-    uint8_t tx_buf[3+128] = {0};
-    uint8_t reg_value=0;
-    uint16_t txn_off,txn_len = 0;
-
+    W25N01GW_errorCode_t res;
 
-    if(writeLoc==1)
-    {
-        reg_value=0;
-    }
     if(dataPtr==NULL)
     {
         return W25N01GW_ERR_BUFFER_INVALID;
@@ -433,7 +873,7 @@ W25N01GW_errorCode_t W25N01GW_write(const uint8_t* dataPtr, uint32_t noOfbytesTo
     {
         return W25N01GW_ERR_BYTE_LEN_INVALID;
     }
-    if(writeLoc>W25N01GW_FLASH_SIZE)
+    if(writeLoc>W25N01GW_FLASH_SIZE*die_count)
     {
         return W25N01GW_ERR_LOCATION_INVALID;
     }
@@ -442,57 +882,100 @@ W25N01GW_errorCode_t W25N01GW_write(const uint8_t* dataPtr, uint32_t noOfbytesTo
         pageNum = writeLoc/W25N01GW_PAGE_SIZE;
         pageOff = writeLoc%W25N01GW_PAGE_SIZE;
 
-        wr_len_page = MIN(noOfbytesToWrite, W25N01GW_PAGE_SIZE+1 - pageOff);
+        wr_len_page = MIN(noOfbytesToWrite, (uint32_t)(W25N01GW_PAGE_SIZE - pageOff));
+        (void)page_select(pageNum);
 
         if(wr_len_page!=W25N01GW_PAGE_SIZE)
         {
             /*If ECC is enabled */
-            W25N01GW_pageRead(pageNum);
-            tx_buf[0] = W25N01GW_CMD_RANDM_PRGM_DATA;
+            (void)flash_page_read(pageNum);
+
+            /* Enable write, the random load keeps the rest of the page in the buffer */
+            cmdBuffer[0] = W25N01GW_CMD_WR_ENABLE;
+            flash_command(cmdBuffer, 1, NULL, 0, NULL, 0);
         }
-        else
+
+        res = W25N01GW_loadProgramData(dataPtr, wr_len_page, pageOff, wr_len_page==W25N01GW_PAGE_SIZE);
+        if(res == W25N01GW_WRITE_SUCCESS)
+        {
+            res = W25N01GW_programExecute(pageNum);
+        }
+        if(res != W25N01GW_WRITE_SUCCESS)
         {
-            tx_buf[0] = W25N01GW_CMD_LD_PRGM_DATA;
+            return res;
         }
-        /* Enable write */
+
+        dataPtr += wr_len_page;
+        writeLoc += wr_len_page;
+        noOfbytesToWrite -= wr_len_page;
+    }
+
+    return W25N01GW_WRITE_SUCCESS;
+}
+
+W25N01GW_errorCode_t W25N01GW_loadProgramData(const uint8_t* dataPtr, uint16_t noOfbytesToLoad, uint16_t pageOff, uint8_t resetBuffer)
+{
+    uint8_t cmdBuffer[3] = { 0 };
+
+    if(dataPtr==NULL)
+    {
+        return W25N01GW_ERR_BUFFER_INVALID;
+    }
+    if(noOfbytesToLoad==0)
+    {
+        return W25N01GW_ERR_BYTE_LEN_INVALID;
+    }
+    if((uint32_t)pageOff+noOfbytesToLoad > W25N01GW_PAGE_SIZE+W25N01GW_SPARE_SIZE)
+    {
+        return W25N01GW_ERR_LOCATION_INVALID;
+    }
+
+    if(resetBuffer)
+    {
+        /* Enable write, WEL stays set until the program execute */
         cmdBuffer[0] = W25N01GW_CMD_WR_ENABLE;
+        flash_command(cmdBuffer, 1, NULL, 0, NULL, 0);
 
-                nrf_drv_spi_transfer(&spi,&cmdBuffer[0],1,NULL,0);
+        /*The first load sets the rest of the buffer to 0xFF*/
+        cmdBuffer[0] = W25N01GW_CMD_LD_PRGM_DATA;
+    }
+    else
+    {
+        cmdBuffer[0] = W25N01GW_CMD_RANDM_PRGM_DATA;
+    }
+    cmdBuffer[1] = pageOff >> 8;
+    cmdBuffer[2] = pageOff & 0xff;
 
+    /* The whole load in one transfer from the caller's buffer */
+    flash_command(cmdBuffer, 3, dataPtr, noOfbytesToLoad, NULL, 0);
 
+    return W25N01GW_WRITE_SUCCESS;
+}
 
-        /*Load the program into Databuffer*/
-           for (txn_off = 0, txn_len = 0; txn_off < wr_len_page;txn_off += txn_len)
-           {
-              txn_len = MIN(128, wr_len_page - txn_off);
-              tx_buf[1] = (pageOff + txn_off) >> 8;
-              tx_buf[2] = (pageOff + txn_off) & 0xff;
-              memcpy(tx_buf + 3, dataPtr, txn_len);
-              nrf_drv_spi_transfer(&spi,&tx_buf[0],3 + txn_len,NULL,0);
-              tx_buf[0] = W25N01GW_CMD_RANDM_PRGM_DATA;
-              dataPtr += txn_len;
-            }
+W25N01GW_errorCode_t W25N01GW_startProgramExecute(uint32_t page)
+{
+    uint8_t cmdBuffer[4] = { 0 };
+    uint16_t pageNum = page_select(page);
 
-           /*Execute the program*/
-            cmdBuffer[0] = W25N01GW_CMD_PRGM_EXEC;
-            cmdBuffer[1] = dummy_byte;//Dummy byte
-            cmdBuffer[2] = ((pageNum >> 8) & 0xff);
-            cmdBuffer[3] = (pageNum & 0xff);
+    cmdBuffer[0] = W25N01GW_CMD_PRGM_EXEC;
+    cmdBuffer[1] = 0;//Dummy byte
+    cmdBuffer[2] = ((pageNum >> 8) & 0xff);
+    cmdBuffer[3] = (pageNum & 0xff);
 
-            nrf_drv_spi_transfer(&spi,&cmdBuffer[0],4,NULL,0);
+    flash_command(cmdBuffer, 4, NULL, 0, NULL, 0);
+    flash_start_busy(W25N01GW_T_PROG_US);
 
-            /*Wait until data is written to the flash*/
-            while((reg_value=W25N01GW_readReg(W25N01GW_STATUS_REG_ADDR))&W25N01GW_BUSY_STAT)
-            {
-                ;
-            }
-            if(reg_value&W25N01GW_PFAIL_STAT)
-            {
-                return W25N01GW_WRITE_FAILURE;
-            }
+    return W25N01GW_WRITE_SUCCESS;
+}
 
-           writeLoc += wr_len_page;
-           noOfbytesToWrite -= wr_len_page;
+W25N01GW_errorCode_t W25N01GW_programExecute(uint32_t pageNum)
+{
+    (void)W25N01GW_startProgramExecute(pageNum);
+
+    /*Wait until data is written to the flash*/
+    if(die_wait(target_die)&W25N01GW_PFAIL_STAT)
+    {
+        return W25N01GW_WRITE_FAILURE;
     }
 
     return W25N01GW_WRITE_SUCCESS;
@@ -502,16 +985,16 @@ void W25N01GW_getManufactureAndDevId(W25N01GW_deviceInfo_t* info)
 {
     uint8_t cmdBuffer[2] = { 0 };
     uint8_t dummy_byte = 0;
-    uint8_t recv_buff[5];
-    /*TOBE REMOVED*/
+    uint8_t recv_buff[3];
+
     cmdBuffer[0] = W25N01GW_CMD_JDEC_ID;
     cmdBuffer[1] = dummy_byte;
 
-    memset(recv_buff,0,5);
-    nrf_drv_spi_transfer(&spi,&cmdBuffer[0],W25N01GW_RD_SREG_CMD_LEN,&recv_buff[0],5);
+    memset(recv_buff,0,3);
+    flash_command(cmdBuffer, W25N01GW_RD_SREG_CMD_LEN, NULL, 0, recv_buff, 3);
 
-    info->mfgId = recv_buff[2];
-    info->deviceId = recv_buff[3] << 8 | recv_buff[4];
+    info->mfgId = recv_buff[0];
+    info->deviceId = recv_buff[1] << 8 | recv_buff[2];
 
 }
 
@@ -526,8 +1009,8 @@ void  W25N01GW_getMemoryParams(W25N01GW_memoryParams_t* flashMemoryParams)
 
     /* Get the memorySize from the macro defined for the flash module */
         flashMemoryParams->eraseBlockUnits = 1;
-        flashMemoryParams->memorySize = W25N01GW_FLASH_SIZE;
-        flashMemoryParams->noOfSectors = W25N01GW_TOTAL_SECTORS;
+        flashMemoryParams->memorySize = W25N01GW_FLASH_SIZE * die_count;
+        flashMemoryParams->noOfSectors = W25N01GW_TOTAL_SECTORS * die_count;
         flashMemoryParams->sectorSize = W25N01GW_SECTOR_SIZE;
 
 }
@@ -38,8 +38,28 @@ mtp_operation_t flogfs_glue_op = {
 mtp_file_object_t file_obj[MTP_MAX_NUM_OF_FILES];
 
 int num_of_files = 0;
-uint64_t free_space = STORAGE_CAPACITY;
-bool pending_delete = false;
+uint64_t free_space;
+
+/*!
+ *
+ * @brief       : Size of the flash used by FlogFS, a W25M02GW has two dies
+ *
+ * @param[in]   : None
+ *
+ * @return      : Capacity in bytes
+ */
+static uint64_t flogfs_glue_capacity()
+{
+    uint32_t blocks = (uint32_t)W25N01GW_NO_OF_BLOCKS * W25N01GW_getDieCount();
+
+    if (blocks > FS_NUM_BLOCKS)
+    {
+        blocks = FS_NUM_BLOCKS;
+    }
+
+    return (uint64_t)blocks * FS_PAGES_PER_BLOCK * FS_SECTORS_PER_PAGE * FS_SECTOR_SIZE;
+}
+
 /*!
  *
  * @brief       : Handler to create default files after format
@@ -83,12 +103,13 @@ int32_t flogfs_glue_init()
 {
 
     flog_initialize_params_t params = {
-        .number_of_blocks = 1024,
+        .number_of_blocks = FS_NUM_BLOCKS,
         .pages_per_block = 64,
     };
     flogfs_initialize(&params);
 
     flogfs_mount();
+    free_space = flogfs_glue_capacity();
 
     return 0;
 }
@@ -104,11 +125,11 @@ int32_t flogfs_glue_format()
 {
     int error_code;
     flog_initialize_params_t params = {
-        .number_of_blocks = 1024,
+        .number_of_blocks = FS_NUM_BLOCKS,
         .pages_per_block = 64,
     };
     flogfs_initialize(&params);
-    for (uint16_t i = 0; i < 1024; i++)
+    for (uint16_t i = 0; i < (W25N01GW_NO_OF_BLOCKS * W25N01GW_getDieCount()); i++)
     {
         W25N01GW_eraseBlock((i * W25N01GW_BLOCK_SIZE) + 1, W25N01GW_BLOCK_SIZE);
     }
@@ -133,7 +154,7 @@ int32_t flogfs_glue_format()
  */
 int32_t flogfs_glue_get_storage_info(mtp_storage_info_t * storage_info)
 {
-    storage_info->capacity = STORAGE_CAPACITY;
+    storage_info->capacity = flogfs_glue_capacity();
     storage_info->free_space =  flogfs_available_space();
     return 0;
 }
@@ -152,14 +173,10 @@ int32_t flogfs_glue_get_object_handles(uint32_t *handles, uint32_t *len)
     flogfs_ls_iterator_t iter;
     flogfs_start_ls(&iter);
 
-    /*Populate file names,size and handle in file object*/
-    while (flogfs_ls_iterate(&iter, file_obj[num_of_files].name))
+    /*Populate file names,size and handle in file object, the sizes come without opening the files*/
+    while (flogfs_ls_iterate_size(&iter, file_obj[num_of_files].name, &file_obj[num_of_files].size))
     {
         file_obj[num_of_files].handle = num_of_files + 1;
-        flog_read_file_t read_file;
-        flogfs_open_read(&read_file, file_obj[num_of_files].name);
-        file_obj[num_of_files].size = flogfs_read_file_size(&read_file);
-        flogfs_close_read(&read_file);
         num_of_files++;
     }
 
@@ -194,14 +211,33 @@ int32_t flogfs_glue_get_object_info_by_handle(uint32_t handle, mtp_file_object_t
 int32_t flogfs_glue_file_read(uint32_t handle, uint32_t offset, uint8_t *buff, uint32_t len)
 {
     static flog_read_file_t read_file;
+    static uint32_t read_handle;
 
-    if(offset == 0)  flogfs_open_read(&read_file,file_obj[handle-1].name);
+    if(offset >= file_obj[handle-1].size)
+    {
+        if(read_handle == handle)
+        {
+            flogfs_close_read(&read_file);
+            read_handle = 0;
+        }
+        return 0;
+    }
 
-    if(offset < file_obj[handle-1].size)  return flogfs_read(&read_file,buff,len);
+    if(read_handle != handle)
+    {
+        if(read_handle != 0)  flogfs_close_read(&read_file);
+        read_handle = 0;
+        if(flogfs_open_read(&read_file,file_obj[handle-1].name) != FLOG_SUCCESS)  return 0;
+        read_handle = handle;
+    }
 
-    if(offset == file_obj[handle-1].size)  flogfs_close_read(&read_file);
+    /* Partial object reads may start anywhere, the seek follows the block index of the file */
+    if(flogfs_read_tell(&read_file) != offset)
+    {
+        if(flogfs_read_seek(&read_file,offset) != FLOG_SUCCESS)  return 0;
+    }
 
-    return 0;
+    return flogfs_read(&read_file,buff,len);
 }
 /*!
  *
@@ -213,16 +249,9 @@ int32_t flogfs_glue_file_read(uint32_t handle, uint32_t offset, uint8_t *buff, u
  */
 int32_t flogfs_glue_file_delete(uint32_t handle)
 {
-    if (pending_delete == false)
-    {
-        if (flogfs_invalidate(file_obj[handle - 1].name) == FLOG_SUCCESS)
-        {
-            pending_delete = true;
-            return 0;
-        }
-        else
-            return -1;
-    }
+    /* The blocks are erased by the garbage collection in the MTP loop */
+    if (flogfs_invalidate(file_obj[handle - 1].name) == FLOG_SUCCESS)
+        return 0;
     else
         return -1;
 }
@@ -275,20 +304,16 @@ int32_t flogfs_glue_deinit()
 
 /*!
  *
- * @brief       : Handler to delete invalidated file block
+ * @brief       : Handler to erase the blocks of deleted files, a few at a time
  *
  * @param[in]   : None
  *
- * @return      : 0
+ * @return      : 0 while blocks are left to erase, else -1
  */
 int32_t flogfs_glue_delete_invalid_file_block(void)
 {
-    if (pending_delete == true)
-    {
-        flog_delete_invalidated_block();
-        pending_delete = false;
+    if (flogfs_gc(FLOGFS_GLUE_GC_BUDGET_US) != 0)
         return 0;
-    }
     else
         return -1;
 }
@@ -27,6 +27,7 @@ int32_t flogfs_glue_file_write(uint32_t handle,uint32_t offset,uint8_t *buff,uin
 int32_t flogfs_glue_deinit();
 int32_t flogfs_glue_delete_invalid_file_block(void);
 
-#define STORAGE_CAPACITY (128*1024*1024)
+/*! Garbage collection per pass of the MTP loop: one erase, left running on the flash */
+#define FLOGFS_GLUE_GC_BUDGET_US (FS_ERASE_US)
 
 #endif /* FLOGSFS_H_ */
@@ -35,6 +35,8 @@
 #include "coines.h"
 #include "coines_defs.h"
 #include "comm_intf.h"
+#include "comm_trace.h"
+#include "usb_capture.h"
 #if defined (ZEUS_QUIRK)
 #include "zeus.h"
 #endif
@@ -62,7 +64,6 @@ struct coines_streaming_settings
     struct coines_streaming_blocks data_blocks; /*< streaming data blocks */
 };
 
-comm_stream_info_t comm_intf_sensor_info;
 /*! variable to hold the maximum no of streaming configuration buffer*/
 struct coines_streaming_settings coines_streaming_cfg_buf[COINES_MAX_SENSOR_COUNT];
 
@@ -124,6 +125,8 @@ int16_t coines_open_comm_intf(enum coines_comm_intf intf_type)
 int16_t coines_close_comm_intf(enum coines_comm_intf intf_type)
 {
     comm_intf_close(intf_type);
+    /* Streaming configuration belongs to the closed session, start the next one with an empty table */
+    coines_sensor_id_count = 0;
     return COINES_SUCCESS;
 }
 
@@ -269,6 +272,10 @@ int16_t coines_config_spi_bus(enum coines_spi_bus bus, enum coines_spi_speed spi
 {
     int16_t rslt;
 
+    /* The board firmware has no SPI clock above 10 MHz */
+    if ((spi_speed == COINES_SPI_SPEED_32_MHZ) || (spi_speed == COINES_SPI_SPEED_16_MHZ))
+        return COINES_E_NOT_SUPPORTED;
+
     memset(coines_rsp_buf.buffer, 0, COINES_DATA_BUF_SIZE);
     comm_intf_init_command_header(COINES_DD_SET, COINES_CMDID_INTERFACE);
 
@@ -308,6 +315,10 @@ int16_t coines_config_word_spi_bus(enum coines_spi_bus bus,
 {
     int16_t rslt;
 
+    /* The board firmware has no SPI clock above 10 MHz */
+    if ((spi_speed == COINES_SPI_SPEED_32_MHZ) || (spi_speed == COINES_SPI_SPEED_16_MHZ))
+        return COINES_E_NOT_SUPPORTED;
+
     memset(coines_rsp_buf.buffer, 0, COINES_DATA_BUF_SIZE);
     comm_intf_init_command_header(COINES_DD_SET, COINES_CMDID_INTERFACE);
 
@@ -367,7 +378,13 @@ int16_t coines_config_i2c_bus(enum coines_i2c_bus bus, enum coines_i2c_mode i2c_
  */
 int8_t coines_write_i2c(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data, uint16_t count)
 {
-    return (int8_t)coines_write(COINES_SENSOR_INTF_I2C, 0, dev_addr, reg_addr, reg_data, count);
+    int8_t rslt;
+
+    COMM_TRACE_BEGIN(COMM_TRACE_API_WRITE, count);
+    rslt = (int8_t)coines_write(COINES_SENSOR_INTF_I2C, 0, dev_addr, reg_addr, reg_data, count);
+    COMM_TRACE_END(COMM_TRACE_API_WRITE, count);
+
+    return rslt;
 }
 /*********************************************************************/
 /*!
@@ -375,7 +392,13 @@ int8_t coines_write_i2c(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data, u
  */
 int8_t coines_read_i2c(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data, uint16_t count)
 {
-    return (int8_t)coines_read(COINES_SENSOR_INTF_I2C, 0, dev_addr, reg_addr, reg_data, count);
+    int8_t rslt;
+
+    COMM_TRACE_BEGIN(COMM_TRACE_API_READ, count);
+    rslt = (int8_t)coines_read(COINES_SENSOR_INTF_I2C, 0, dev_addr, reg_addr, reg_data, count);
+    COMM_TRACE_END(COMM_TRACE_API_READ, count);
+
+    return rslt;
 }
 
 /*********************************************************************/
@@ -385,7 +408,13 @@ int8_t coines_read_i2c(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data, ui
  */
 int8_t coines_write_spi(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data, uint16_t count)
 {
-    return (int8_t)coines_write(COINES_SENSOR_INTF_SPI, dev_addr, 0, reg_addr, reg_data, count);
+    int8_t rslt;
+
+    COMM_TRACE_BEGIN(COMM_TRACE_API_WRITE, count);
+    rslt = (int8_t)coines_write(COINES_SENSOR_INTF_SPI, dev_addr, 0, reg_addr, reg_data, count);
+    COMM_TRACE_END(COMM_TRACE_API_WRITE, count);
+
+    return rslt;
 }
 
 /*!
@@ -394,7 +423,13 @@ int8_t coines_write_spi(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data, u
  */
 int8_t coines_write_16bit_spi(uint8_t cs, uint16_t reg_addr, uint16_t *reg_data, uint16_t count)
 {
-    return (int8_t)coines_write_16bit(cs, reg_addr, reg_data, count);
+    int8_t rslt;
+
+    COMM_TRACE_BEGIN(COMM_TRACE_API_WRITE, count);
+    rslt = (int8_t)coines_write_16bit(cs, reg_addr, reg_data, count);
+    COMM_TRACE_END(COMM_TRACE_API_WRITE, count);
+
+    return rslt;
 }
 
 /*********************************************************************/
@@ -404,7 +439,13 @@ int8_t coines_write_16bit_spi(uint8_t cs, uint16_t reg_addr, uint16_t *reg_data,
  */
 int8_t coines_read_spi(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data, uint16_t count)
 {
-    return (int8_t)coines_read(COINES_SENSOR_INTF_SPI, dev_addr, 0, reg_addr, reg_data, count);
+    int8_t rslt;
+
+    COMM_TRACE_BEGIN(COMM_TRACE_API_READ, count);
+    rslt = (int8_t)coines_read(COINES_SENSOR_INTF_SPI, dev_addr, 0, reg_addr, reg_data, count);
+    COMM_TRACE_END(COMM_TRACE_API_READ, count);
+
+    return rslt;
 }
 
 /*!
@@ -413,7 +454,13 @@ int8_t coines_read_spi(uint8_t dev_addr, uint8_t reg_addr, uint8_t *reg_data, ui
  */
 int8_t coines_read_16bit_spi(uint8_t cs, uint16_t reg_addr, uint16_t *reg_data, uint16_t count)
 {
-    return (int8_t)coines_read_16bit(cs, reg_addr, reg_data, count);
+    int8_t rslt;
+
+    COMM_TRACE_BEGIN(COMM_TRACE_API_READ, count);
+    rslt = (int8_t)coines_read_16bit(cs, reg_addr, reg_data, count);
+    COMM_TRACE_END(COMM_TRACE_API_READ, count);
+
+    return rslt;
 }
 
 /*********************************************************************/
@@ -677,6 +724,7 @@ int16_t coines_read_stream_sensor_data(uint8_t sensor_id,
     if ((data == NULL) || (valid_samples_count == NULL))
         return COINES_E_NULL_PTR;
 
+    COMM_TRACE_BEGIN(COMM_TRACE_API_STREAM_READ, sensor_id);
     coines_rsp_buf.buffer_size = 0;
     memset(coines_rsp_buf.buffer, 0, COINES_DATA_BUF_SIZE);
     rslt = comm_intf_process_stream_response(sensor_id, number_of_samples, &coines_stream_rsp_buf);
@@ -684,7 +732,9 @@ int16_t coines_read_stream_sensor_data(uint8_t sensor_id,
     {
         *valid_samples_count = coines_stream_rsp_buf.buffer_size /
                                comm_intf_sensor_info.sensors_byte_count[sensor_id - 1];
+        COMM_TRACE_BEGIN(COMM_TRACE_COPY_OUT, coines_stream_rsp_buf.buffer_size);
         memcpy(data, coines_stream_rsp_buf.buffer, coines_stream_rsp_buf.buffer_size);
+        COMM_TRACE_END(COMM_TRACE_COPY_OUT, coines_stream_rsp_buf.buffer_size);
         DEBUG_PRINT("coines_read_stream_sensor_data SUCCESFUL! sample_count: %d  bufsize: %d\n",
                     *valid_samples_count,
                     coines_stream_rsp_buf.buffer_size);
@@ -694,6 +744,7 @@ int16_t coines_read_stream_sensor_data(uint8_t sensor_id,
         rslt = COINES_E_FAILURE;
         DEBUG_PRINT("coines_read_stream_sensor_data FAIL!\n");
     }
+    COMM_TRACE_END(COMM_TRACE_API_STREAM_READ, rslt);
 
     return rslt;
 }
@@ -808,7 +859,7 @@ static int16_t coines_read_16bit(uint8_t cs_pin, uint16_t reg_addr, uint16_t *re
         if ((pkt_len > 0) && (pkt_len <= (count * 2)))
         {
             data_pos = COINES_SPI_16BIT_READ_WRITE_DATA_START_POSITION + rsp_buf_pos;
-            index = data_bytes_filled;
+            index = data_bytes_filled / 2; /* words filled */
             for (cnt = 0; cnt < pkt_len; cnt += 2)
             {
                 /*data_pos += cnt; */
@@ -978,8 +1029,10 @@ static int16_t coines_read(enum coines_sensor_intf intf,
             if ((pkt_len > 0) && (pkt_len <= count))
             {
                 /*Copy the data and adjust the buffer position*/
+                COMM_TRACE_BEGIN(COMM_TRACE_COPY_OUT, pkt_len);
                 memcpy(&reg_data[data_bytes_filled],
                        &coines_rsp_buf.buffer[COINES_DD_READ_WRITE_DATA_START_POSITION + rsp_buf_pos], pkt_len);
+                COMM_TRACE_END(COMM_TRACE_COPY_OUT, pkt_len);
             }
             /* Packet length will be negative when there is no valid packet in the response buffer.
              * In that case, reading the ring buffer again and see if any valid packet exists.if so,
@@ -1009,8 +1062,10 @@ static int16_t coines_read(enum coines_sensor_intf intf,
                         rsp_buf_pos = 0;
 
                         /*Copy the data and adjust the buffer position*/
+                        COMM_TRACE_BEGIN(COMM_TRACE_COPY_OUT, pkt_len);
                         memcpy(&reg_data[data_bytes_filled],
                                &coines_rsp_buf.buffer[COINES_DD_READ_WRITE_DATA_START_POSITION + rsp_buf_pos], pkt_len);
+                        COMM_TRACE_END(COMM_TRACE_COPY_OUT, pkt_len);
                     }
                 }
                 else
@@ -1197,6 +1252,87 @@ static int16_t coines_write(enum coines_sensor_intf intf,
     return rslt;
 }
 
+/*********************************************************************/
+/*!
+ * @brief This API is used to configure the real-time tuning of the host communication threads.
+ */
+int16_t coines_config_realtime(const struct coines_rt_config *rt_config)
+{
+    return comm_intf_config_realtime(rt_config);
+}
+
+/*!
+ * @brief This API is used to get the real-time tuning applied by the last coines_open_comm_intf()
+ */
+int16_t coines_get_realtime_status(struct coines_rt_status *rt_status)
+{
+    return comm_intf_get_realtime_status(rt_status);
+}
+
+/*!
+ * @brief This API starts capturing the raw command/response traffic with the board to a file.
+ */
+int16_t coines_start_capture(const char *file_path)
+{
+    return comm_intf_start_capture(file_path);
+}
+
+/*!
+ * @brief This API stops the traffic capture and flushes the capture file
+ */
+int16_t coines_stop_capture(struct coines_capture_status *status)
+{
+    return comm_intf_stop_capture(status);
+}
+
+/*!
+ * @brief This API makes the next coines_open_comm_intf() play back a capture instead of using the board.
+ */
+int16_t coines_config_replay(const char *file_path, enum coines_replay_timing timing)
+{
+    return comm_intf_config_replay(file_path, timing);
+}
+
+/*!
+ * @brief This API gets the comparison between the commands sent and the played back capture
+ */
+int16_t coines_get_replay_status(struct coines_replay_status *status)
+{
+    return comm_intf_get_replay_status(status);
+}
+
+/*!
+ * @brief This API makes the next coines_open_comm_intf() talk to a simulated board instead of the board.
+ */
+int16_t coines_config_simulation(const struct coines_sim_config *config)
+{
+    return comm_intf_config_simulation(config);
+}
+
+/*!
+ * @brief This API gets the statistics of the simulated board
+ */
+int16_t coines_get_simulation_status(struct coines_sim_status *status)
+{
+    return comm_intf_get_simulation_status(status);
+}
+
+/*!
+ * @brief This API writes the hot path trace as Chrome trace_event JSON
+ */
+int16_t coines_export_trace(const char *file_path)
+{
+    return comm_trace_export_chrome(file_path);
+}
+
+/*!
+ * @brief This API discards the hot path trace recorded so far
+ */
+int16_t coines_reset_trace(void)
+{
+    return comm_trace_reset();
+}
+
 /*!
  * @brief This API returns the number of milliseconds passed since the program started
  *
@@ -1207,4 +1343,20 @@ uint32_t coines_get_millis()
     return (uint32_t)clock();
 }
 
+/*!
+ * @brief This API returns the number of microseconds passed since the program started
+ *
+ * @return Time in microseconds
+ */
+uint64_t coines_get_micros(void)
+{
+    static uint64_t start_ns = 0;
+    uint64_t now_ns = usb_capture_timestamp_ns();
+
+    if (start_ns == 0)
+        start_ns = now_ns;
+
+    return (now_ns - start_ns) / 1000;
+}
+
 /** @}*/
@@ -0,0 +1,511 @@
+/**
+ * Copyright (C) 2018 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    usb_capture.c
+ * @brief   This file captures the byte stream between the host and the board to a binary file.
+ *          Records are copied into an in-memory buffer by the USB threads and written to the
+ *          file by a separate writer thread, so file I/O never delays a transfer.
+ *
+ */
+
+/*!
+ * @defgroup usb_capture_api usb_capture
+ * @{*/
+
+/*********************************************************************/
+/* system header files */
+/*********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#ifdef PLATFORM_WINDOWS
+#include <windows.h>
+#endif
+
+#ifdef PLATFORM_LINUX
+#include <pthread.h>
+#endif
+
+/*********************************************************************/
+/* own header files */
+/*********************************************************************/
+#include "usb_capture.h"
+#include "mutex_port.h"
+
+/*********************************************************************/
+/* local macro definitions */
+/*********************************************************************/
+/*! Time the writer sleeps when there is nothing to write */
+#define USB_CAPTURE_WRITER_TIMEOUT_US   UINT32_C(10000)
+
+/*********************************************************************/
+/* global variables */
+/*********************************************************************/
+/*! Non zero while a capture is running */
+volatile uint8_t usb_capture_active = 0;
+
+/*********************************************************************/
+/* static variables */
+/*********************************************************************/
+/*! Capture file */
+static FILE *usb_capture_file;
+/*! Buffer between the USB threads and the writer thread */
+static uint8_t *usb_capture_buf;
+/*! Total bytes queued, index is usb_capture_head % USB_CAPTURE_BUF_SIZE */
+static uint64_t usb_capture_head;
+/*! Total bytes written to the file */
+static uint64_t usb_capture_tail;
+/*! Records queued */
+static uint32_t usb_capture_records;
+/*! Records dropped because the writer could not keep up */
+static uint32_t usb_capture_dropped;
+/*! Writer thread exit request */
+static uint8_t usb_capture_stop_req;
+/*! Set if writing to the file failed */
+static uint8_t usb_capture_io_error;
+/*! Protects the buffer indices */
+static mutex_t usb_capture_mutex;
+/*! Wakes up the writer thread */
+static cond_t usb_capture_cond;
+/*! Mutex and condition are created once and kept, a late usb_capture_record() may still lock them */
+static uint8_t usb_capture_sync_ready = 0;
+
+#ifdef PLATFORM_WINDOWS
+static HANDLE usb_capture_thread;
+#endif
+#ifdef PLATFORM_LINUX
+static pthread_t usb_capture_thread;
+#endif
+
+/*********************************************************************/
+/* static function declarations */
+/*********************************************************************/
+#ifdef PLATFORM_WINDOWS
+static DWORD WINAPI usb_capture_writer(void *arg);
+#endif
+#ifdef PLATFORM_LINUX
+static void *usb_capture_writer(void *arg);
+#endif
+
+static uint64_t usb_capture_wall_time_ns(void);
+static void usb_capture_put_le(uint8_t *dst, uint64_t value, uint8_t size);
+static uint64_t usb_capture_get_le(const uint8_t *src, uint8_t size);
+static void usb_capture_copy_in(uint64_t pos, const uint8_t *src, uint32_t length);
+
+/*********************************************************************/
+/* functions */
+/*********************************************************************/
+
+/*!
+ * @brief This API returns a monotonic host timestamp
+ */
+uint64_t usb_capture_timestamp_ns(void)
+{
+#ifdef PLATFORM_LINUX
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+#endif
+#ifdef PLATFORM_WINDOWS
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((counter.QuadPart / frequency.QuadPart) * 1000000000ULL) +
+           (uint64_t)(((counter.QuadPart % frequency.QuadPart) * 1000000000ULL) / frequency.QuadPart);
+#endif
+}
+
+/*!
+ * @brief This API starts capturing the USB traffic to a file
+ */
+int16_t usb_capture_start(const char *file_path)
+{
+    uint8_t header[USB_CAPTURE_FILE_HEADER_SIZE] = { 0 };
+
+    if (file_path == NULL)
+        return COINES_E_NULL_PTR;
+
+    if (usb_capture_active)
+        return COINES_E_FAILURE;
+
+    usb_capture_buf = (uint8_t *)malloc(USB_CAPTURE_BUF_SIZE);
+    if (usb_capture_buf == NULL)
+        return COINES_E_MEMORY_ALLOCATION;
+
+    usb_capture_file = fopen(file_path, "wb");
+    if (usb_capture_file == NULL)
+    {
+        free(usb_capture_buf);
+        usb_capture_buf = NULL;
+        return COINES_E_FAILURE;
+    }
+
+    memcpy(header, USB_CAPTURE_MAGIC, 8);
+    usb_capture_put_le(&header[8], USB_CAPTURE_VERSION, 2);
+    usb_capture_put_le(&header[10], USB_CAPTURE_RECORD_HEADER_SIZE, 2);
+    usb_capture_put_le(&header[16], usb_capture_wall_time_ns(), 8);
+    fwrite(header, 1, sizeof(header), usb_capture_file);
+
+    usb_capture_head = 0;
+    usb_capture_tail = 0;
+    usb_capture_records = 0;
+    usb_capture_dropped = 0;
+    usb_capture_stop_req = 0;
+    usb_capture_io_error = 0;
+    if (!usb_capture_sync_ready)
+    {
+        mutex_init(&usb_capture_mutex);
+        cond_init(&usb_capture_cond);
+        usb_capture_sync_ready = 1;
+    }
+
+#ifdef PLATFORM_LINUX
+    if (pthread_create(&usb_capture_thread, NULL, usb_capture_writer, NULL) != 0)
+#endif
+#ifdef PLATFORM_WINDOWS
+    usb_capture_thread = CreateThread(NULL, 0, usb_capture_writer, NULL, 0, NULL);
+    if (usb_capture_thread == NULL)
+#endif
+    {
+        fclose(usb_capture_file);
+        free(usb_capture_buf);
+        usb_capture_buf = NULL;
+        return COINES_E_FAILURE;
+    }
+
+    usb_capture_active = 1;
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This API stops the capture and flushes all pending records to the file
+ */
+int16_t usb_capture_stop(struct coines_capture_status *status)
+{
+    if (!usb_capture_active)
+        return COINES_E_FAILURE;
+
+    usb_capture_active = 0;
+
+    mutex_lock(&usb_capture_mutex);
+    usb_capture_stop_req = 1;
+    cond_signal(&usb_capture_cond);
+    mutex_unlock(&usb_capture_mutex);
+
+#ifdef PLATFORM_LINUX
+    pthread_join(usb_capture_thread, NULL);
+#endif
+#ifdef PLATFORM_WINDOWS
+    WaitForSingleObject(usb_capture_thread, INFINITE);
+    CloseHandle(usb_capture_thread);
+#endif
+
+    if (fclose(usb_capture_file) != 0)
+        usb_capture_io_error = 1;
+
+    free(usb_capture_buf);
+    usb_capture_buf = NULL;
+
+    if (status != NULL)
+    {
+        status->records = usb_capture_records;
+        status->dropped_records = usb_capture_dropped;
+        status->bytes = usb_capture_tail + USB_CAPTURE_FILE_HEADER_SIZE;
+    }
+
+    return usb_capture_io_error ? COINES_E_FAILURE : COINES_SUCCESS;
+}
+
+/*!
+ * @brief This API queues one record for the capture writer
+ */
+void usb_capture_record(uint8_t direction, const uint8_t *buffer, uint32_t length)
+{
+    uint8_t header[USB_CAPTURE_RECORD_HEADER_SIZE] = { 0 };
+    uint64_t timestamp = usb_capture_timestamp_ns();
+
+    if (length > COINES_DATA_BUF_SIZE)
+        length = COINES_DATA_BUF_SIZE;
+
+    usb_capture_put_le(&header[0], timestamp, 8);
+    usb_capture_put_le(&header[8], length, 2);
+    header[10] = direction;
+
+    mutex_lock(&usb_capture_mutex);
+    if (!usb_capture_active)
+    {
+        mutex_unlock(&usb_capture_mutex);
+        return;
+    }
+
+    if ((USB_CAPTURE_BUF_SIZE - (usb_capture_head - usb_capture_tail)) < (USB_CAPTURE_RECORD_HEADER_SIZE + length))
+    {
+        usb_capture_dropped++;
+    }
+    else
+    {
+        usb_capture_copy_in(usb_capture_head, header, USB_CAPTURE_RECORD_HEADER_SIZE);
+        usb_capture_copy_in(usb_capture_head + USB_CAPTURE_RECORD_HEADER_SIZE, buffer, length);
+        usb_capture_head += USB_CAPTURE_RECORD_HEADER_SIZE + length;
+        usb_capture_records++;
+        cond_signal(&usb_capture_cond);
+    }
+    mutex_unlock(&usb_capture_mutex);
+}
+
+/*!
+ * @brief This function writes the queued records to the capture file until a stop is requested.
+ *
+ * @param[in] arg : unused
+ *
+ * @return None
+ */
+#ifdef PLATFORM_WINDOWS
+static DWORD WINAPI usb_capture_writer(void *arg)
+#endif
+#ifdef PLATFORM_LINUX
+static void *usb_capture_writer(void *arg)
+#endif
+{
+    uint64_t head, tail;
+    uint32_t offset, chunk;
+    uint8_t stop;
+
+    (void)arg;
+
+    for (;;)
+    {
+        mutex_lock(&usb_capture_mutex);
+        if ((usb_capture_head == usb_capture_tail) && !usb_capture_stop_req)
+            cond_wait_timeout(&usb_capture_cond, &usb_capture_mutex, USB_CAPTURE_WRITER_TIMEOUT_US);
+        head = usb_capture_head;
+        tail = usb_capture_tail;
+        stop = usb_capture_stop_req;
+        mutex_unlock(&usb_capture_mutex);
+
+        /* Only this thread moves the tail, so the data in [tail, head) can be written unlocked */
+        while (tail != head)
+        {
+            offset = (uint32_t)(tail % USB_CAPTURE_BUF_SIZE);
+            chunk = USB_CAPTURE_BUF_SIZE - offset;
+            if (chunk > (head - tail))
+                chunk = (uint32_t)(head - tail);
+
+            if (fwrite(&usb_capture_buf[offset], 1, chunk, usb_capture_file) != chunk)
+                usb_capture_io_error = 1;
+            tail += chunk;
+        }
+
+        mutex_lock(&usb_capture_mutex);
+        usb_capture_tail = tail;
+        mutex_unlock(&usb_capture_mutex);
+
+        if (stop && (tail == usb_capture_head))
+            break;
+    }
+
+    fflush(usb_capture_file);
+
+#ifdef PLATFORM_WINDOWS
+    return COINES_SUCCESS;
+#endif
+#ifdef PLATFORM_LINUX
+    return NULL;
+#endif
+}
+
+/*!
+ * @brief This API loads a capture file in memory
+ */
+int16_t usb_capture_load(const char *file_path, usb_capture_file_t *capture)
+{
+    FILE *file;
+    long file_size;
+    uint32_t pos, idx, length;
+
+    if ((file_path == NULL) || (capture == NULL))
+        return COINES_E_NULL_PTR;
+
+    memset(capture, 0, sizeof(usb_capture_file_t));
+
+    file = fopen(file_path, "rb");
+    if (file == NULL)
+        return COINES_E_FAILURE;
+
+    fseek(file, 0, SEEK_END);
+    file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (file_size < (long)USB_CAPTURE_FILE_HEADER_SIZE)
+    {
+        fclose(file);
+        return COINES_E_FAILURE;
+    }
+
+    capture->data = (uint8_t *)malloc((size_t)file_size);
+    if (capture->data == NULL)
+    {
+        fclose(file);
+        return COINES_E_MEMORY_ALLOCATION;
+    }
+
+    if (fread(capture->data, 1, (size_t)file_size, file) != (size_t)file_size)
+    {
+        fclose(file);
+        usb_capture_unload(capture);
+        return COINES_E_FAILURE;
+    }
+    fclose(file);
+
+    if ((memcmp(capture->data, USB_CAPTURE_MAGIC, 8) != 0) ||
+        (usb_capture_get_le(&capture->data[8], 2) != USB_CAPTURE_VERSION))
+    {
+        usb_capture_unload(capture);
+        return COINES_E_NOT_SUPPORTED;
+    }
+    capture->start_time_ns = usb_capture_get_le(&capture->data[16], 8);
+
+    /* First pass counts the records, second pass indexes them */
+    for (idx = 0; idx < 2; idx++)
+    {
+        pos = USB_CAPTURE_FILE_HEADER_SIZE;
+        capture->record_count = 0;
+        while ((pos + USB_CAPTURE_RECORD_HEADER_SIZE) <= (uint32_t)file_size)
+        {
+            length = (uint32_t)usb_capture_get_le(&capture->data[pos + 8], 2);
+            if ((pos + USB_CAPTURE_RECORD_HEADER_SIZE + length) > (uint32_t)file_size)
+                break; /* truncated last record */
+
+            if (capture->records != NULL)
+            {
+                capture->records[capture->record_count].timestamp_ns = usb_capture_get_le(&capture->data[pos], 8);
+                capture->records[capture->record_count].length = (uint16_t)length;
+                capture->records[capture->record_count].direction = capture->data[pos + 10];
+                capture->records[capture->record_count].payload = &capture->data[pos + USB_CAPTURE_RECORD_HEADER_SIZE];
+            }
+            capture->record_count++;
+            pos += USB_CAPTURE_RECORD_HEADER_SIZE + length;
+        }
+
+        if ((idx == 0) && (capture->record_count > 0))
+        {
+            capture->records = (usb_capture_record_t *)malloc(capture->record_count * sizeof(usb_capture_record_t));
+            if (capture->records == NULL)
+            {
+                usb_capture_unload(capture);
+                return COINES_E_MEMORY_ALLOCATION;
+            }
+        }
+    }
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This API releases a capture file loaded with usb_capture_load()
+ */
+void usb_capture_unload(usb_capture_file_t *capture)
+{
+    if (capture != NULL)
+    {
+        free(capture->records);
+        free(capture->data);
+        memset(capture, 0, sizeof(usb_capture_file_t));
+    }
+}
+
+/*!
+ * @brief This function returns the wall clock time
+ *
+ * @return Time in nanoseconds since the Unix epoch
+ */
+static uint64_t usb_capture_wall_time_ns(void)
+{
+#ifdef PLATFORM_LINUX
+    struct timespec now;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+#endif
+#ifdef PLATFORM_WINDOWS
+    FILETIME now;
+    uint64_t ticks;
+
+    /* 100 ns ticks since 1601-01-01 */
+    GetSystemTimeAsFileTime(&now);
+    ticks = ((uint64_t)now.dwHighDateTime << 32) | now.dwLowDateTime;
+    return (ticks - 116444736000000000ULL) * 100;
+#endif
+}
+
+/*!
+ * @brief This function stores a value in little endian byte order
+ *
+ * @param[out] dst : destination
+ * @param[in] value : value to store
+ * @param[in] size : number of bytes
+ *
+ * @return None
+ */
+static void usb_capture_put_le(uint8_t *dst, uint64_t value, uint8_t size)
+{
+    uint8_t idx;
+
+    for (idx = 0; idx < size; idx++)
+    {
+        dst[idx] = (uint8_t)(value >> (8 * idx));
+    }
+}
+
+/*!
+ * @brief This function reads a value stored in little endian byte order
+ *
+ * @param[in] src : source
+ * @param[in] size : number of bytes
+ *
+ * @return value read
+ */
+static uint64_t usb_capture_get_le(const uint8_t *src, uint8_t size)
+{
+    uint64_t value = 0;
+    uint8_t idx;
+
+    for (idx = 0; idx < size; idx++)
+    {
+        value |= (uint64_t)src[idx] << (8 * idx);
+    }
+
+    return value;
+}
+
+/*!
+ * @brief This function copies data into the capture buffer, wrapping around at the end
+ *
+ * @param[in] pos : absolute byte position in the stream
+ * @param[in] src : data
+ * @param[in] length : data length
+ *
+ * @return None
+ */
+static void usb_capture_copy_in(uint64_t pos, const uint8_t *src, uint32_t length)
+{
+    uint32_t offset = (uint32_t)(pos % USB_CAPTURE_BUF_SIZE);
+    uint32_t chunk = USB_CAPTURE_BUF_SIZE - offset;
+
+    if (chunk > length)
+        chunk = length;
+
+    memcpy(&usb_capture_buf[offset], src, chunk);
+    memcpy(usb_capture_buf, src + chunk, length - chunk);
+}
+
+/** @}*/
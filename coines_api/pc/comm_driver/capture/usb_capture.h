@@ -0,0 +1,161 @@
+/**
+ * Copyright (C) 2018 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    usb_capture.h
+ * @brief   This file contains the USB traffic capture file format and capture/read API declarations
+ *
+ */
+
+/*!
+ * @addtogroup usb_capture_api
+ * @{*/
+
+#ifndef COMM_DRIVER_USB_CAPTURE_H_
+#define COMM_DRIVER_USB_CAPTURE_H_
+
+/**********************************************************************************/
+/* header includes */
+/**********************************************************************************/
+#include <stdint.h>
+#include "coines_defs.h"
+
+/**********************************************************************************/
+/* macro definitions */
+/**********************************************************************************/
+
+/*!
+ * @brief Capture file layout (all fields little endian)
+ *
+ * File header (24 bytes)
+ *   0  : "COINESCP" magic
+ *   8  : uint16 format version
+ *   10 : uint16 record header size
+ *   12 : uint32 reserved
+ *   16 : uint64 wall clock time of capture start in ns since the Unix epoch
+ *
+ * Record (12 bytes header + payload)
+ *   0  : uint64 monotonic host timestamp in ns
+ *   8  : uint16 payload length
+ *   10 : uint8  direction (USB_CAPTURE_DIR_OUT/USB_CAPTURE_DIR_IN)
+ *   11 : uint8  reserved
+ *   12 : payload
+ */
+#define USB_CAPTURE_MAGIC                   "COINESCP"
+/*! Capture file format version */
+#define USB_CAPTURE_VERSION                 UINT16_C(1)
+/*! Size of the file header */
+#define USB_CAPTURE_FILE_HEADER_SIZE        UINT32_C(24)
+/*! Size of the record header */
+#define USB_CAPTURE_RECORD_HEADER_SIZE      UINT32_C(12)
+
+/*! Record direction - command sent by the host */
+#define USB_CAPTURE_DIR_OUT                 UINT8_C(0)
+/*! Record direction - response received from the board */
+#define USB_CAPTURE_DIR_IN                  UINT8_C(1)
+
+/*! Size of the in-memory buffer between the USB threads and the capture writer */
+#define USB_CAPTURE_BUF_SIZE                UINT32_C(4194304)
+
+/**********************************************************************************/
+/* data structure declarations */
+/**********************************************************************************/
+
+/*!
+ * @brief One record of a capture file loaded in memory
+ */
+typedef struct
+{
+    uint64_t timestamp_ns; /**< Monotonic host timestamp */
+    const uint8_t *payload; /**< Record payload */
+    uint16_t length; /**< Payload length */
+    uint8_t direction; /**< USB_CAPTURE_DIR_OUT or USB_CAPTURE_DIR_IN */
+} usb_capture_record_t;
+
+/*!
+ * @brief Capture file loaded in memory
+ */
+typedef struct
+{
+    uint8_t *data; /**< File contents */
+    usb_capture_record_t *records; /**< Parsed records */
+    uint32_t record_count; /**< Number of records */
+    uint64_t start_time_ns; /**< Wall clock time of capture start */
+} usb_capture_file_t;
+
+/**********************************************************************************/
+/* global variables */
+/**********************************************************************************/
+
+/*! Non zero while a capture is running, checked before calling usb_capture_record() */
+extern volatile uint8_t usb_capture_active;
+
+/**********************************************************************************/
+/* function declarations */
+/**********************************************************************************/
+
+/*!
+ *  @brief This API starts capturing the USB traffic to a file
+ *
+ *  @param[in] file_path : capture file, overwritten if it exists
+ *
+ *  @return Result of API execution status
+ *  @retval 0 -> Success
+ *  @retval Any non zero value -> Fail
+ */
+int16_t usb_capture_start(const char *file_path);
+
+/*!
+ *  @brief This API stops the capture and flushes all pending records to the file
+ *
+ *  @param[out] status : capture statistics, can be NULL
+ *
+ *  @return Result of API execution status
+ *  @retval 0 -> Success
+ *  @retval Any non zero value -> Fail
+ */
+int16_t usb_capture_stop(struct coines_capture_status *status);
+
+/*!
+ *  @brief This API queues one record for the capture writer. Never blocks on file I/O.
+ *
+ *  @param[in] direction : USB_CAPTURE_DIR_OUT or USB_CAPTURE_DIR_IN
+ *  @param[in] buffer    : payload
+ *  @param[in] length    : payload length
+ *
+ *  @return void
+ */
+void usb_capture_record(uint8_t direction, const uint8_t *buffer, uint32_t length);
+
+/*!
+ *  @brief This API returns a monotonic host timestamp
+ *
+ *  @return Time in nanoseconds
+ */
+uint64_t usb_capture_timestamp_ns(void);
+
+/*!
+ *  @brief This API loads a capture file in memory
+ *
+ *  @param[in] file_path : capture file
+ *  @param[out] capture  : loaded capture, release with usb_capture_unload()
+ *
+ *  @return Result of API execution status
+ *  @retval 0 -> Success
+ *  @retval Any non zero value -> Fail
+ */
+int16_t usb_capture_load(const char *file_path, usb_capture_file_t *capture);
+
+/*!
+ *  @brief This API releases a capture file loaded with usb_capture_load()
+ *
+ *  @param[in] capture : loaded capture
+ *
+ *  @return void
+ */
+void usb_capture_unload(usb_capture_file_t *capture);
+
+#endif /* COMM_DRIVER_USB_CAPTURE_H_ */
+
+/** @}*/
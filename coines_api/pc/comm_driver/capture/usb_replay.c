@@ -0,0 +1,293 @@
+/**
+ * Copyright (C) 2018 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    usb_replay.c
+ * @brief   This file plays a capture file back in place of the USB hardware.
+ *
+ * Every command sent by the host is compared with the next recorded command. The responses
+ * recorded after that command, up to the next recorded command, are then handed to the
+ * communication interface either immediately or with their recorded spacing.
+ *
+ */
+
+/*!
+ * @defgroup usb_replay_api usb_replay
+ * @{*/
+
+/*********************************************************************/
+/* system header files */
+/*********************************************************************/
+#include <stdint.h>
+#include <string.h>
+
+/*********************************************************************/
+/* own header files */
+/*********************************************************************/
+#include "usb_replay.h"
+#include "usb_capture.h"
+#include "mutex_port.h"
+
+/*********************************************************************/
+/* local macro definitions */
+/*********************************************************************/
+/*! first_mismatch value when all commands matched */
+#define USB_REPLAY_NO_MISMATCH    UINT32_MAX
+
+/*********************************************************************/
+/* static function declarations */
+/*********************************************************************/
+static int16_t usb_replay_open(void);
+static void usb_replay_close(void);
+static int16_t usb_replay_send(const uint8_t *buffer, uint32_t length);
+static int16_t usb_replay_receive(usb_rsp_buffer_t *rsp_buf, uint32_t timeout_us);
+static uint32_t usb_replay_next_command(uint32_t from);
+
+/*********************************************************************/
+/* global variables */
+/*********************************************************************/
+/*! Transport playing back a capture file */
+const usb_transport_t usb_replay_transport = {
+    .open = usb_replay_open,
+    .close = usb_replay_close,
+    .send = usb_replay_send,
+    .receive = usb_replay_receive
+};
+
+/*********************************************************************/
+/* static variables */
+/*********************************************************************/
+/*! Loaded capture */
+static usb_capture_file_t usb_replay_capture;
+/*! Pacing of the responses */
+static enum coines_replay_timing usb_replay_timing;
+/*! Next record to play */
+static uint32_t usb_replay_next;
+/*! Records before this index are released for playing */
+static uint32_t usb_replay_release_end;
+/*! Recorded timestamp matching usb_replay_anchor_host_ns */
+static uint64_t usb_replay_anchor_rec_ns;
+/*! Host time at which the released records started */
+static uint64_t usb_replay_anchor_host_ns;
+/*! Index of the sent command, counting from 0 */
+static uint32_t usb_replay_command_idx;
+/*! Comparison results */
+static struct coines_replay_status usb_replay_status;
+/*! Protects the replay state between the sending thread and the event thread */
+static mutex_t usb_replay_mutex;
+/*! Wakes up the event thread when responses are released */
+static cond_t usb_replay_cond;
+
+/*********************************************************************/
+/* functions */
+/*********************************************************************/
+
+/*!
+ * @brief This API loads the capture file to be played by usb_replay_transport
+ */
+int16_t usb_replay_load(const char *file_path, enum coines_replay_timing timing)
+{
+    int16_t rslt = COINES_SUCCESS;
+
+    usb_capture_unload(&usb_replay_capture);
+
+    if (file_path != NULL)
+    {
+        rslt = usb_capture_load(file_path, &usb_replay_capture);
+        if (rslt == COINES_SUCCESS)
+        {
+            usb_replay_timing = timing;
+        }
+    }
+
+    return rslt;
+}
+
+/*!
+ * @brief This API gets the result of the comparison between sent and recorded commands
+ */
+int16_t usb_replay_get_status(struct coines_replay_status *status)
+{
+    if (status == NULL)
+        return COINES_E_NULL_PTR;
+
+    *status = usb_replay_status;
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This function starts playing the loaded capture.
+ *        Responses recorded before the first command are released right away.
+ *
+ * @return Result of API execution status
+ */
+static int16_t usb_replay_open(void)
+{
+    uint32_t idx;
+
+    if (usb_replay_capture.records == NULL)
+        return COINES_E_FAILURE;
+
+    mutex_init(&usb_replay_mutex);
+    cond_init(&usb_replay_cond);
+
+    usb_replay_next = 0;
+    usb_replay_command_idx = 0;
+    usb_replay_release_end = usb_replay_next_command(0);
+    usb_replay_anchor_rec_ns = usb_replay_capture.records[0].timestamp_ns;
+    usb_replay_anchor_host_ns = usb_capture_timestamp_ns();
+
+    memset(&usb_replay_status, 0, sizeof(usb_replay_status));
+    usb_replay_status.first_mismatch = USB_REPLAY_NO_MISMATCH;
+    for (idx = 0; idx < usb_replay_capture.record_count; idx++)
+    {
+        if (usb_replay_capture.records[idx].direction == USB_CAPTURE_DIR_OUT)
+            usb_replay_status.commands_expected++;
+    }
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This function stops playing. The capture stays loaded for the next open.
+ *
+ * @return None
+ */
+static void usb_replay_close(void)
+{
+    cond_destroy(&usb_replay_cond);
+    mutex_destroy(&usb_replay_mutex);
+}
+
+/*!
+ * @brief This function compares a host command with the next recorded command and
+ *        releases the responses recorded after it.
+ *
+ * @param[in] buffer : command
+ * @param[in] length : command length
+ *
+ * @return Result of API execution status
+ */
+static int16_t usb_replay_send(const uint8_t *buffer, uint32_t length)
+{
+    const usb_capture_record_t *rec;
+    uint32_t cmd;
+
+    mutex_lock(&usb_replay_mutex);
+
+    /* Responses of the previous command not consumed yet are skipped, Eg: stream stopped earlier than recorded */
+    cmd = usb_replay_next_command(usb_replay_next);
+    for (; usb_replay_next < cmd; usb_replay_next++)
+    {
+        if (usb_replay_capture.records[usb_replay_next].direction == USB_CAPTURE_DIR_IN)
+            usb_replay_status.responses_skipped++;
+    }
+
+    if (cmd >= usb_replay_capture.record_count)
+    {
+        /* More commands than recorded */
+        usb_replay_status.commands_unexpected++;
+        if (usb_replay_status.first_mismatch == USB_REPLAY_NO_MISMATCH)
+            usb_replay_status.first_mismatch = usb_replay_command_idx;
+    }
+    else
+    {
+        rec = &usb_replay_capture.records[cmd];
+        if ((rec->length == length) && (memcmp(rec->payload, buffer, length) == 0))
+        {
+            usb_replay_status.commands_matched++;
+        }
+        else
+        {
+            usb_replay_status.commands_mismatched++;
+            if (usb_replay_status.first_mismatch == USB_REPLAY_NO_MISMATCH)
+                usb_replay_status.first_mismatch = usb_replay_command_idx;
+        }
+
+        usb_replay_next = cmd + 1;
+        usb_replay_release_end = usb_replay_next_command(usb_replay_next);
+        usb_replay_anchor_rec_ns = rec->timestamp_ns;
+        usb_replay_anchor_host_ns = usb_capture_timestamp_ns();
+        cond_signal(&usb_replay_cond);
+    }
+
+    usb_replay_command_idx++;
+
+    mutex_unlock(&usb_replay_mutex);
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This function hands the next released response to the event thread
+ *
+ * @param[out] rsp_buf : response buffer
+ * @param[in] timeout_us : maximum wait time
+ *
+ * @return COINES_SUCCESS if a response was copied to rsp_buf
+ */
+static int16_t usb_replay_receive(usb_rsp_buffer_t *rsp_buf, uint32_t timeout_us)
+{
+    const usb_capture_record_t *rec;
+    uint64_t due_ns, now_ns;
+    int16_t rslt = COINES_E_FAILURE;
+
+    mutex_lock(&usb_replay_mutex);
+
+    if (usb_replay_next >= usb_replay_release_end)
+    {
+        cond_wait_timeout(&usb_replay_cond, &usb_replay_mutex, timeout_us);
+    }
+
+    if (usb_replay_next < usb_replay_release_end)
+    {
+        rec = &usb_replay_capture.records[usb_replay_next];
+
+        if (usb_replay_timing == COINES_REPLAY_RECORDED_TIMING)
+        {
+            due_ns = usb_replay_anchor_host_ns + (rec->timestamp_ns - usb_replay_anchor_rec_ns);
+            now_ns = usb_capture_timestamp_ns();
+            if (due_ns > now_ns)
+            {
+                if ((due_ns - now_ns) / 1000 < timeout_us)
+                    timeout_us = (uint32_t)((due_ns - now_ns) / 1000);
+                cond_wait_timeout(&usb_replay_cond, &usb_replay_mutex, timeout_us);
+                mutex_unlock(&usb_replay_mutex);
+                return COINES_E_FAILURE;
+            }
+        }
+
+        memcpy(rsp_buf->buffer, rec->payload, rec->length);
+        memset(rsp_buf->buffer + rec->length, 0, COINES_DATA_BUF_SIZE - rec->length);
+        rsp_buf->buffer_size = rec->length;
+        usb_replay_next++;
+        usb_replay_status.responses_played++;
+        rslt = COINES_SUCCESS;
+    }
+
+    mutex_unlock(&usb_replay_mutex);
+
+    return rslt;
+}
+
+/*!
+ * @brief This function finds the next recorded command
+ *
+ * @param[in] from : first record to look at
+ *
+ * @return Index of the command record, record count if there is none
+ */
+static uint32_t usb_replay_next_command(uint32_t from)
+{
+    while ((from < usb_replay_capture.record_count) &&
+           (usb_replay_capture.records[from].direction != USB_CAPTURE_DIR_OUT))
+    {
+        from++;
+    }
+
+    return from;
+}
+
+/** @}*/
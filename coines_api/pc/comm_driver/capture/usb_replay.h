@@ -0,0 +1,61 @@
+/**
+ * Copyright (C) 2018 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    usb_replay.h
+ * @brief   This file contains the declarations of the capture replay transport
+ *
+ */
+
+/*!
+ * @addtogroup usb_replay_api
+ * @{*/
+
+#ifndef COMM_DRIVER_USB_REPLAY_H_
+#define COMM_DRIVER_USB_REPLAY_H_
+
+/**********************************************************************************/
+/* header includes */
+/**********************************************************************************/
+#include <stdint.h>
+#include "coines_defs.h"
+#include "usb.h"
+
+/**********************************************************************************/
+/* global variables */
+/**********************************************************************************/
+
+/*! Transport playing back a capture file, see usb_set_transport() */
+extern const usb_transport_t usb_replay_transport;
+
+/**********************************************************************************/
+/* function declarations */
+/**********************************************************************************/
+
+/*!
+ *  @brief This API loads the capture file to be played by usb_replay_transport
+ *
+ *  @param[in] file_path : capture file, NULL to release the loaded capture
+ *  @param[in] timing    : pacing of the recorded responses
+ *
+ *  @return Result of API execution status
+ *  @retval 0 -> Success
+ *  @retval Any non zero value -> Fail
+ */
+int16_t usb_replay_load(const char *file_path, enum coines_replay_timing timing);
+
+/*!
+ *  @brief This API gets the result of the comparison between sent and recorded commands
+ *
+ *  @param[out] status : replay statistics
+ *
+ *  @return Result of API execution status
+ *  @retval 0 -> Success
+ *  @retval Any non zero value -> Fail
+ */
+int16_t usb_replay_get_status(struct coines_replay_status *status);
+
+#endif /* COMM_DRIVER_USB_REPLAY_H_ */
+
+/** @}*/
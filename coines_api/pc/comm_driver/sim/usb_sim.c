@@ -0,0 +1,1089 @@
+/**
+ * Copyright (C) 2018 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    usb_sim.c
+ * @brief   This file simulates an Application Board in place of the USB hardware.
+ *
+ * Every command is decoded as the DD protocol firmware would and answered with the same
+ * 64 byte response packets, carried in transfers of up to COINES_DATA_BUF_SIZE bytes.
+ * Sensor accesses are forwarded to a register model. Polling and interrupt streaming
+ * packets are generated when their sample is due on the simulated clock, which can run
+ * faster than the host clock. Samples the host does not fetch in time are dropped once
+ * USB_SIM_STREAM_BACKLOG samples are pending, like a board FIFO overrun.
+ *
+ * Interrupt stream samples are laid out as
+ *   4 bytes big endian sample counter, data blocks, 6 bytes big endian timestamp in us (if enabled)
+ *
+ */
+
+/*!
+ * @defgroup usb_sim_api usb_sim
+ * @{*/
+
+/*********************************************************************/
+/* system header files */
+/*********************************************************************/
+#include <stdint.h>
+#include <string.h>
+
+/*********************************************************************/
+/* own header files */
+/*********************************************************************/
+#include "usb_sim.h"
+#include "usb_sim_regmap.h"
+#include "usb_capture.h"
+#include "mutex_port.h"
+
+/*********************************************************************/
+/* local macro definitions */
+/*********************************************************************/
+/*! Response packets waiting for the host */
+#define USB_SIM_QUEUE_PACKETS           UINT32_C(4096)
+/*! Response packets per transfer */
+#define USB_SIM_PACKETS_PER_TRANSFER    (COINES_DATA_BUF_SIZE / COINES_PACKET_SIZE)
+/*! Stream samples per channel pending before samples are dropped */
+#define USB_SIM_STREAM_BACKLOG          UINT64_C(1024)
+/*! Shuttle pins tracked by the pin configuration */
+#define USB_SIM_PIN_COUNT               64
+/*! Maximum data blocks of a stream configuration */
+#define USB_SIM_STREAM_MAX_BLOCKS       10
+/*! Data rate used when the configuration leaves it at 0 */
+#define USB_SIM_DEFAULT_DATA_READY_HZ   UINT32_C(100)
+
+/*! Response packet header, before the payload */
+#define USB_SIM_RSP_HEADER_SIZE         6
+/*! Response packet overhead, header and "\r\n" */
+#define USB_SIM_RSP_OVERHEAD            (USB_SIM_RSP_HEADER_SIZE + 2)
+/*! Read data bytes per response packet, header 11 bytes and "\r\n" */
+#define USB_SIM_READ_CHUNK              (COINES_PACKET_SIZE - 13)
+/*! 16 bit SPI read data bytes per response packet, header 12 bytes and "\r\n" */
+#define USB_SIM_READ16_CHUNK            (COINES_PACKET_SIZE - 14)
+/*! Polling stream packet overhead, header 5 bytes, sensor id mask 2 bytes and "\r\n" */
+#define USB_SIM_POLLING_OVERHEAD        9
+/*! Interrupt stream packet overhead, header 6 bytes and "\r\n" */
+#define USB_SIM_INT_OVERHEAD            8
+
+/*! Status byte of a successful response */
+#define USB_SIM_STATUS_OK               UINT8_C(0)
+/*! Status byte of a failed response */
+#define USB_SIM_STATUS_ERROR            UINT8_C(1)
+
+/*! Stream channel modes */
+#define USB_SIM_STREAM_NONE             UINT8_C(0)
+#define USB_SIM_STREAM_POLLING          UINT8_C(1)
+#define USB_SIM_STREAM_INT              UINT8_C(2)
+
+/*! Big endian 16 bit field of a command */
+#define USB_SIM_U16(buf, pos)           ((uint16_t)(((buf)[(pos)] << 8) | (buf)[(pos) + 1]))
+
+/*********************************************************************/
+/* local data structure declarations */
+/*********************************************************************/
+
+/*!
+ * @brief Streaming configuration of one channel
+ */
+typedef struct
+{
+    uint8_t mode; /*< USB_SIM_STREAM_* */
+    uint8_t active; /*< Sample packets are generated */
+    uint8_t intf_sel; /*< DD interface selector */
+    uint8_t timestamp; /*< Interrupt samples carry a timestamp */
+    uint16_t dev_addr; /*< I2C address */
+    uint8_t block_count; /*< Number of data blocks */
+    uint8_t block_reg[USB_SIM_STREAM_MAX_BLOCKS]; /*< First register of each block */
+    uint16_t block_len[USB_SIM_STREAM_MAX_BLOCKS]; /*< Bytes of each block */
+    uint16_t data_len; /*< Bytes of all blocks */
+    uint64_t period_ns; /*< Sample period in simulated time */
+    uint64_t next_due_ns; /*< Simulated time of the next sample */
+    uint32_t counter; /*< Interrupt sample counter */
+} usb_sim_stream_t;
+
+/*********************************************************************/
+/* static function declarations */
+/*********************************************************************/
+static int16_t usb_sim_open(void);
+static void usb_sim_close(void);
+static int16_t usb_sim_send(const uint8_t *buffer, uint32_t length);
+static int16_t usb_sim_receive(usb_rsp_buffer_t *rsp_buf, uint32_t timeout_us);
+static uint64_t usb_sim_time_ns(uint64_t host_ns);
+static uint64_t usb_sim_host_ns(uint64_t sim_ns);
+static uint8_t *usb_sim_queue_packet(uint64_t due_ns);
+static void usb_sim_respond(uint8_t cmd, uint8_t feature, uint8_t status, const uint8_t *payload, uint8_t length);
+static uint8_t usb_sim_access(uint8_t intf_sel,
+                              uint8_t expected_sel,
+                              uint16_t dev_addr,
+                              uint16_t reg_addr,
+                              uint8_t *data,
+                              uint16_t count,
+                              uint8_t write,
+                              uint64_t sim_ns);
+static void usb_sim_sensor_cmd(const uint8_t *cmd, uint64_t sim_ns);
+static void usb_sim_sensor16_cmd(const uint8_t *cmd, uint64_t sim_ns);
+static void usb_sim_pin_cmd(const uint8_t *cmd);
+static void usb_sim_timer_cmd(const uint8_t *cmd, uint64_t sim_ns);
+static void usb_sim_feature_cmd(const uint8_t *cmd, uint64_t sim_ns);
+static void usb_sim_stream_config_cmd(const uint8_t *cmd, uint8_t mode);
+static void usb_sim_stream_start_stop_cmd(const uint8_t *cmd, uint8_t mode, uint64_t sim_ns);
+static uint8_t usb_sim_stream_packet(uint8_t channel, uint8_t *pkt);
+static usb_sim_stream_t *usb_sim_next_stream(uint8_t *channel);
+static uint8_t usb_sim_cs_select(uint8_t cs_pin);
+static uint64_t usb_sim_timer_value_us(uint64_t sim_ns);
+
+/*********************************************************************/
+/* global variables */
+/*********************************************************************/
+/*! Transport answering the DD protocol in-process */
+const usb_transport_t usb_sim_transport = {
+    .open = usb_sim_open,
+    .close = usb_sim_close,
+    .send = usb_sim_send,
+    .receive = usb_sim_receive
+};
+
+/*********************************************************************/
+/* static variables */
+/*********************************************************************/
+/*! Simulated board and sensor */
+static struct coines_sim_config usb_sim_cfg;
+/*! Initial content of the built-in sensor registers */
+static uint8_t usb_sim_reg_init[COINES_SIM_REG_COUNT];
+/*! Built-in sensor */
+static usb_sim_regmap_t usb_sim_regmap;
+/*! Sensor accessed by the commands */
+static struct coines_sim_sensor_model usb_sim_model;
+/*! Statistics */
+static struct coines_sim_status usb_sim_status;
+/*! Protects the board state between the sending thread and the event thread */
+static mutex_t usb_sim_mutex;
+/*! Wakes up the event thread when responses are queued */
+static cond_t usb_sim_cond;
+
+/*! Response packets waiting for the host */
+static uint8_t usb_sim_queue[USB_SIM_QUEUE_PACKETS][COINES_PACKET_SIZE];
+/*! Host time at which each queued packet is delivered */
+static uint64_t usb_sim_queue_due_ns[USB_SIM_QUEUE_PACKETS];
+/*! Oldest queued packet */
+static uint32_t usb_sim_queue_head;
+/*! Number of queued packets */
+static uint32_t usb_sim_queue_count;
+/*! Delivery time of the responses to the command being processed */
+static uint64_t usb_sim_rsp_due_ns;
+/*! Burst data of the command being processed */
+static uint8_t usb_sim_data[UINT16_MAX + 1];
+
+/*! Host time the board was opened at, origin of the simulated time */
+static uint64_t usb_sim_open_ns;
+/*! Shuttle supply in mV */
+static uint16_t usb_sim_vdd_mv;
+static uint16_t usb_sim_vddio_mv;
+/*! Shuttle pin configuration */
+static uint8_t usb_sim_pin_dir[USB_SIM_PIN_COUNT];
+static uint8_t usb_sim_pin_val[USB_SIM_PIN_COUNT];
+/*! Timer running since usb_sim_timer_start_ns in simulated time */
+static uint8_t usb_sim_timer_running;
+static uint64_t usb_sim_timer_start_ns;
+/*! Timer value while stopped */
+static uint64_t usb_sim_timer_stopped_ns;
+/*! Streaming channels, indexed by sensor id */
+static usb_sim_stream_t usb_sim_stream[COINES_MAX_SENSOR_COUNT];
+
+/*********************************************************************/
+/* functions */
+/*********************************************************************/
+
+/*!
+ * @brief This API sets the board and sensor simulated by usb_sim_transport
+ */
+int16_t usb_sim_config(const struct coines_sim_config *config)
+{
+    if (config == NULL)
+    {
+        memset(&usb_sim_cfg, 0, sizeof(usb_sim_cfg));
+        return COINES_SUCCESS;
+    }
+
+    if ((config->model != NULL) && ((config->model->read == NULL) || (config->model->write == NULL)))
+        return COINES_E_NULL_PTR;
+
+    usb_sim_cfg = *config;
+    if (usb_sim_cfg.data_ready_hz == 0)
+        usb_sim_cfg.data_ready_hz = USB_SIM_DEFAULT_DATA_READY_HZ;
+    if (usb_sim_cfg.time_scale == 0)
+        usb_sim_cfg.time_scale = 1;
+
+    /* The caller's initial values need not outlive this call */
+    if (config->reg_init != NULL)
+        memcpy(usb_sim_reg_init, config->reg_init, COINES_SIM_REG_COUNT);
+    else
+        memset(usb_sim_reg_init, 0, COINES_SIM_REG_COUNT);
+    usb_sim_cfg.reg_init = usb_sim_reg_init;
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This API gets the statistics of the simulated board
+ */
+int16_t usb_sim_get_status(struct coines_sim_status *status)
+{
+    if (status == NULL)
+        return COINES_E_NULL_PTR;
+
+    *status = usb_sim_status;
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This function powers up the simulated board. The sensor, pins, supplies,
+ *        timer and streaming configuration start from their reset state.
+ *
+ * @return Result of API execution status
+ */
+static int16_t usb_sim_open(void)
+{
+    if (usb_sim_cfg.reg_init == NULL)
+        return COINES_E_FAILURE;
+
+    mutex_init(&usb_sim_mutex);
+    cond_init(&usb_sim_cond);
+
+    if (usb_sim_cfg.model != NULL)
+        usb_sim_model = *usb_sim_cfg.model;
+    else
+        usb_sim_regmap_init(&usb_sim_regmap, usb_sim_cfg.reg_init, &usb_sim_cfg.generator, &usb_sim_model);
+
+    memset(&usb_sim_status, 0, sizeof(usb_sim_status));
+    memset(usb_sim_pin_dir, 0, sizeof(usb_sim_pin_dir));
+    memset(usb_sim_pin_val, 0, sizeof(usb_sim_pin_val));
+    memset(usb_sim_stream, 0, sizeof(usb_sim_stream));
+    usb_sim_queue_head = 0;
+    usb_sim_queue_count = 0;
+    usb_sim_vdd_mv = 0;
+    usb_sim_vddio_mv = 0;
+    usb_sim_timer_running = 0;
+    usb_sim_timer_stopped_ns = 0;
+    usb_sim_open_ns = usb_capture_timestamp_ns();
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This function powers down the simulated board. The configuration stays for the next open.
+ *
+ * @return None
+ */
+static void usb_sim_close(void)
+{
+    cond_destroy(&usb_sim_cond);
+    mutex_destroy(&usb_sim_mutex);
+}
+
+/*!
+ * @brief This function decodes a command and queues its response packets
+ *
+ * @param[in] buffer : command
+ * @param[in] length : command length
+ *
+ * @return Result of API execution status
+ */
+static int16_t usb_sim_send(const uint8_t *buffer, uint32_t length)
+{
+    uint64_t now_ns, sim_ns;
+
+    mutex_lock(&usb_sim_mutex);
+
+    now_ns = usb_capture_timestamp_ns();
+    sim_ns = usb_sim_time_ns(now_ns);
+    usb_sim_rsp_due_ns = now_ns + (uint64_t)usb_sim_cfg.response_delay_us * 1000;
+    usb_sim_status.commands++;
+
+    if ((length < 6) || (buffer[COINES_IDENTIFIER_POSITION] != COINES_CMD_ID) ||
+        (buffer[COINES_COMMAND_LENGTH_POSITION] > length))
+    {
+        usb_sim_status.unknown_commands++;
+        usb_sim_respond(0, 0, USB_SIM_STATUS_ERROR, NULL, 0);
+    }
+    else
+    {
+        switch (buffer[COINES_COMMAND_ID_POSITION])
+        {
+            case COINES_DD_SET:
+            case COINES_DD_GET:
+                usb_sim_feature_cmd(buffer, sim_ns);
+                break;
+            case COINES_DD_GENERAL_STREAMING_SETTINGS:
+                /* The polling rate of each channel comes with its own configuration */
+                usb_sim_respond(buffer[2], buffer[3], USB_SIM_STATUS_OK, NULL, 0);
+                break;
+            case COINES_CMDIDEXT_STREAM_POLLING:
+                usb_sim_stream_config_cmd(buffer, USB_SIM_STREAM_POLLING);
+                break;
+            case COINES_CMDIDEXT_STREAM_INT:
+                usb_sim_stream_config_cmd(buffer, USB_SIM_STREAM_INT);
+                break;
+            case COINES_CMDIDEXT_STARTSTOP_STREAM_POLLING:
+                usb_sim_stream_start_stop_cmd(buffer, USB_SIM_STREAM_POLLING, sim_ns);
+                break;
+            case COINES_CMDIDEXT_STARTSTOP_STREAM_INT:
+                usb_sim_stream_start_stop_cmd(buffer, USB_SIM_STREAM_INT, sim_ns);
+                break;
+            default:
+                usb_sim_status.unknown_commands++;
+                usb_sim_respond(buffer[2], buffer[3], USB_SIM_STATUS_ERROR, NULL, 0);
+                break;
+        }
+    }
+
+    cond_signal(&usb_sim_cond);
+
+    mutex_unlock(&usb_sim_mutex);
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This function hands the due response and stream packets to the event thread
+ *
+ * @param[out] rsp_buf : response buffer
+ * @param[in] timeout_us : maximum wait time
+ *
+ * @return COINES_SUCCESS if packets were copied to rsp_buf
+ */
+static int16_t usb_sim_receive(usb_rsp_buffer_t *rsp_buf, uint32_t timeout_us)
+{
+    usb_sim_stream_t *stream;
+    uint64_t now_ns, sim_ns, wake_ns, lag;
+    uint32_t packets = 0;
+    uint8_t channel;
+
+    mutex_lock(&usb_sim_mutex);
+
+    now_ns = usb_capture_timestamp_ns();
+
+    /* Sleep until the first packet is due */
+    wake_ns = UINT64_MAX;
+    if (usb_sim_queue_count > 0)
+        wake_ns = usb_sim_queue_due_ns[usb_sim_queue_head];
+    stream = usb_sim_next_stream(&channel);
+    if ((stream != NULL) && (usb_sim_host_ns(stream->next_due_ns) < wake_ns))
+        wake_ns = usb_sim_host_ns(stream->next_due_ns);
+    if (wake_ns > now_ns)
+    {
+        if ((wake_ns - now_ns) / 1000 < timeout_us)
+            timeout_us = (uint32_t)((wake_ns - now_ns) / 1000);
+        cond_wait_timeout(&usb_sim_cond, &usb_sim_mutex, timeout_us);
+        now_ns = usb_capture_timestamp_ns();
+    }
+
+    /* Command responses first, in order */
+    while ((packets < USB_SIM_PACKETS_PER_TRANSFER) && (usb_sim_queue_count > 0) &&
+           (usb_sim_queue_due_ns[usb_sim_queue_head] <= now_ns))
+    {
+        memcpy(&rsp_buf->buffer[packets * COINES_PACKET_SIZE], usb_sim_queue[usb_sim_queue_head], COINES_PACKET_SIZE);
+        usb_sim_queue_head = (usb_sim_queue_head + 1) % USB_SIM_QUEUE_PACKETS;
+        usb_sim_queue_count--;
+        packets++;
+    }
+
+    /* Then the stream samples due by now, oldest first */
+    sim_ns = usb_sim_time_ns(now_ns);
+    for (channel = COINES_MIN_SENSOR_ID; channel <= COINES_MAX_SENSOR_ID; channel++)
+    {
+        stream = &usb_sim_stream[channel];
+        if (stream->active && (sim_ns > stream->next_due_ns))
+        {
+            lag = (sim_ns - stream->next_due_ns) / stream->period_ns;
+            if (lag > USB_SIM_STREAM_BACKLOG)
+            {
+                lag -= USB_SIM_STREAM_BACKLOG;
+                usb_sim_status.samples_dropped += (uint32_t)lag;
+                stream->next_due_ns += lag * stream->period_ns;
+                stream->counter += (uint32_t)lag;
+            }
+        }
+    }
+    while (packets < USB_SIM_PACKETS_PER_TRANSFER)
+    {
+        stream = usb_sim_next_stream(&channel);
+        if ((stream == NULL) || (stream->next_due_ns > sim_ns))
+            break;
+        if (usb_sim_stream_packet(channel, &rsp_buf->buffer[packets * COINES_PACKET_SIZE]) == USB_SIM_STATUS_OK)
+        {
+            packets++;
+            usb_sim_status.samples_streamed++;
+        }
+        stream->next_due_ns += stream->period_ns;
+    }
+
+    usb_sim_status.packets += packets;
+
+    mutex_unlock(&usb_sim_mutex);
+
+    if (packets == 0)
+        return COINES_E_FAILURE;
+
+    memset(&rsp_buf->buffer[packets * COINES_PACKET_SIZE], 0, COINES_DATA_BUF_SIZE - (packets * COINES_PACKET_SIZE));
+    rsp_buf->buffer_size = (int)(packets * COINES_PACKET_SIZE);
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This function converts host time to simulated time
+ *
+ * @param[in] host_ns : monotonic host time
+ *
+ * @return Simulated time since the board was opened
+ */
+static uint64_t usb_sim_time_ns(uint64_t host_ns)
+{
+    if (host_ns < usb_sim_open_ns)
+        return 0;
+
+    return (host_ns - usb_sim_open_ns) * usb_sim_cfg.time_scale;
+}
+
+/*!
+ * @brief This function converts simulated time to host time
+ *
+ * @param[in] sim_ns : simulated time
+ *
+ * @return Monotonic host time
+ */
+static uint64_t usb_sim_host_ns(uint64_t sim_ns)
+{
+    return usb_sim_open_ns + (sim_ns / usb_sim_cfg.time_scale);
+}
+
+/*!
+ * @brief This function appends a cleared packet to the response queue
+ *
+ * @param[in] due_ns : host time the packet is delivered at
+ *
+ * @return Packet, NULL if the queue is full
+ */
+static uint8_t *usb_sim_queue_packet(uint64_t due_ns)
+{
+    uint32_t idx;
+
+    if (usb_sim_queue_count >= USB_SIM_QUEUE_PACKETS)
+        return NULL;
+
+    idx = (usb_sim_queue_head + usb_sim_queue_count) % USB_SIM_QUEUE_PACKETS;
+    usb_sim_queue_count++;
+    usb_sim_queue_due_ns[idx] = due_ns;
+    memset(usb_sim_queue[idx], 0, COINES_PACKET_SIZE);
+
+    return usb_sim_queue[idx];
+}
+
+/*!
+ * @brief This function queues a response packet
+ *
+ * @param[in] cmd : command type being answered
+ * @param[in] feature : feature being answered
+ * @param[in] status : USB_SIM_STATUS_OK or USB_SIM_STATUS_ERROR
+ * @param[in] payload : response payload, may be NULL if length is 0
+ * @param[in] length : payload length
+ *
+ * @return void
+ */
+static void usb_sim_respond(uint8_t cmd, uint8_t feature, uint8_t status, const uint8_t *payload, uint8_t length)
+{
+    uint8_t *pkt = usb_sim_queue_packet(usb_sim_rsp_due_ns);
+
+    if (pkt == NULL)
+        return;
+
+    pkt[COINES_IDENTIFIER_POSITION] = COINES_DD_RESP_ID;
+    pkt[COINES_DD_RESPONSE_SIZE_POSITION] = length + USB_SIM_RSP_OVERHEAD;
+    pkt[COINES_COMMAND_ID_POSITION] = cmd;
+    pkt[COINES_DD_STATUS_RESPONSE_POSITION] = status;
+    pkt[COINES_DD_COMMAND_ID_RESPONSE_POSITION] = COINES_READ_RESP_ID;
+    pkt[COINES_DD_FEATURE_POSITION] = feature;
+    if (length > 0)
+        memcpy(&pkt[USB_SIM_RSP_HEADER_SIZE], payload, length);
+    pkt[USB_SIM_RSP_HEADER_SIZE + length] = '\r';
+    pkt[USB_SIM_RSP_HEADER_SIZE + length + 1] = '\n';
+}
+
+/*!
+ * @brief This function forwards a bus transfer to the sensor if it is the addressed device
+ *
+ * @param[in] intf_sel : DD interface selector of the command, 0 for I2C
+ * @param[in] expected_sel : selector of the sensor chip select
+ * @param[in] dev_addr : I2C address of the command
+ * @param[in] reg_addr : register address as seen by the sensor model
+ * @param[in,out] data : transfer data
+ * @param[in] count : number of bytes
+ * @param[in] write : 1 for a write, 0 for a read
+ * @param[in] sim_ns : simulated time of the transfer
+ *
+ * @return USB_SIM_STATUS_OK or USB_SIM_STATUS_ERROR
+ */
+static uint8_t usb_sim_access(uint8_t intf_sel,
+                              uint8_t expected_sel,
+                              uint16_t dev_addr,
+                              uint16_t reg_addr,
+                              uint8_t *data,
+                              uint16_t count,
+                              uint8_t write,
+                              uint64_t sim_ns)
+{
+    int16_t rslt;
+
+    /* An unpowered or not addressed sensor does not answer */
+    if ((usb_sim_vddio_mv == 0) ||
+        ((intf_sel == 0) && (dev_addr != usb_sim_cfg.i2c_addr)) ||
+        ((intf_sel != 0) && (intf_sel != expected_sel)))
+    {
+        usb_sim_status.sensor_errors++;
+        return USB_SIM_STATUS_ERROR;
+    }
+
+    if (usb_sim_model.update != NULL)
+    {
+        usb_sim_model.update(usb_sim_model.context,
+                             ((sim_ns / 1000) * usb_sim_cfg.data_ready_hz) / UINT64_C(1000000));
+    }
+
+    if (write)
+        rslt = usb_sim_model.write(usb_sim_model.context, reg_addr, data, count);
+    else
+        rslt = usb_sim_model.read(usb_sim_model.context, reg_addr, data, count);
+
+    if (rslt != COINES_SUCCESS)
+    {
+        usb_sim_status.sensor_errors++;
+        return USB_SIM_STATUS_ERROR;
+    }
+
+    return USB_SIM_STATUS_OK;
+}
+
+/*!
+ * @brief This function gets the DD interface selector of a chip select pin,
+ *        as encoded by the 8 bit sensor and streaming commands
+ *
+ * @param[in] cs_pin : chip select pin
+ *
+ * @return Interface selector
+ */
+static uint8_t usb_sim_cs_select(uint8_t cs_pin)
+{
+    /* APP3.0 shuttle pins are sent as they are */
+    if (cs_pin >= COINES_MINI_SHUTTLE_PIN_1_4)
+        return cs_pin;
+
+    return (cs_pin <= 8) ? (uint8_t)(cs_pin + 2) : 1;
+}
+
+/*!
+ * @brief This function executes a SENSORWRITEANDREAD command
+ *
+ * Command : [4] mode, [5] interface, [6] sensor id, [7] analog switch, [8..9] address,
+ *           [10] register, [11..12] count, [13] writes, [14] delay, [15] read response, [16..] data
+ *
+ * @param[in] cmd : command
+ * @param[in] sim_ns : simulated time of the command
+ *
+ * @return void
+ */
+static void usb_sim_sensor_cmd(const uint8_t *cmd, uint64_t sim_ns)
+{
+    uint8_t hdr[COINES_PACKET_SIZE];
+    uint8_t intf_sel = cmd[5];
+    uint16_t dev_addr = USB_SIM_U16(cmd, 8);
+    uint16_t reg_addr = cmd[10];
+    uint16_t count = USB_SIM_U16(cmd, 11);
+    uint16_t chunk, pos = 0;
+    uint8_t status;
+
+    /* SPI read/write bit is not part of the register address */
+    if (intf_sel != 0)
+        reg_addr &= 0x7F;
+
+    if (cmd[COINES_COMMAND_ID_POSITION] == COINES_DD_SET)
+    {
+        if ((count == 0) || (16 + (uint32_t)count + 2 > cmd[COINES_COMMAND_LENGTH_POSITION]))
+        {
+            usb_sim_respond(cmd[2], cmd[3], USB_SIM_STATUS_ERROR, NULL, 0);
+            return;
+        }
+        memcpy(usb_sim_data, &cmd[16], count);
+        status = usb_sim_access(intf_sel, usb_sim_cs_select(usb_sim_cfg.cs_pin), dev_addr, reg_addr,
+                                usb_sim_data, count, 1, sim_ns);
+        usb_sim_respond(cmd[2], cmd[3], status, NULL, 0);
+        return;
+    }
+
+    status = (count > 0) ? usb_sim_access(intf_sel, usb_sim_cs_select(usb_sim_cfg.cs_pin), dev_addr, reg_addr,
+                                          usb_sim_data, count, 0, sim_ns) : USB_SIM_STATUS_ERROR;
+
+    /* [6] mode, [7] interface, [8..9] bytes in this packet, [10] register, [11..] data */
+    hdr[0] = cmd[4];
+    hdr[1] = intf_sel;
+    hdr[4] = cmd[10];
+    do
+    {
+        chunk = (uint16_t)(count - pos);
+        if ((status != USB_SIM_STATUS_OK) || (chunk == 0))
+            chunk = 0;
+        else if (chunk > USB_SIM_READ_CHUNK)
+            chunk = USB_SIM_READ_CHUNK;
+        hdr[2] = (uint8_t)(chunk >> 8);
+        hdr[3] = (uint8_t)chunk;
+        memcpy(&hdr[5], &usb_sim_data[pos], chunk);
+        usb_sim_respond(cmd[2], cmd[3], status, hdr, (uint8_t)(5 + chunk));
+        pos += chunk;
+    } while ((status == USB_SIM_STATUS_OK) && (pos < count));
+}
+
+/*!
+ * @brief This function executes a 16 bit SPI command. Word w is stored big endian
+ *        at byte address 2 * w of the sensor model.
+ *
+ * Command : [4] mode, [5] interface, [6] sensor id, [7..8] register, [9..10] words,
+ *           [11] writes, [12] delay, [13] read response, [14..] data
+ *
+ * @param[in] cmd : command
+ * @param[in] sim_ns : simulated time of the command
+ *
+ * @return void
+ */
+static void usb_sim_sensor16_cmd(const uint8_t *cmd, uint64_t sim_ns)
+{
+    uint8_t hdr[COINES_PACKET_SIZE];
+    uint8_t intf_sel = cmd[5];
+    uint8_t expected_sel;
+    uint16_t reg_addr = USB_SIM_U16(cmd, 7);
+    uint32_t count = 2 * (uint32_t)USB_SIM_U16(cmd, 9);
+    uint16_t chunk, pos = 0;
+    uint8_t status;
+
+    /* The 16 bit commands only know the APP2.0 chip selects */
+    expected_sel = (usb_sim_cfg.cs_pin <= 8) ? (uint8_t)(usb_sim_cfg.cs_pin + 2) : 1;
+    if ((count == 0) || (count > UINT16_MAX))
+    {
+        usb_sim_respond(cmd[2], cmd[3], USB_SIM_STATUS_ERROR, NULL, 0);
+        return;
+    }
+
+    if (cmd[COINES_COMMAND_ID_POSITION] == COINES_DD_SET)
+    {
+        if (14 + count + 2 > cmd[COINES_COMMAND_LENGTH_POSITION])
+        {
+            usb_sim_respond(cmd[2], cmd[3], USB_SIM_STATUS_ERROR, NULL, 0);
+            return;
+        }
+        memcpy(usb_sim_data, &cmd[14], count);
+        status = usb_sim_access(intf_sel, expected_sel, 0, (uint16_t)(2 * reg_addr), usb_sim_data,
+                                (uint16_t)count, 1, sim_ns);
+        usb_sim_respond(cmd[2], cmd[3], status, NULL, 0);
+        return;
+    }
+
+    status = usb_sim_access(intf_sel, expected_sel, 0, (uint16_t)(2 * reg_addr), usb_sim_data,
+                            (uint16_t)count, 0, sim_ns);
+
+    /* [6] mode, [7] interface, [8..9] register, [10..11] bytes in this packet, [12..] data */
+    hdr[0] = cmd[4];
+    hdr[1] = intf_sel;
+    hdr[2] = cmd[7];
+    hdr[3] = cmd[8];
+    do
+    {
+        chunk = (uint16_t)(count - pos);
+        if (status != USB_SIM_STATUS_OK)
+            chunk = 0;
+        else if (chunk > USB_SIM_READ16_CHUNK)
+            chunk = USB_SIM_READ16_CHUNK;
+        hdr[4] = (uint8_t)(chunk >> 8);
+        hdr[5] = (uint8_t)chunk;
+        memcpy(&hdr[6], &usb_sim_data[pos], chunk);
+        usb_sim_respond(cmd[2], cmd[3], status, hdr, (uint8_t)(6 + chunk));
+        pos += chunk;
+    } while ((status == USB_SIM_STATUS_OK) && (pos < count));
+}
+
+/*!
+ * @brief This function executes a MULTIO_CONFIGURATION command.
+ *        APP2.0 pins are addressed by a bit mask, APP3.0 pins by COINES_MINI_SHUTTLE_PIN_ID | pin.
+ *
+ * @param[in] cmd : command
+ *
+ * @return void
+ */
+static void usb_sim_pin_cmd(const uint8_t *cmd)
+{
+    uint8_t payload[6];
+    uint16_t pins = USB_SIM_U16(cmd, 4);
+    uint16_t dir = 0, val = 0;
+    uint8_t pin;
+
+    if (cmd[COINES_COMMAND_ID_POSITION] == COINES_DD_SET)
+    {
+        if (pins & COINES_MINI_SHUTTLE_PIN_ID)
+        {
+            pin = (uint8_t)(pins & 0xFF);
+            if (pin < USB_SIM_PIN_COUNT)
+            {
+                usb_sim_pin_dir[pin] = (USB_SIM_U16(cmd, 6) != 0);
+                usb_sim_pin_val[pin] = (USB_SIM_U16(cmd, 8) != 0);
+            }
+        }
+        else
+        {
+            for (pin = 0; pin < 16; pin++)
+            {
+                if (pins & (1 << pin))
+                {
+                    usb_sim_pin_dir[pin] = ((USB_SIM_U16(cmd, 6) & (1 << pin)) != 0);
+                    usb_sim_pin_val[pin] = ((USB_SIM_U16(cmd, 8) & (1 << pin)) != 0);
+                }
+            }
+        }
+        usb_sim_respond(cmd[2], cmd[3], USB_SIM_STATUS_OK, NULL, 0);
+        return;
+    }
+
+    if (pins & COINES_MINI_SHUTTLE_PIN_ID)
+    {
+        pin = (uint8_t)(pins & 0xFF);
+        if (pin < USB_SIM_PIN_COUNT)
+        {
+            dir = usb_sim_pin_dir[pin];
+            val = usb_sim_pin_val[pin];
+        }
+    }
+    else
+    {
+        for (pin = 0; pin < 16; pin++)
+        {
+            if ((pins & (1 << pin)) && usb_sim_pin_dir[pin])
+                dir |= (uint16_t)(1 << pin);
+            if ((pins & (1 << pin)) && usb_sim_pin_val[pin])
+                val |= (uint16_t)(1 << pin);
+        }
+    }
+
+    /* [6..7] pins, [8..9] direction, [10..11] value */
+    payload[0] = cmd[4];
+    payload[1] = cmd[5];
+    payload[2] = (uint8_t)(dir >> 8);
+    payload[3] = (uint8_t)dir;
+    payload[4] = (uint8_t)(val >> 8);
+    payload[5] = (uint8_t)val;
+    usb_sim_respond(cmd[2], cmd[3], USB_SIM_STATUS_OK, payload, sizeof(payload));
+}
+
+/*!
+ * @brief This function gets the board timer
+ *
+ * @param[in] sim_ns : simulated time
+ *
+ * @return Timer value in us
+ */
+static uint64_t usb_sim_timer_value_us(uint64_t sim_ns)
+{
+    if (!usb_sim_timer_running)
+        return usb_sim_timer_stopped_ns / 1000;
+
+    return (usb_sim_timer_stopped_ns + (sim_ns - usb_sim_timer_start_ns)) / 1000;
+}
+
+/*!
+ * @brief This function executes a TIMER_CFG command.
+ *        SET carries enum coines_timer_config, GET carries enum coines_time_stamp_config.
+ *
+ * @param[in] cmd : command
+ * @param[in] sim_ns : simulated time of the command
+ *
+ * @return void
+ */
+static void usb_sim_timer_cmd(const uint8_t *cmd, uint64_t sim_ns)
+{
+    if (cmd[COINES_COMMAND_ID_POSITION] == COINES_DD_SET)
+    {
+        switch (cmd[4])
+        {
+            case COINES_TIMER_START:
+                if (!usb_sim_timer_running)
+                {
+                    usb_sim_timer_running = 1;
+                    usb_sim_timer_start_ns = sim_ns;
+                }
+                break;
+            case COINES_TIMER_STOP:
+                usb_sim_timer_stopped_ns = usb_sim_timer_value_us(sim_ns) * 1000;
+                usb_sim_timer_running = 0;
+                break;
+            case COINES_TIMER_RESET:
+                usb_sim_timer_stopped_ns = 0;
+                usb_sim_timer_start_ns = sim_ns;
+                break;
+            default:
+                usb_sim_respond(cmd[2], cmd[3], USB_SIM_STATUS_ERROR, NULL, 0);
+                return;
+        }
+    }
+
+    usb_sim_respond(cmd[2], cmd[3], USB_SIM_STATUS_OK, NULL, 0);
+}
+
+/*!
+ * @brief This function executes a SET or GET command
+ *
+ * @param[in] cmd : command
+ * @param[in] sim_ns : simulated time of the command
+ *
+ * @return void
+ */
+static void usb_sim_feature_cmd(const uint8_t *cmd, uint64_t sim_ns)
+{
+    uint8_t payload[7];
+
+    switch (cmd[3])
+    {
+        case COINES_CMDID_SENSORWRITEANDREAD:
+            usb_sim_sensor_cmd(cmd, sim_ns);
+            break;
+        case COINES_CMDID_16BIT_SPIWRITEANDREAD:
+            usb_sim_sensor16_cmd(cmd, sim_ns);
+            break;
+        case COINES_CMDID_MULTIO_CONFIGURATION:
+            usb_sim_pin_cmd(cmd);
+            break;
+        case COINES_CMDID_TIMER_CFG_CMD_ID:
+            usb_sim_timer_cmd(cmd, sim_ns);
+            break;
+        case COINES_CMDID_SHUTTLEBOARD_VDD_VDDIO_CONFIGURATION:
+            /* [4..5] VDD, [6] VDD enable, [7..8] VDDIO, [9] VDDIO enable */
+            usb_sim_vdd_mv = cmd[6] ? USB_SIM_U16(cmd, 4) : 0;
+            usb_sim_vddio_mv = cmd[9] ? USB_SIM_U16(cmd, 7) : 0;
+            usb_sim_respond(cmd[2], cmd[3], USB_SIM_STATUS_OK, NULL, 0);
+            break;
+        case COINES_CMDID_BOARDINFORMATION:
+            /* [6..7] shuttle id, [8..9] hardware id, [10..11] software id, [12] board */
+            payload[0] = (uint8_t)(usb_sim_cfg.shuttle_id >> 8);
+            payload[1] = (uint8_t)usb_sim_cfg.shuttle_id;
+            payload[2] = (uint8_t)(usb_sim_cfg.hardware_id >> 8);
+            payload[3] = (uint8_t)usb_sim_cfg.hardware_id;
+            payload[4] = (uint8_t)(usb_sim_cfg.software_id >> 8);
+            payload[5] = (uint8_t)usb_sim_cfg.software_id;
+            payload[6] = usb_sim_cfg.board;
+            usb_sim_respond(cmd[2], cmd[3], USB_SIM_STATUS_OK, payload, sizeof(payload));
+            break;
+        case COINES_CMDID_INTERFACE:
+        case COINES_CMDID_SPISETTINGS:
+        case COINES_CMDID_I2CSPEED:
+            /* Bus settings do not change the simulated transfers */
+            usb_sim_respond(cmd[2], cmd[3], USB_SIM_STATUS_OK, NULL, 0);
+            break;
+        default:
+            usb_sim_status.unknown_commands++;
+            usb_sim_respond(cmd[2], cmd[3], USB_SIM_STATUS_ERROR, NULL, 0);
+            break;
+    }
+}
+
+/*!
+ * @brief This function stores the streaming configuration of a channel
+ *
+ * Polling   : [4] 0, [5] interface, [6] analog switch, [7..8] address, [9..10] sampling time,
+ *             [11] sampling unit, [12] read mode, [13] blocks, 3 bytes per block
+ * Interrupt : [4] timestamp, [5] interface, [6] interrupt pin, [7..8] address,
+ *             [9] read mode, [10] blocks, 3 bytes per block
+ *
+ * @param[in] cmd : command
+ * @param[in] mode : USB_SIM_STREAM_POLLING or USB_SIM_STREAM_INT
+ *
+ * @return void
+ */
+static void usb_sim_stream_config_cmd(const uint8_t *cmd, uint8_t mode)
+{
+    usb_sim_stream_t *stream;
+    uint8_t channel = cmd[3];
+    uint8_t pos = (mode == USB_SIM_STREAM_POLLING) ? 13 : 10;
+    uint32_t sampling_us;
+    uint8_t idx;
+
+    if ((channel < COINES_MIN_SENSOR_ID) || (channel > COINES_MAX_SENSOR_ID) ||
+        (cmd[pos] == 0) || (cmd[pos] > USB_SIM_STREAM_MAX_BLOCKS))
+    {
+        usb_sim_respond(cmd[2], cmd[3], USB_SIM_STATUS_ERROR, NULL, 0);
+        return;
+    }
+
+    stream = &usb_sim_stream[channel];
+    memset(stream, 0, sizeof(*stream));
+    stream->intf_sel = cmd[5];
+    stream->dev_addr = USB_SIM_U16(cmd, 7);
+    stream->block_count = cmd[pos++];
+    for (idx = 0; idx < stream->block_count; idx++, pos += 3)
+    {
+        stream->block_reg[idx] = cmd[pos];
+        stream->block_len[idx] = USB_SIM_U16(cmd, pos + 1);
+        stream->data_len += stream->block_len[idx];
+    }
+
+    if (mode == USB_SIM_STREAM_POLLING)
+    {
+        sampling_us = USB_SIM_U16(cmd, 9);
+        if (cmd[11] == COINES_SAMPLING_TIME_IN_MILLI_SEC)
+            sampling_us *= 1000;
+        stream->period_ns = (uint64_t)sampling_us * 1000;
+    }
+    else
+    {
+        stream->timestamp = cmd[4];
+        stream->period_ns = UINT64_C(1000000000) / usb_sim_cfg.data_ready_hz;
+    }
+
+    /* A sample has to fit in one stream packet */
+    if ((stream->period_ns == 0) ||
+        ((mode == USB_SIM_STREAM_POLLING) && (stream->data_len + USB_SIM_POLLING_OVERHEAD > COINES_PACKET_SIZE)) ||
+        ((mode == USB_SIM_STREAM_INT) &&
+         (stream->data_len + 4 + (stream->timestamp ? 6 : 0) + USB_SIM_INT_OVERHEAD > COINES_PACKET_SIZE)))
+    {
+        memset(stream, 0, sizeof(*stream));
+        usb_sim_respond(cmd[2], cmd[3], USB_SIM_STATUS_ERROR, NULL, 0);
+        return;
+    }
+
+    stream->mode = mode;
+    usb_sim_respond(cmd[2], cmd[3], USB_SIM_STATUS_OK, NULL, 0);
+}
+
+/*!
+ * @brief This function starts ([3] != 0) or stops ([3] == 0) the channels of a streaming mode.
+ *        Stopping also discards their configuration.
+ *
+ * @param[in] cmd : command
+ * @param[in] mode : USB_SIM_STREAM_POLLING or USB_SIM_STREAM_INT
+ * @param[in] sim_ns : simulated time of the command
+ *
+ * @return void
+ */
+static void usb_sim_stream_start_stop_cmd(const uint8_t *cmd, uint8_t mode, uint64_t sim_ns)
+{
+    usb_sim_stream_t *stream;
+    uint8_t channel;
+
+    for (channel = COINES_MIN_SENSOR_ID; channel <= COINES_MAX_SENSOR_ID; channel++)
+    {
+        stream = &usb_sim_stream[channel];
+        if (stream->mode != mode)
+            continue;
+
+        if (cmd[3] != 0)
+        {
+            stream->active = 1;
+            stream->counter = 0;
+            stream->next_due_ns = sim_ns + stream->period_ns;
+        }
+        else
+        {
+            memset(stream, 0, sizeof(*stream));
+        }
+    }
+
+    usb_sim_respond(cmd[2], cmd[3], USB_SIM_STATUS_OK, NULL, 0);
+}
+
+/*!
+ * @brief This function finds the active stream channel with the earliest due sample
+ *
+ * @param[out] channel : sensor id of the channel
+ *
+ * @return Channel, NULL if no channel is streaming
+ */
+static usb_sim_stream_t *usb_sim_next_stream(uint8_t *channel)
+{
+    usb_sim_stream_t *next = NULL;
+    uint8_t idx;
+
+    for (idx = COINES_MIN_SENSOR_ID; idx <= COINES_MAX_SENSOR_ID; idx++)
+    {
+        if (usb_sim_stream[idx].active &&
+            ((next == NULL) || (usb_sim_stream[idx].next_due_ns < next->next_due_ns)))
+        {
+            next = &usb_sim_stream[idx];
+            *channel = idx;
+        }
+    }
+
+    return next;
+}
+
+/*!
+ * @brief This function samples a stream channel at its due time and builds the stream packet
+ *
+ * @param[in] channel : sensor id
+ * @param[out] pkt : COINES_PACKET_SIZE bytes packet
+ *
+ * @return USB_SIM_STATUS_OK if a packet was built
+ */
+static uint8_t usb_sim_stream_packet(uint8_t channel, uint8_t *pkt)
+{
+    usb_sim_stream_t *stream = &usb_sim_stream[channel];
+    uint64_t sim_ns = stream->next_due_ns;
+    uint64_t timestamp;
+    uint16_t reg_addr, pos, len;
+    uint8_t idx, status = USB_SIM_STATUS_OK;
+
+    memset(pkt, 0, COINES_PACKET_SIZE);
+    pos = (stream->mode == USB_SIM_STREAM_POLLING) ? 5 : 10;
+    for (idx = 0; (idx < stream->block_count) && (status == USB_SIM_STATUS_OK); idx++)
+    {
+        reg_addr = stream->block_reg[idx];
+        if (stream->intf_sel != 0)
+            reg_addr &= 0x7F;
+        status = usb_sim_access(stream->intf_sel, usb_sim_cs_select(usb_sim_cfg.cs_pin), stream->dev_addr,
+                                reg_addr, &pkt[pos], stream->block_len[idx], 0, sim_ns);
+        pos += stream->block_len[idx];
+    }
+
+    if (status != USB_SIM_STATUS_OK)
+        return status;
+
+    pkt[COINES_IDENTIFIER_POSITION] = COINES_DD_RESP_ID;
+    pkt[COINES_DD_STATUS_RESPONSE_POSITION] = USB_SIM_STATUS_OK;
+    if (stream->mode == USB_SIM_STREAM_POLLING)
+    {
+        /* [4] 0x87, [5..] data, sensor id mask, "\r\n" */
+        pkt[4] = COINES_RSPID_POLLING_STREAMING_DATA;
+        pkt[pos++] = 0;
+        pkt[pos++] = (uint8_t)(1 << (channel - 1));
+    }
+    else
+    {
+        /* [4] 0x8A, [5] sensor id, [6..9] counter, [10..] data, timestamp, "\r\n" */
+        pkt[4] = COINES_RSPID_INT_STREAMING_DATA;
+        pkt[5] = channel;
+        pkt[6] = (uint8_t)(stream->counter >> 24);
+        pkt[7] = (uint8_t)(stream->counter >> 16);
+        pkt[8] = (uint8_t)(stream->counter >> 8);
+        pkt[9] = (uint8_t)stream->counter;
+        stream->counter++;
+        if (stream->timestamp)
+        {
+            timestamp = usb_sim_timer_value_us(sim_ns);
+            for (len = 0; len < 6; len++)
+            {
+                pkt[pos++] = (uint8_t)(timestamp >> (8 * (5 - len)));
+            }
+        }
+    }
+    pkt[pos++] = '\r';
+    pkt[pos++] = '\n';
+    pkt[COINES_BYTEPOS_PACKET_SIZE] = (uint8_t)pos;
+
+    return USB_SIM_STATUS_OK;
+}
+
+/** @}*/
@@ -0,0 +1,60 @@
+/**
+ * Copyright (C) 2018 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    usb_sim.h
+ * @brief   This file contains the declarations of the simulated Application Board transport
+ *
+ */
+
+/*!
+ * @addtogroup usb_sim_api
+ * @{*/
+
+#ifndef COMM_DRIVER_USB_SIM_H_
+#define COMM_DRIVER_USB_SIM_H_
+
+/**********************************************************************************/
+/* header includes */
+/**********************************************************************************/
+#include <stdint.h>
+#include "coines_defs.h"
+#include "usb.h"
+
+/**********************************************************************************/
+/* global variables */
+/**********************************************************************************/
+
+/*! Transport answering the DD protocol in-process, see usb_set_transport() */
+extern const usb_transport_t usb_sim_transport;
+
+/**********************************************************************************/
+/* function declarations */
+/**********************************************************************************/
+
+/*!
+ *  @brief This API sets the board and sensor simulated by usb_sim_transport
+ *
+ *  @param[in] config : simulation configuration, NULL to release it
+ *
+ *  @return Result of API execution status
+ *  @retval 0 -> Success
+ *  @retval Any non zero value -> Fail
+ */
+int16_t usb_sim_config(const struct coines_sim_config *config);
+
+/*!
+ *  @brief This API gets the statistics of the simulated board
+ *
+ *  @param[out] status : simulation statistics
+ *
+ *  @return Result of API execution status
+ *  @retval 0 -> Success
+ *  @retval Any non zero value -> Fail
+ */
+int16_t usb_sim_get_status(struct coines_sim_status *status);
+
+#endif /* COMM_DRIVER_USB_SIM_H_ */
+
+/** @}*/
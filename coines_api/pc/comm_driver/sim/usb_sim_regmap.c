@@ -0,0 +1,190 @@
+/**
+ * Copyright (C) 2018 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    usb_sim_regmap.c
+ * @brief   This file implements the built-in sensor of the simulated board.
+ *
+ * The sensor is a plain map of COINES_SIM_REG_COUNT registers. Bursts auto-increment the
+ * register address and wrap around at the end of the map. At every data ready event the
+ * generator writes the next sample to its data registers.
+ *
+ */
+
+/*!
+ * @defgroup usb_sim_regmap_api usb_sim_regmap
+ * @{*/
+
+/*********************************************************************/
+/* system header files */
+/*********************************************************************/
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+/*********************************************************************/
+/* own header files */
+/*********************************************************************/
+#include "usb_sim_regmap.h"
+
+/*********************************************************************/
+/* local macro definitions */
+/*********************************************************************/
+#ifndef M_PI
+#define M_PI    3.14159265358979323846
+#endif
+
+/*********************************************************************/
+/* static function declarations */
+/*********************************************************************/
+static int16_t usb_sim_regmap_read(void *context, uint16_t reg_addr, uint8_t *data, uint16_t count);
+static int16_t usb_sim_regmap_write(void *context, uint16_t reg_addr, const uint8_t *data, uint16_t count);
+static void usb_sim_regmap_update(void *context, uint64_t sample_idx);
+static int16_t usb_sim_regmap_sample(usb_sim_regmap_t *regmap, uint64_t sample_idx, uint8_t channel);
+
+/*********************************************************************/
+/* functions */
+/*********************************************************************/
+
+/*!
+ * @brief This API resets the register map and returns the sensor model accessing it
+ */
+void usb_sim_regmap_init(usb_sim_regmap_t *regmap,
+                         const uint8_t *reg_init,
+                         const struct coines_sim_generator *generator,
+                         struct coines_sim_sensor_model *model)
+{
+    if (reg_init != NULL)
+        memcpy(regmap->regs, reg_init, COINES_SIM_REG_COUNT);
+    else
+        memset(regmap->regs, 0, COINES_SIM_REG_COUNT);
+
+    regmap->generator = *generator;
+    regmap->noise_state = (generator->seed != 0) ? generator->seed : 1;
+    /* Force the first update to write sample 0 */
+    regmap->sample_idx = UINT64_MAX;
+
+    model->context = regmap;
+    model->read = usb_sim_regmap_read;
+    model->write = usb_sim_regmap_write;
+    model->update = usb_sim_regmap_update;
+}
+
+/*!
+ * @brief This function reads a burst from the register map
+ *
+ * @param[in] context : register map
+ * @param[in] reg_addr : first register
+ * @param[out] data : register content
+ * @param[in] count : number of bytes
+ *
+ * @return Result of API execution status
+ */
+static int16_t usb_sim_regmap_read(void *context, uint16_t reg_addr, uint8_t *data, uint16_t count)
+{
+    usb_sim_regmap_t *regmap = (usb_sim_regmap_t *)context;
+    uint16_t idx;
+
+    for (idx = 0; idx < count; idx++)
+    {
+        data[idx] = regmap->regs[(reg_addr + idx) % COINES_SIM_REG_COUNT];
+    }
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This function writes a burst to the register map
+ *
+ * @param[in] context : register map
+ * @param[in] reg_addr : first register
+ * @param[in] data : register content
+ * @param[in] count : number of bytes
+ *
+ * @return Result of API execution status
+ */
+static int16_t usb_sim_regmap_write(void *context, uint16_t reg_addr, const uint8_t *data, uint16_t count)
+{
+    usb_sim_regmap_t *regmap = (usb_sim_regmap_t *)context;
+    uint16_t idx;
+
+    for (idx = 0; idx < count; idx++)
+    {
+        regmap->regs[(reg_addr + idx) % COINES_SIM_REG_COUNT] = data[idx];
+    }
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This function writes the generated sample to the data registers
+ *
+ * @param[in] context : register map
+ * @param[in] sample_idx : data ready events since the board was opened
+ *
+ * @return void
+ */
+static void usb_sim_regmap_update(void *context, uint64_t sample_idx)
+{
+    usb_sim_regmap_t *regmap = (usb_sim_regmap_t *)context;
+    uint16_t reg;
+    int16_t value;
+    uint8_t channel;
+
+    if (sample_idx == regmap->sample_idx)
+        return;
+
+    regmap->sample_idx = sample_idx;
+    for (channel = 0; channel < regmap->generator.channels; channel++)
+    {
+        value = usb_sim_regmap_sample(regmap, sample_idx, channel);
+        reg = regmap->generator.data_reg + (2 * channel);
+        regmap->regs[reg % COINES_SIM_REG_COUNT] = (uint8_t)((uint16_t)value & 0xFF);
+        regmap->regs[(reg + 1) % COINES_SIM_REG_COUNT] = (uint8_t)((uint16_t)value >> 8);
+    }
+}
+
+/*!
+ * @brief This function computes one channel of a generated sample
+ *
+ * @param[in] regmap : register map
+ * @param[in] sample_idx : sample index
+ * @param[in] channel : channel index
+ *
+ * @return Channel value
+ */
+static int16_t usb_sim_regmap_sample(usb_sim_regmap_t *regmap, uint64_t sample_idx, uint8_t channel)
+{
+    const struct coines_sim_generator *gen = &regmap->generator;
+    uint32_t period = (gen->period_samples != 0) ? gen->period_samples : 1;
+    uint32_t range;
+    double phase;
+    int32_t value = gen->offset;
+
+    switch (gen->waveform)
+    {
+        case COINES_SIM_WAVEFORM_RAMP:
+            value += (int32_t)((sample_idx + channel) & 0xFFFF);
+            break;
+        case COINES_SIM_WAVEFORM_SINE:
+            phase = (double)((sample_idx + ((uint64_t)period * channel) / gen->channels) % period) / period;
+            value += (int32_t)(gen->amplitude * sin(2.0 * M_PI * phase));
+            break;
+        case COINES_SIM_WAVEFORM_NOISE:
+            /* xorshift32 */
+            regmap->noise_state ^= regmap->noise_state << 13;
+            regmap->noise_state ^= regmap->noise_state >> 17;
+            regmap->noise_state ^= regmap->noise_state << 5;
+            range = (uint32_t)(2 * (gen->amplitude < 0 ? -gen->amplitude : gen->amplitude)) + 1;
+            value += (int32_t)(regmap->noise_state % range) - (int32_t)(range / 2);
+            break;
+        case COINES_SIM_WAVEFORM_CONSTANT:
+        default:
+            break;
+    }
+
+    return (int16_t)(uint16_t)(uint32_t)value;
+}
+
+/** @}*/
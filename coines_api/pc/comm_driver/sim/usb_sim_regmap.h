@@ -0,0 +1,60 @@
+/**
+ * Copyright (C) 2018 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    usb_sim_regmap.h
+ * @brief   This file contains the declarations of the built-in sensor of the simulated board
+ *
+ */
+
+/*!
+ * @addtogroup usb_sim_regmap_api
+ * @{*/
+
+#ifndef COMM_DRIVER_USB_SIM_REGMAP_H_
+#define COMM_DRIVER_USB_SIM_REGMAP_H_
+
+/**********************************************************************************/
+/* header includes */
+/**********************************************************************************/
+#include <stdint.h>
+#include "coines.h"
+
+/**********************************************************************************/
+/* data structure declarations */
+/**********************************************************************************/
+
+/*!
+ * @brief Register map sensor with a data generator
+ */
+typedef struct
+{
+    uint8_t regs[COINES_SIM_REG_COUNT]; /*< Register content */
+    struct coines_sim_generator generator; /*< Data generator */
+    uint64_t sample_idx; /*< Sample currently in the data registers */
+    uint32_t noise_state; /*< State of the noise generator */
+} usb_sim_regmap_t;
+
+/**********************************************************************************/
+/* function declarations */
+/**********************************************************************************/
+
+/*!
+ *  @brief This API resets the register map and returns the sensor model accessing it
+ *
+ *  @param[out] regmap    : register map
+ *  @param[in]  reg_init  : COINES_SIM_REG_COUNT initial register values, NULL for all 0
+ *  @param[in]  generator : data generator
+ *  @param[out] model     : sensor model to hand to the simulated board
+ *
+ *  @return void
+ */
+void usb_sim_regmap_init(usb_sim_regmap_t *regmap,
+                         const uint8_t *reg_init,
+                         const struct coines_sim_generator *generator,
+                         struct coines_sim_sensor_model *model);
+
+#endif /* COMM_DRIVER_USB_SIM_REGMAP_H_ */
+
+/** @}*/
@@ -12,9 +12,15 @@
  * @defgroup usb_api usb
  * @{*/
 
+#if defined(PLATFORM_LINUX) && !defined(_GNU_SOURCE)
+/*! Needed for pthread_setaffinity_np() and the CPU_SET() macros */
+#define _GNU_SOURCE
+#endif
+
 /*********************************************************************/
 /* system header files */
 /*********************************************************************/
+#include <errno.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
@@ -24,7 +30,9 @@
 
 #ifdef PLATFORM_LINUX
 #include <pthread.h>
+#include <sched.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #endif
 
 #ifdef LEGACY_USB_DRIVER
@@ -43,6 +51,8 @@
 /* own header files */
 /*********************************************************************/
 #include "usb.h"
+#include "usb_capture.h"
+#include "comm_trace.h"
 
 /*********************************************************************/
 /* local macro definitions */
@@ -63,6 +73,8 @@
 #define USB_PACKET_SIZE      64
 /*! USB Number of transfers to submit */
 #define USB_NO_TRANSFERS_TO_SUBMIT UINT8_C(3)
+/*! Time the event thread waits for a transport response before re-checking the state */
+#define USB_TRANSPORT_POLL_TIMEOUT_US UINT32_C(10000)
 
 /*********************************************************************/
 /* global variables */
@@ -86,9 +98,34 @@ pthread_attr_t usb_keep_alive_attr;
 struct sched_param usb_keep_alive_sched_param;
 #endif
 
+/*!
+ * @brief Variables used to hold the dispatcher thread pinned by usb_open_device() and its
+ * affinity from before, restored by usb_close_device().
+ */
+#ifdef PLATFORM_WINDOWS
+static HANDLE usb_dispatch_thread;
+static DWORD_PTR usb_dispatch_affinity;
+#endif
+#if defined(PLATFORM_LINUX) && defined(__linux__)
+static pthread_t usb_dispatch_thread;
+static cpu_set_t usb_dispatch_affinity;
+#endif
+
 /*! USB response buffer */
 usb_rsp_buffer_t usb_rsp_buf[USB_NO_TRANSFERS_TO_SUBMIT];
 
+/*! Real-time tuning used for the next usb_open_device() */
+struct coines_rt_config usb_rt_config = {
+    .policy = COINES_RT_SCHED_DEFAULT,
+    .priority = 0,
+    .event_thread_cpu = COINES_RT_CPU_ANY,
+    .dispatch_thread_cpu = COINES_RT_CPU_ANY,
+    .lock_memory = 0,
+    .prefault_buffers = 0
+};
+/*! Real-time tuning applied by the last usb_open_device() */
+struct coines_rt_status usb_rt_status;
+
 /*********************************************************************/
 /* static function declarations */
 /*********************************************************************/
@@ -103,6 +140,31 @@ DWORD WINAPI usb_keep_alive(void * arg);
 static void *usb_keep_alive(void *arg);
 #endif
 
+/*!
+ * @brief This function applies the memory and dispatcher thread tuning of usb_rt_config
+ */
+static void usb_apply_process_rt_config(void);
+
+/*!
+ * @brief This function undoes the memory lock and dispatcher thread pinning of usb_apply_process_rt_config()
+ */
+static void usb_restore_process_rt_config(void);
+
+/*!
+ * @brief This function creates the keep alive thread with the tuning of usb_rt_config
+ */
+static int16_t usb_create_keep_alive_thread(void);
+
+/*!
+ * @brief This function hands a received USB buffer to the response callback
+ */
+static void usb_dispatch_response(usb_rsp_buffer_t *rsp_buf);
+
+/*!
+ * @brief This function checks a CPU index of usb_rt_config against the affinity mask
+ */
+static int usb_rt_cpu_valid(int16_t cpu);
+
 #ifdef LIBUSB_DRIVER
 /*!
  * @brief This internal callback function triggered for USB in events .
@@ -114,6 +176,11 @@ static void usb_transfer_event_callback(struct libusb_transfer *transfer);
  */
 libusb_device * usb_find_device(libusb_device **devices);
 
+/*!
+ * @brief This function releases the claimed interface and closes the libusb device and context
+ */
+static void usb_release_device(void);
+
 /*!
  * @brief This internal callback function triggered for USB async response event
  */
@@ -138,6 +205,12 @@ usb_async_response_call_back usb_rsp_callback;
 /*! USB init status */
 static uint8_t usb_initialized = 0;
 
+/*! Transport replacing the USB hardware, NULL if the hardware is used */
+static const usb_transport_t *usb_transport = NULL;
+
+/*! Transport of the currently open device */
+static const usb_transport_t *usb_active_transport = NULL;
+
 /*********************************************************************/
 /* functions */
 /*********************************************************************/
@@ -149,12 +222,46 @@ int16_t usb_open_device(coines_command_t* comm_buf, usb_async_response_call_back
 #ifdef LIBUSB_DRIVER
     libusb_device **device_list;
     uint8_t count = 0;
+    struct timeval reap_timeout = { 0, 100000 };
 #endif
     if ((comm_buf == NULL) || (rsp_cb == NULL))
     {
         /* Null pointer error */
         return COINES_E_NULL_PTR;
     }
+    if (usb_transport != NULL)
+    {
+        usb_apply_process_rt_config();
+
+        memset(comm_buf, 0, sizeof(coines_command_t));
+        comm_buf->board_type = COINES_BOARD_DD;
+        usb_rsp_callback = rsp_cb;
+
+        if (usb_transport->open() != COINES_SUCCESS)
+        {
+            usb_restore_process_rt_config();
+            return COINES_E_UNABLE_OPEN_DEVICE;
+        }
+
+        usb_active_transport = usb_transport;
+        usb_initialized = 1;
+        if (usb_create_keep_alive_thread() != COINES_SUCCESS)
+        {
+            usb_initialized = 0;
+            usb_restore_process_rt_config();
+            usb_active_transport->close();
+            usb_active_transport = NULL;
+            return COINES_E_COMM_INIT_FAILED;
+        }
+
+        return COINES_SUCCESS;
+    }
+
+#if !defined(LIBUSB_DRIVER) && !defined(LEGACY_USB_DRIVER)
+    /* Built without a USB driver (NO_USB_DRIVER), only transports can be opened */
+    return COINES_E_DEVICE_NOT_FOUND;
+#endif
+
 #ifdef LIBUSB_DRIVER
     if (libusb_init(&usb_ctx) < 0)
     {
@@ -195,6 +302,8 @@ int16_t usb_open_device(coines_command_t* comm_buf, usb_async_response_call_back
         return COINES_E_UNABLE_CLAIM_INTF;
     }
 #endif
+    usb_apply_process_rt_config();
+
     /*allocate memory for communication buffer*/
     memset(comm_buf, 0, sizeof(sizeof(coines_command_t)));
     comm_buf->board_type = (coines_board_t)usb_board_type;
@@ -215,6 +324,8 @@ int16_t usb_open_device(coines_command_t* comm_buf, usb_async_response_call_back
     if (libusb_submit_transfer(usb_transfer_handle[0]) < 0)
     {
         libusb_free_transfer(usb_transfer_handle[0]);
+        usb_restore_process_rt_config();
+        usb_release_device();
         return COINES_E_FAILURE;
     }
 #endif
@@ -222,13 +333,323 @@ int16_t usb_open_device(coines_command_t* comm_buf, usb_async_response_call_back
 
     usb_initialized = 1;
 
+    if (usb_create_keep_alive_thread() != COINES_SUCCESS)
+    {
+        /* Undone as by usb_close_device(), there is no event thread to stop */
+        usb_initialized = 0;
+        usb_restore_process_rt_config();
+#ifdef LIBUSB_DRIVER
+        /* The cancelled transfer is reaped here, as the event thread would */
+        if (libusb_cancel_transfer(usb_transfer_handle[0]) == LIBUSB_SUCCESS)
+            (void)libusb_handle_events_timeout(usb_ctx, &reap_timeout);
+        usb_release_device();
+#endif
+        return COINES_E_COMM_INIT_FAILED;
+    }
+
+#ifdef LIBUSB_DRIVER
+    return COINES_SUCCESS;
+#endif
+
+#ifdef LEGACY_USB_DRIVER
+    int rslt;
+    rslt = legacy_open_usb_connection();
+    if (rslt == COINES_SUCCESS)
+    {
+        rslt = legacy_configure_usb_read();
+        legacy_configure_usb_write();
+    }
+    return rslt;
+#endif
+}
+
+/*!
+ * @brief This function checks that a CPU index fits the affinity mask of the platform.
+ *
+ * @param[in] cpu : CPU index or COINES_RT_CPU_ANY
+ *
+ * @return 1 if the CPU can be pinned to, 0 otherwise
+ */
+static int usb_rt_cpu_valid(int16_t cpu)
+{
+    if (cpu == COINES_RT_CPU_ANY)
+        return 1;
+    if (cpu < 0)
+        return 0;
+#if defined(PLATFORM_LINUX)
+    return cpu < CPU_SETSIZE;
+#elif defined(PLATFORM_WINDOWS)
+    return (size_t)cpu < (sizeof(DWORD_PTR) * 8);
+#else
+    return 1;
+#endif
+}
+
+/*!
+ * @brief This API is used to configure the real-time tuning of the USB threads.
+ */
+int16_t usb_config_realtime(const struct coines_rt_config *rt_config)
+{
+    if (rt_config == NULL)
+        return COINES_E_NULL_PTR;
+
+    if ((rt_config->policy > COINES_RT_SCHED_RR) || (rt_config->priority < 0))
+        return COINES_E_NOT_SUPPORTED;
+
+    if (!usb_rt_cpu_valid(rt_config->event_thread_cpu) || !usb_rt_cpu_valid(rt_config->dispatch_thread_cpu))
+        return COINES_E_INVALID_PARAM;
+
+    usb_rt_config = *rt_config;
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This API is used to get the real-time tuning applied by the last usb_open_device()
+ */
+int16_t usb_get_realtime_status(struct coines_rt_status *rt_status)
+{
+    if (rt_status == NULL)
+        return COINES_E_NULL_PTR;
+
+    *rt_status = usb_rt_status;
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This API is used to replace the USB hardware by another transport.
+ */
+int16_t usb_set_transport(const usb_transport_t *transport)
+{
+    if (usb_initialized)
+        return COINES_E_FAILURE;
+
+    if ((transport != NULL) &&
+        ((transport->open == NULL) || (transport->close == NULL) || (transport->send == NULL) ||
+         (transport->receive == NULL)))
+        return COINES_E_NULL_PTR;
+
+    usb_transport = transport;
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This function hands a received USB buffer to the response callback.
+ *
+ * @param[in] rsp_buf : received buffer
+ *
+ * @return None
+ */
+static void usb_dispatch_response(usb_rsp_buffer_t *rsp_buf)
+{
+    if (usb_capture_active)
+        usb_capture_record(USB_CAPTURE_DIR_IN, rsp_buf->buffer, (uint32_t)rsp_buf->buffer_size);
+
+    COMM_TRACE_BEGIN(COMM_TRACE_USB_IN, rsp_buf->buffer_size);
+    usb_rsp_callback(rsp_buf);
+    COMM_TRACE_END(COMM_TRACE_USB_IN, rsp_buf->buffer_size);
+}
+
+/*!
+ * @brief This function locks the process memory and pins the dispatcher (calling) thread
+ *        as requested in usb_rt_config.
+ *
+ * @return None
+ */
+static void usb_apply_process_rt_config(void)
+{
+    memset(&usb_rt_status, 0, sizeof(usb_rt_status));
+
+    if (usb_rt_config.policy != COINES_RT_SCHED_DEFAULT)
+        usb_rt_status.requested |= COINES_RT_SCHED;
+    if (usb_rt_config.event_thread_cpu != COINES_RT_CPU_ANY)
+        usb_rt_status.requested |= COINES_RT_EVENT_AFFINITY;
+    if (usb_rt_config.dispatch_thread_cpu != COINES_RT_CPU_ANY)
+        usb_rt_status.requested |= COINES_RT_DISPATCH_AFFINITY;
+    if (usb_rt_config.lock_memory)
+        usb_rt_status.requested |= COINES_RT_MEMLOCK;
+    if (usb_rt_config.prefault_buffers)
+        usb_rt_status.requested |= COINES_RT_PREFAULT;
+
+    if (usb_rt_config.prefault_buffers)
+    {
+        /* Fault in the transfer buffers before libusb starts writing into them */
+        memset(usb_rsp_buf, 0, sizeof(usb_rsp_buf));
+        usb_rt_status.applied |= COINES_RT_PREFAULT;
+    }
+
+#ifdef PLATFORM_LINUX
+    if (usb_rt_config.lock_memory)
+    {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+            usb_rt_status.applied |= COINES_RT_MEMLOCK;
+        else
+            usb_rt_status.memlock_error = errno;
+    }
+
+    if (usb_rt_config.dispatch_thread_cpu != COINES_RT_CPU_ANY)
+    {
+#ifdef __linux__
+        cpu_set_t cpu_set;
+        int rslt;
+
+        CPU_ZERO(&cpu_set);
+        CPU_SET(usb_rt_config.dispatch_thread_cpu, &cpu_set);
+        usb_dispatch_thread = pthread_self();
+        rslt = pthread_getaffinity_np(usb_dispatch_thread, sizeof(usb_dispatch_affinity), &usb_dispatch_affinity);
+        if (rslt == 0)
+            rslt = pthread_setaffinity_np(usb_dispatch_thread, sizeof(cpu_set), &cpu_set);
+        if (rslt == 0)
+            usb_rt_status.applied |= COINES_RT_DISPATCH_AFFINITY;
+        else
+            usb_rt_status.affinity_error = rslt;
+#else
+        usb_rt_status.affinity_error = ENOSYS;
+#endif
+    }
+#endif
+
+#ifdef PLATFORM_WINDOWS
+    if (usb_rt_config.lock_memory)
+    {
+        /* No process wide equivalent of mlockall() */
+        usb_rt_status.memlock_error = ENOSYS;
+    }
+
+    if (usb_rt_config.dispatch_thread_cpu != COINES_RT_CPU_ANY)
+    {
+        /* A real handle, usb_close_device() may run on another thread */
+        usb_dispatch_thread = OpenThread(THREAD_SET_INFORMATION | THREAD_QUERY_INFORMATION, FALSE,
+                                         GetCurrentThreadId());
+        usb_dispatch_affinity = 0;
+        if (usb_dispatch_thread != NULL)
+            usb_dispatch_affinity =
+                SetThreadAffinityMask(usb_dispatch_thread, (DWORD_PTR)1 << usb_rt_config.dispatch_thread_cpu);
+
+        if (usb_dispatch_affinity != 0)
+        {
+            usb_rt_status.applied |= COINES_RT_DISPATCH_AFFINITY;
+        }
+        else
+        {
+            usb_rt_status.affinity_error = (int)GetLastError();
+            if (usb_dispatch_thread != NULL)
+            {
+                CloseHandle(usb_dispatch_thread);
+                usb_dispatch_thread = NULL;
+            }
+        }
+    }
+#endif
+}
+
+/*!
+ * @brief This function unlocks the process memory and gives the dispatcher thread its affinity
+ *        from before usb_open_device() back, if they were applied.
+ *
+ * @return None
+ */
+static void usb_restore_process_rt_config(void)
+{
 #ifdef PLATFORM_LINUX
+    if (usb_rt_status.applied & COINES_RT_MEMLOCK)
+    {
+        munlockall();
+        usb_rt_status.applied &= ~COINES_RT_MEMLOCK;
+    }
+
+#ifdef __linux__
+    if (usb_rt_status.applied & COINES_RT_DISPATCH_AFFINITY)
+    {
+        (void)pthread_setaffinity_np(usb_dispatch_thread, sizeof(usb_dispatch_affinity), &usb_dispatch_affinity);
+        usb_rt_status.applied &= ~COINES_RT_DISPATCH_AFFINITY;
+    }
+#endif
+#endif
+
+#ifdef PLATFORM_WINDOWS
+    if (usb_rt_status.applied & COINES_RT_DISPATCH_AFFINITY)
+    {
+        (void)SetThreadAffinityMask(usb_dispatch_thread, usb_dispatch_affinity);
+        CloseHandle(usb_dispatch_thread);
+        usb_dispatch_thread = NULL;
+        usb_rt_status.applied &= ~COINES_RT_DISPATCH_AFFINITY;
+    }
+#endif
+}
+
+/*!
+ * @brief This function creates the keep alive thread.
+ *
+ * When a real-time policy is requested, the thread is created with explicit scheduling attributes.
+ * If the OS rejects them (Eg: EPERM without CAP_SYS_NICE), the thread is created with the
+ * inherited scheduling instead and the error is recorded in usb_rt_status.
+ *
+ * @return Result of thread creation
+ */
+static int16_t usb_create_keep_alive_thread(void)
+{
+#ifdef PLATFORM_LINUX
+    int policy = SCHED_OTHER;
+    int max_priority;
+    int rslt;
+
     pthread_attr_init(&usb_keep_alive_attr);
-    pthread_attr_setschedpolicy(&usb_keep_alive_attr, SCHED_FIFO);
-    usb_keep_alive_sched_param.sched_priority=sched_get_priority_max(SCHED_FIFO);
-    pthread_attr_setschedparam(&usb_keep_alive_attr, &usb_keep_alive_sched_param);
-    pthread_create(&usb_keep_alive_thread, &usb_keep_alive_attr, usb_keep_alive, NULL);
+
+    if (usb_rt_config.policy != COINES_RT_SCHED_DEFAULT)
+    {
+        policy = (usb_rt_config.policy == COINES_RT_SCHED_RR) ? SCHED_RR : SCHED_FIFO;
+        max_priority = sched_get_priority_max(policy);
+        if ((usb_rt_config.priority == 0) || (usb_rt_config.priority > max_priority))
+            usb_keep_alive_sched_param.sched_priority = max_priority;
+        else
+            usb_keep_alive_sched_param.sched_priority = usb_rt_config.priority;
+
+        /* Without PTHREAD_EXPLICIT_SCHED the policy and priority below are silently ignored */
+        pthread_attr_setinheritsched(&usb_keep_alive_attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&usb_keep_alive_attr, policy);
+        pthread_attr_setschedparam(&usb_keep_alive_attr, &usb_keep_alive_sched_param);
+    }
+
+    rslt = pthread_create(&usb_keep_alive_thread, &usb_keep_alive_attr, usb_keep_alive, NULL);
+    if ((rslt != 0) && (policy != SCHED_OTHER))
+    {
+        usb_rt_status.sched_error = rslt;
+        pthread_attr_setinheritsched(&usb_keep_alive_attr, PTHREAD_INHERIT_SCHED);
+        rslt = pthread_create(&usb_keep_alive_thread, &usb_keep_alive_attr, usb_keep_alive, NULL);
+    }
+    else if ((rslt == 0) && (policy != SCHED_OTHER))
+    {
+        usb_rt_status.applied |= COINES_RT_SCHED;
+        usb_rt_status.priority = (int16_t)usb_keep_alive_sched_param.sched_priority;
+    }
+
+    if (rslt != 0)
+    {
+        pthread_attr_destroy(&usb_keep_alive_attr);
+        return COINES_E_COMM_INIT_FAILED;
+    }
+
+    if (usb_rt_config.event_thread_cpu != COINES_RT_CPU_ANY)
+    {
+#ifdef __linux__
+        cpu_set_t cpu_set;
+
+        CPU_ZERO(&cpu_set);
+        CPU_SET(usb_rt_config.event_thread_cpu, &cpu_set);
+        rslt = pthread_setaffinity_np(usb_keep_alive_thread, sizeof(cpu_set), &cpu_set);
+        if (rslt == 0)
+            usb_rt_status.applied |= COINES_RT_EVENT_AFFINITY;
+        else
+            usb_rt_status.affinity_error = rslt;
+#else
+        usb_rt_status.affinity_error = ENOSYS;
+#endif
+    }
 #endif
+
 #ifdef PLATFORM_WINDOWS
     /*Set priority class*/
     SetPriorityClass(GetCurrentProcess(), ABOVE_NORMAL_PRIORITY_CLASS);
@@ -242,24 +663,30 @@ int16_t usb_open_device(coines_command_t* comm_buf, usb_async_response_call_back
             0, // use default creation flags
             &usb_keep_alive_id); // returns the thread identifier
 
-    SetThreadPriority(usb_keep_alive_thread, THREAD_PRIORITY_TIME_CRITICAL);
-
-#endif
+    if (usb_keep_alive_thread == NULL)
+        return COINES_E_COMM_INIT_FAILED;
 
-#ifdef LIBUSB_DRIVER
-    return COINES_SUCCESS;
-#endif
+    if (SetThreadPriority(usb_keep_alive_thread, THREAD_PRIORITY_TIME_CRITICAL))
+    {
+        if (usb_rt_config.policy != COINES_RT_SCHED_DEFAULT)
+            usb_rt_status.applied |= COINES_RT_SCHED;
+        usb_rt_status.priority = THREAD_PRIORITY_TIME_CRITICAL;
+    }
+    else
+    {
+        usb_rt_status.sched_error = (int)GetLastError();
+    }
 
-#ifdef LEGACY_USB_DRIVER
-    int rslt;
-    rslt = legacy_open_usb_connection();
-    if (rslt == COINES_SUCCESS)
+    if (usb_rt_config.event_thread_cpu != COINES_RT_CPU_ANY)
     {
-        rslt = legacy_configure_usb_read();
-        legacy_configure_usb_write();
+        if (SetThreadAffinityMask(usb_keep_alive_thread, (DWORD_PTR)1 << usb_rt_config.event_thread_cpu) != 0)
+            usb_rt_status.applied |= COINES_RT_EVENT_AFFINITY;
+        else
+            usb_rt_status.affinity_error = (int)GetLastError();
     }
-    return rslt;
 #endif
+
+    return COINES_SUCCESS;
 }
 
 /*!
@@ -288,7 +715,7 @@ static void usb_transfer_event_callback(struct libusb_transfer *transfer)
             if (transfer->actual_length > 0)
             {
                 usb_rsp_buf[count].buffer_size = transfer->actual_length;
-                usb_rsp_callback(&usb_rsp_buf[count]);
+                usb_dispatch_response(&usb_rsp_buf[count]);
 
                 /*Prepare the next available buffer for receiving usb data */
                 if (count == (USB_NO_TRANSFERS_TO_SUBMIT - 1))
@@ -349,7 +776,18 @@ static void *usb_keep_alive(void *arg)
 #ifdef LEGACY_USB_DRIVER
     int16_t rslt = COINES_E_FAILURE;
 #endif
-    while (usb_initialized)
+    COMM_TRACE_THREAD_NAME("usb_event");
+
+    while (usb_initialized && (usb_active_transport != NULL))
+    {
+        if (usb_active_transport->receive(&usb_rsp_buf[0], USB_TRANSPORT_POLL_TIMEOUT_US) == COINES_SUCCESS)
+        {
+            usb_dispatch_response(&usb_rsp_buf[0]);
+            memset(&usb_rsp_buf[0].buffer, 0, COINES_DATA_BUF_SIZE);
+        }
+    }
+
+    while (usb_initialized && (usb_active_transport == NULL))
     {
 #ifdef LIBUSB_DRIVER
         /*usb handle events are triggered to keep alive the libusb asynchronous communication*/
@@ -360,7 +798,7 @@ static void *usb_keep_alive(void *arg)
         rslt = legacy_read_usb_response(usb_rsp_buf[0].buffer);
         if (rslt == COINES_SUCCESS)
         {
-            usb_rsp_callback(&usb_rsp_buf[0]);
+            usb_dispatch_response(&usb_rsp_buf[0]);
             memset(&usb_rsp_buf[0].buffer, 0, COINES_DATA_BUF_SIZE);
         }
 #endif
@@ -420,6 +858,26 @@ libusb_device * usb_find_device(libusb_device **devices)
 
     return NULL;
 }
+
+/*!
+ * @brief This function releases the claimed interface and closes the libusb device and context.
+ *
+ * @return None
+ */
+static void usb_release_device(void)
+{
+    if (usb_handle)
+    {
+        libusb_release_interface(usb_handle, 0);
+#ifdef PLATFORM_LINUX
+        libusb_attach_kernel_driver(usb_handle,0);
+#endif
+        libusb_close(usb_handle);
+        usb_handle = NULL;
+    }
+
+    libusb_exit(usb_ctx);
+}
 #endif
 
 /*!
@@ -428,6 +886,23 @@ libusb_device * usb_find_device(libusb_device **devices)
 void usb_close_device(void)
 {
     usb_initialized = 0;
+
+    if (usb_active_transport != NULL)
+    {
+        /* The transport bounds the time spent in receive(), so the event thread can be joined */
+#ifdef PLATFORM_WINDOWS
+        WaitForSingleObject(usb_keep_alive_thread, INFINITE);
+        CloseHandle(usb_keep_alive_thread);
+#endif
+#ifdef PLATFORM_LINUX
+        pthread_join(usb_keep_alive_thread, NULL);
+        pthread_attr_destroy(&usb_keep_alive_attr);
+#endif
+        usb_restore_process_rt_config();
+        usb_active_transport->close();
+        usb_active_transport = NULL;
+        return;
+    }
 #ifdef PLATFORM_WINDOWS
     /*Wait until all threads have terminated*/
     //WaitForMultipleObjects(1, &usb_keep_alive_thread, TRUE, INFINITE);
@@ -438,18 +913,9 @@ void usb_close_device(void)
     //pthread_join(usb_keep_alive_thread, NULL);
     pthread_detach(usb_keep_alive_thread);
 #endif
+    usb_restore_process_rt_config();
 #ifdef LIBUSB_DRIVER
-    if (usb_handle)
-    {
-        libusb_release_interface(usb_handle, 0);
-#ifdef PLATFORM_LINUX
-        libusb_attach_kernel_driver(usb_handle,0);
-#endif
-        libusb_close(usb_handle);
-        usb_handle = NULL;
-    }
-
-    libusb_exit(usb_ctx);
+    usb_release_device();
 #endif
 
 #ifdef LEGACY_USB_DRIVER
@@ -481,13 +947,29 @@ int16_t usb_send_command(coines_command_t* buffer)
     printf("\n");
 #endif
 
+    if (usb_capture_active)
+        usb_capture_record(USB_CAPTURE_DIR_OUT, buffer->buffer, buffer->buffer_size);
+
+    if (usb_active_transport != NULL)
+    {
+        int16_t rslt;
+
+        buffer->error = 0;
+        COMM_TRACE_BEGIN(COMM_TRACE_USB_OUT, buffer->buffer_size);
+        rslt = usb_active_transport->send(&buffer->buffer[0], buffer->buffer_size);
+        COMM_TRACE_END(COMM_TRACE_USB_OUT, buffer->buffer_size);
+        return rslt;
+    }
+
 #ifdef LIBUSB_DRIVER
     if(usb_handle == NULL)
     return COINES_E_COMM_IO_ERROR;
     int size;
     /* Making buffer size as multiple of 64 bytes(USB endpoint size) */
     buffer_size = buffer->buffer_size + (USB_PACKET_SIZE -(buffer->buffer_size % USB_PACKET_SIZE));
+    COMM_TRACE_BEGIN(COMM_TRACE_USB_OUT, buffer_size);
     buffer->error = libusb_bulk_transfer(usb_handle, USB_BULK_EP_OUT, &buffer->buffer[0], buffer_size, &size, USB_TIMEOUT);
+    COMM_TRACE_END(COMM_TRACE_USB_OUT, size);
 
     if (buffer->error == 0)
     {
@@ -500,7 +982,9 @@ int16_t usb_send_command(coines_command_t* buffer)
 #endif
 
 #ifdef LEGACY_USB_DRIVER
+    COMM_TRACE_BEGIN(COMM_TRACE_USB_OUT, USB_PACKET_SIZE);
     buffer->error = legacy_send_usb_command(&buffer->buffer[0], USB_PACKET_SIZE);
+    COMM_TRACE_END(COMM_TRACE_USB_OUT, USB_PACKET_SIZE);
     if (buffer->error == TRUE)
     {
         return COINES_SUCCESS;
@@ -510,6 +994,10 @@ int16_t usb_send_command(coines_command_t* buffer)
         return COINES_E_FAILURE;
     }
 #endif
+
+#if !defined(LIBUSB_DRIVER) && !defined(LEGACY_USB_DRIVER)
+    return COINES_E_COMM_IO_ERROR;
+#endif
 }
 
 /** @}*/
@@ -33,6 +33,19 @@ typedef struct
     int buffer_size; /**< buffer size */
 } usb_rsp_buffer_t;
 
+/*!
+ * @brief Transport used in place of the USB hardware (Eg: capture replay, simulated board).
+ *
+ * 'receive' is polled from the USB event thread, 'send' is called from the thread issuing the command.
+ */
+typedef struct
+{
+    int16_t (*open)(void); /**< Prepare the transport, called from usb_open_device() */
+    void (*close)(void); /**< Release the transport, called from usb_close_device() */
+    int16_t (*send)(const uint8_t *buffer, uint32_t length); /**< Consume a command sent by the host */
+    int16_t (*receive)(usb_rsp_buffer_t *rsp_buf, uint32_t timeout_us); /**< Wait for the next board response */
+} usb_transport_t;
+
 /**********************************************************************************/
 /* function declarations */
 /**********************************************************************************/
@@ -73,6 +86,41 @@ void usb_close_device(void);
  */
 int16_t usb_send_command(coines_command_t * buffer);
 
+/*!
+ *  @brief This API is used to configure the real-time tuning of the USB threads.
+ *         Takes effect on the next usb_open_device().
+ *
+ *  @param[in] rt_config : real-time configuration
+ *
+ *  @return Result of API execution status
+ *  @retval 0 -> Success
+ *  @retval Any non zero value -> Fail
+ */
+int16_t usb_config_realtime(const struct coines_rt_config *rt_config);
+
+/*!
+ *  @brief This API is used to get the real-time tuning applied by the last usb_open_device()
+ *
+ *  @param[out] rt_status : requested and applied tunings
+ *
+ *  @return Result of API execution status
+ *  @retval 0 -> Success
+ *  @retval Any non zero value -> Fail
+ */
+int16_t usb_get_realtime_status(struct coines_rt_status *rt_status);
+
+/*!
+ *  @brief This API is used to replace the USB hardware by another transport.
+ *         Takes effect on the next usb_open_device().
+ *
+ *  @param[in] transport : transport to use, NULL to go back to the USB hardware
+ *
+ *  @return Result of API execution status
+ *  @retval 0 -> Success
+ *  @retval Any non zero value -> Fail
+ */
+int16_t usb_set_transport(const usb_transport_t *transport);
+
 #endif /* COMM_DRIVER_USB_H_ */
 
 /** @}*/
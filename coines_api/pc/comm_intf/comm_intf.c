@@ -27,7 +27,11 @@
 #include "comm_intf.h"
 #include "comm_ringbuffer.h"
 #include "usb.h"
+#include "usb_capture.h"
+#include "usb_replay.h"
+#include "usb_sim.h"
 #include "mutex_port.h"
+#include "comm_trace.h"
 
 /*********************************************************************/
 /* global variables */
@@ -61,6 +65,9 @@ static comm_ringbuffer_t* rb_stream_rsp_p[COINES_MAX_SENSOR_COUNT];
 static comm_ringbuffer_t* rb_gpio_rsp_p;
 static comm_ringbuffer_t* rb_non_stream_rsp_p;
 
+/*! Pre-fault the ringbuffers on the next open */
+static uint8_t comm_intf_prefault_buffers = 0;
+
 /*********************************************************************/
 /* local macro definitions */
 /*********************************************************************/
@@ -116,6 +123,17 @@ int16_t comm_intf_open(enum coines_comm_intf intf_type, coines_board_t* board_ty
             if (!rb_gpio_rsp_p)
                 return COINES_E_MEMORY_ALLOCATION;
 
+            if (comm_intf_prefault_buffers)
+            {
+                /* The event thread writes into these, a page fault there delays the next transfer */
+                for (idx = 0; idx < COINES_MAX_SENSOR_COUNT; idx++)
+                {
+                    comm_ringbuffer_prefault(rb_stream_rsp_p[idx]);
+                }
+                comm_ringbuffer_prefault(rb_non_stream_rsp_p);
+                comm_ringbuffer_prefault(rb_gpio_rsp_p);
+            }
+
             /* init pthread objects */
             mutex_init(&comm_intf_thread_mutex);
             mutex_init(&comm_intf_non_stream_buff_mutex);
@@ -181,6 +199,100 @@ void comm_intf_close(enum coines_comm_intf intf_type)
     }
 }
 
+/*!
+ * @brief This API is used to configure the real-time tuning of the communication threads
+ */
+int16_t comm_intf_config_realtime(const struct coines_rt_config *rt_config)
+{
+    int16_t rslt;
+
+    rslt = usb_config_realtime(rt_config);
+    if (rslt == COINES_SUCCESS)
+    {
+        comm_intf_prefault_buffers = rt_config->prefault_buffers;
+    }
+
+    return rslt;
+}
+
+/*!
+ * @brief This API is used to get the real-time tuning applied on the last open
+ */
+int16_t comm_intf_get_realtime_status(struct coines_rt_status *rt_status)
+{
+    return usb_get_realtime_status(rt_status);
+}
+
+/*!
+ * @brief This API is used to start capturing the traffic with the board
+ */
+int16_t comm_intf_start_capture(const char *file_path)
+{
+    return usb_capture_start(file_path);
+}
+
+/*!
+ * @brief This API is used to stop capturing the traffic with the board
+ */
+int16_t comm_intf_stop_capture(struct coines_capture_status *status)
+{
+    return usb_capture_stop(status);
+}
+
+/*!
+ * @brief This API is used to select the capture played back in place of the board
+ */
+int16_t comm_intf_config_replay(const char *file_path, enum coines_replay_timing timing)
+{
+    int16_t rslt;
+
+    if (is_interface_usb_init)
+        return COINES_E_FAILURE;
+
+    rslt = usb_replay_load(file_path, timing);
+    if (rslt == COINES_SUCCESS)
+    {
+        rslt = usb_set_transport((file_path != NULL) ? &usb_replay_transport : NULL);
+    }
+
+    return rslt;
+}
+
+/*!
+ * @brief This API is used to get the comparison between sent and recorded commands
+ */
+int16_t comm_intf_get_replay_status(struct coines_replay_status *status)
+{
+    return usb_replay_get_status(status);
+}
+
+/*!
+ * @brief This API is used to select the simulated board used in place of the board
+ */
+int16_t comm_intf_config_simulation(const struct coines_sim_config *config)
+{
+    int16_t rslt;
+
+    if (is_interface_usb_init)
+        return COINES_E_FAILURE;
+
+    rslt = usb_sim_config(config);
+    if (rslt == COINES_SUCCESS)
+    {
+        rslt = usb_set_transport((config != NULL) ? &usb_sim_transport : NULL);
+    }
+
+    return rslt;
+}
+
+/*!
+ * @brief This API is used to get the statistics of the simulated board
+ */
+int16_t comm_intf_get_simulation_status(struct coines_sim_status *status)
+{
+    return usb_sim_get_status(status);
+}
+
 /*!
  * @brief This API is used as a data receive callback
  *
@@ -191,7 +303,9 @@ void comm_intf_close(enum coines_comm_intf intf_type)
 static void comm_intf_data_receive_call_back(usb_rsp_buffer_t* rsp_buf)
 {
     mutex_lock(&comm_intf_thread_mutex);
+    COMM_TRACE_BEGIN(COMM_TRACE_PARSE, rsp_buf->buffer_size);
     comm_intf_parse_received_data(rsp_buf);
+    COMM_TRACE_END(COMM_TRACE_PARSE, rsp_buf->buffer_size);
     mutex_unlock(&comm_intf_thread_mutex);
 }
 
@@ -200,6 +314,7 @@ static void comm_intf_data_receive_call_back(usb_rsp_buffer_t* rsp_buf)
  */
 void comm_intf_init_command_header(uint8_t cmd_type, uint8_t int_feature)
 {
+    COMM_TRACE_BEGIN(COMM_TRACE_CMD_ENCODE, cmd_type);
     comm_buf.buffer[0] = COINES_CMD_ID;
     comm_buf.buffer[1] = 0;
     comm_buf.buffer[2] = cmd_type;
@@ -248,6 +363,7 @@ int16_t comm_intf_send_command(coines_rsp_buffer_t* rsp_buf)
     comm_intf_put_u8('\r');
     comm_intf_put_u8('\n');
     comm_buf.buffer[1] = comm_buf.buffer_size;
+    COMM_TRACE_END(COMM_TRACE_CMD_ENCODE, comm_buf.buffer_size);
     rslt = usb_send_command(&comm_buf);
 
     if (rsp_buf == NULL)
@@ -296,6 +412,7 @@ int16_t comm_intf_process_non_streaming_response(coines_rsp_buffer_t * rsp_buf)
     uint32_t retry_count = COMM_INTF_RETRY_COUNT;
 
     mutex_lock(&comm_intf_non_stream_buff_mutex);
+    COMM_TRACE_BEGIN(COMM_TRACE_RSP_WAIT, 0);
 
     while (retry_count > 0)
     {
@@ -318,6 +435,8 @@ int16_t comm_intf_process_non_streaming_response(coines_rsp_buffer_t * rsp_buf)
         }
     }
 
+    COMM_TRACE_END(COMM_TRACE_RSP_WAIT, COMM_INTF_RETRY_COUNT - retry_count);
+
     if (rsp_buf->buffer_size == 0)
         rslt = COINES_E_FAILURE;
 
@@ -342,6 +461,7 @@ int16_t comm_intf_process_stream_response(uint8_t sensor_id, uint32_t no_ofsampl
         return COINES_E_NOT_SUPPORTED;
 
     mutex_lock(&comm_intf_stream_buff_mutex);
+    COMM_TRACE_BEGIN(COMM_TRACE_RSP_WAIT, sensor_id);
 
     /* wait for data */
     while (retry_count > 0)
@@ -353,6 +473,7 @@ int16_t comm_intf_process_stream_response(uint8_t sensor_id, uint32_t no_ofsampl
         comm_intf_delay(1);
         retry_count--;
     }
+    COMM_TRACE_END(COMM_TRACE_RSP_WAIT, COMM_INTF_STREAMING_RETRY_COUNT - retry_count);
 
     /* if any data came before wait period expired, then process it, else return error */
     if (rb_stream_rsp_p[sensor_id - 1]->packetCounter > 0)
@@ -41,6 +41,12 @@ typedef struct
     uint16_t sensors_byte_count[COINES_MAX_SENSOR_COUNT]; /**< Sensor byte count */
 } comm_stream_info_t;
 
+/**********************************************************************************/
+/* global variables */
+/**********************************************************************************/
+/*! Streaming info, defined in comm_intf.c */
+extern comm_stream_info_t comm_intf_sensor_info;
+
 /**********************************************************************************/
 /* function prototype declarations */
 /*!
@@ -144,6 +150,96 @@ void comm_intf_delay(uint32_t delay_ms);
  *  @return void
  */
 int16_t comm_intf_process_non_streaming_response(coines_rsp_buffer_t* rsp_buf);
+
+/*!
+ *  @brief This API is used to configure the real-time tuning of the communication threads.
+ *         Takes effect on the next comm_intf_open().
+ *
+ *  @param[in] rt_config   :  real-time configuration
+ *
+ *  @return Result of API execution status
+ *  @retval zero -> Success
+ *  @retval Negative value -> Error
+ */
+int16_t comm_intf_config_realtime(const struct coines_rt_config *rt_config);
+
+/*!
+ *  @brief This API is used to get the real-time tuning applied on the last comm_intf_open()
+ *
+ *  @param[out] rt_status   :  requested and applied tunings
+ *
+ *  @return Result of API execution status
+ *  @retval zero -> Success
+ *  @retval Negative value -> Error
+ */
+int16_t comm_intf_get_realtime_status(struct coines_rt_status *rt_status);
+
+/*!
+ *  @brief This API is used to start capturing the traffic with the board
+ *
+ *  @param[in] file_path   :  capture file
+ *
+ *  @return Result of API execution status
+ *  @retval zero -> Success
+ *  @retval Negative value -> Error
+ */
+int16_t comm_intf_start_capture(const char *file_path);
+
+/*!
+ *  @brief This API is used to stop capturing the traffic with the board
+ *
+ *  @param[out] status   :  capture statistics, can be NULL
+ *
+ *  @return Result of API execution status
+ *  @retval zero -> Success
+ *  @retval Negative value -> Error
+ */
+int16_t comm_intf_stop_capture(struct coines_capture_status *status);
+
+/*!
+ *  @brief This API is used to select the capture played back in place of the board on the next comm_intf_open()
+ *
+ *  @param[in] file_path   :  capture file, NULL to use the board
+ *  @param[in] timing      :  pacing of the recorded responses
+ *
+ *  @return Result of API execution status
+ *  @retval zero -> Success
+ *  @retval Negative value -> Error
+ */
+int16_t comm_intf_config_replay(const char *file_path, enum coines_replay_timing timing);
+
+/*!
+ *  @brief This API is used to get the comparison between sent and recorded commands
+ *
+ *  @param[out] status   :  replay statistics
+ *
+ *  @return Result of API execution status
+ *  @retval zero -> Success
+ *  @retval Negative value -> Error
+ */
+int16_t comm_intf_get_replay_status(struct coines_replay_status *status);
+
+/*!
+ *  @brief This API is used to select the simulated board used in place of the board on the next comm_intf_open()
+ *
+ *  @param[in] config   :  simulated board, NULL to use the board
+ *
+ *  @return Result of API execution status
+ *  @retval zero -> Success
+ *  @retval Negative value -> Error
+ */
+int16_t comm_intf_config_simulation(const struct coines_sim_config *config);
+
+/*!
+ *  @brief This API is used to get the statistics of the simulated board
+ *
+ *  @param[out] status   :  simulation statistics
+ *
+ *  @return Result of API execution status
+ *  @retval zero -> Success
+ *  @retval Negative value -> Error
+ */
+int16_t comm_intf_get_simulation_status(struct coines_sim_status *status);
 #endif /* COMM_INTF_COMM_INTF_H_ */
 
 /** @}*/
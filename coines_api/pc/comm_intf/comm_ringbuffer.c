@@ -19,12 +19,16 @@
 #include "comm_ringbuffer.h"
 #include "coines.h"
 #include "coines_defs.h"
+#include "comm_trace.h"
 #include "stdlib.h"
+#include "string.h"
 
 #define CHECK_WRAPAROUND_READ(rb)		if ((rb)->Rptr == (rb)->Base + (rb)->Size) 	{ (rb)->Rptr = (rb)->Base; }
 #define CHECK_WRAPAROUND_WRITE(rb)		if ((rb)->Wptr == (rb)->Base + (rb)->Size) 	{ (rb)->Wptr = (rb)->Base; }
 
 static const uint8_t packet_delimiter[4] = { 0x22, 0x06, 0x19, 0x93 };
+
+static uint32_t comm_ringbuffer_read_packets(comm_ringbuffer_t * rbuf, uint8_t *buffer, uint32_t packet_count);
 /**********************************************************************************/
 /* functions */
 /**********************************************************************************/
@@ -134,6 +138,7 @@ int8_t comm_ringbuffer_write_packet(comm_ringbuffer_t* rbuf, const uint8_t *buff
 
         int8_t ret_val = COINES_SUCCESS;
 
+        COMM_TRACE_BEGIN(COMM_TRACE_RB_WRITE, write_len);
         ret_val += comm_ringbuffer_write(rbuf, buffer, write_len);
         ret_val += comm_ringbuffer_add_delimiter(rbuf);
 
@@ -141,6 +146,7 @@ int8_t comm_ringbuffer_write_packet(comm_ringbuffer_t* rbuf, const uint8_t *buff
         {
             rbuf->packetCounter++;
         }
+        COMM_TRACE_END(COMM_TRACE_RB_WRITE, rbuf->Count);
 
         return ret_val;
     }
@@ -191,6 +197,26 @@ int8_t comm_ringbuffer_pop(comm_ringbuffer_t* rbuf, uint8_t *bt)
  *  @return Result of API execution status
  */
 uint32_t comm_ringbuffer_read(comm_ringbuffer_t * rbuf, uint8_t *buffer, uint32_t packet_count)
+{
+    uint32_t payload_bytes_read;
+
+    COMM_TRACE_BEGIN(COMM_TRACE_RB_READ, packet_count);
+    payload_bytes_read = comm_ringbuffer_read_packets(rbuf, buffer, packet_count);
+    COMM_TRACE_END(COMM_TRACE_RB_READ, payload_bytes_read);
+
+    return payload_bytes_read;
+}
+
+/**
+ *  @brief Reads packets from the ringbuffer, see comm_ringbuffer_read()
+ *
+ *  @param[in] rbuf : Pointer to the ring buffer data structure
+ *  @param[out] buffer : Pointer to the data buffer
+ *  @param[in] packet_count : packet count
+ *
+ *  @return Number of payload bytes read
+ */
+static uint32_t comm_ringbuffer_read_packets(comm_ringbuffer_t * rbuf, uint8_t *buffer, uint32_t packet_count)
 {
     int rslt;
     uint32_t idx_bt = 0, payload_bytes_read = 0;
@@ -274,6 +300,21 @@ void comm_ringbuffer_reset(comm_ringbuffer_t * rbuf)
     }
 }
 
+/**
+ *  @brief Touch every page of the ringbuffer so that the first writes don't page fault
+ *
+ *  @param[in] rbuf : Pointer to the circular buffer data structure
+ *
+ *  @return void
+ */
+void comm_ringbuffer_prefault(comm_ringbuffer_t * rbuf)
+{
+    if ((rbuf != NULL) && (rbuf->Base != NULL))
+    {
+        memset(rbuf->Base, 0, rbuf->Size);
+    }
+}
+
 /**
  *  @brief This API adds delimiter to the ring buffer
  *
@@ -104,5 +104,13 @@ uint32_t comm_ringbuffer_read(comm_ringbuffer_t * rbuf, uint8_t *buffer, uint32_
  *  @return void
  */
 void comm_ringbuffer_reset(comm_ringbuffer_t * rbuf);
+/**
+ *  @brief Touch every page of the ringbuffer so that the first writes don't page fault
+ *
+ *  @param[in] rbuf : Pointer to the circular buffer data structure
+ *
+ *  @return void
+ */
+void comm_ringbuffer_prefault(comm_ringbuffer_t * rbuf);
 
 #endif /* COMM_INTF_COMM_RINGBUFFER_H_ */
@@ -0,0 +1,288 @@
+/**
+ * Copyright (C) 2018 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    comm_trace.c
+ * @brief   This file records the hot path trace points and exports them as Chrome trace_event JSON.
+ *          Every thread owns one ring buffer, which is allocated on its first trace entry and
+ *          linked into a global list without taking a lock. Only the owning thread writes to
+ *          a buffer, the exporter reads it.
+ *
+ */
+
+/*!
+ * @defgroup comm_trace_api comm_trace
+ * @{*/
+
+/*********************************************************************/
+/* system header files */
+/*********************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#ifdef PLATFORM_WINDOWS
+#include <windows.h>
+#endif
+
+/*********************************************************************/
+/* own header files */
+/*********************************************************************/
+#include "coines_defs.h"
+#include "comm_trace.h"
+#include "usb_capture.h"
+
+#if defined(COINES_TRACE)
+
+/*********************************************************************/
+/* local macro definitions */
+/*********************************************************************/
+#if defined(_MSC_VER)
+#define COMM_TRACE_TLS                        __declspec(thread)
+#define COMM_TRACE_LOAD(ptr)                  (*(volatile uint32_t *)(ptr))
+#define COMM_TRACE_STORE(ptr, val)            (*(volatile uint32_t *)(ptr) = (val))
+#define COMM_TRACE_LOAD_PTR(ptr)              (*(comm_trace_buf_t * volatile *)(ptr))
+#define COMM_TRACE_CAS_PTR(ptr, expected, desired) \
+    (InterlockedCompareExchangePointer((PVOID volatile *)(ptr), (desired), (expected)) == (expected))
+#else
+#define COMM_TRACE_TLS                        __thread
+#define COMM_TRACE_LOAD(ptr)                  __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define COMM_TRACE_STORE(ptr, val)            __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#define COMM_TRACE_LOAD_PTR(ptr)              __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define COMM_TRACE_CAS_PTR(ptr, expected, desired) \
+    __atomic_compare_exchange_n((ptr), &(expected), (desired), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#endif
+
+#define COMM_TRACE_BUF_MASK                   (COMM_TRACE_BUF_ENTRIES - 1)
+
+/*********************************************************************/
+/* local data structure declarations */
+/*********************************************************************/
+/*!
+ * @brief One trace entry
+ */
+typedef struct
+{
+    uint64_t timestamp_ns; /**< usb_capture_timestamp_ns() at the trace point */
+    uint32_t arg; /**< event specific argument */
+    uint16_t event; /**< enum comm_trace_event */
+    uint8_t phase; /**< COMM_TRACE_PHASE_xxx */
+    uint8_t reserved;
+} comm_trace_entry_t;
+
+/*!
+ * @brief Per thread trace buffer
+ */
+typedef struct comm_trace_buf
+{
+    struct comm_trace_buf *next; /**< next buffer in comm_trace_buf_list */
+    const char *name; /**< thread name or NULL */
+    uint32_t tid; /**< thread index in the exported trace */
+    uint32_t head; /**< entries written, only the owner thread writes it */
+    uint32_t start; /**< first entry still valid after comm_trace_reset() */
+    comm_trace_entry_t entries[COMM_TRACE_BUF_ENTRIES];
+} comm_trace_buf_t;
+
+/*********************************************************************/
+/* static variables */
+/*********************************************************************/
+/*! Buffer of the calling thread */
+static COMM_TRACE_TLS comm_trace_buf_t *comm_trace_thread_buf;
+/*! All buffers, buffers are kept until the process exits */
+static comm_trace_buf_t *comm_trace_buf_list;
+/*! Set if a buffer could not be allocated */
+static volatile uint8_t comm_trace_alloc_failed;
+
+/*! Event names, indexed by enum comm_trace_event */
+static const char * const comm_trace_event_names[COMM_TRACE_EVENT_COUNT] = {
+    [COMM_TRACE_API_READ] = "api_read",
+    [COMM_TRACE_API_WRITE] = "api_write",
+    [COMM_TRACE_API_STREAM_READ] = "api_stream_read",
+    [COMM_TRACE_CMD_ENCODE] = "cmd_encode",
+    [COMM_TRACE_USB_OUT] = "usb_bulk_out",
+    [COMM_TRACE_USB_IN] = "usb_in_callback",
+    [COMM_TRACE_PARSE] = "parse",
+    [COMM_TRACE_RB_WRITE] = "ringbuffer_write",
+    [COMM_TRACE_RB_READ] = "ringbuffer_read",
+    [COMM_TRACE_RSP_WAIT] = "response_wait",
+    [COMM_TRACE_COPY_OUT] = "copy_out",
+};
+
+/*********************************************************************/
+/* static function declarations */
+/*********************************************************************/
+static comm_trace_buf_t *comm_trace_get_buf(void);
+
+/*********************************************************************/
+/* functions */
+/*********************************************************************/
+
+/*!
+ * @brief This API returns the buffer of the calling thread, allocating it on first use
+ */
+static comm_trace_buf_t *comm_trace_get_buf(void)
+{
+    comm_trace_buf_t *buf = comm_trace_thread_buf;
+    comm_trace_buf_t *head;
+
+    if (buf != NULL)
+        return buf;
+
+    buf = (comm_trace_buf_t *)calloc(1, sizeof(comm_trace_buf_t));
+    if (buf == NULL)
+    {
+        comm_trace_alloc_failed = 1;
+        return NULL;
+    }
+
+    do
+    {
+        head = COMM_TRACE_LOAD_PTR(&comm_trace_buf_list);
+        buf->next = head;
+        buf->tid = (head == NULL) ? 1 : head->tid + 1;
+    } while (!COMM_TRACE_CAS_PTR(&comm_trace_buf_list, head, buf));
+
+    comm_trace_thread_buf = buf;
+
+    return buf;
+}
+
+/*!
+ * @brief This API records a trace entry into the ring buffer of the calling thread
+ */
+void comm_trace_record(enum comm_trace_event event, uint8_t phase, uint32_t arg)
+{
+    comm_trace_buf_t *buf = comm_trace_get_buf();
+    comm_trace_entry_t *entry;
+    uint32_t head;
+
+    if (buf == NULL)
+        return;
+
+    head = buf->head;
+    entry = &buf->entries[head & COMM_TRACE_BUF_MASK];
+    entry->timestamp_ns = usb_capture_timestamp_ns();
+    entry->arg = arg;
+    entry->event = (uint16_t)event;
+    entry->phase = phase;
+    COMM_TRACE_STORE(&buf->head, head + 1);
+}
+
+/*!
+ * @brief This API names the calling thread in the exported trace
+ */
+void comm_trace_thread_name(const char *name)
+{
+    comm_trace_buf_t *buf = comm_trace_get_buf();
+
+    if (buf != NULL)
+        buf->name = name;
+}
+
+/*!
+ * @brief This API discards all recorded entries
+ */
+int16_t comm_trace_reset(void)
+{
+    comm_trace_buf_t *buf;
+
+    for (buf = COMM_TRACE_LOAD_PTR(&comm_trace_buf_list); buf != NULL; buf = buf->next)
+        COMM_TRACE_STORE(&buf->start, COMM_TRACE_LOAD(&buf->head));
+
+    comm_trace_alloc_failed = 0;
+
+    return COINES_SUCCESS;
+}
+
+/*!
+ * @brief This API writes the recorded entries as Chrome trace_event JSON
+ */
+int16_t comm_trace_export_chrome(const char *file_path)
+{
+    FILE *file;
+    comm_trace_buf_t *buf;
+    uint64_t origin_ns = UINT64_MAX;
+    uint32_t head, first, i;
+    const char *separator = "";
+
+    if (file_path == NULL)
+        return COINES_E_NULL_PTR;
+
+    file = fopen(file_path, "w");
+    if (file == NULL)
+        return COINES_E_FAILURE;
+
+    /* Timestamps are exported relative to the oldest entry to keep the numbers short */
+    for (buf = COMM_TRACE_LOAD_PTR(&comm_trace_buf_list); buf != NULL; buf = buf->next)
+    {
+        head = COMM_TRACE_LOAD(&buf->head);
+        first = COMM_TRACE_LOAD(&buf->start);
+        if ((head - first) > COMM_TRACE_BUF_ENTRIES)
+            first = head - COMM_TRACE_BUF_ENTRIES;
+        if ((head != first) && (buf->entries[first & COMM_TRACE_BUF_MASK].timestamp_ns < origin_ns))
+            origin_ns = buf->entries[first & COMM_TRACE_BUF_MASK].timestamp_ns;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    for (buf = COMM_TRACE_LOAD_PTR(&comm_trace_buf_list); buf != NULL; buf = buf->next)
+    {
+        fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                separator, (unsigned)buf->tid, (buf->name != NULL) ? buf->name : "thread");
+        separator = ",";
+
+        head = COMM_TRACE_LOAD(&buf->head);
+        first = COMM_TRACE_LOAD(&buf->start);
+        if ((head - first) > COMM_TRACE_BUF_ENTRIES)
+            first = head - COMM_TRACE_BUF_ENTRIES;
+
+        for (i = first; i != head; i++)
+        {
+            const comm_trace_entry_t *entry = &buf->entries[i & COMM_TRACE_BUF_MASK];
+            uint64_t ts_ns = entry->timestamp_ns - origin_ns;
+
+            if (entry->event >= COMM_TRACE_EVENT_COUNT)
+                continue;
+
+            fprintf(file,
+                    ",\n{\"name\":\"%s\",\"cat\":\"coines\",\"ph\":\"%c\",%s\"ts\":%llu.%03u,\"pid\":1,\"tid\":%u,"
+                    "\"args\":{\"arg\":%lu}}",
+                    comm_trace_event_names[entry->event],
+                    entry->phase,
+                    (entry->phase == COMM_TRACE_PHASE_INSTANT) ? "\"s\":\"t\"," : "",
+                    (unsigned long long)(ts_ns / 1000),
+                    (unsigned)(ts_ns % 1000),
+                    (unsigned)buf->tid,
+                    (unsigned long)entry->arg);
+        }
+    }
+    fprintf(file, "\n]}\n");
+
+    if (fclose(file) != 0)
+        return COINES_E_FAILURE;
+
+    return comm_trace_alloc_failed ? COINES_E_MEMORY_ALLOCATION : COINES_SUCCESS;
+}
+
+#else /* COINES_TRACE */
+
+/*!
+ * @brief Trace points are compiled out, nothing to reset
+ */
+int16_t comm_trace_reset(void)
+{
+    return COINES_E_NOT_SUPPORTED;
+}
+
+/*!
+ * @brief Trace points are compiled out, nothing to export
+ */
+int16_t comm_trace_export_chrome(const char *file_path)
+{
+    (void)file_path;
+
+    return COINES_E_NOT_SUPPORTED;
+}
+
+#endif /* COINES_TRACE */
+
+/** @}*/
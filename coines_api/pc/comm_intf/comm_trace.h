@@ -0,0 +1,123 @@
+/**
+ * Copyright (C) 2018 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    comm_trace.h
+ * @brief   This file contains the hot path trace points of the host communication stack.
+ *
+ * Trace points compile to nothing unless COINES_TRACE is defined. When enabled, each thread
+ * records (timestamp, event, phase, argument) entries into its own lock-free ring buffer, which
+ * keeps the most recent COMM_TRACE_BUF_ENTRIES entries. comm_trace_export_chrome() writes all
+ * buffers as Chrome trace_event JSON (chrome://tracing, Perfetto).
+ *
+ */
+
+/*!
+ * @addtogroup comm_trace_api
+ * @{*/
+
+#ifndef COMM_INTF_COMM_TRACE_H_
+#define COMM_INTF_COMM_TRACE_H_
+
+/**********************************************************************************/
+/* header includes */
+/**********************************************************************************/
+#include <stdint.h>
+
+/**********************************************************************************/
+/* macro definitions */
+/**********************************************************************************/
+/*! Entries kept per thread, must be a power of 2 */
+#define COMM_TRACE_BUF_ENTRIES      UINT32_C(65536)
+
+/*! Trace entry phase - begin of a duration */
+#define COMM_TRACE_PHASE_BEGIN      UINT8_C('B')
+/*! Trace entry phase - end of a duration */
+#define COMM_TRACE_PHASE_END        UINT8_C('E')
+/*! Trace entry phase - single point in time */
+#define COMM_TRACE_PHASE_INSTANT    UINT8_C('i')
+
+#if defined(COINES_TRACE)
+#define COMM_TRACE_BEGIN(event, arg)     comm_trace_record((event), COMM_TRACE_PHASE_BEGIN, (uint32_t)(arg))
+#define COMM_TRACE_END(event, arg)       comm_trace_record((event), COMM_TRACE_PHASE_END, (uint32_t)(arg))
+#define COMM_TRACE_INSTANT(event, arg)   comm_trace_record((event), COMM_TRACE_PHASE_INSTANT, (uint32_t)(arg))
+#define COMM_TRACE_THREAD_NAME(name)     comm_trace_thread_name(name)
+#else
+#define COMM_TRACE_BEGIN(event, arg)
+#define COMM_TRACE_END(event, arg)
+#define COMM_TRACE_INSTANT(event, arg)
+#define COMM_TRACE_THREAD_NAME(name)
+#endif
+
+/**********************************************************************************/
+/* data structure declarations */
+/**********************************************************************************/
+
+/*!
+ * @brief Trace events, keep in sync with the names in comm_trace.c
+ */
+enum comm_trace_event
+{
+    COMM_TRACE_API_READ, /**< coines_read_i2c()/coines_read_spi() */
+    COMM_TRACE_API_WRITE, /**< coines_write_i2c()/coines_write_spi() */
+    COMM_TRACE_API_STREAM_READ, /**< coines_read_stream_sensor_data() */
+    COMM_TRACE_CMD_ENCODE, /**< command header to comm_intf_send_command() */
+    COMM_TRACE_USB_OUT, /**< bulk OUT transfer of a command */
+    COMM_TRACE_USB_IN, /**< USB IN completion callback */
+    COMM_TRACE_PARSE, /**< comm_intf_parse_received_data() */
+    COMM_TRACE_RB_WRITE, /**< ring buffer packet write */
+    COMM_TRACE_RB_READ, /**< ring buffer packet read */
+    COMM_TRACE_RSP_WAIT, /**< waiting for a non streaming response */
+    COMM_TRACE_COPY_OUT, /**< copy of the response to the caller's buffer */
+    COMM_TRACE_EVENT_COUNT
+};
+
+/**********************************************************************************/
+/* function declarations */
+/**********************************************************************************/
+
+/*!
+ *  @brief This API records a trace entry into the ring buffer of the calling thread
+ *
+ *  @param[in] event : trace event
+ *  @param[in] phase : COMM_TRACE_PHASE_BEGIN/END/INSTANT
+ *  @param[in] arg   : event specific argument (Eg: byte count)
+ *
+ *  @return void
+ */
+void comm_trace_record(enum comm_trace_event event, uint8_t phase, uint32_t arg);
+
+/*!
+ *  @brief This API names the calling thread in the exported trace
+ *
+ *  @param[in] name : thread name, must stay valid until the export
+ *
+ *  @return void
+ */
+void comm_trace_thread_name(const char *name);
+
+/*!
+ *  @brief This API discards all recorded entries
+ *
+ *  @return Result of API execution status
+ *  @retval 0 -> Success
+ *  @retval Any non zero value -> Fail
+ */
+int16_t comm_trace_reset(void);
+
+/*!
+ *  @brief This API writes the recorded entries as Chrome trace_event JSON.
+ *         Entries recorded while exporting may be missing or torn.
+ *
+ *  @param[in] file_path : output file
+ *
+ *  @return Result of API execution status
+ *  @retval 0 -> Success
+ *  @retval Any non zero value -> Fail
+ */
+int16_t comm_trace_export_chrome(const char *file_path);
+
+#endif /* COMM_INTF_COMM_TRACE_H_ */
+
+/** @}*/
@@ -12,6 +12,7 @@
 
 #ifdef PLATFORM_WINDOWS
 #include <windows.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -26,7 +27,7 @@ typedef CRITICAL_SECTION mutex_t;
  *
  * @return void
  */
-static void mutex_lock(mutex_t *mutex)
+static inline void mutex_lock(mutex_t *mutex)
 {
     EnterCriticalSection(mutex);
 }
@@ -38,7 +39,7 @@ static void mutex_lock(mutex_t *mutex)
  *
  * @return void
  */
-static void mutex_unlock(mutex_t *mutex)
+static inline void mutex_unlock(mutex_t *mutex)
 {
     LeaveCriticalSection(mutex);
 }
@@ -49,7 +50,7 @@ static void mutex_unlock(mutex_t *mutex)
  *
  * @return void
  */
-static void mutex_init(mutex_t *mutex)
+static inline void mutex_init(mutex_t *mutex)
 {
     InitializeCriticalSection(mutex);
 }
@@ -60,11 +61,59 @@ static void mutex_init(mutex_t *mutex)
  *
  * @return void
  */
-static void mutex_destroy(mutex_t *mutex)
+static inline void mutex_destroy(mutex_t *mutex)
 {
     DeleteCriticalSection(mutex);
 }
 
+typedef CONDITION_VARIABLE cond_t;
+/*!
+ * @brief API to initiate condition variable
+ *
+ * @param	: Pointer to the condition variable
+ *
+ * @return void
+ */
+static inline void cond_init(cond_t *cond)
+{
+    InitializeConditionVariable(cond);
+}
+/*!
+ * @brief API to wait on a condition variable with the mutex locked
+ *
+ * @param	: Pointer to the condition variable
+ * @param	: Pointer to the locked mutex
+ * @param	: Timeout in microseconds
+ *
+ * @return void
+ */
+static inline void cond_wait_timeout(cond_t *cond, mutex_t *mutex, uint32_t timeout_us)
+{
+    SleepConditionVariableCS(cond, mutex, (timeout_us + 999) / 1000);
+}
+/*!
+ * @brief API to wake up a thread waiting on the condition variable
+ *
+ * @param	: Pointer to the condition variable
+ *
+ * @return void
+ */
+static inline void cond_signal(cond_t *cond)
+{
+    WakeConditionVariable(cond);
+}
+/*!
+ * @brief API to destroy condition variable
+ *
+ * @param	: Pointer to the condition variable
+ *
+ * @return void
+ */
+static inline void cond_destroy(cond_t *cond)
+{
+    (void)cond;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -73,6 +122,8 @@ static void mutex_destroy(mutex_t *mutex)
 
 #ifdef PLATFORM_LINUX
 #include <pthread.h>
+#include <stdint.h>
+#include <time.h>
 #include <unistd.h>
 
 typedef pthread_mutex_t mutex_t;
@@ -83,7 +134,7 @@ typedef pthread_mutex_t mutex_t;
  *
  * @return void
  */
-static void mutex_lock(mutex_t *mutex)
+static inline void mutex_lock(mutex_t *mutex)
 {
 pthread_mutex_lock(mutex);
 }
@@ -94,7 +145,7 @@ pthread_mutex_lock(mutex);
  * @param	: Pointer to the mutex
  *
  * @return void
- */static void mutex_unlock(mutex_t *mutex)
+ */static inline void mutex_unlock(mutex_t *mutex)
 {
 pthread_mutex_unlock(mutex);
 }
@@ -105,7 +156,7 @@ pthread_mutex_unlock(mutex);
  *
  * @return void
  */
-static void mutex_init(mutex_t *mutex)
+static inline void mutex_init(mutex_t *mutex)
 {
 pthread_mutex_init(mutex,0);
 }
@@ -116,10 +167,68 @@ pthread_mutex_init(mutex,0);
  *
  * @return void
  */
-static void mutex_destroy(mutex_t *mutex)
+static inline void mutex_destroy(mutex_t *mutex)
 {
 pthread_mutex_destroy(mutex);
 }
+
+typedef pthread_cond_t cond_t;
+/*!
+ * @brief API to initiate condition variable
+ *
+ * @param	: Pointer to the condition variable
+ *
+ * @return void
+ */
+static inline void cond_init(cond_t *cond)
+{
+pthread_cond_init(cond, 0);
+}
+/*!
+ * @brief API to wait on a condition variable with the mutex locked
+ *
+ * @param	: Pointer to the condition variable
+ * @param	: Pointer to the locked mutex
+ * @param	: Timeout in microseconds
+ *
+ * @return void
+ */
+static inline void cond_wait_timeout(cond_t *cond, mutex_t *mutex, uint32_t timeout_us)
+{
+struct timespec abs_time;
+
+clock_gettime(CLOCK_REALTIME, &abs_time);
+abs_time.tv_sec += timeout_us / 1000000;
+abs_time.tv_nsec += (long)(timeout_us % 1000000) * 1000;
+if (abs_time.tv_nsec >= 1000000000L)
+{
+    abs_time.tv_sec++;
+    abs_time.tv_nsec -= 1000000000L;
+}
+pthread_cond_timedwait(cond, mutex, &abs_time);
+}
+/*!
+ * @brief API to wake up a thread waiting on the condition variable
+ *
+ * @param	: Pointer to the condition variable
+ *
+ * @return void
+ */
+static inline void cond_signal(cond_t *cond)
+{
+pthread_cond_signal(cond);
+}
+/*!
+ * @brief API to destroy condition variable
+ *
+ * @param	: Pointer to the condition variable
+ *
+ * @return void
+ */
+static inline void cond_destroy(cond_t *cond)
+{
+pthread_cond_destroy(cond);
+}
 #endif /* COMM_INTF_MUTEX_PORT_H_ */
 
 #endif
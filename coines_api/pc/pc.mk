@@ -9,6 +9,9 @@ endif
 # 0 - False , 1 - True
 ZEUS_QUIRK ?= 0
 
+# 0 - False , 1 - True (hot path trace points, see README)
+TRACE ?= 0
+
 CC     = gcc
 
 CFLAGS ?= -D$(PLATFORM) -c -g -Wall -D$(DRIVER)
@@ -17,13 +20,20 @@ C_SRCS_COINES += \
 coines.c \
 comm_intf/comm_intf.c \
 comm_intf/comm_ringbuffer.c \
+comm_intf/comm_trace.c \
 comm_driver/usb.c \
+comm_driver/capture/usb_capture.c \
+comm_driver/capture/usb_replay.c \
+comm_driver/sim/usb_sim.c \
+comm_driver/sim/usb_sim_regmap.c \
 
 INCLUDEPATHS_COINES += \
 . \
 coines_api \
 comm_intf \
 comm_driver \
+comm_driver/capture \
+comm_driver/sim \
 
 ifeq ($(DRIVER),LEGACY_USB_DRIVER)
 C_SRCS_COINES += comm_driver/legacy_usb/legacy_usb_support.c
@@ -38,4 +48,8 @@ ifneq ($(ZEUS_QUIRK),0)
 C_SRCS_COINES += quirks/zeus.c
 INCLUDEPATHS_COINES += quirks
 CFLAGS += -D ZEUS_QUIRK
-endif
\ No newline at end of file
+endif
+
+ifneq ($(TRACE),0)
+CFLAGS += -D COINES_TRACE
+endif
@@ -0,0 +1,147 @@
+/**
+ * Copyright (C) 2019 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    app30_async_bus_bench.c
+ * @brief   Measures the CPU time left free by the asynchronous sensor bus API during a FIFO read
+ *
+ * A 4 KB FIFO burst read is done with the blocking API and then with the asynchronous API.
+ * While the asynchronous transfer runs, the CPU counts idle loops, which are compared with
+ * the number of loops it executes per millisecond when the bus is not used.
+ * The results are printed on the USB serial port.
+ *
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "coines.h"
+
+/* Sensor under test, defaults match a BMI160 on the mini shuttle */
+#ifndef BENCH_USE_I2C
+#define BENCH_USE_I2C           0
+#endif
+#define BENCH_I2C_ADDR          0x68
+#define BENCH_CS_PIN            COINES_MINI_SHUTTLE_PIN_2_1
+#define BENCH_FIFO_REG          0x24
+#define BENCH_SPI_READ          0x80
+
+#define BENCH_FIFO_SIZE         4096
+#define BENCH_ITERATIONS        50
+#define BENCH_CALIBRATION_MS    200
+
+static uint8_t fifo_data[BENCH_FIFO_SIZE];
+static volatile uint32_t completed = 0;
+
+/*!
+ * @brief Completion callback of the asynchronous reads
+ */
+static void bench_xfer_done(int16_t result, void *context)
+{
+    if (result == COINES_SUCCESS)
+        completed++;
+}
+
+/*!
+ * @brief Counts the idle loops executed in one millisecond
+ */
+static uint32_t bench_loops_per_ms(void)
+{
+    volatile uint32_t loops = 0;
+    uint32_t start;
+
+    /* Align to a millisecond edge */
+    start = coines_get_millis();
+    while (coines_get_millis() == start)
+        ;
+
+    start = coines_get_millis();
+    while ((coines_get_millis() - start) < BENCH_CALIBRATION_MS)
+        loops++;
+
+    return loops / BENCH_CALIBRATION_MS;
+}
+
+/*!
+ * @brief Reads the FIFO with the blocking API
+ */
+static int16_t bench_read_blocking(void)
+{
+#if BENCH_USE_I2C
+    return coines_read_i2c(BENCH_I2C_ADDR, BENCH_FIFO_REG, fifo_data, BENCH_FIFO_SIZE);
+#else
+    return coines_read_spi(BENCH_CS_PIN, BENCH_FIFO_REG | BENCH_SPI_READ, fifo_data, BENCH_FIFO_SIZE);
+#endif
+}
+
+/*!
+ * @brief Starts a FIFO read with the asynchronous API
+ */
+static int16_t bench_read_async(void)
+{
+#if BENCH_USE_I2C
+    return coines_read_i2c_async(BENCH_I2C_ADDR, BENCH_FIFO_REG, fifo_data, BENCH_FIFO_SIZE,
+                                 bench_xfer_done, NULL);
+#else
+    return coines_read_spi_async(BENCH_CS_PIN, BENCH_FIFO_REG | BENCH_SPI_READ, fifo_data, BENCH_FIFO_SIZE,
+                                 bench_xfer_done, NULL);
+#endif
+}
+
+int main(void)
+{
+    uint32_t loops_per_ms;
+    uint32_t start, blocking_ms, async_ms;
+    uint32_t idle_loops = 0;
+    uint32_t errors = 0;
+    int i;
+
+    coines_open_comm_intf(COINES_COMM_INTF_USB);
+    coines_set_shuttleboard_vdd_vddio_config(1800, 1800);
+    coines_delay_msec(200);
+
+#if BENCH_USE_I2C
+    coines_config_i2c_bus(COINES_I2C_BUS_0, COINES_I2C_FAST_MODE);
+#else
+    coines_config_spi_bus(COINES_SPI_BUS_0, COINES_SPI_SPEED_10_MHZ, COINES_SPI_MODE0);
+#endif
+
+    loops_per_ms = bench_loops_per_ms();
+
+    start = coines_get_millis();
+    for (i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        if (bench_read_blocking() != COINES_SUCCESS)
+            errors++;
+    }
+    blocking_ms = coines_get_millis() - start;
+
+    start = coines_get_millis();
+    for (i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        if (bench_read_async() != COINES_SUCCESS)
+        {
+            errors++;
+            continue;
+        }
+
+        /* Work the application could do while EasyDMA moves the data */
+        while (coines_is_xfer_busy())
+            idle_loops++;
+    }
+    async_ms = coines_get_millis() - start;
+
+    printf("FIFO read of %d bytes, %d iterations, %s\r\n", BENCH_FIFO_SIZE, BENCH_ITERATIONS,
+           BENCH_USE_I2C ? "I2C" : "SPI");
+    printf("blocking : %lu ms\r\n", (unsigned long)blocking_ms);
+    printf("async    : %lu ms, %lu completed, %lu errors\r\n", (unsigned long)async_ms,
+           (unsigned long)completed, (unsigned long)errors);
+    if ((loops_per_ms != 0) && (async_ms != 0))
+        printf("CPU free during async read : %lu %%\r\n",
+               (unsigned long)((100ULL * idle_loops) / ((uint64_t)loops_per_ms * async_ms)));
+
+    fflush(stdout);
+    coines_close_comm_intf(COINES_COMM_INTF_USB);
+
+    return 0;
+}
@@ -0,0 +1,80 @@
+/**
+ * Copyright (C) 2019 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    app30_binary_log_bench.c
+ * @brief   Compares the cost of logging a sample with printf and with COINES_LOG
+ *
+ * A sample of 3 floats and a time stamp is logged in bursts that fit the USB serial buffer, so
+ * that only the time spent formatting and buffering is measured, not the USB throughput.
+ * Decode the output with
+ *
+ *     python util/coines_log_decode/coines_log_decode.py build/MCU_APP30/app30_binary_log_bench.elf -p <port>
+ *
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "coines.h"
+#include "coines_log.h"
+
+#define BENCH_BURST             40
+#define BENCH_BURSTS            25
+
+int main(void)
+{
+    uint64_t start, printf_us = 0, log_us = 0;
+    uint32_t printf_bytes = 0;
+    float x, y, z;
+    int burst, i, len;
+
+    coines_open_comm_intf(COINES_COMM_INTF_USB);
+    coines_delay_msec(1000);
+
+    /* Whole lines are handed to the serial port at once, as with the log records */
+    setvbuf(stdout, NULL, _IOFBF, 256);
+
+    for (burst = 0; burst < BENCH_BURSTS; burst++)
+    {
+        start = coines_get_micros();
+        for (i = 0; i < BENCH_BURST; i++)
+        {
+            x = 0.01f * i;
+            y = -9.81f + x;
+            z = 100.0f * x;
+            len = printf("%lu: %.4f %.4f %.4f\r\n", (unsigned long)coines_get_millis(), x, y, z);
+            fflush(stdout);
+            if (len > 0)
+                printf_bytes += (uint32_t)len;
+        }
+        printf_us += coines_get_micros() - start;
+        coines_flush_serial();
+
+        start = coines_get_micros();
+        for (i = 0; i < BENCH_BURST; i++)
+        {
+            x = 0.01f * i;
+            y = -9.81f + x;
+            z = 100.0f * x;
+            COINES_LOG("%lu: %.4f %.4f %.4f\r\n", (unsigned long)coines_get_millis(), x, y, z);
+        }
+        log_us += coines_get_micros() - start;
+        coines_flush_serial();
+    }
+
+    printf("\r\n%d samples each\r\n", BENCH_BURST * BENCH_BURSTS);
+    printf("printf     : %lu ns/sample, %lu bytes/sample\r\n",
+           (unsigned long)((printf_us * 1000) / (BENCH_BURST * BENCH_BURSTS)),
+           (unsigned long)(printf_bytes / (BENCH_BURST * BENCH_BURSTS)));
+    printf("COINES_LOG : %lu ns/sample, %d bytes/sample\r\n",
+           (unsigned long)((log_us * 1000) / (BENCH_BURST * BENCH_BURSTS)),
+           COINES_LOG_HEADER_SIZE + 4 * 4);
+    if (log_us != 0)
+        printf("speed up   : %lu x\r\n", (unsigned long)(printf_us / log_us));
+
+    fflush(stdout);
+    coines_close_comm_intf(COINES_COMM_INTF_USB);
+
+    return 0;
+}
@@ -0,0 +1,70 @@
+/**
+ * Copyright (C) 2019 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    app30_printf_bench.c
+ * @brief   Measures the sustained printf throughput on the USB serial port
+ *
+ * Log lines looking like sensor samples are printed for a fixed duration, as fast as possible.
+ * The throughput is computed once all output has left the board, together with the time
+ * spent in printf, which is the time the sensor loop of an application would lose.
+ * Open the port with a terminal that keeps reading (e.g. redirected to a file).
+ *
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "coines.h"
+
+#define BENCH_DURATION_MS       5000
+#define BENCH_LINE_SIZE_MAX     96
+
+int main(void)
+{
+    uint64_t start, end, call_start, call_us, printf_us = 0, max_call_us = 0;
+    uint32_t lines = 0;
+    uint64_t bytes = 0;
+    int len;
+
+    coines_open_comm_intf(COINES_COMM_INTF_USB);
+    coines_delay_msec(1000);
+
+    /* Line buffered stdout would split the output in one USB transfer per line */
+    setvbuf(stdout, NULL, _IOFBF, BENCH_LINE_SIZE_MAX * 4);
+
+    start = coines_get_micros();
+    while ((coines_get_micros() - start) < (BENCH_DURATION_MS * 1000ULL))
+    {
+        call_start = coines_get_micros();
+        len = printf("%lu,%lu,%d,%d,%d\r\n", (unsigned long)lines, (unsigned long)(call_start - start),
+                     (int)(lines % 2048) - 1024, -(int)(lines % 512), (int)(lines % 16384));
+        call_us = coines_get_micros() - call_start;
+
+        if (len > 0)
+            bytes += (uint64_t)len;
+        printf_us += call_us;
+        if (call_us > max_call_us)
+            max_call_us = call_us;
+        lines++;
+    }
+    fflush(stdout);
+    coines_flush_serial();
+    end = coines_get_micros();
+
+    setvbuf(stdout, NULL, _IOLBF, BENCH_LINE_SIZE_MAX);
+    printf("\r\n%lu lines, %lu bytes in %lu ms\r\n", (unsigned long)lines, (unsigned long)bytes,
+           (unsigned long)((end - start) / 1000));
+    if (end != start)
+        printf("throughput      : %lu KB/s\r\n", (unsigned long)((bytes * 1000000ULL) / ((end - start) * 1024)));
+    if (lines != 0)
+        printf("printf average  : %lu us, max %lu us\r\n", (unsigned long)(printf_us / lines),
+               (unsigned long)max_call_us);
+    if (end != start)
+        printf("time in printf  : %lu %%\r\n", (unsigned long)((100 * printf_us) / (end - start)));
+
+    fflush(stdout);
+    coines_close_comm_intf(COINES_COMM_INTF_USB);
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+/**
+ * Copyright (C) 2019 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    app30_profile_zones.c
+ * @brief   Profiles a few code paths with COINES_PROFILE_BEGIN/END zones
+ *
+ * The statistics are dumped when 'p' is received on the USB serial port and cleared on 'r'.
+ * Print them with
+ *
+ *     python util/coines_profile/coines_profile.py -p <port>
+ *
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "coines.h"
+#include "coines_profile.h"
+
+#define BLOCK_SIZE      1024
+
+static uint8_t src[BLOCK_SIZE];
+static uint8_t dst[BLOCK_SIZE];
+static volatile float filtered;
+
+/*!
+ * @brief Filters a sample, stands for the application processing
+ */
+static float filter_sample(float sample)
+{
+    static float state = 0.0f;
+
+    state += 0.1f * (sample - state);
+
+    return state;
+}
+
+/*!
+ * @brief Handles the commands received on the serial port
+ */
+static void handle_commands(void)
+{
+    while (coines_serial_rx_available())
+    {
+        switch (getchar())
+        {
+            case 'p':
+                coines_profile_dump();
+                break;
+            case 'r':
+                coines_profile_reset();
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+int main(void)
+{
+    uint32_t loop = 0;
+
+    coines_open_comm_intf(COINES_COMM_INTF_USB);
+    memset(src, 0x5A, sizeof(src));
+
+    while (1)
+    {
+        COINES_PROFILE_BEGIN(main_loop);
+
+        COINES_PROFILE_BEGIN(memcpy_1k);
+        memcpy(dst, src, sizeof(dst));
+        COINES_PROFILE_END(memcpy_1k);
+
+        COINES_PROFILE_BEGIN(filter);
+        filtered = filter_sample((float)(loop % 100));
+        COINES_PROFILE_END(filter);
+
+        COINES_PROFILE_BEGIN(get_micros);
+        (void)coines_get_micros();
+        COINES_PROFILE_END(get_micros);
+
+        COINES_PROFILE_BEGIN(delay_10us);
+        coines_delay_usec(10);
+        COINES_PROFILE_END(delay_10us);
+
+        handle_commands();
+        loop++;
+
+        COINES_PROFILE_END(main_loop);
+    }
+
+    return 0;
+}
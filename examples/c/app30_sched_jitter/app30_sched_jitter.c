@@ -0,0 +1,108 @@
+/**
+ * Copyright (C) 2019 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    app30_sched_jitter.c
+ * @brief   Measures the wake up jitter of the cooperative scheduler
+ *
+ * A 1.6 kHz task (sensor ODR) and a 100 Hz task run from coines_sched_dispatch(). Each records
+ * the delay between its deadline and the start of its callback. Every second the min/max/mean
+ * jitter and the number of missed runs are printed on the USB serial port and cleared.
+ *
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "coines.h"
+
+/*!
+ * @brief Jitter statistics of a task
+ */
+struct jitter_stats
+{
+    const char *name;
+    struct coines_sched_task task;
+    uint32_t runs;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t missed;
+};
+
+static struct jitter_stats odr_1600hz = { "1600 Hz" };
+static struct jitter_stats odr_100hz = { "100 Hz" };
+static struct coines_sched_task report_task;
+
+/*!
+ * @brief Clears the statistics of a task
+ */
+static void stats_clear(struct jitter_stats *stats)
+{
+    stats->runs = 0;
+    stats->min = UINT32_MAX;
+    stats->max = 0;
+    stats->sum = 0;
+    stats->missed = stats->task.missed;
+}
+
+/*!
+ * @brief Periodic task, records how late it started
+ */
+static void measure_jitter(void *context)
+{
+    struct jitter_stats *stats = (struct jitter_stats *)context;
+    uint32_t jitter = (uint32_t)(coines_get_micros() - stats->task.due_us);
+
+    stats->runs++;
+    stats->sum += jitter;
+    if (jitter < stats->min)
+        stats->min = jitter;
+    if (jitter > stats->max)
+        stats->max = jitter;
+}
+
+/*!
+ * @brief Prints the statistics of a task
+ */
+static void stats_print(struct jitter_stats *stats)
+{
+    printf("%-8s runs %5lu  jitter min %4lu  max %4lu  mean %4lu us  missed %lu\r\n",
+           stats->name,
+           (unsigned long)stats->runs,
+           (unsigned long)(stats->runs ? stats->min : 0),
+           (unsigned long)stats->max,
+           (unsigned long)(stats->runs ? (stats->sum / stats->runs) : 0),
+           (unsigned long)(stats->task.missed - stats->missed));
+}
+
+/*!
+ * @brief Once per second, prints and clears the statistics
+ */
+static void report(void *context)
+{
+    (void)context;
+
+    stats_print(&odr_1600hz);
+    stats_print(&odr_100hz);
+    printf("\r\n");
+    stats_clear(&odr_1600hz);
+    stats_clear(&odr_100hz);
+}
+
+int main(void)
+{
+    coines_open_comm_intf(COINES_COMM_INTF_USB);
+
+    stats_clear(&odr_1600hz);
+    stats_clear(&odr_100hz);
+
+    coines_sched_start(&odr_1600hz.task, 1000, 625, measure_jitter, &odr_1600hz);
+    coines_sched_start(&odr_100hz.task, 1000, 10000, measure_jitter, &odr_100hz);
+    coines_sched_start(&report_task, 1000000, 1000000, report, NULL);
+
+    while (1)
+    {
+        coines_sched_dispatch();
+    }
+}
@@ -0,0 +1,87 @@
+/**
+ * Copyright (C) 2019 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    app30_spi_throughput_bench.c
+ * @brief   Measures the sensor SPI FIFO read throughput for each SPI speed
+ *
+ * Speeds up to 10 MHz run on SPIM1 (8 MHz max), 16 MHz and 32 MHz on SPIM3.
+ * The results are printed on the USB serial port.
+ * Only run the 16/32 MHz rows with a sensor that supports these speeds.
+ *
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "coines.h"
+
+/* Sensor under test, defaults match a BMI160 on the mini shuttle */
+#define BENCH_CS_PIN            COINES_MINI_SHUTTLE_PIN_2_1
+#define BENCH_FIFO_REG          0x24
+#define BENCH_SPI_READ          0x80
+
+#define BENCH_FIFO_SIZE         4096
+#define BENCH_ITERATIONS        100
+
+static uint8_t fifo_data[BENCH_FIFO_SIZE];
+
+static const struct
+{
+    enum coines_spi_speed speed;
+    const char *name;
+} bench_speeds[] = {
+    { COINES_SPI_SPEED_1_MHZ, "1 MHz" },
+    { COINES_SPI_SPEED_2_MHZ, "2 MHz" },
+    { COINES_SPI_SPEED_5_MHZ, "4 MHz" },
+    { COINES_SPI_SPEED_10_MHZ, "8 MHz" },
+    { COINES_SPI_SPEED_16_MHZ, "16 MHz" },
+    { COINES_SPI_SPEED_32_MHZ, "32 MHz" },
+};
+
+int main(void)
+{
+    uint32_t start, elapsed_ms, errors;
+    uint32_t bytes = (uint32_t)BENCH_FIFO_SIZE * BENCH_ITERATIONS;
+    size_t idx;
+    int i;
+
+    coines_open_comm_intf(COINES_COMM_INTF_USB);
+    coines_set_shuttleboard_vdd_vddio_config(1800, 1800);
+    coines_delay_msec(200);
+
+    printf("FIFO read of %d bytes, %d iterations\r\n", BENCH_FIFO_SIZE, BENCH_ITERATIONS);
+    printf("speed  , time (ms), throughput (kB/s), errors\r\n");
+
+    for (idx = 0; idx < sizeof(bench_speeds) / sizeof(bench_speeds[0]); idx++)
+    {
+        if (coines_config_spi_bus(COINES_SPI_BUS_0, bench_speeds[idx].speed, COINES_SPI_MODE0) != COINES_SUCCESS)
+        {
+            printf("%-7s, not supported\r\n", bench_speeds[idx].name);
+            continue;
+        }
+
+        errors = 0;
+        start = coines_get_millis();
+        for (i = 0; i < BENCH_ITERATIONS; i++)
+        {
+            if (coines_read_spi(BENCH_CS_PIN, BENCH_FIFO_REG | BENCH_SPI_READ, fifo_data, BENCH_FIFO_SIZE) !=
+                COINES_SUCCESS)
+                errors++;
+        }
+        elapsed_ms = coines_get_millis() - start;
+        if (elapsed_ms == 0)
+            elapsed_ms = 1;
+
+        printf("%-7s, %9lu, %17lu, %lu\r\n",
+               bench_speeds[idx].name,
+               (unsigned long)elapsed_ms,
+               (unsigned long)(bytes / elapsed_ms),
+               (unsigned long)errors);
+    }
+
+    fflush(stdout);
+    coines_close_comm_intf(COINES_COMM_INTF_USB);
+
+    return 0;
+}
@@ -0,0 +1,225 @@
+# -*- coding: utf-8 -*-
+"""
+Copyright (C) 2019 Bosch Sensortec GmbH
+
+SPDX-License-Identifier: BSD-3-Clause
+
+Decoder of the binary log records written by COINES_LOG() (coines_api/coines_log.h)
+
+The format strings are read from the `.coines_log` section of the application ELF file.
+Log records are formatted, any other byte (printf output) is passed through unchanged.
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+LOG_SYNC = 0xA5
+LOG_HEADER_SIZE = 9
+LOG_SECTION = ".coines_log"
+
+# printf conversion: flags, width, precision, length modifier, conversion
+CONVERSION = re.compile(r"%([-+ #0]*)(\d+|\*)?(?:\.(\d+|\*))?(hh|h|ll|l|j|z|t|L|q)?([diouxXcfFeEgGaAsp%])")
+
+
+def read_format_section(elf_path):
+    """Returns the content of the .coines_log section of an ELF file"""
+    with open(elf_path, "rb") as elf_file:
+        elf = elf_file.read()
+
+    if elf[:4] != b"\x7fELF":
+        raise ValueError("%s is not an ELF file" % elf_path)
+
+    is_64 = elf[4] == 2
+    endian = "<" if elf[5] == 1 else ">"
+    if is_64:
+        shoff, = struct.unpack_from(endian + "Q", elf, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + "HHH", elf, 0x3A)
+        sh_format = endian + "IIQQQQIIQQ"
+    else:
+        shoff, = struct.unpack_from(endian + "I", elf, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + "HHH", elf, 0x2E)
+        sh_format = endian + "IIIIIIIIII"
+
+    sections = [struct.unpack_from(sh_format, elf, shoff + i * shentsize) for i in range(shnum)]
+    names_offset = sections[shstrndx][4]
+    for section in sections:
+        name_end = elf.index(b"\0", names_offset + section[0])
+        if elf[names_offset + section[0]:name_end].decode() == LOG_SECTION:
+            return elf[section[4]:section[4] + section[5]]
+
+    raise ValueError("%s has no %s section, was it linked with a COINES linker script ?" % (elf_path, LOG_SECTION))
+
+
+class LogFormat:
+    """Format string prepared for Python formatting"""
+
+    def __init__(self, text):
+        self.pieces = []
+        position = 0
+        for match in CONVERSION.finditer(text):
+            self.pieces.append((text[position:match.start()], None, None))
+            flags, width, precision, length, conversion = match.groups()
+            position = match.end()
+            if conversion == "%":
+                self.pieces.append(("%", None, None))
+                continue
+            if conversion in "sp" or width == "*" or precision == "*":
+                # Not loggable, printed as is
+                self.pieces.append((match.group(0), None, None))
+                continue
+
+            # The size of an integer is in the record, the length modifier is ignored
+            spec = "%" + flags + (width or "") + ("." + precision if precision else "")
+            if conversion in "fFeEgGaA":
+                arg = "f"
+                spec += "f" if conversion in "aA" else conversion
+            else:
+                arg = "i" if conversion in "di" else "I"
+                spec += {"i": "d", "u": "d"}.get(conversion, conversion)
+            self.pieces.append((None, spec, arg))
+        self.pieces.append((text[position:], None, None))
+
+    @staticmethod
+    def arg_format(arg, wide):
+        """Returns the struct format of an argument, wide if it takes 8 bytes"""
+        return "<" + (arg.replace("i", "q").replace("I", "Q") if wide else arg)
+
+    def args_size(self, sizes):
+        """Returns the size of the arguments with the argument sizes byte of a record"""
+        size = 0
+        index = 0
+        for _, spec, arg in self.pieces:
+            if spec is not None:
+                size += struct.calcsize(self.arg_format(arg, (sizes >> index) & 1))
+                index += 1
+        return size
+
+    def format(self, args, sizes):
+        """Formats the raw arguments of a record"""
+        out = []
+        offset = 0
+        index = 0
+        for literal, spec, arg in self.pieces:
+            if spec is None:
+                out.append(literal)
+                continue
+            arg = self.arg_format(arg, (sizes >> index) & 1)
+            index += 1
+            value, = struct.unpack_from(arg, args, offset)
+            offset += struct.calcsize(arg)
+            if spec.endswith("c"):
+                value = chr(value & 0xFF)
+            out.append(spec % value)
+        return "".join(out)
+
+
+class LogDecoder:
+    """Incremental decoder of a byte stream mixing text and log records"""
+
+    def __init__(self, formats, show_time):
+        self.formats = formats
+        self.cache = {}
+        self.show_time = show_time
+        self.pending = b""
+        self.time_high = 0
+        self.last_time = 0
+        self.records = 0
+
+    def lookup(self, fmt_id):
+        """Returns the format of an ID, None if the ID does not start a format string"""
+        if fmt_id in self.cache:
+            return self.cache[fmt_id]
+        log_format = None
+        if fmt_id < len(self.formats) and (fmt_id == 0 or self.formats[fmt_id - 1] == 0):
+            end = self.formats.find(b"\0", fmt_id)
+            if end > fmt_id:
+                log_format = LogFormat(self.formats[fmt_id:end].decode("latin-1"))
+        self.cache[fmt_id] = log_format
+        return log_format
+
+    def feed(self, data):
+        """Decodes the next bytes, returns the text decoded so far"""
+        buf = self.pending + data
+        out = []
+        text_start = 0
+        idx = 0
+        while idx < len(buf):
+            idx = buf.find(bytes([LOG_SYNC]), idx)
+            if idx < 0:
+                idx = len(buf)
+                break
+            if len(buf) - idx < LOG_HEADER_SIZE:
+                break
+            args_size = buf[idx + 1]
+            fmt_id, timestamp, sizes = struct.unpack_from("<HIB", buf, idx + 2)
+            log_format = self.lookup(fmt_id)
+            if log_format is None or log_format.args_size(sizes) != args_size:
+                idx += 1
+                continue
+            if len(buf) - idx < LOG_HEADER_SIZE + args_size:
+                break
+
+            out.append(buf[text_start:idx].decode("latin-1"))
+            args = buf[idx + LOG_HEADER_SIZE:idx + LOG_HEADER_SIZE + args_size]
+            if self.show_time:
+                if timestamp < self.last_time:
+                    self.time_high += 1 << 32
+                self.last_time = timestamp
+                out.append("[%12.6f] " % ((self.time_high + timestamp) / 1e6))
+            out.append(log_format.format(args, sizes))
+            self.records += 1
+            idx += LOG_HEADER_SIZE + args_size
+            text_start = idx
+
+        # Keep a possibly incomplete record for the next call
+        keep = min(idx, len(buf))
+        out.append(buf[text_start:keep].decode("latin-1"))
+        self.pending = buf[keep:]
+        return "".join(out)
+
+    def flush(self):
+        """Returns the bytes left at the end of the stream as text"""
+        text = self.pending.decode("latin-1")
+        self.pending = b""
+        return text
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decodes COINES_LOG() records")
+    parser.add_argument("elf", help="application ELF file")
+    parser.add_argument("input", nargs="?", default="-",
+                        help="captured serial output or log file, - for standard input (default)")
+    parser.add_argument("-p", "--port", help="read from a serial port instead (needs pyserial)")
+    parser.add_argument("-t", "--time", action="store_true", help="prefix records with the board time in s")
+    args = parser.parse_args()
+
+    decoder = LogDecoder(read_format_section(args.elf), args.time)
+
+    if args.port:
+        import serial
+        stream = serial.Serial(args.port, 115200, timeout=0.1)
+    elif args.input == "-":
+        stream = sys.stdin.buffer
+    else:
+        stream = open(args.input, "rb")
+
+    try:
+        while True:
+            data = stream.read(4096) if not args.port else stream.read(max(1, stream.in_waiting))
+            if not data:
+                if args.port:
+                    continue
+                break
+            sys.stdout.write(decoder.feed(data))
+            sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        sys.stdout.write(decoder.flush())
+        stream.close()
+
+
+if __name__ == "__main__":
+    main()
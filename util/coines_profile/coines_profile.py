@@ -0,0 +1,120 @@
+# -*- coding: utf-8 -*-
+"""
+Copyright (C) 2019 Bosch Sensortec GmbH
+
+SPDX-License-Identifier: BSD-3-Clause
+
+Pretty-printer of the profiling zones dumped by coines_profile_dump() (coines_api/coines_profile.h)
+
+Reads the dump from a file, standard input or the serial port of the board. On a serial port,
+the dump command ('p' by default) is sent first, the application has to answer it by calling
+coines_profile_dump().
+"""
+
+import argparse
+import sys
+import time
+
+HIST_WIDTH = 40
+
+
+def parse_dump(lines):
+    """Returns (cpu_hz, overhead, zones) of the last complete dump in lines, None if there is none"""
+    result = None
+    current = None
+    for line in lines:
+        words = line.split()
+        if len(words) < 2 or words[0] != "coines_profile":
+            continue
+        if words[1] == "begin" and len(words) >= 5:
+            current = {"cpu_hz": int(words[2]), "bins": int(words[3]), "overhead": int(words[4]), "zones": []}
+        elif words[1] == "zone" and current is not None and len(words) >= 7:
+            tag = words[2]
+            count, min_cyc, max_cyc, mean = (int(w) for w in words[3:7])
+            hist = [int(w) for w in words[7:7 + current["bins"]]]
+            current["zones"].append((tag, count, min_cyc, max_cyc, mean, hist))
+        elif words[1] == "end" and current is not None:
+            result = current
+            current = None
+    return result
+
+
+def bin_label(bin_idx, last):
+    """Cycle range of a histogram bin"""
+    low = 0 if bin_idx == 0 else 1 << bin_idx
+    if bin_idx == last:
+        return ">= %d" % low
+    return "%d..%d" % (low, (1 << (bin_idx + 1)) - 1)
+
+
+def print_dump(dump, show_hist):
+    """Prints the zone table and the histograms"""
+    cpu_hz = dump["cpu_hz"] or 1
+    us = lambda cycles: cycles * 1e6 / cpu_hz
+
+    print("CPU clock %.1f MHz, empty zone %d cycles" % (cpu_hz / 1e6, dump["overhead"]))
+    print()
+    print("%-24s %10s %10s %10s %10s %10s %10s" % ("zone", "count", "min", "mean", "max", "mean us", "max us"))
+    print("-" * 90)
+    for tag, count, min_cyc, max_cyc, mean, _ in dump["zones"]:
+        print("%-24s %10d %10d %10d %10d %10.2f %10.2f" % (tag, count, min_cyc, mean, max_cyc, us(mean), us(max_cyc)))
+
+    if not show_hist:
+        return
+    for tag, count, _, _, _, hist in dump["zones"]:
+        if count == 0:
+            continue
+        print()
+        print("%s (cycles)" % tag)
+        peak = max(hist)
+        used = [i for i, n in enumerate(hist) if n]
+        for bin_idx in range(used[0], used[-1] + 1):
+            bar = "#" * ((hist[bin_idx] * HIST_WIDTH + peak - 1) // peak)
+            print("  %20s %10d %s" % (bin_label(bin_idx, len(hist) - 1), hist[bin_idx], bar))
+
+
+def read_port(port, command, timeout):
+    """Sends the dump command and returns the lines received until the end of the dump"""
+    import serial
+    lines = []
+    with serial.Serial(port, 115200, timeout=0.1) as ser:
+        ser.reset_input_buffer()
+        ser.write(command.encode())
+        deadline = time.time() + timeout
+        pending = b""
+        while time.time() < deadline:
+            pending += ser.read(max(1, ser.in_waiting))
+            *complete, pending = pending.split(b"\n")
+            for raw in complete:
+                line = raw.decode("latin-1").strip()
+                lines.append(line)
+                if line == "coines_profile end":
+                    return lines
+    return lines
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Prints the profiling zones dumped by a COINES MCU application")
+    parser.add_argument("input", nargs="?", default="-", help="captured serial output, - for standard input (default)")
+    parser.add_argument("-p", "--port", help="request the dump on a serial port instead (needs pyserial)")
+    parser.add_argument("-c", "--command", default="p", help="dump command sent on the serial port (default: p)")
+    parser.add_argument("--timeout", type=float, default=5.0, help="seconds to wait for the dump (default: 5)")
+    parser.add_argument("--no-hist", action="store_true", help="do not print the histograms")
+    args = parser.parse_args()
+
+    if args.port:
+        lines = read_port(args.port, args.command, args.timeout)
+    elif args.input == "-":
+        lines = sys.stdin.read().splitlines()
+    else:
+        with open(args.input, encoding="latin-1") as dump_file:
+            lines = dump_file.read().splitlines()
+
+    dump = parse_dump(lines)
+    if dump is None:
+        sys.exit("No complete coines_profile dump found")
+    print_dump(dump, not args.no_hist)
+
+
+if __name__ == "__main__":
+    main()
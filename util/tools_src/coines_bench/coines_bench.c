@@ -0,0 +1,796 @@
+/**
+ * Copyright (C) 2018 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    coines_bench.c
+ * @brief   Benchmark of the COINES host communication stack.
+ *          Measures register access latency, burst throughput, streaming rate and loss,
+ *          open/close time and CPU use per streamed sample, and prints the results as JSON.
+ *
+ */
+
+#if defined(PLATFORM_LINUX) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef PLATFORM_WINDOWS
+#include <windows.h>
+#endif
+
+#ifdef PLATFORM_LINUX
+#include <sys/resource.h>
+#endif
+
+#include "coines.h"
+
+/*! Maximum entries of a comma separated list option */
+#define BENCH_MAX_LIST          (16)
+/*! Number of bytes for a "single register" access */
+#define BENCH_SINGLE_REG_BYTES  (1)
+/*! Largest write the host sends in one command */
+#define BENCH_WRITE_CHUNK       (46)
+
+/*!
+ * @brief Benchmark settings, see bench_usage()
+ */
+struct bench_config
+{
+    enum coines_sensor_intf intf;
+    uint8_t addr;
+    uint8_t read_reg;
+    uint8_t write_reg;
+    uint16_t vdd_mv;
+    uint16_t vddio_mv;
+    uint32_t iterations;
+    uint32_t open_cycles;
+    uint32_t burst_iterations;
+    uint32_t burst_sizes[BENCH_MAX_LIST];
+    uint32_t burst_size_count;
+    uint32_t odrs[BENCH_MAX_LIST];
+    uint32_t odr_count;
+    uint32_t stream_seconds;
+    uint8_t stream_reg;
+    uint8_t stream_bytes;
+    uint32_t sim_scale;
+    uint32_t sim_delay_us;
+    const char *capture_path;
+    const char *trace_path;
+    const char *output_path;
+};
+
+/*!
+ * @brief Summary of a set of latency samples
+ */
+struct bench_stats
+{
+    uint32_t count;
+    uint32_t errors;
+    double min_us;
+    double mean_us;
+    double p50_us;
+    double p99_us;
+    double p999_us;
+    double max_us;
+};
+
+static FILE *bench_out;
+static uint32_t bench_errors;
+
+static uint64_t bench_now_ns(void);
+static uint64_t bench_cpu_ns(void);
+static int bench_parse_list(const char *arg, uint32_t *list, uint32_t *count);
+static int bench_parse_args(int argc, char *argv[], struct bench_config *cfg);
+static void bench_usage(const char *name);
+static int bench_compare_u64(const void *a, const void *b);
+static void bench_summarize(uint64_t *samples_ns, uint32_t count, uint32_t errors, struct bench_stats *stats);
+static void bench_print_stats(const char *name, const struct bench_stats *stats, const char *separator);
+static int16_t bench_read(const struct bench_config *cfg, uint8_t reg, uint8_t *data, uint16_t count);
+static int16_t bench_write(const struct bench_config *cfg, uint8_t reg, uint8_t *data, uint16_t count);
+static int16_t bench_config_simulation(const struct bench_config *cfg);
+static int16_t bench_open(const struct bench_config *cfg);
+static void bench_close(const struct bench_config *cfg);
+static void bench_open_close(const struct bench_config *cfg);
+static void bench_latency(const struct bench_config *cfg);
+static void bench_burst(const struct bench_config *cfg, uint8_t write);
+static void bench_streaming(const struct bench_config *cfg);
+
+int main(int argc, char *argv[])
+{
+    struct bench_config cfg;
+    struct coines_board_info board_info = { 0 };
+    int16_t rslt;
+
+    if (bench_parse_args(argc, argv, &cfg) != 0)
+    {
+        bench_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    bench_out = stdout;
+    if (cfg.output_path != NULL)
+    {
+        bench_out = fopen(cfg.output_path, "w");
+        if (bench_out == NULL)
+        {
+            fprintf(stderr, "Unable to create %s\n", cfg.output_path);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (cfg.capture_path != NULL)
+    {
+        rslt = coines_start_capture(cfg.capture_path);
+        if (rslt != COINES_SUCCESS)
+        {
+            fprintf(stderr, "Unable to start the capture to %s (%d)\n", cfg.capture_path, rslt);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (cfg.sim_scale > 0)
+    {
+        rslt = bench_config_simulation(&cfg);
+        if (rslt != COINES_SUCCESS)
+        {
+            fprintf(stderr, "Unable to set up the simulated board (%d)\n", rslt);
+            return EXIT_FAILURE;
+        }
+    }
+
+    rslt = bench_open(&cfg);
+    if (rslt != COINES_SUCCESS)
+    {
+        fprintf(stderr, "Unable to connect to Application Board ! (%d)\n", rslt);
+        return EXIT_FAILURE;
+    }
+    coines_get_board_info(&board_info);
+    bench_close(&cfg);
+
+    fprintf(bench_out, "{\n\"tool\":\"coines-bench\",\"format\":1,\n");
+    fprintf(bench_out,
+            "\"board\":{\"hardware_id\":%u,\"software_id\":%u,\"board\":%u,\"shuttle_id\":%u},\n",
+            board_info.hardware_id,
+            board_info.software_id,
+            board_info.board,
+            board_info.shuttle_id);
+    fprintf(bench_out,
+            "\"config\":{\"intf\":\"%s\",\"addr\":%u,\"read_reg\":%u,\"write_reg\":%u,\"iterations\":%lu,"
+            "\"burst_iterations\":%lu,\"stream_seconds\":%lu,\"stream_bytes\":%u,\"sim_scale\":%lu},\n",
+            (cfg.intf == COINES_SENSOR_INTF_I2C) ? "i2c" : "spi",
+            cfg.addr,
+            cfg.read_reg,
+            cfg.write_reg,
+            (unsigned long)cfg.iterations,
+            (unsigned long)cfg.burst_iterations,
+            (unsigned long)cfg.stream_seconds,
+            cfg.stream_bytes,
+            (unsigned long)cfg.sim_scale);
+
+    bench_open_close(&cfg);
+
+    if (bench_open(&cfg) == COINES_SUCCESS)
+    {
+        if (cfg.trace_path != NULL)
+            coines_reset_trace();
+
+        bench_latency(&cfg);
+        bench_burst(&cfg, 0);
+        bench_burst(&cfg, 1);
+
+        if (cfg.trace_path != NULL)
+        {
+            rslt = coines_export_trace(cfg.trace_path);
+            if (rslt != COINES_SUCCESS)
+                fprintf(stderr, "Trace export to %s failed (%d)\n", cfg.trace_path, rslt);
+        }
+
+        bench_close(&cfg);
+    }
+    else
+    {
+        bench_errors++;
+    }
+
+    /* Every rate reopens the interface, the streaming configuration is cleared on close */
+    bench_streaming(&cfg);
+
+    fprintf(bench_out, "\"errors\":%lu\n}\n", (unsigned long)bench_errors);
+
+    if (cfg.capture_path != NULL)
+        coines_stop_capture(NULL);
+
+    if (bench_out != stdout)
+        fclose(bench_out);
+
+    return (bench_errors == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*!
+ * @brief Monotonic wall clock in nanoseconds
+ */
+static uint64_t bench_now_ns(void)
+{
+#ifdef PLATFORM_LINUX
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+#endif
+#ifdef PLATFORM_WINDOWS
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((counter.QuadPart / frequency.QuadPart) * 1000000000ULL) +
+           (uint64_t)(((counter.QuadPart % frequency.QuadPart) * 1000000000ULL) / frequency.QuadPart);
+#endif
+}
+
+/*!
+ * @brief User + system CPU time of the process (all threads) in nanoseconds
+ */
+static uint64_t bench_cpu_ns(void)
+{
+#ifdef PLATFORM_LINUX
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+    return ((uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ULL) +
+           ((uint64_t)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ULL);
+#endif
+#ifdef PLATFORM_WINDOWS
+    FILETIME creation, exit_time, kernel, user;
+    ULARGE_INTEGER k, u;
+
+    GetProcessTimes(GetCurrentProcess(), &creation, &exit_time, &kernel, &user);
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    return (k.QuadPart + u.QuadPart) * 100ULL;
+#endif
+}
+
+/*!
+ * @brief Parses a comma separated list of numbers
+ */
+static int bench_parse_list(const char *arg, uint32_t *list, uint32_t *count)
+{
+    char *end;
+
+    *count = 0;
+    while (*arg != '\0')
+    {
+        if (*count == BENCH_MAX_LIST)
+            return -1;
+        list[*count] = (uint32_t)strtoul(arg, &end, 0);
+        if ((end == arg) || (list[*count] == 0))
+            return -1;
+        (*count)++;
+        arg = (*end == ',') ? end + 1 : end;
+        if ((*end != ',') && (*end != '\0'))
+            return -1;
+    }
+
+    return (*count > 0) ? 0 : -1;
+}
+
+/*!
+ * @brief Parses the command line into cfg
+ */
+static int bench_parse_args(int argc, char *argv[], struct bench_config *cfg)
+{
+    int idx;
+    const char *opt, *val;
+
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->intf = COINES_SENSOR_INTF_I2C;
+    cfg->addr = 0x68;
+    cfg->read_reg = 0x00;
+    cfg->write_reg = 0x00;
+    cfg->vdd_mv = 1800;
+    cfg->vddio_mv = 1800;
+    cfg->iterations = 1000;
+    cfg->open_cycles = 3;
+    cfg->burst_iterations = 100;
+    cfg->stream_seconds = 2;
+    cfg->stream_reg = 0x0C;
+    cfg->stream_bytes = 6;
+    bench_parse_list("1,16,64,256,1024,2048", cfg->burst_sizes, &cfg->burst_size_count);
+    bench_parse_list("25,50,100,200,400,800,1600", cfg->odrs, &cfg->odr_count);
+
+    for (idx = 1; idx < argc; idx++)
+    {
+        opt = argv[idx];
+        if ((strcmp(opt, "-h") == 0) || (strcmp(opt, "--help") == 0))
+            return -1;
+        if (idx + 1 >= argc)
+            return -1;
+        val = argv[++idx];
+
+        if (strcmp(opt, "--intf") == 0)
+        {
+            if (strcmp(val, "i2c") == 0)
+                cfg->intf = COINES_SENSOR_INTF_I2C;
+            else if (strcmp(val, "spi") == 0)
+                cfg->intf = COINES_SENSOR_INTF_SPI;
+            else
+                return -1;
+        }
+        else if (strcmp(opt, "--addr") == 0)
+            cfg->addr = (uint8_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--reg") == 0)
+            cfg->read_reg = (uint8_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--write-reg") == 0)
+            cfg->write_reg = (uint8_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--vdd") == 0)
+            cfg->vdd_mv = (uint16_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--vddio") == 0)
+            cfg->vddio_mv = (uint16_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--iterations") == 0)
+            cfg->iterations = (uint32_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--open-cycles") == 0)
+            cfg->open_cycles = (uint32_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--burst-iterations") == 0)
+            cfg->burst_iterations = (uint32_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--burst-sizes") == 0)
+        {
+            if (bench_parse_list(val, cfg->burst_sizes, &cfg->burst_size_count) != 0)
+                return -1;
+        }
+        else if (strcmp(opt, "--odr") == 0)
+        {
+            if (bench_parse_list(val, cfg->odrs, &cfg->odr_count) != 0)
+                return -1;
+        }
+        else if (strcmp(opt, "--stream-seconds") == 0)
+            cfg->stream_seconds = (uint32_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--stream-reg") == 0)
+            cfg->stream_reg = (uint8_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--stream-bytes") == 0)
+            cfg->stream_bytes = (uint8_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--sim") == 0)
+            cfg->sim_scale = (uint32_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--sim-delay") == 0)
+            cfg->sim_delay_us = (uint32_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--capture") == 0)
+            cfg->capture_path = val;
+        else if (strcmp(opt, "--trace") == 0)
+            cfg->trace_path = val;
+        else if (strcmp(opt, "--output") == 0)
+            cfg->output_path = val;
+        else
+            return -1;
+    }
+
+    for (idx = 0; idx < (int)cfg->burst_size_count; idx++)
+    {
+        if (cfg->burst_sizes[idx] > UINT16_MAX)
+            return -1;
+    }
+
+    if ((cfg->iterations == 0) || (cfg->burst_iterations == 0) || (cfg->stream_bytes == 0))
+        return -1;
+
+    return 0;
+}
+
+/*!
+ * @brief Prints the command line help
+ */
+static void bench_usage(const char *name)
+{
+    printf("\n %s [options]\n", name);
+    printf("\n  --intf i2c|spi          sensor interface (i2c)");
+    printf("\n  --addr N                I2C address or SPI chip select pin (0x68)");
+    printf("\n  --reg N                 register for reads and bursts (0x00)");
+    printf("\n  --write-reg N           register for writes, its value is written back (0x00)");
+    printf("\n  --vdd N / --vddio N     shuttle supply in mV (1800 / 1800)");
+    printf("\n  --iterations N          single register round trips (1000)");
+    printf("\n  --open-cycles N         open/close cycles (3)");
+    printf("\n  --burst-sizes a,b,..    burst sizes in bytes (1,16,64,256,1024,2048)");
+    printf("\n  --burst-iterations N    transfers per burst size (100)");
+    printf("\n  --odr a,b,..            streaming rates in Hz (25,50,100,200,400,800,1600)");
+    printf("\n  --stream-seconds N      duration of each streaming rate (2)");
+    printf("\n  --stream-reg N          first streamed register (0x0C)");
+    printf("\n  --stream-bytes N        bytes per streamed sample (6)");
+    printf("\n  --sim N                 run against the simulated board, N times faster than real time");
+    printf("\n  --sim-delay N           turnaround of the simulated board in us (0)");
+    printf("\n  --capture FILE          capture the USB traffic of the run");
+    printf("\n  --trace FILE            export the hot path trace (library built with COINES_TRACE)");
+    printf("\n  --output FILE           write the JSON results to FILE instead of stdout");
+    printf("\n");
+}
+
+static int bench_compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*!
+ * @brief Computes min/mean/percentiles/max of samples_ns (nearest rank), sorts samples_ns
+ */
+static void bench_summarize(uint64_t *samples_ns, uint32_t count, uint32_t errors, struct bench_stats *stats)
+{
+    uint64_t sum = 0;
+    uint32_t idx;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->count = count;
+    stats->errors = errors;
+    if (count == 0)
+        return;
+
+    qsort(samples_ns, count, sizeof(uint64_t), bench_compare_u64);
+    for (idx = 0; idx < count; idx++)
+        sum += samples_ns[idx];
+
+    stats->min_us = samples_ns[0] / 1000.0;
+    stats->max_us = samples_ns[count - 1] / 1000.0;
+    stats->mean_us = (sum / (double)count) / 1000.0;
+    stats->p50_us = samples_ns[((uint64_t)count * 500 + 999) / 1000 - 1] / 1000.0;
+    stats->p99_us = samples_ns[((uint64_t)count * 990 + 999) / 1000 - 1] / 1000.0;
+    stats->p999_us = samples_ns[((uint64_t)count * 999 + 999) / 1000 - 1] / 1000.0;
+}
+
+static void bench_print_stats(const char *name, const struct bench_stats *stats, const char *separator)
+{
+    fprintf(bench_out,
+            "\"%s\":{\"count\":%lu,\"errors\":%lu,\"min\":%.3f,\"mean\":%.3f,\"p50\":%.3f,\"p99\":%.3f,"
+            "\"p999\":%.3f,\"max\":%.3f}%s\n",
+            name,
+            (unsigned long)stats->count,
+            (unsigned long)stats->errors,
+            stats->min_us,
+            stats->mean_us,
+            stats->p50_us,
+            stats->p99_us,
+            stats->p999_us,
+            stats->max_us,
+            separator);
+}
+
+static int16_t bench_read(const struct bench_config *cfg, uint8_t reg, uint8_t *data, uint16_t count)
+{
+    if (cfg->intf == COINES_SENSOR_INTF_I2C)
+        return coines_read_i2c(cfg->addr, reg, data, count);
+
+    return coines_read_spi(cfg->addr, reg | 0x80, data, count);
+}
+
+/*!
+ * @brief Burst write, split in BENCH_WRITE_CHUNK commands with auto-incremented register address
+ */
+static int16_t bench_write(const struct bench_config *cfg, uint8_t reg, uint8_t *data, uint16_t count)
+{
+    int16_t rslt = COINES_SUCCESS;
+    uint16_t pos, chunk;
+
+    for (pos = 0; (rslt == COINES_SUCCESS) && (pos < count); pos += chunk)
+    {
+        chunk = ((count - pos) > BENCH_WRITE_CHUNK) ? BENCH_WRITE_CHUNK : (uint16_t)(count - pos);
+        if (cfg->intf == COINES_SENSOR_INTF_I2C)
+            rslt = coines_write_i2c(cfg->addr, (uint8_t)(reg + pos), &data[pos], chunk);
+        else
+            rslt = coines_write_spi(cfg->addr, (uint8_t)(reg + pos) & 0x7F, &data[pos], chunk);
+    }
+
+    return rslt;
+}
+
+/*!
+ * @brief Replaces the board with the simulated board. The simulated sensor answers at --addr
+ *        and streams a ramp of --stream-bytes / 2 channels from --stream-reg.
+ */
+static int16_t bench_config_simulation(const struct bench_config *cfg)
+{
+    struct coines_sim_config sim_config;
+
+    memset(&sim_config, 0, sizeof(sim_config));
+    sim_config.shuttle_id = 0x1FF;
+    sim_config.hardware_id = 0x30;
+    sim_config.software_id = 0x23;
+    sim_config.board = 5;
+    sim_config.i2c_addr = cfg->addr;
+    sim_config.cs_pin = cfg->addr;
+    sim_config.data_ready_hz = 1600;
+    sim_config.time_scale = cfg->sim_scale;
+    sim_config.response_delay_us = cfg->sim_delay_us;
+    sim_config.generator.waveform = COINES_SIM_WAVEFORM_RAMP;
+    sim_config.generator.data_reg = cfg->stream_reg;
+    sim_config.generator.channels = (uint8_t)((cfg->stream_bytes + 1) / 2);
+
+    return coines_config_simulation(&sim_config);
+}
+
+/*!
+ * @brief Opens the interface and powers and configures the shuttle bus
+ */
+static int16_t bench_open(const struct bench_config *cfg)
+{
+    int16_t rslt = coines_open_comm_intf(COINES_COMM_INTF_USB);
+
+    if (rslt != COINES_SUCCESS)
+        return rslt;
+
+    if (cfg->intf == COINES_SENSOR_INTF_I2C)
+        rslt = coines_config_i2c_bus(COINES_I2C_BUS_0, COINES_I2C_FAST_MODE);
+    else
+        rslt = coines_config_spi_bus(COINES_SPI_BUS_0, COINES_SPI_SPEED_10_MHZ, COINES_SPI_MODE0);
+
+    if (rslt == COINES_SUCCESS)
+        rslt = coines_set_shuttleboard_vdd_vddio_config(cfg->vdd_mv, cfg->vddio_mv);
+
+    if (rslt != COINES_SUCCESS)
+        coines_close_comm_intf(COINES_COMM_INTF_USB);
+    else
+        coines_delay_msec(10);
+
+    return rslt;
+}
+
+static void bench_close(const struct bench_config *cfg)
+{
+    (void)cfg;
+
+    coines_set_shuttleboard_vdd_vddio_config(0, 0);
+    coines_close_comm_intf(COINES_COMM_INTF_USB);
+}
+
+/*!
+ * @brief Time of coines_open_comm_intf()/coines_close_comm_intf() alone, without bus setup
+ */
+static void bench_open_close(const struct bench_config *cfg)
+{
+    uint64_t *open_ns = calloc(cfg->open_cycles + 1, sizeof(uint64_t));
+    uint64_t *close_ns = calloc(cfg->open_cycles + 1, sizeof(uint64_t));
+    struct bench_stats open_stats, close_stats;
+    uint32_t idx, done = 0, errors = 0;
+    uint64_t start;
+
+    for (idx = 0; (open_ns != NULL) && (close_ns != NULL) && (idx < cfg->open_cycles); idx++)
+    {
+        start = bench_now_ns();
+        if (coines_open_comm_intf(COINES_COMM_INTF_USB) != COINES_SUCCESS)
+        {
+            errors++;
+            continue;
+        }
+        open_ns[done] = bench_now_ns() - start;
+
+        start = bench_now_ns();
+        coines_close_comm_intf(COINES_COMM_INTF_USB);
+        close_ns[done] = bench_now_ns() - start;
+        done++;
+    }
+
+    bench_summarize(open_ns, done, errors, &open_stats);
+    bench_summarize(close_ns, done, 0, &close_stats);
+    bench_errors += errors;
+
+    fprintf(bench_out, "\"open_close_us\":{\n");
+    bench_print_stats("open", &open_stats, ",");
+    bench_print_stats("close", &close_stats, "");
+    fprintf(bench_out, "},\n");
+
+    free(open_ns);
+    free(close_ns);
+}
+
+/*!
+ * @brief Round trip time of single register reads and writes
+ */
+static void bench_latency(const struct bench_config *cfg)
+{
+    uint64_t *samples_ns = calloc(cfg->iterations, sizeof(uint64_t));
+    struct bench_stats read_stats, write_stats;
+    uint32_t idx, done, errors;
+    uint8_t value = 0;
+    uint64_t start;
+
+    if (samples_ns == NULL)
+    {
+        bench_errors++;
+        return;
+    }
+
+    for (idx = 0, done = 0, errors = 0; idx < cfg->iterations; idx++)
+    {
+        start = bench_now_ns();
+        if (bench_read(cfg, cfg->read_reg, &value, BENCH_SINGLE_REG_BYTES) != COINES_SUCCESS)
+        {
+            errors++;
+            continue;
+        }
+        samples_ns[done++] = bench_now_ns() - start;
+    }
+    bench_summarize(samples_ns, done, errors, &read_stats);
+    bench_errors += errors;
+
+    /* The register keeps its value, the write benchmark stores back what was read */
+    if (bench_read(cfg, cfg->write_reg, &value, BENCH_SINGLE_REG_BYTES) != COINES_SUCCESS)
+        bench_errors++;
+
+    for (idx = 0, done = 0, errors = 0; idx < cfg->iterations; idx++)
+    {
+        start = bench_now_ns();
+        if (bench_write(cfg, cfg->write_reg, &value, BENCH_SINGLE_REG_BYTES) != COINES_SUCCESS)
+        {
+            errors++;
+            continue;
+        }
+        samples_ns[done++] = bench_now_ns() - start;
+    }
+    bench_summarize(samples_ns, done, errors, &write_stats);
+    bench_errors += errors;
+
+    fprintf(bench_out, "\"latency_us\":{\n");
+    bench_print_stats("read", &read_stats, ",");
+    bench_print_stats("write", &write_stats, "");
+    fprintf(bench_out, "},\n");
+
+    free(samples_ns);
+}
+
+/*!
+ * @brief Throughput of burst reads (write = 0) or writes (write = 1) for each burst size
+ */
+static void bench_burst(const struct bench_config *cfg, uint8_t write)
+{
+    uint32_t max_size = 0, idx, iter, errors;
+    uint8_t *data;
+    uint64_t start, elapsed_ns;
+    double mb_per_s;
+
+    for (idx = 0; idx < cfg->burst_size_count; idx++)
+    {
+        if (cfg->burst_sizes[idx] > max_size)
+            max_size = cfg->burst_sizes[idx];
+    }
+
+    data = calloc(max_size, 1);
+    if (data == NULL)
+    {
+        bench_errors++;
+        return;
+    }
+
+    /* Writes store back the content read from the same registers */
+    if (write)
+        bench_read(cfg, cfg->write_reg, data, (uint16_t)max_size);
+
+    fprintf(bench_out, "\"%s\":[\n", write ? "burst_write" : "burst_read");
+    for (idx = 0; idx < cfg->burst_size_count; idx++)
+    {
+        errors = 0;
+        start = bench_now_ns();
+        for (iter = 0; iter < cfg->burst_iterations; iter++)
+        {
+            int16_t rslt;
+
+            if (write)
+                rslt = bench_write(cfg, cfg->write_reg, data, (uint16_t)cfg->burst_sizes[idx]);
+            else
+                rslt = bench_read(cfg, cfg->read_reg, data, (uint16_t)cfg->burst_sizes[idx]);
+
+            if (rslt != COINES_SUCCESS)
+                errors++;
+        }
+        elapsed_ns = bench_now_ns() - start;
+        bench_errors += errors;
+
+        mb_per_s = ((double)cfg->burst_sizes[idx] * (cfg->burst_iterations - errors) * 1000.0) / (double)elapsed_ns;
+        fprintf(bench_out,
+                "{\"size\":%lu,\"iterations\":%lu,\"errors\":%lu,\"us_per_transfer\":%.3f,\"mb_per_s\":%.4f}%s\n",
+                (unsigned long)cfg->burst_sizes[idx],
+                (unsigned long)cfg->burst_iterations,
+                (unsigned long)errors,
+                (elapsed_ns / 1000.0) / cfg->burst_iterations,
+                mb_per_s,
+                (idx + 1 < cfg->burst_size_count) ? "," : "");
+    }
+    fprintf(bench_out, "],\n");
+
+    free(data);
+}
+
+/*!
+ * @brief Polling mode streaming at each requested rate: received samples/s, loss and CPU time per sample
+ */
+static void bench_streaming(const struct bench_config *cfg)
+{
+    struct coines_streaming_config stream_config;
+    struct coines_streaming_blocks stream_blocks;
+    uint8_t *data = malloc(COINES_STREAM_RSP_BUF_SIZE);
+    uint32_t idx, samples, received;
+    uint64_t start, elapsed_ns, cpu_start, cpu_ns, duration_ns;
+    double expected, loss;
+    int16_t rslt;
+
+    fprintf(bench_out, "\"streaming\":[\n");
+    for (idx = 0; (data != NULL) && (idx < cfg->odr_count); idx++)
+    {
+        uint32_t period_us = 1000000 / cfg->odrs[idx];
+
+        memset(&stream_config, 0, sizeof(stream_config));
+        memset(&stream_blocks, 0, sizeof(stream_blocks));
+        stream_config.intf = cfg->intf;
+        stream_config.i2c_bus = COINES_I2C_BUS_0;
+        stream_config.spi_bus = COINES_SPI_BUS_0;
+        stream_config.dev_addr = cfg->addr;
+        stream_config.cs_pin = cfg->addr;
+        if (period_us <= UINT16_MAX)
+        {
+            stream_config.sampling_time = (uint16_t)period_us;
+            stream_config.sampling_units = COINES_SAMPLING_TIME_IN_MICRO_SEC;
+        }
+        else
+        {
+            stream_config.sampling_time = (uint16_t)(period_us / 1000);
+            stream_config.sampling_units = COINES_SAMPLING_TIME_IN_MILLI_SEC;
+        }
+        stream_blocks.no_of_blocks = 1;
+        stream_blocks.reg_start_addr[0] = (cfg->intf == COINES_SENSOR_INTF_SPI) ? (cfg->stream_reg | 0x80) : cfg->stream_reg;
+        stream_blocks.no_of_data_bytes[0] = cfg->stream_bytes;
+
+        received = 0;
+        elapsed_ns = 0;
+        cpu_ns = 0;
+        rslt = bench_open(cfg);
+        if (rslt == COINES_SUCCESS)
+        {
+            rslt = coines_config_streaming(1, &stream_config, &stream_blocks);
+            if (rslt == COINES_SUCCESS)
+                rslt = coines_start_stop_streaming(COINES_STREAMING_MODE_POLLING, COINES_STREAMING_START);
+
+            duration_ns = (uint64_t)cfg->stream_seconds * 1000000000ULL;
+            cpu_start = bench_cpu_ns();
+            start = bench_now_ns();
+            while ((rslt == COINES_SUCCESS) && ((bench_now_ns() - start) < duration_ns))
+            {
+                samples = 0;
+                if (coines_read_stream_sensor_data(1, 1, data, &samples) == COINES_SUCCESS)
+                    received += samples;
+            }
+            elapsed_ns = bench_now_ns() - start;
+            cpu_ns = bench_cpu_ns() - cpu_start;
+
+            coines_start_stop_streaming(COINES_STREAMING_MODE_POLLING, COINES_STREAMING_STOP);
+            bench_close(cfg);
+        }
+
+        if (rslt != COINES_SUCCESS)
+            bench_errors++;
+
+        /* The simulated board samples on its own clock, sim_scale times faster */
+        expected = (elapsed_ns / 1e9) * cfg->odrs[idx] * ((cfg->sim_scale > 0) ? cfg->sim_scale : 1);
+        loss = ((expected > 0) && (received < expected)) ? (1.0 - received / expected) : 0.0;
+        fprintf(bench_out,
+                "{\"odr_hz\":%lu,\"status\":%d,\"seconds\":%.3f,\"expected\":%.0f,\"received\":%lu,"
+                "\"samples_per_s\":%.1f,\"loss\":%.4f,\"cpu_us_per_sample\":%.3f}%s\n",
+                (unsigned long)cfg->odrs[idx],
+                rslt,
+                elapsed_ns / 1e9,
+                expected,
+                (unsigned long)received,
+                (elapsed_ns > 0) ? (received / (elapsed_ns / 1e9)) : 0.0,
+                loss,
+                (received > 0) ? ((cpu_ns / 1000.0) / received) : 0.0,
+                (idx + 1 < cfg->odr_count) ? "," : "");
+    }
+    fprintf(bench_out, "],\n");
+
+    free(data);
+}
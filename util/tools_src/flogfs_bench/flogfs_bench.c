@@ -0,0 +1,1737 @@
+/**
+ * Copyright (C) 2019 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    flogfs_bench.c
+ * @brief   Benchmark and power cut torture test of FLogFS on a simulated W25N01GW.
+ *          Runs the Application Board 3.0 file system and flash driver on the host, measures
+ *          format and mount time, sequential, small file and delete throughput and flash
+ *          wear, and checks the file system after power cuts. Prints the results as JSON.
+ *
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "flogfs.h"
+#include "w25n01gwtbig.h"
+#include "w25n01gw_sim.h"
+
+#ifndef MIN
+#define MIN(a, b)               ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b)               ((a) > (b) ? (a) : (b))
+#endif
+
+/*! Largest write or read of the workloads */
+#define BENCH_MAX_CHUNK         (4096)
+/*! Random seeks into the log file */
+#define BENCH_SEEKS             (200)
+/*! Bytes read and compared after a seek */
+#define BENCH_SEEK_READ         (64)
+/*! Files listed by bench_ls() */
+#define BENCH_MAX_LS            (512)
+/*! Files and operations of the block count check */
+#define BENCH_BLOCK_FILES       (8)
+#define BENCH_BLOCK_OPS         (96)
+/*! Operations between two comparisons with the counts of a mount */
+#define BENCH_BLOCK_CHECK       (8)
+/*! Files invalidated at once by the garbage collection test */
+#define BENCH_GC_FILES          (8)
+/*! Program and erase operations between two power cuts of the invalidation power cut test */
+#define BENCH_GC_CUT_STEP       (5)
+/*! Log written after a format by the garbage collection test, and the pause after every write */
+#define BENCH_GC_LOG_BYTES      (2UL * 1024 * 1024)
+#define BENCH_GC_IDLE_US        (1000)
+/*! Period of the garbage collection in the pauses, as the log task of mcu_app30.c */
+#define BENCH_GC_PERIOD_US      (10000)
+/*! Files filling most of the chip for the checkpoint test */
+#define BENCH_CHECKPOINT_FILES  (56)
+#define BENCH_CHECKPOINT_FILE_BYTES (2UL * 1024 * 1024)
+/*! Bytes of every workload of the die comparison */
+#define BENCH_DIES_BYTES        (2UL * 1024 * 1024)
+/*! Files of the power cut test */
+#define BENCH_TORTURE_FILES     (16)
+/*! Largest append of the power cut test */
+#define BENCH_TORTURE_APPEND    (3000)
+
+/*!
+ * @brief Benchmark settings, see bench_usage()
+ */
+struct bench_config
+{
+    uint32_t seq_bytes;
+    uint32_t chunk;
+    uint32_t files;
+    uint32_t file_bytes;
+    uint32_t churn_rounds;
+    uint32_t boots;
+    uint32_t max_cut_ops;
+    uint32_t boot_timeout_s;
+    uint32_t seed;
+    uint32_t dies;
+    struct w25n_sim_timing timing;
+    const char *image_path;
+    const char *output_path;
+};
+
+/*!
+ * @brief Simulated and wall time, and flash operations, of a section
+ */
+struct bench_span
+{
+    uint64_t sim_ns;
+    uint64_t wall_ns;
+    struct w25n_sim_stats stats;
+};
+
+/*!
+ * @brief State of a power cut test file, kept over the power cuts
+ */
+enum bench_file_state {
+    BENCH_FILE_ABSENT = 0,
+    BENCH_FILE_WRITING,     /*< Opened for write, durable is the size at the last close */
+    BENCH_FILE_PRESENT,
+    BENCH_FILE_REMOVING
+};
+
+/*!
+ * @brief What the power cut test knows about the files and its findings, shared by the boots
+ */
+struct bench_journal
+{
+    struct
+    {
+        uint8_t state;
+        uint32_t durable;
+    } files[BENCH_TORTURE_FILES];
+    uint32_t boots;
+    uint8_t format_next;    /*< The previous boot hung or crashed */
+    uint32_t operations;
+    uint32_t mount_failures;
+    uint32_t lost_files;
+    uint32_t lost_bytes;
+    uint32_t corrupt_files;
+    uint32_t resurrected_files;
+    uint32_t check_errors;
+    uint64_t mount_sim_ns;
+    uint64_t mount_sim_ns_max;
+};
+
+static FILE *bench_out;
+static uint32_t bench_errors;
+static uint8_t bench_buffer[BENCH_MAX_CHUNK];
+static uint32_t bench_random_state;
+
+static uint64_t bench_now_ns(void);
+static int bench_parse_args(int argc, char *argv[], struct bench_config *cfg);
+static void bench_usage(const char *name);
+static uint32_t bench_random(void);
+static uint8_t bench_pattern(uint32_t file, uint32_t offset);
+static void bench_fill(uint8_t *data, uint32_t file, uint32_t offset, uint32_t len);
+static uint32_t bench_check(const uint8_t *data, uint32_t file, uint32_t offset, uint32_t len);
+static void bench_span_begin(struct bench_span *span);
+static void bench_span_end(struct bench_span *span);
+static double bench_mb_s(uint64_t bytes, uint64_t ns);
+static flog_result_t bench_mount(void);
+static uint32_t bench_write_file(const char *name, uint32_t file, uint32_t offset, uint32_t len, uint32_t chunk);
+static uint32_t bench_verify_file(const char *name, uint32_t file, uint32_t *size);
+static void bench_format_mount(void);
+static void bench_sequential(const struct bench_config *cfg);
+static void bench_seek(void);
+static void bench_small_files(const struct bench_config *cfg);
+static void bench_churn(const struct bench_config *cfg);
+static void bench_remount(void);
+static void bench_ls(void);
+static void bench_blocks(const struct bench_config *cfg);
+static void bench_gc_log(const struct bench_config *cfg, uint8_t gc, uint64_t *write_ns_max, uint32_t *erases);
+static void bench_gc(const struct bench_config *cfg);
+static void bench_gc_cut(const struct bench_config *cfg);
+static void bench_checkpoint(const struct bench_config *cfg);
+static void bench_flash(void);
+static uint32_t bench_dies_pair(const struct bench_config *cfg, struct bench_span *span);
+static uint32_t bench_dies_gc(const struct bench_config *cfg, struct bench_span *span);
+static void bench_dies(const struct bench_config *cfg);
+static void bench_torture_check(struct bench_journal *journal);
+static void bench_torture_boot(const struct bench_config *cfg, struct bench_journal *journal, uint32_t cut_after);
+static void bench_torture(const struct bench_config *cfg);
+
+int main(int argc, char *argv[])
+{
+    struct bench_config cfg;
+
+    if (bench_parse_args(argc, argv, &cfg) != 0)
+    {
+        bench_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    bench_out = stdout;
+    if (cfg.output_path != NULL)
+    {
+        bench_out = fopen(cfg.output_path, "w");
+        if (bench_out == NULL)
+        {
+            fprintf(stderr, "Unable to create %s\n", cfg.output_path);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (w25n_sim_open(cfg.image_path, &cfg.timing) != 0)
+    {
+        fprintf(stderr, "Unable to map the flash image %s\n", cfg.image_path ? cfg.image_path : "");
+        return EXIT_FAILURE;
+    }
+    w25n_sim_set_dies((uint8_t)cfg.dies);
+    bench_random_state = cfg.seed | 1;
+
+    fprintf(bench_out, "{\n\"tool\":\"flogfs-bench\",\"format\":1,\n");
+    fprintf(bench_out,
+            "\"config\":{\"seq_bytes\":%lu,\"chunk\":%lu,\"files\":%lu,\"file_bytes\":%lu,\"churn_rounds\":%lu,"
+            "\"boots\":%lu,\"max_cut_ops\":%lu,\"boot_timeout_s\":%lu,\"seed\":%lu,\"dies\":%lu,\"read_us\":%lu,\"program_us\":%lu,\"erase_us\":%lu,"
+            "\"transfer_ns\":%lu},\n",
+            (unsigned long)cfg.seq_bytes,
+            (unsigned long)cfg.chunk,
+            (unsigned long)cfg.files,
+            (unsigned long)cfg.file_bytes,
+            (unsigned long)cfg.churn_rounds,
+            (unsigned long)cfg.boots,
+            (unsigned long)cfg.max_cut_ops,
+            (unsigned long)cfg.boot_timeout_s,
+            (unsigned long)cfg.seed,
+            (unsigned long)cfg.dies,
+            (unsigned long)cfg.timing.read_us,
+            (unsigned long)cfg.timing.program_us,
+            (unsigned long)cfg.timing.erase_us,
+            (unsigned long)cfg.timing.transfer_ns);
+    fflush(bench_out);
+
+    bench_format_mount();
+    bench_sequential(&cfg);
+    bench_seek();
+    bench_small_files(&cfg);
+    bench_churn(&cfg);
+    bench_remount();
+    bench_ls();
+    bench_blocks(&cfg);
+    bench_gc(&cfg);
+    bench_gc_cut(&cfg);
+    bench_checkpoint(&cfg);
+    bench_flash();
+    bench_dies(&cfg);
+
+    /* Starts again from an erased chip */
+    if (cfg.boots > 0)
+        bench_torture(&cfg);
+
+    fprintf(bench_out, "\"errors\":%lu\n}\n", (unsigned long)bench_errors);
+
+    if (bench_out != stdout)
+        fclose(bench_out);
+
+    w25n_sim_close();
+
+    return (bench_errors == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*!
+ * @brief Monotonic wall clock in nanoseconds
+ */
+static uint64_t bench_now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+}
+
+/*!
+ * @brief Parses the command line into cfg
+ */
+static int bench_parse_args(int argc, char *argv[], struct bench_config *cfg)
+{
+    int idx;
+    const char *opt, *val;
+
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->seq_bytes = 4 * 1024 * 1024;
+    cfg->chunk = 512;
+    cfg->files = 100;
+    cfg->file_bytes = 1000;
+    cfg->churn_rounds = 200;
+    cfg->boots = 0;
+    cfg->max_cut_ops = 200;
+    cfg->boot_timeout_s = 2;
+    cfg->seed = 1;
+    cfg->dies = 1;
+    cfg->timing.read_us = 25;
+    cfg->timing.program_us = 250;
+    cfg->timing.erase_us = 2000;
+    cfg->timing.spi_hz = 4000000;
+    cfg->timing.transfer_ns = 3000;
+
+    for (idx = 1; idx < argc; idx++)
+    {
+        opt = argv[idx];
+        if ((strcmp(opt, "-h") == 0) || (strcmp(opt, "--help") == 0))
+            return -1;
+        if (idx + 1 >= argc)
+            return -1;
+        val = argv[++idx];
+
+        if (strcmp(opt, "--seq-bytes") == 0)
+            cfg->seq_bytes = (uint32_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--chunk") == 0)
+            cfg->chunk = (uint32_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--files") == 0)
+            cfg->files = (uint32_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--file-bytes") == 0)
+            cfg->file_bytes = (uint32_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--churn-rounds") == 0)
+            cfg->churn_rounds = (uint32_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--boots") == 0)
+            cfg->boots = (uint32_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--max-cut-ops") == 0)
+            cfg->max_cut_ops = (uint32_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--boot-timeout") == 0)
+            cfg->boot_timeout_s = (uint32_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--seed") == 0)
+            cfg->seed = (uint32_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--dies") == 0)
+            cfg->dies = (uint32_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--read-us") == 0)
+            cfg->timing.read_us = (uint32_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--program-us") == 0)
+            cfg->timing.program_us = (uint32_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--erase-us") == 0)
+            cfg->timing.erase_us = (uint32_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--transfer-ns") == 0)
+            cfg->timing.transfer_ns = (uint32_t)strtoul(val, NULL, 0);
+        else if (strcmp(opt, "--image") == 0)
+            cfg->image_path = val;
+        else if (strcmp(opt, "--output") == 0)
+            cfg->output_path = val;
+        else
+            return -1;
+    }
+
+    if ((cfg->chunk == 0) || (cfg->chunk > BENCH_MAX_CHUNK) || (cfg->max_cut_ops == 0) || (cfg->boot_timeout_s == 0) ||
+        (cfg->dies == 0) || (cfg->dies > W25N_SIM_MAX_DIES))
+        return -1;
+
+    return 0;
+}
+
+/*!
+ * @brief Prints the command line help
+ */
+static void bench_usage(const char *name)
+{
+    printf("\n %s [options]\n", name);
+    printf("\n  --seq-bytes N           size of the sequential log file (4194304)");
+    printf("\n  --chunk N               bytes per flogfs_write()/flogfs_read(), up to %u (512)", BENCH_MAX_CHUNK);
+    printf("\n  --files N               number of small files (100)");
+    printf("\n  --file-bytes N          size of a small file (1000)");
+    printf("\n  --churn-rounds N        create/delete rounds, alternating flogfs_rm() and flogfs_invalidate() (200)");
+    printf("\n  --boots N               power cut test boots, its findings are known failures (0, skipped)");
+    printf("\n  --max-cut-ops N         a boot is cut within its first N program/erase operations (200)");
+    printf("\n  --boot-timeout N        a boot running longer than N s is counted as a hang (2)");
+    printf("\n  --seed N                seed of the power cut test (1)");
+    printf("\n  --dies N                1 for a W25N01GW, 2 for a W25M02GW (1)");
+    printf("\n  --read-us N             page read time tRD (25)");
+    printf("\n  --program-us N          page program time tPROG (250)");
+    printf("\n  --erase-us N            block erase time tBERS (2000)");
+    printf("\n  --transfer-ns N         turnaround of every SPI transfer (3000)");
+    printf("\n  --image FILE            keep the flash image in FILE instead of anonymous memory");
+    printf("\n  --output FILE           write the JSON results to FILE instead of stdout");
+    printf("\n\n");
+}
+
+/*!
+ * @brief xorshift32 of the workloads
+ */
+static uint32_t bench_random(void)
+{
+    bench_random_state ^= bench_random_state << 13;
+    bench_random_state ^= bench_random_state >> 17;
+    bench_random_state ^= bench_random_state << 5;
+    return bench_random_state;
+}
+
+/*!
+ * @brief Content of a file at an offset, different for every file
+ */
+static uint8_t bench_pattern(uint32_t file, uint32_t offset)
+{
+    uint32_t value = (offset * 2654435761UL) ^ (file * 40503UL) ^ (offset >> 9);
+
+    return (uint8_t)(value ^ (value >> 13));
+}
+
+static void bench_fill(uint8_t *data, uint32_t file, uint32_t offset, uint32_t len)
+{
+    uint32_t idx;
+
+    for (idx = 0; idx < len; idx++)
+    {
+        data[idx] = bench_pattern(file, offset + idx);
+    }
+}
+
+/*!
+ * @brief Number of bytes that differ from the file content
+ */
+static uint32_t bench_check(const uint8_t *data, uint32_t file, uint32_t offset, uint32_t len)
+{
+    uint32_t idx, bad = 0;
+
+    for (idx = 0; idx < len; idx++)
+    {
+        if (data[idx] != bench_pattern(file, offset + idx))
+            bad++;
+    }
+
+    return bad;
+}
+
+static void bench_span_begin(struct bench_span *span)
+{
+    span->sim_ns = w25n_sim_time_ns();
+    span->wall_ns = bench_now_ns();
+    span->stats = *w25n_sim_stats();
+}
+
+/*!
+ * @brief Turns the start values of the span into the differences
+ */
+static void bench_span_end(struct bench_span *span)
+{
+    const struct w25n_sim_stats *now = w25n_sim_stats();
+
+    span->sim_ns = w25n_sim_time_ns() - span->sim_ns;
+    span->wall_ns = bench_now_ns() - span->wall_ns;
+    span->stats.spi_transfers = now->spi_transfers - span->stats.spi_transfers;
+    span->stats.spi_bytes = now->spi_bytes - span->stats.spi_bytes;
+    span->stats.busy_polls = now->busy_polls - span->stats.busy_polls;
+    span->stats.page_reads = now->page_reads - span->stats.page_reads;
+    span->stats.page_programs = now->page_programs - span->stats.page_programs;
+    span->stats.block_erases = now->block_erases - span->stats.block_erases;
+    span->stats.nop_violations = now->nop_violations - span->stats.nop_violations;
+    span->stats.program_conflicts = now->program_conflicts - span->stats.program_conflicts;
+    span->stats.protocol_errors = now->protocol_errors - span->stats.protocol_errors;
+    span->stats.power_cuts = now->power_cuts - span->stats.power_cuts;
+}
+
+static double bench_mb_s(uint64_t bytes, uint64_t ns)
+{
+    return (ns > 0) ? ((double)bytes * 1000.0 / (double)ns) : 0.0;
+}
+
+/*!
+ * @brief Mounts the file system like coines_open_comm_intf()
+ */
+static flog_result_t bench_mount(void)
+{
+    flog_initialize_params_t params = {
+        .number_of_blocks = FS_NUM_BLOCKS,
+        .pages_per_block = FS_PAGES_PER_BLOCK,
+    };
+
+    if (flogfs_initialize(&params) != FLOG_SUCCESS)
+        return FLOG_FAILURE;
+
+    return flogfs_mount();
+}
+
+/*!
+ * @brief Appends len bytes of the file content at offset, in writes of chunk bytes
+ *
+ * @return Bytes written
+ */
+static uint32_t bench_write_file(const char *name, uint32_t file, uint32_t offset, uint32_t len, uint32_t chunk)
+{
+    static flog_write_file_t wr;
+    uint32_t done = 0, part;
+
+    if (flogfs_open_write(&wr, name) != FLOG_SUCCESS)
+        return 0;
+
+    while (done < len)
+    {
+        part = MIN(chunk, len - done);
+        bench_fill(bench_buffer, file, offset + done, part);
+        if (flogfs_write(&wr, bench_buffer, part) != part)
+            break;
+        done += part;
+    }
+
+    if (flogfs_close_write(&wr) != FLOG_SUCCESS)
+        return 0;
+
+    return done;
+}
+
+/*!
+ * @brief Reads a whole file and compares it with its content
+ *
+ * @param[out] size : bytes read
+ *
+ * @return Bytes that differ, UINT32_MAX when the file cannot be opened
+ */
+static uint32_t bench_verify_file(const char *name, uint32_t file, uint32_t *size)
+{
+    static flog_read_file_t rd;
+    uint32_t len, bad = 0;
+
+    *size = 0;
+    if (flogfs_open_read(&rd, name) != FLOG_SUCCESS)
+        return UINT32_MAX;
+
+    while ((len = flogfs_read(&rd, bench_buffer, sizeof(bench_buffer))) > 0)
+    {
+        bad += bench_check(bench_buffer, file, *size, len);
+        *size += len;
+    }
+
+    (void)flogfs_close_read(&rd);
+
+    return bad;
+}
+
+/*!
+ * @brief Format of the erased chip and mount of the empty file system
+ */
+static void bench_format_mount(void)
+{
+    struct bench_span format, mount;
+    flog_result_t rslt;
+
+    bench_span_begin(&format);
+    rslt = bench_mount();
+    if (rslt != FLOG_SUCCESS)
+        rslt = flogfs_format();
+    bench_span_end(&format);
+
+    bench_span_begin(&mount);
+    if (rslt == FLOG_SUCCESS)
+        rslt = bench_mount();
+    bench_span_end(&mount);
+
+    if (rslt != FLOG_SUCCESS)
+    {
+        fprintf(stderr, "Format and mount of the erased flash failed\n");
+        bench_errors++;
+    }
+
+    fprintf(bench_out,
+            "\"format\":{\"sim_ms\":%.3f,\"wall_ms\":%.3f,\"erases\":%llu},\n"
+            "\"mount_empty\":{\"sim_ms\":%.3f,\"wall_ms\":%.3f,\"page_reads\":%llu},\n",
+            format.sim_ns / 1e6,
+            format.wall_ns / 1e6,
+            (unsigned long long)format.stats.block_erases,
+            mount.sim_ns / 1e6,
+            mount.wall_ns / 1e6,
+            (unsigned long long)mount.stats.page_reads);
+}
+
+/*!
+ * @brief One log file written and read sequentially
+ */
+static void bench_sequential(const struct bench_config *cfg)
+{
+    struct bench_span wr, rd;
+    uint32_t written, size, bad;
+
+    bench_span_begin(&wr);
+    written = bench_write_file("seq.log", 0, 0, cfg->seq_bytes, cfg->chunk);
+    bench_span_end(&wr);
+
+    bench_span_begin(&rd);
+    bad = bench_verify_file("seq.log", 0, &size);
+    bench_span_end(&rd);
+
+    if ((written != cfg->seq_bytes) || (size != written) || (bad != 0))
+    {
+        fprintf(stderr, "Sequential file: %lu of %lu bytes written, %lu read, %lu wrong\n",
+                (unsigned long)written, (unsigned long)cfg->seq_bytes, (unsigned long)size, (unsigned long)bad);
+        bench_errors++;
+    }
+
+    fprintf(bench_out,
+            "\"seq_write\":{\"bytes\":%lu,\"sim_mb_s\":%.3f,\"wall_mb_s\":%.3f,\"programs\":%llu,\"erases\":%llu},\n",
+            (unsigned long)written,
+            bench_mb_s(written, wr.sim_ns),
+            bench_mb_s(written, wr.wall_ns),
+            (unsigned long long)wr.stats.page_programs,
+            (unsigned long long)wr.stats.block_erases);
+    fprintf(bench_out,
+            "\"seq_read\":{\"bytes\":%lu,\"sim_mb_s\":%.3f,\"wall_mb_s\":%.3f,\"page_reads\":%llu,\"errors\":%lu},\n",
+            (unsigned long)size,
+            bench_mb_s(size, rd.sim_ns),
+            bench_mb_s(size, rd.wall_ns),
+            (unsigned long long)rd.stats.page_reads,
+            (unsigned long)((bad == UINT32_MAX) ? 1 : bad));
+}
+
+/*!
+ * @brief Many small files, each created, written and closed, then all read back
+ */
+/*!
+ * @brief Opens the log file of bench_sequential(), seeks to random offsets and reads there
+ */
+static void bench_seek(void)
+{
+    static flog_read_file_t rd;
+    struct bench_span open, seek;
+    uint32_t idx, size, offset, len, errors = 0;
+
+    bench_span_begin(&open);
+    if (flogfs_open_read(&rd, "seq.log") != FLOG_SUCCESS)
+    {
+        fprintf(stderr, "Seek: unable to open the log file\n");
+        bench_errors++;
+        return;
+    }
+    bench_span_end(&open);
+    size = flogfs_read_file_size(&rd);
+
+    bench_span_begin(&seek);
+    for (idx = 0; (idx < BENCH_SEEKS) && (size > BENCH_SEEK_READ); idx++)
+    {
+        offset = bench_random() % (size - BENCH_SEEK_READ);
+        if ((flogfs_read_seek(&rd, offset) != FLOG_SUCCESS) || (flogfs_read_tell(&rd) != offset))
+        {
+            errors++;
+            continue;
+        }
+        len = flogfs_read(&rd, bench_buffer, BENCH_SEEK_READ);
+        if ((len != BENCH_SEEK_READ) || (bench_check(bench_buffer, 0, offset, len) != 0))
+            errors++;
+    }
+    bench_span_end(&seek);
+
+    /* The end of the file */
+    if ((flogfs_read_seek(&rd, size) != FLOG_SUCCESS) || (flogfs_read(&rd, bench_buffer, 1) != 0))
+        errors++;
+
+    (void)flogfs_close_read(&rd);
+
+    if (errors != 0)
+    {
+        fprintf(stderr, "Seek: %lu of %lu seeks wrong\n", (unsigned long)errors, (unsigned long)BENCH_SEEKS);
+        bench_errors++;
+    }
+
+    fprintf(bench_out,
+            "\"seek\":{\"size\":%lu,\"open_ms\":%.3f,\"open_page_reads\":%llu,\"seeks\":%lu,\"seek_ms_mean\":%.3f,"
+            "\"page_reads_per_seek\":%.1f,\"errors\":%lu},\n",
+            (unsigned long)size,
+            open.sim_ns / 1e6,
+            (unsigned long long)open.stats.page_reads,
+            (unsigned long)BENCH_SEEKS,
+            seek.sim_ns / 1e6 / BENCH_SEEKS,
+            (double)seek.stats.page_reads / BENCH_SEEKS,
+            (unsigned long)errors);
+}
+
+static void bench_small_files(const struct bench_config *cfg)
+{
+    struct bench_span wr, rd;
+    char name[FLOG_MAX_FNAME_LEN];
+    uint32_t idx, size, bad, written = 0, read = 0, errors = 0;
+
+    bench_span_begin(&wr);
+    for (idx = 0; idx < cfg->files; idx++)
+    {
+        snprintf(name, sizeof(name), "small%lu.bin", (unsigned long)idx);
+        written += bench_write_file(name, idx + 1, 0, cfg->file_bytes, cfg->chunk);
+    }
+    bench_span_end(&wr);
+
+    bench_span_begin(&rd);
+    for (idx = 0; idx < cfg->files; idx++)
+    {
+        snprintf(name, sizeof(name), "small%lu.bin", (unsigned long)idx);
+        bad = bench_verify_file(name, idx + 1, &size);
+        read += size;
+        if ((bad != 0) || (size != cfg->file_bytes))
+            errors++;
+    }
+    bench_span_end(&rd);
+
+    if ((errors != 0) || (written != cfg->files * cfg->file_bytes))
+    {
+        fprintf(stderr, "Small files: %lu of %lu bytes written, %lu files wrong\n",
+                (unsigned long)written, (unsigned long)(cfg->files * cfg->file_bytes), (unsigned long)errors);
+        bench_errors++;
+    }
+
+    fprintf(bench_out,
+            "\"small_files\":{\"files\":%lu,\"bytes\":%lu,\"create_ms_mean\":%.3f,\"sim_mb_s\":%.3f,"
+            "\"read_sim_mb_s\":%.3f,\"programs\":%llu,\"erases\":%llu,\"errors\":%lu},\n",
+            (unsigned long)cfg->files,
+            (unsigned long)written,
+            cfg->files ? (wr.sim_ns / 1e6 / cfg->files) : 0.0,
+            bench_mb_s(written, wr.sim_ns),
+            bench_mb_s(read, rd.sim_ns),
+            (unsigned long long)wr.stats.page_programs,
+            (unsigned long long)wr.stats.block_erases,
+            (unsigned long)errors);
+}
+
+/*!
+ * @brief Files created and deleted again, by flogfs_rm() and by flogfs_invalidate() followed
+ *        by flog_delete_invalidated_block()
+ */
+static void bench_churn(const struct bench_config *cfg)
+{
+    struct bench_span span;
+    char name[FLOG_MAX_FNAME_LEN];
+    uint32_t round, removed = 0, invalidated = 0, errors = 0;
+    uint64_t delete_ns = 0, start_ns;
+
+    bench_span_begin(&span);
+    for (round = 0; round < cfg->churn_rounds; round++)
+    {
+        snprintf(name, sizeof(name), "churn%lu.bin", (unsigned long)(round % 8));
+        if (bench_write_file(name, round, 0, cfg->file_bytes, cfg->chunk) != cfg->file_bytes)
+        {
+            errors++;
+            continue;
+        }
+
+        start_ns = w25n_sim_time_ns();
+        if (round & 1)
+        {
+            if (flogfs_invalidate(name) == FLOG_SUCCESS)
+            {
+                flog_delete_invalidated_block();
+                invalidated++;
+            }
+            else
+                errors++;
+        }
+        else
+        {
+            if (flogfs_rm(name) == FLOG_SUCCESS)
+                removed++;
+            else
+                errors++;
+        }
+        delete_ns += w25n_sim_time_ns() - start_ns;
+
+        if (flogfs_check_exists(name) == FLOG_SUCCESS)
+            errors++;
+    }
+    bench_span_end(&span);
+
+    if (errors != 0)
+    {
+        fprintf(stderr, "Churn: %lu failed rounds\n", (unsigned long)errors);
+        bench_errors++;
+    }
+
+    fprintf(bench_out,
+            "\"churn\":{\"rounds\":%lu,\"rm\":%lu,\"invalidate\":%lu,\"rounds_s\":%.1f,\"delete_ms_mean\":%.3f,"
+            "\"erases\":%llu,\"errors\":%lu},\n",
+            (unsigned long)cfg->churn_rounds,
+            (unsigned long)removed,
+            (unsigned long)invalidated,
+            span.sim_ns ? (cfg->churn_rounds * 1e9 / span.sim_ns) : 0.0,
+            (removed + invalidated) ? (delete_ns / 1e6 / (removed + invalidated)) : 0.0,
+            (unsigned long long)span.stats.block_erases,
+            (unsigned long)errors);
+}
+
+/*!
+ * @brief Mount of the populated file system, as after a reset of the board
+ */
+static void bench_remount(void)
+{
+    struct bench_span span;
+    flogfs_ls_iterator_t iter;
+    char name[FLOG_MAX_FNAME_LEN];
+    uint32_t files = 0;
+    flog_result_t rslt;
+
+    bench_span_begin(&span);
+    rslt = bench_mount();
+    bench_span_end(&span);
+
+    if (rslt == FLOG_SUCCESS)
+    {
+        flogfs_start_ls(&iter);
+        while (flogfs_ls_iterate(&iter, name))
+        {
+            files++;
+        }
+        flogfs_stop_ls(&iter);
+    }
+    else
+    {
+        fprintf(stderr, "Mount of the populated file system failed\n");
+        bench_errors++;
+    }
+
+    fprintf(bench_out,
+            "\"mount\":{\"files\":%lu,\"sim_ms\":%.3f,\"wall_ms\":%.3f,\"page_reads\":%llu,\"spi_bytes\":%llu},\n",
+            (unsigned long)files,
+            span.sim_ns / 1e6,
+            span.wall_ns / 1e6,
+            (unsigned long long)span.stats.page_reads,
+            (unsigned long long)span.stats.spi_bytes);
+}
+
+/*!
+ * @brief Random creates, appends and deletions, comparing the block counts kept by the file
+ *        system with the counts of a mount, which scans the flash
+ */
+static void bench_blocks(const struct bench_config *cfg)
+{
+    uint32_t sizes[BENCH_BLOCK_FILES] = { 0 };
+    char name[FLOG_MAX_FNAME_LEN];
+    flogfs_block_usage_t kept, scanned;
+    uint32_t op, file, len, checks = 0, errors = 0, pending = 0;
+    uint64_t scan_ns = 0, query_ns = 0, queries = 0, start_ns;
+
+    /* The first query after the mount of bench_remount() scans */
+    start_ns = w25n_sim_time_ns();
+    if (flogfs_block_usage(&kept) != FLOG_SUCCESS)
+        errors++;
+    scan_ns += w25n_sim_time_ns() - start_ns;
+
+    for (op = 1; op <= BENCH_BLOCK_OPS; op++)
+    {
+        file = bench_random() % BENCH_BLOCK_FILES;
+        snprintf(name, sizeof(name), "blocks%lu.bin", (unsigned long)file);
+
+        /* An invalidated file is erased one operation later, as by the MTP glue */
+        if (pending)
+        {
+            flog_delete_invalidated_block();
+            pending = 0;
+        }
+
+        switch ((sizes[file] == 0) ? 0 : (bench_random() % 3))
+        {
+            case 0:
+                /* Up to two and a half blocks */
+                len = bench_random() % (FS_PAGES_PER_BLOCK * FS_SECTORS_PER_PAGE * FS_SECTOR_SIZE * 5 / 2);
+                if (bench_write_file(name, file, sizes[file], len, cfg->chunk) != len)
+                    errors++;
+                sizes[file] += len;
+                break;
+            case 1:
+                if (flogfs_rm(name) != FLOG_SUCCESS)
+                    errors++;
+                sizes[file] = 0;
+                break;
+            default:
+                if (flogfs_invalidate(name) != FLOG_SUCCESS)
+                    errors++;
+                pending = 1;
+                sizes[file] = 0;
+                break;
+        }
+
+        start_ns = w25n_sim_time_ns();
+        if (flogfs_block_usage(&kept) != FLOG_SUCCESS)
+            errors++;
+        query_ns += w25n_sim_time_ns() - start_ns;
+        queries++;
+
+        if ((op % BENCH_BLOCK_CHECK) != 0)
+            continue;
+
+        /* The mount is a reset, it finds the pending invalidation on flash again */
+        if (bench_mount() != FLOG_SUCCESS)
+        {
+            errors++;
+            break;
+        }
+        start_ns = w25n_sim_time_ns();
+        if (flogfs_block_usage(&scanned) != FLOG_SUCCESS)
+            errors++;
+        scan_ns += w25n_sim_time_ns() - start_ns;
+        checks++;
+
+        if ((kept.free_blocks != scanned.free_blocks) || (kept.used_blocks != scanned.used_blocks) ||
+            (kept.invalidated_blocks != scanned.invalidated_blocks))
+        {
+            fprintf(stderr,
+                    "Block counts after %lu operations: free %u used %u invalidated %u, mount: %u %u %u\n",
+                    (unsigned long)op,
+                    kept.free_blocks,
+                    kept.used_blocks,
+                    kept.invalidated_blocks,
+                    scanned.free_blocks,
+                    scanned.used_blocks,
+                    scanned.invalidated_blocks);
+            errors++;
+        }
+    }
+
+    if (errors != 0)
+    {
+        fprintf(stderr, "Block counts: %lu errors\n", (unsigned long)errors);
+        bench_errors++;
+    }
+
+    fprintf(bench_out,
+            "\"blocks\":{\"operations\":%lu,\"checks\":%lu,\"free\":%u,\"used\":%u,\"scan_ms_mean\":%.3f,"
+            "\"query_us_mean\":%.3f,\"errors\":%lu},\n",
+            (unsigned long)BENCH_BLOCK_OPS,
+            (unsigned long)checks,
+            kept.free_blocks,
+            kept.used_blocks,
+            (scan_ns / 1e6) / (checks + 1),
+            queries ? (query_ns / 1e3 / queries) : 0.0,
+            (unsigned long)errors);
+}
+
+/*!
+ * @brief Lists the files with their sizes after the mount, like the MTP object handles, and
+ *        looks every file up by name
+ */
+static void bench_ls(void)
+{
+    static char names[BENCH_MAX_LS][FLOG_MAX_FNAME_LEN];
+    static uint32_t sizes[BENCH_MAX_LS];
+    static flog_read_file_t rd;
+    struct bench_span cold, warm, open, lookup;
+    flogfs_ls_iterator_t iter;
+    char name[FLOG_MAX_FNAME_LEN];
+    uint32_t files = 0, idx, size, errors = 0;
+
+    /* The first listing after the mount finds the sizes, the second one has them */
+    bench_span_begin(&cold);
+    flogfs_start_ls(&iter);
+    while ((files < BENCH_MAX_LS) && flogfs_ls_iterate_size(&iter, names[files], &sizes[files]))
+    {
+        files++;
+    }
+    flogfs_stop_ls(&iter);
+    bench_span_end(&cold);
+
+    bench_span_begin(&warm);
+    idx = 0;
+    flogfs_start_ls(&iter);
+    while (flogfs_ls_iterate_size(&iter, name, &size))
+    {
+        if ((idx >= files) || (strcmp(name, names[idx]) != 0) || (size != sizes[idx]))
+            errors++;
+        idx++;
+    }
+    flogfs_stop_ls(&iter);
+    bench_span_end(&warm);
+
+    /* The sizes as an application got them so far: open every file */
+    bench_span_begin(&open);
+    idx = 0;
+    flogfs_start_ls(&iter);
+    while (flogfs_ls_iterate(&iter, name))
+    {
+        if (flogfs_open_read(&rd, name) != FLOG_SUCCESS)
+        {
+            errors++;
+            continue;
+        }
+        if ((idx >= files) || (flogfs_read_file_size(&rd) != sizes[idx]))
+            errors++;
+        (void)flogfs_close_read(&rd);
+        idx++;
+    }
+    flogfs_stop_ls(&iter);
+    bench_span_end(&open);
+
+    bench_span_begin(&lookup);
+    for (idx = 0; idx < files; idx++)
+    {
+        if (flogfs_check_exists(names[idx]) != FLOG_SUCCESS)
+            errors++;
+    }
+    if (flogfs_check_exists("missing.bin") == FLOG_SUCCESS)
+        errors++;
+    bench_span_end(&lookup);
+
+    if (errors != 0)
+    {
+        fprintf(stderr, "Listing: %lu files wrong\n", (unsigned long)errors);
+        bench_errors++;
+    }
+
+    fprintf(bench_out,
+            "\"ls\":{\"files\":%lu,\"cold_ms\":%.3f,\"cold_page_reads\":%llu,\"warm_ms\":%.3f,\"warm_page_reads\":%llu,"
+            "\"open_each_ms\":%.3f,\"open_each_page_reads\":%llu,\"lookup_ms_mean\":%.3f,\"lookup_page_reads\":%llu,"
+            "\"errors\":%lu},\n",
+            (unsigned long)files,
+            cold.sim_ns / 1e6,
+            (unsigned long long)cold.stats.page_reads,
+            warm.sim_ns / 1e6,
+            (unsigned long long)warm.stats.page_reads,
+            open.sim_ns / 1e6,
+            (unsigned long long)open.stats.page_reads,
+            (files + 1) ? (lookup.sim_ns / 1e6 / (files + 1)) : 0.0,
+            (unsigned long long)lookup.stats.page_reads,
+            (unsigned long)errors);
+}
+
+/*!
+ * @brief Files invalidated at once and erased by flogfs_gc() in the budget of one erase, and a log
+ *        written after a format with and without flogfs_gc() in the pauses between the writes
+ */
+static void bench_gc(const struct bench_config *cfg)
+{
+    char name[FLOG_MAX_FNAME_LEN];
+    flogfs_block_usage_t before, queued, after;
+    uint32_t file, len, calls = 0, errors = 0;
+    uint32_t erases_plain = 0, erases_gc = 0;
+    uint64_t invalidate_ns = 0, call_ns_max = 0, write_ns_plain = 0, write_ns_gc = 0, start_ns;
+
+    /* One and a half blocks per file */
+    len = FS_PAGES_PER_BLOCK * FS_SECTORS_PER_PAGE * FS_SECTOR_SIZE * 3 / 2;
+    for (file = 0; file < BENCH_GC_FILES; file++)
+    {
+        snprintf(name, sizeof(name), "gc%lu.bin", (unsigned long)file);
+        if (bench_write_file(name, file, 0, len, cfg->chunk) != len)
+            errors++;
+    }
+
+    if (flogfs_block_usage(&before) != FLOG_SUCCESS)
+        errors++;
+    for (file = 0; file < BENCH_GC_FILES; file++)
+    {
+        snprintf(name, sizeof(name), "gc%lu.bin", (unsigned long)file);
+        start_ns = w25n_sim_time_ns();
+        if (flogfs_invalidate(name) != FLOG_SUCCESS)
+            errors++;
+        invalidate_ns += w25n_sim_time_ns() - start_ns;
+    }
+    if (flogfs_block_usage(&queued) != FLOG_SUCCESS)
+        errors++;
+
+    /* Every call starts one erase and returns, the next one comes a period later */
+    do
+    {
+        w25n_sim_idle(BENCH_GC_PERIOD_US);
+        start_ns = w25n_sim_time_ns();
+        len = flogfs_gc(FS_ERASE_US);
+        call_ns_max = MAX(call_ns_max, w25n_sim_time_ns() - start_ns);
+        calls++;
+    } while ((len > 0) && (calls <= FS_NUM_BLOCKS));
+
+    if (flogfs_block_usage(&after) != FLOG_SUCCESS)
+        errors++;
+    if ((len != 0) || (after.invalidated_blocks != 0) ||
+        (after.free_blocks != before.free_blocks + queued.invalidated_blocks - before.invalidated_blocks))
+        errors++;
+
+    bench_gc_log(cfg, 0, &write_ns_plain, &erases_plain);
+    bench_gc_log(cfg, 1, &write_ns_gc, &erases_gc);
+    if ((erases_gc != 0) || (write_ns_plain == 0))
+        errors++;
+
+    if (errors != 0)
+    {
+        fprintf(stderr, "Garbage collection: %lu errors\n", (unsigned long)errors);
+        bench_errors++;
+    }
+
+    fprintf(bench_out,
+            "\"gc\":{\"files\":%lu,\"blocks\":%u,\"invalidate_ms_mean\":%.3f,\"calls\":%lu,\"call_ms_max\":%.3f,"
+            "\"log_write_ms_max\":%.3f,\"log_write_erases\":%lu,\"log_gc_write_ms_max\":%.3f,\"log_gc_write_erases\":%lu,"
+            "\"errors\":%lu},\n",
+            (unsigned long)BENCH_GC_FILES,
+            (unsigned)(queued.invalidated_blocks - before.invalidated_blocks),
+            invalidate_ns / 1e6 / BENCH_GC_FILES,
+            (unsigned long)calls,
+            call_ns_max / 1e6,
+            write_ns_plain / 1e6,
+            (unsigned long)erases_plain,
+            write_ns_gc / 1e6,
+            (unsigned long)erases_gc,
+            (unsigned long)errors);
+}
+
+/*!
+ * @brief Files invalidated and erased by a child process, which a power cut stops after more
+ *        operations every round. The mount after the cut has to queue the blocks of the
+ *        invalidated files again, all blocks are free once the files left are deleted.
+ */
+static void bench_gc_cut(const struct bench_config *cfg)
+{
+    char name[FLOG_MAX_FNAME_LEN];
+    flogfs_block_usage_t before, after;
+    uint32_t file, len, round, cut_after, cuts = 0, leaked = 0, errors = 0;
+    uint8_t completed = 0;
+    pid_t pid;
+    int status;
+
+    /* One and a half blocks per file */
+    len = FS_PAGES_PER_BLOCK * FS_SECTORS_PER_PAGE * FS_SECTOR_SIZE * 3 / 2;
+
+    /* The last round is not cut, every invalidation and erase ends */
+    for (round = 0; !completed; round++)
+    {
+        if ((flogfs_format() != FLOG_SUCCESS) || (bench_mount() != FLOG_SUCCESS) ||
+            (flogfs_block_usage(&before) != FLOG_SUCCESS))
+        {
+            errors++;
+            break;
+        }
+        for (file = 0; file < BENCH_GC_FILES; file++)
+        {
+            snprintf(name, sizeof(name), "gc%lu.bin", (unsigned long)file);
+            if (bench_write_file(name, file, 0, len, cfg->chunk) != len)
+                errors++;
+        }
+
+        (void)W25N01GW_waitReady();
+        fflush(bench_out);
+        cut_after = 1 + round * BENCH_GC_CUT_STEP;
+
+        pid = fork();
+        if (pid < 0)
+        {
+            errors++;
+            break;
+        }
+        if (pid == 0)
+        {
+            w25n_sim_power_cut_after(cut_after, bench_random());
+            for (file = 0; file < BENCH_GC_FILES; file++)
+            {
+                snprintf(name, sizeof(name), "gc%lu.bin", (unsigned long)file);
+                (void)flogfs_invalidate(name);
+            }
+            flog_delete_invalidated_block();
+            _exit(EXIT_SUCCESS);
+        }
+        if ((waitpid(pid, &status, 0) != pid) ||
+            (!WIFEXITED(status) || ((WEXITSTATUS(status) != W25N_SIM_POWER_CUT_EXIT) &&
+                                    (WEXITSTATUS(status) != EXIT_SUCCESS))))
+        {
+            errors++;
+            break;
+        }
+        if (WEXITSTATUS(status) == W25N_SIM_POWER_CUT_EXIT)
+            cuts++;
+        else
+            completed = 1;
+
+        /* A reset, the queue of the child is gone with its RAM */
+        if (bench_mount() != FLOG_SUCCESS)
+        {
+            errors++;
+            break;
+        }
+        for (file = 0; file < BENCH_GC_FILES; file++)
+        {
+            snprintf(name, sizeof(name), "gc%lu.bin", (unsigned long)file);
+            if ((flogfs_check_exists(name) == FLOG_SUCCESS) && (flogfs_rm(name) != FLOG_SUCCESS))
+                errors++;
+        }
+        flog_delete_invalidated_block();
+
+        if (flogfs_block_usage(&after) != FLOG_SUCCESS)
+            errors++;
+        else if (after.free_blocks < before.free_blocks)
+            leaked += before.free_blocks - after.free_blocks;
+    }
+
+    if ((errors + leaked) != 0)
+    {
+        fprintf(stderr, "Invalidation power cuts: %lu blocks leaked, %lu errors\n", (unsigned long)leaked,
+                (unsigned long)errors);
+        bench_errors++;
+    }
+
+    fprintf(bench_out,
+            "\"gc_cut\":{\"rounds\":%lu,\"cuts\":%lu,\"leaked_blocks\":%lu,\"errors\":%lu},\n",
+            (unsigned long)round,
+            (unsigned long)cuts,
+            (unsigned long)leaked,
+            (unsigned long)errors);
+}
+
+/*!
+ * @brief Formats, mounts and writes a log with a pause after every write
+ *
+ * @param[in] gc : run flogfs_gc() every BENCH_GC_PERIOD_US of the pauses
+ * @param[out] write_ns_max : longest write
+ * @param[out] erases : erases inside the writes
+ */
+static void bench_gc_log(const struct bench_config *cfg, uint8_t gc, uint64_t *write_ns_max, uint32_t *erases)
+{
+    static flog_write_file_t wr;
+    uint32_t done = 0, part, idle = 0, size;
+    uint64_t start_ns, start_erases;
+
+    *write_ns_max = 0;
+    *erases = 0;
+    if ((flogfs_format() != FLOG_SUCCESS) || (bench_mount() != FLOG_SUCCESS) ||
+        (flogfs_open_write(&wr, "gc.log") != FLOG_SUCCESS))
+        return;
+
+    while (done < BENCH_GC_LOG_BYTES)
+    {
+        part = MIN(cfg->chunk, BENCH_GC_LOG_BYTES - done);
+        bench_fill(bench_buffer, 0, done, part);
+
+        start_ns = w25n_sim_time_ns();
+        start_erases = w25n_sim_stats()->block_erases;
+        if (flogfs_write(&wr, bench_buffer, part) != part)
+            break;
+        *write_ns_max = MAX(*write_ns_max, w25n_sim_time_ns() - start_ns);
+        *erases += (uint32_t)(w25n_sim_stats()->block_erases - start_erases);
+        done += part;
+
+        w25n_sim_idle(BENCH_GC_IDLE_US);
+        idle += BENCH_GC_IDLE_US;
+        if (gc && (idle >= BENCH_GC_PERIOD_US))
+        {
+            (void)flogfs_gc(FS_ERASE_US);
+            idle = 0;
+        }
+    }
+
+    if ((flogfs_close_write(&wr) != FLOG_SUCCESS) || (bench_verify_file("gc.log", 0, &size) != 0) ||
+        (size != BENCH_GC_LOG_BYTES))
+        *write_ns_max = 0;
+}
+
+/*!
+ * @brief Mount of a nearly full chip, with the state found on flash after a power cut and from
+ *        the checkpoint of flogfs_unmount(). The first allocation and the block counts are
+ *        measured with the mount, as they scan the blocks without a checkpoint.
+ */
+static void bench_checkpoint(const struct bench_config *cfg)
+{
+    char name[FLOG_MAX_FNAME_LEN];
+    struct bench_span scan_mount, scan, fast_mount, fast;
+    flogfs_block_usage_t scan_usage, fast_usage, rescan_usage;
+    uint32_t file, size, errors = 0;
+
+    if ((flogfs_format() != FLOG_SUCCESS) || (bench_mount() != FLOG_SUCCESS))
+        errors++;
+    for (file = 0; file < BENCH_CHECKPOINT_FILES; file++)
+    {
+        snprintf(name, sizeof(name), "cp%lu.bin", (unsigned long)file);
+        if (bench_write_file(name, file, 0, BENCH_CHECKPOINT_FILE_BYTES, cfg->chunk) != BENCH_CHECKPOINT_FILE_BYTES)
+            errors++;
+    }
+
+    /* Power cut, the files were changed after the last checkpoint */
+    bench_span_begin(&scan);
+    bench_span_begin(&scan_mount);
+    if (bench_mount() != FLOG_SUCCESS)
+        errors++;
+    bench_span_end(&scan_mount);
+    if ((bench_write_file("cp_scan.bin", 0, 0, cfg->chunk, cfg->chunk) != cfg->chunk) ||
+        (flogfs_block_usage(&scan_usage) != FLOG_SUCCESS))
+        errors++;
+    bench_span_end(&scan);
+
+    if (flogfs_unmount() != FLOG_SUCCESS)
+        errors++;
+    bench_span_begin(&fast);
+    bench_span_begin(&fast_mount);
+    if (bench_mount() != FLOG_SUCCESS)
+        errors++;
+    bench_span_end(&fast_mount);
+    if ((bench_write_file("cp_fast.bin", 1, 0, cfg->chunk, cfg->chunk) != cfg->chunk) ||
+        (flogfs_block_usage(&fast_usage) != FLOG_SUCCESS))
+        errors++;
+    bench_span_end(&fast);
+
+    /* The write outdated the checkpoint, this mount counts the blocks on flash again */
+    if ((bench_mount() != FLOG_SUCCESS) || (flogfs_block_usage(&rescan_usage) != FLOG_SUCCESS))
+        errors++;
+    if ((fast_usage.free_blocks != rescan_usage.free_blocks) ||
+        (fast_usage.used_blocks != rescan_usage.used_blocks) ||
+        (fast_usage.invalidated_blocks != rescan_usage.invalidated_blocks) ||
+        (fast_usage.free_blocks + 1 != scan_usage.free_blocks))
+        errors++;
+    if ((bench_verify_file("cp_scan.bin", 0, &size) != 0) || (size != cfg->chunk) ||
+        (bench_verify_file("cp_fast.bin", 1, &size) != 0) || (size != cfg->chunk))
+        errors++;
+    for (file = 0; file < BENCH_CHECKPOINT_FILES; file += BENCH_CHECKPOINT_FILES - 1)
+    {
+        snprintf(name, sizeof(name), "cp%lu.bin", (unsigned long)file);
+        if ((bench_verify_file(name, file, &size) != 0) || (size != BENCH_CHECKPOINT_FILE_BYTES))
+            errors++;
+    }
+
+    if (errors != 0)
+    {
+        fprintf(stderr, "Checkpoint: %lu errors\n", (unsigned long)errors);
+        bench_errors++;
+    }
+
+    fprintf(bench_out,
+            "\"checkpoint\":{\"used_blocks\":%lu,\"free_blocks\":%lu,"
+            "\"scan_mount_ms\":%.3f,\"scan_ms\":%.3f,\"scan_page_reads\":%llu,"
+            "\"checkpoint_mount_ms\":%.3f,\"checkpoint_ms\":%.3f,\"checkpoint_page_reads\":%llu,\"errors\":%lu},\n",
+            (unsigned long)fast_usage.used_blocks,
+            (unsigned long)fast_usage.free_blocks,
+            scan_mount.sim_ns / 1e6,
+            scan.sim_ns / 1e6,
+            (unsigned long long)scan.stats.page_reads,
+            fast_mount.sim_ns / 1e6,
+            fast.sim_ns / 1e6,
+            (unsigned long long)fast.stats.page_reads,
+            (unsigned long)errors);
+}
+
+/*!
+ * @brief Flash totals and erase count spread of the benchmark sections
+ */
+static void bench_flash(void)
+{
+    const struct w25n_sim_stats *stats = w25n_sim_stats();
+    uint32_t block, count, min = UINT32_MAX, max = 0, used = 0;
+    uint64_t sum = 0;
+
+    for (block = 0; block < (uint32_t)w25n_sim_dies() * W25N_SIM_BLOCKS; block++)
+    {
+        count = w25n_sim_erase_count((uint16_t)block);
+        sum += count;
+        min = MIN(min, count);
+        max = MAX(max, count);
+        if (count > 0)
+            used++;
+    }
+
+    fprintf(bench_out,
+            "\"flash\":{\"sim_s\":%.3f,\"page_reads\":%llu,\"page_programs\":%llu,\"block_erases\":%llu,"
+            "\"erase_min\":%lu,\"erase_max\":%lu,\"erase_mean\":%.3f,\"blocks_erased\":%lu,"
+            "\"nop_violations\":%llu,\"program_conflicts\":%llu,\"protocol_errors\":%llu,\"busy_polls\":%llu,"
+            "\"spi_transfers\":%llu,\"spi_bytes\":%llu},\n",
+            w25n_sim_time_ns() / 1e9,
+            (unsigned long long)stats->page_reads,
+            (unsigned long long)stats->page_programs,
+            (unsigned long long)stats->block_erases,
+            (unsigned long)min,
+            (unsigned long)max,
+            (double)sum / (w25n_sim_dies() * W25N_SIM_BLOCKS),
+            (unsigned long)used,
+            (unsigned long long)stats->nop_violations,
+            (unsigned long long)stats->program_conflicts,
+            (unsigned long long)stats->protocol_errors,
+            (unsigned long long)stats->busy_polls,
+            (unsigned long long)stats->spi_transfers,
+            (unsigned long long)stats->spi_bytes);
+
+    if (stats->protocol_errors != 0)
+        bench_errors++;
+}
+
+/*!
+ * @brief Two files written in turns, a chunk to each
+ *
+ * @param[out] span : the writes of both files
+ *
+ * @return Bytes written to both
+ */
+static uint32_t bench_dies_pair(const struct bench_config *cfg, struct bench_span *span)
+{
+    static flog_write_file_t wr[2];
+    uint32_t done = 0, part, size, file;
+
+    bench_span_begin(span);
+    if ((flogfs_open_write(&wr[0], "pair0.log") != FLOG_SUCCESS) ||
+        (flogfs_open_write(&wr[1], "pair1.log") != FLOG_SUCCESS))
+        return 0;
+
+    while (done < BENCH_DIES_BYTES)
+    {
+        part = MIN(cfg->chunk, (BENCH_DIES_BYTES - done) / 2);
+        for (file = 0; file < 2; file++)
+        {
+            bench_fill(bench_buffer, file + 1, done / 2, part);
+            if (flogfs_write(&wr[file], bench_buffer, part) != part)
+                return 0;
+        }
+        done += 2 * part;
+    }
+
+    if ((flogfs_close_write(&wr[0]) != FLOG_SUCCESS) || (flogfs_close_write(&wr[1]) != FLOG_SUCCESS))
+        return 0;
+    bench_span_end(span);
+
+    for (file = 0; file < 2; file++)
+    {
+        if ((bench_verify_file(file ? "pair1.log" : "pair0.log", file + 1, &size) != 0) || (size != done / 2))
+            return 0;
+    }
+
+    return done;
+}
+
+/*!
+ * @brief A log written with flogfs_gc() after every write, erasing the blocks of an invalidated one
+ *
+ * @param[out] span : the writes of the log
+ *
+ * @return Bytes written
+ */
+static uint32_t bench_dies_gc(const struct bench_config *cfg, struct bench_span *span)
+{
+    static flog_write_file_t wr;
+    uint32_t done = 0, part, size;
+
+    if ((bench_write_file("old.log", 3, 0, BENCH_DIES_BYTES, cfg->chunk) != BENCH_DIES_BYTES) ||
+        (flogfs_invalidate("old.log") != FLOG_SUCCESS) || (flogfs_open_write(&wr, "gc.log") != FLOG_SUCCESS))
+        return 0;
+
+    bench_span_begin(span);
+    while (done < BENCH_DIES_BYTES)
+    {
+        part = MIN(cfg->chunk, BENCH_DIES_BYTES - done);
+        bench_fill(bench_buffer, 4, done, part);
+        if (flogfs_write(&wr, bench_buffer, part) != part)
+            return 0;
+        (void)flogfs_gc(FS_ERASE_US);
+        done += part;
+    }
+    bench_span_end(span);
+
+    if ((flogfs_close_write(&wr) != FLOG_SUCCESS) || (bench_verify_file("gc.log", 4, &size) != 0) ||
+        (size != done))
+        return 0;
+
+    return done;
+}
+
+/*!
+ * @brief Write throughput of a W25N01GW and of a W25M02GW, whose FLogFS allocates the blocks on
+ *        the dies in turns: a log written alone, two logs written in turns, and a log written
+ *        while flogfs_gc() erases. The chip is erased before and after.
+ */
+static void bench_dies(const struct bench_config *cfg)
+{
+    struct bench_span log[W25N_SIM_MAX_DIES], pair[W25N_SIM_MAX_DIES], gc[W25N_SIM_MAX_DIES];
+    flogfs_block_usage_t usage[W25N_SIM_MAX_DIES];
+    uint32_t dies, size, errors = 0;
+
+    for (dies = 1; dies <= W25N_SIM_MAX_DIES; dies++)
+    {
+        w25n_sim_set_dies((uint8_t)dies);
+        if ((bench_mount() == FLOG_SUCCESS) || (flogfs_format() != FLOG_SUCCESS) || (bench_mount() != FLOG_SUCCESS))
+            errors++;
+
+        bench_span_begin(&log[dies - 1]);
+        if (bench_write_file("dies.log", 0, 0, BENCH_DIES_BYTES, cfg->chunk) != BENCH_DIES_BYTES)
+            errors++;
+        bench_span_end(&log[dies - 1]);
+        if ((bench_verify_file("dies.log", 0, &size) != 0) || (size != BENCH_DIES_BYTES))
+            errors++;
+
+        if (bench_dies_pair(cfg, &pair[dies - 1]) != BENCH_DIES_BYTES)
+            errors++;
+
+        if (bench_dies_gc(cfg, &gc[dies - 1]) != BENCH_DIES_BYTES)
+            errors++;
+
+        /* Blocks on both dies are counted after a mount */
+        if ((bench_mount() != FLOG_SUCCESS) || (flogfs_block_usage(&usage[dies - 1]) != FLOG_SUCCESS) ||
+            ((uint32_t)(usage[dies - 1].free_blocks + usage[dies - 1].invalidated_blocks +
+                        usage[dies - 1].used_blocks) < dies * W25N_SIM_BLOCKS - 1))
+            errors++;
+        if (w25n_sim_stats()->protocol_errors != 0)
+            errors++;
+    }
+
+    w25n_sim_set_dies((uint8_t)cfg->dies);
+
+    if (errors != 0)
+    {
+        fprintf(stderr, "Dies: %lu errors\n", (unsigned long)errors);
+        bench_errors++;
+    }
+
+    fprintf(bench_out,
+            "\"dies\":{\"w25n01gw\":{\"blocks\":%lu,\"log_mb_s\":%.3f,\"pair_mb_s\":%.3f,\"gc_log_mb_s\":%.3f,\"erases\":%llu},"
+            "\"w25m02gw\":{\"blocks\":%lu,\"log_mb_s\":%.3f,\"pair_mb_s\":%.3f,\"gc_log_mb_s\":%.3f,\"erases\":%llu},\"errors\":%lu},\n",
+            (unsigned long)(usage[0].free_blocks + usage[0].invalidated_blocks + usage[0].used_blocks),
+            bench_mb_s(BENCH_DIES_BYTES, log[0].sim_ns),
+            bench_mb_s(BENCH_DIES_BYTES, pair[0].sim_ns),
+            bench_mb_s(BENCH_DIES_BYTES, gc[0].sim_ns),
+            (unsigned long long)gc[0].stats.block_erases,
+            (unsigned long)(usage[1].free_blocks + usage[1].invalidated_blocks + usage[1].used_blocks),
+            bench_mb_s(BENCH_DIES_BYTES, log[1].sim_ns),
+            bench_mb_s(BENCH_DIES_BYTES, pair[1].sim_ns),
+            bench_mb_s(BENCH_DIES_BYTES, gc[1].sim_ns),
+            (unsigned long long)gc[1].stats.block_erases,
+            (unsigned long)errors);
+}
+
+/*!
+ * @brief Checks the files after a power cut against the journal and settles their state
+ *
+ * A closed file must keep at least its durable size, every byte it has must be its content.
+ * A file being written or removed at the cut may or may not be there.
+ */
+static void bench_torture_check(struct bench_journal *journal)
+{
+    char name[FLOG_MAX_FNAME_LEN];
+    uint32_t idx, size, bad;
+    uint8_t exists;
+
+    for (idx = 0; idx < BENCH_TORTURE_FILES; idx++)
+    {
+        snprintf(name, sizeof(name), "cut%lu.bin", (unsigned long)idx);
+        exists = (flogfs_check_exists(name) == FLOG_SUCCESS);
+
+        switch (journal->files[idx].state)
+        {
+            case BENCH_FILE_ABSENT:
+                if (exists)
+                {
+                    journal->resurrected_files++;
+                    (void)flogfs_rm(name);
+                }
+                break;
+
+            case BENCH_FILE_REMOVING:
+                if (exists)
+                    (void)flogfs_rm(name);
+                journal->files[idx].state = BENCH_FILE_ABSENT;
+                break;
+
+            case BENCH_FILE_WRITING:
+            case BENCH_FILE_PRESENT:
+                if (!exists)
+                {
+                    if ((journal->files[idx].state == BENCH_FILE_PRESENT) || (journal->files[idx].durable > 0))
+                    {
+                        journal->lost_files++;
+                        journal->lost_bytes += journal->files[idx].durable;
+                    }
+                    journal->files[idx].state = BENCH_FILE_ABSENT;
+                    journal->files[idx].durable = 0;
+                    break;
+                }
+
+                bad = bench_verify_file(name, idx, &size);
+                if (bad == UINT32_MAX)
+                {
+                    journal->check_errors++;
+                }
+                else if (bad != 0)
+                {
+                    journal->corrupt_files++;
+                }
+                if (size < journal->files[idx].durable)
+                {
+                    journal->lost_bytes += journal->files[idx].durable - size;
+                    journal->lost_files++;
+                }
+
+                if ((bad != 0) && (bad != UINT32_MAX))
+                {
+                    /* Start the file again, its content cannot be appended to */
+                    (void)flogfs_rm(name);
+                    journal->files[idx].state = BENCH_FILE_ABSENT;
+                    journal->files[idx].durable = 0;
+                }
+                else
+                {
+                    journal->files[idx].state = BENCH_FILE_PRESENT;
+                    journal->files[idx].durable = size;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+/*!
+ * @brief One boot of the power cut test, runs in its own process
+ *
+ * Mounts, checks the files, then appends to, creates and deletes files at random until the
+ * power cut stops the process. Without a cut the boot only checks the files. After a hang or a
+ * crash the file system is formatted, as it may not be usable any more.
+ */
+static void bench_torture_boot(const struct bench_config *cfg, struct bench_journal *journal, uint32_t cut_after)
+{
+    char name[FLOG_MAX_FNAME_LEN];
+    uint64_t start_ns = w25n_sim_time_ns();
+    uint64_t mount_ns;
+    uint32_t idx, len, done, op;
+
+    alarm(cfg->boot_timeout_s);
+
+    if ((bench_mount() != FLOG_SUCCESS) || journal->format_next)
+    {
+        if ((journal->boots > 1) && !journal->format_next)
+            journal->mount_failures++;
+        if (((cut_after == 0) && !journal->format_next) || (flogfs_format() != FLOG_SUCCESS) ||
+            (bench_mount() != FLOG_SUCCESS))
+            _exit(EXIT_FAILURE);
+        memset(journal->files, 0, sizeof(journal->files));
+        journal->format_next = 0;
+    }
+
+    mount_ns = w25n_sim_time_ns() - start_ns;
+    journal->mount_sim_ns += mount_ns;
+    journal->mount_sim_ns_max = MAX(journal->mount_sim_ns_max, mount_ns);
+
+    bench_torture_check(journal);
+    if (cut_after == 0)
+        _exit(EXIT_SUCCESS);
+
+    w25n_sim_power_cut_after(cut_after, bench_random());
+
+    /* Every operation programs at least one page, the cut comes first */
+    for (op = 0; op < cfg->max_cut_ops; op++)
+    {
+        idx = bench_random() % BENCH_TORTURE_FILES;
+        snprintf(name, sizeof(name), "cut%lu.bin", (unsigned long)idx);
+        journal->operations++;
+
+        if ((journal->files[idx].state == BENCH_FILE_ABSENT) || ((bench_random() % 4) != 0))
+        {
+            len = 1 + (bench_random() % BENCH_TORTURE_APPEND);
+            journal->files[idx].state = BENCH_FILE_WRITING;
+            done = bench_write_file(name, idx, journal->files[idx].durable, len, cfg->chunk);
+            if (done != len)
+                journal->check_errors++;
+            journal->files[idx].durable += done;
+            journal->files[idx].state = BENCH_FILE_PRESENT;
+        }
+        else
+        {
+            journal->files[idx].state = BENCH_FILE_REMOVING;
+            if (bench_random() & 1)
+            {
+                if (flogfs_invalidate(name) == FLOG_SUCCESS)
+                    flog_delete_invalidated_block();
+                else
+                    journal->check_errors++;
+            }
+            else if (flogfs_rm(name) != FLOG_SUCCESS)
+            {
+                journal->check_errors++;
+            }
+            journal->files[idx].state = BENCH_FILE_ABSENT;
+            journal->files[idx].durable = 0;
+        }
+    }
+
+    _exit(EXIT_SUCCESS);
+}
+
+/*!
+ * @brief Power cut test, every boot is a child process sharing the flash image and the journal
+ */
+static void bench_torture(const struct bench_config *cfg)
+{
+    struct bench_journal *journal;
+    struct bench_span span;
+    uint32_t boot, cut_after, cuts = 0, hangs = 0, crashes = 0, completed = 0;
+    uint32_t known;
+    pid_t pid;
+    int status;
+
+    journal = mmap(NULL, sizeof(*journal), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (journal == MAP_FAILED)
+    {
+        fprintf(stderr, "Unable to map the power cut journal\n");
+        bench_errors++;
+        return;
+    }
+    memset(journal, 0, sizeof(*journal));
+
+    /* The erase left running by flogfs_gc() and a read ahead end on the chip they were started on */
+    flog_delete_invalidated_block();
+    (void)W25N01GW_waitReady();
+    w25n_sim_reset();
+    bench_span_begin(&span);
+
+    /* The last boot is not cut, it only checks the files */
+    for (boot = 0; boot <= cfg->boots; boot++)
+    {
+        journal->boots = boot + 1;
+        cut_after = (boot < cfg->boots) ? (1 + (bench_random() % cfg->max_cut_ops)) : 0;
+        fflush(bench_out);
+
+        pid = fork();
+        if (pid < 0)
+        {
+            fprintf(stderr, "fork failed\n");
+            bench_errors++;
+            break;
+        }
+        if (pid == 0)
+            bench_torture_boot(cfg, journal, cut_after);
+
+        if (waitpid(pid, &status, 0) != pid)
+        {
+            crashes++;
+            journal->format_next = 1;
+            continue;
+        }
+
+        if (WIFEXITED(status) && (WEXITSTATUS(status) == W25N_SIM_POWER_CUT_EXIT))
+            cuts++;
+        else if (WIFEXITED(status) && (WEXITSTATUS(status) == EXIT_SUCCESS))
+            completed++;
+        else
+        {
+            if (WIFSIGNALED(status) && (WTERMSIG(status) == SIGALRM))
+                hangs++;
+            else
+                crashes++;
+            journal->format_next = 1;
+        }
+    }
+
+    bench_span_end(&span);
+
+    /* FLogFS is not power cut safe, its findings do not fail the run. Crashes and failed checks do. */
+    known = journal->mount_failures + journal->lost_files + journal->corrupt_files + journal->resurrected_files +
+            hangs;
+    if ((journal->check_errors + crashes) != 0)
+        bench_errors++;
+
+    fprintf(bench_out,
+            "\"power_cut\":{\"boots\":%lu,\"cuts\":%lu,\"completed\":%lu,\"hangs\":%lu,\"crashes\":%lu,\"operations\":%lu,"
+            "\"mount_failures\":%lu,\"lost_files\":%lu,\"lost_bytes\":%lu,\"corrupt_files\":%lu,"
+            "\"resurrected_files\":%lu,\"check_errors\":%lu,\"known_failures\":%lu,\"mount_sim_ms_mean\":%.3f,"
+            "\"mount_sim_ms_max\":%.3f,\"erases\":%llu,\"wall_s\":%.3f},\n",
+            (unsigned long)(cfg->boots + 1),
+            (unsigned long)cuts,
+            (unsigned long)completed,
+            (unsigned long)hangs,
+            (unsigned long)crashes,
+            (unsigned long)journal->operations,
+            (unsigned long)journal->mount_failures,
+            (unsigned long)journal->lost_files,
+            (unsigned long)journal->lost_bytes,
+            (unsigned long)journal->corrupt_files,
+            (unsigned long)journal->resurrected_files,
+            (unsigned long)journal->check_errors,
+            (unsigned long)known,
+            journal->mount_sim_ns / 1e6 / (cfg->boots + 1),
+            journal->mount_sim_ns_max / 1e6,
+            (unsigned long long)span.stats.block_erases,
+            span.wall_ns / 1e9);
+
+    munmap(journal, sizeof(*journal));
+}
@@ -0,0 +1,28 @@
+/**
+ * Copyright (C) 2019 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    nrf_gpio.h
+ * @brief   Host stand-in for the nRF5 SDK GPIO functions used by the W25N01GW driver.
+ *          The flash chip select goes to the simulated chip of w25n01gw_sim.c.
+ *
+ */
+
+#ifndef HOST_NRF_GPIO_H_
+#define HOST_NRF_GPIO_H_
+
+#include <stdint.h>
+
+#define NRF_GPIO_PIN_MAP(port, pin)     (((port) << 5) | ((pin) & 0x1F))
+
+static inline void nrf_gpio_cfg_output(uint32_t pin_number)
+{
+    (void)pin_number;
+}
+
+void nrf_gpio_pin_set(uint32_t pin_number);
+
+void nrf_gpio_pin_clear(uint32_t pin_number);
+
+#endif /* HOST_NRF_GPIO_H_ */
@@ -0,0 +1,87 @@
+/**
+ * Copyright (C) 2019 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    nrfx.h
+ * @brief   Host stand-in for the nrfx and CMSIS definitions used by the W25N01GW driver.
+ *          The driver always runs in thread mode, __WFE() runs the simulated timer events.
+ *
+ */
+
+#ifndef HOST_NRFX_H_
+#define HOST_NRFX_H_
+
+/**********************************************************************************/
+/* header includes */
+/**********************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**********************************************************************************/
+/* macro definitions */
+/**********************************************************************************/
+#ifndef MIN
+#define MIN(a, b)                       ((a) < (b) ? (a) : (b))
+#endif
+
+#ifndef MAX
+#define MAX(a, b)                       ((a) > (b) ? (a) : (b))
+#endif
+
+#define NRFX_SUCCESS                    (0)
+#define NRFX_ERROR_INTERNAL             (1)
+#define NRFX_ERROR_INVALID_STATE        (2)
+
+#define NRFX_CONCAT_3_(p1, p2, p3)      p1 ## p2 ## p3
+#define NRFX_CONCAT_3(p1, p2, p3)       NRFX_CONCAT_3_(p1, p2, p3)
+
+/**********************************************************************************/
+/* data structure declarations */
+/**********************************************************************************/
+typedef int nrfx_err_t;
+
+typedef int IRQn_Type;
+
+/**********************************************************************************/
+/* function declarations */
+/**********************************************************************************/
+static inline bool nrfx_is_in_ram(void const *p_object)
+{
+    (void)p_object;
+    return true;
+}
+
+static inline IRQn_Type nrfx_get_irq_number(void const *p_reg)
+{
+    (void)p_reg;
+    return 0;
+}
+
+static inline uint32_t __get_IPSR(void)
+{
+    return 0;
+}
+
+static inline uint32_t NVIC_GetPendingIRQ(IRQn_Type irqn)
+{
+    (void)irqn;
+    return 0;
+}
+
+static inline void NVIC_ClearPendingIRQ(IRQn_Type irqn)
+{
+    (void)irqn;
+}
+
+static inline void __SEV(void)
+{
+}
+
+/*!
+ * @brief Advances the simulated time to the next timer event and runs its handler
+ */
+void __WFE(void);
+
+#endif /* HOST_NRFX_H_ */
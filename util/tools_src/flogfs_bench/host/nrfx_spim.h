@@ -0,0 +1,110 @@
+/**
+ * Copyright (C) 2019 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    nrfx_spim.h
+ * @brief   Host stand-in for the nrfx SPIM driver used by the W25N01GW driver.
+ *          Transfers go to the simulated flash chip of w25n01gw_sim.c, the event handler
+ *          is called before nrfx_spim_xfer() returns.
+ *
+ */
+
+#ifndef HOST_NRFX_SPIM_H_
+#define HOST_NRFX_SPIM_H_
+
+/**********************************************************************************/
+/* header includes */
+/**********************************************************************************/
+#include "nrfx.h"
+
+/**********************************************************************************/
+/* macro definitions */
+/**********************************************************************************/
+#define NRFX_SPIM_PIN_NOT_USED          (0xFF)
+
+/*! SPI clock in Hz, a register value on the MCU */
+#define NRF_SPIM_FREQ_4M                (4000000UL)
+#define NRF_SPIM_FREQ_8M                (8000000UL)
+
+#define NRFX_SPIM_DEFAULT_CONFIG_IRQ_PRIORITY (6)
+
+#define NRFX_SPIM_INSTANCE(id)          { NULL, (id) }
+
+#define NRFX_SPIM_DEFAULT_CONFIG                            \
+{                                                           \
+    .sck_pin        = NRFX_SPIM_PIN_NOT_USED,               \
+    .mosi_pin       = NRFX_SPIM_PIN_NOT_USED,               \
+    .miso_pin       = NRFX_SPIM_PIN_NOT_USED,               \
+    .ss_pin         = NRFX_SPIM_PIN_NOT_USED,               \
+    .irq_priority   = NRFX_SPIM_DEFAULT_CONFIG_IRQ_PRIORITY, \
+    .orc            = 0xFF,                                 \
+    .frequency      = NRF_SPIM_FREQ_4M,                     \
+}
+
+#define NRFX_SPIM_XFER_TRX(p_tx_buf, tx_len, p_rx_buf, rx_len) \
+    { .p_tx_buffer = (uint8_t const *)(p_tx_buf), .tx_length = (tx_len), \
+      .p_rx_buffer = (p_rx_buf), .rx_length = (rx_len) }
+
+/**********************************************************************************/
+/* data structure declarations */
+/**********************************************************************************/
+typedef struct
+{
+    void *p_reg;
+    uint8_t drv_inst_idx;
+} nrfx_spim_t;
+
+typedef struct
+{
+    uint8_t sck_pin;
+    uint8_t mosi_pin;
+    uint8_t miso_pin;
+    uint8_t ss_pin;
+    uint8_t irq_priority;
+    uint8_t orc;
+    uint32_t frequency;
+} nrfx_spim_config_t;
+
+typedef struct
+{
+    uint8_t const *p_tx_buffer;
+    size_t tx_length;
+    uint8_t *p_rx_buffer;
+    size_t rx_length;
+} nrfx_spim_xfer_desc_t;
+
+typedef enum
+{
+    NRFX_SPIM_EVENT_DONE
+} nrfx_spim_evt_type_t;
+
+typedef struct
+{
+    nrfx_spim_evt_type_t type;
+    nrfx_spim_xfer_desc_t xfer_desc;
+} nrfx_spim_evt_t;
+
+typedef void (*nrfx_spim_evt_handler_t)(nrfx_spim_evt_t const *p_event, void *p_context);
+
+/**********************************************************************************/
+/* function declarations */
+/**********************************************************************************/
+nrfx_err_t nrfx_spim_init(nrfx_spim_t const * const p_instance,
+                          nrfx_spim_config_t const *p_config,
+                          nrfx_spim_evt_handler_t handler,
+                          void *p_context);
+
+void nrfx_spim_uninit(nrfx_spim_t const * const p_instance);
+
+/*!
+ * @brief Clocks MAX(tx_length, rx_length) bytes, bytes past the TX buffer are sent as the
+ *        over-read character
+ */
+nrfx_err_t nrfx_spim_xfer(nrfx_spim_t const * const p_instance,
+                          nrfx_spim_xfer_desc_t const *p_xfer_desc,
+                          uint32_t flags);
+
+void nrfx_spim_2_irq_handler(void);
+
+#endif /* HOST_NRFX_SPIM_H_ */
@@ -0,0 +1,105 @@
+/**
+ * Copyright (C) 2019 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    nrfx_timer.h
+ * @brief   Host stand-in for the nrfx TIMER driver used by the W25N01GW driver.
+ *          One compare channel at 1 MHz on the simulated time of w25n01gw_sim.c.
+ *
+ */
+
+#ifndef HOST_NRFX_TIMER_H_
+#define HOST_NRFX_TIMER_H_
+
+/**********************************************************************************/
+/* header includes */
+/**********************************************************************************/
+#include "nrfx.h"
+
+/**********************************************************************************/
+/* macro definitions */
+/**********************************************************************************/
+#define NRFX_TIMER_INSTANCE(id)         { NULL, (id) }
+
+#define NRF_TIMER_SHORT_COMPARE0_STOP_MASK (1UL << 8)
+
+/**********************************************************************************/
+/* data structure declarations */
+/**********************************************************************************/
+typedef enum
+{
+    NRF_TIMER_FREQ_1MHz = 4
+} nrf_timer_frequency_t;
+
+typedef enum
+{
+    NRF_TIMER_MODE_TIMER = 0
+} nrf_timer_mode_t;
+
+typedef enum
+{
+    NRF_TIMER_BIT_WIDTH_32 = 3
+} nrf_timer_bit_width_t;
+
+typedef enum
+{
+    NRF_TIMER_CC_CHANNEL0 = 0
+} nrf_timer_cc_channel_t;
+
+typedef enum
+{
+    NRF_TIMER_EVENT_COMPARE0 = 0x140
+} nrf_timer_event_t;
+
+typedef uint32_t nrf_timer_short_mask_t;
+
+typedef struct
+{
+    void *p_reg;
+    uint8_t instance_id;
+} nrfx_timer_t;
+
+typedef struct
+{
+    nrf_timer_frequency_t frequency;
+    nrf_timer_mode_t mode;
+    nrf_timer_bit_width_t bit_width;
+    uint8_t interrupt_priority;
+    void *p_context;
+} nrfx_timer_config_t;
+
+typedef void (*nrfx_timer_event_handler_t)(nrf_timer_event_t event_type, void *p_context);
+
+/**********************************************************************************/
+/* function declarations */
+/**********************************************************************************/
+nrfx_err_t nrfx_timer_init(nrfx_timer_t const * const p_instance,
+                           nrfx_timer_config_t const *p_config,
+                           nrfx_timer_event_handler_t timer_event_handler);
+
+void nrfx_timer_uninit(nrfx_timer_t const * const p_instance);
+
+void nrfx_timer_enable(nrfx_timer_t const * const p_instance);
+
+void nrfx_timer_resume(nrfx_timer_t const * const p_instance);
+
+void nrfx_timer_pause(nrfx_timer_t const * const p_instance);
+
+void nrfx_timer_clear(nrfx_timer_t const * const p_instance);
+
+void nrfx_timer_extended_compare(nrfx_timer_t const * const p_instance,
+                                 nrf_timer_cc_channel_t cc_channel,
+                                 uint32_t cc_value,
+                                 nrf_timer_short_mask_t timer_short_mask,
+                                 bool enable_int);
+
+static inline uint32_t nrfx_timer_us_to_ticks(nrfx_timer_t const * const p_instance, uint32_t time_us)
+{
+    (void)p_instance;
+    return time_us;
+}
+
+void nrfx_timer_0_irq_handler(void);
+
+#endif /* HOST_NRFX_TIMER_H_ */
@@ -0,0 +1,866 @@
+/**
+ * Copyright (C) 2019 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    w25n01gw_sim.c
+ * @brief   Simulated W25N01GW SPI NAND flash, behind the host nrfx_spim.h, nrfx_timer.h and
+ *          nrf_gpio.h
+ *
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+/**********************************************************************************/
+/* system header includes */
+/**********************************************************************************/
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**********************************************************************************/
+/* own header files */
+/**********************************************************************************/
+#include "nrf_gpio.h"
+#include "nrfx_spim.h"
+#include "nrfx_timer.h"
+#include "w25n01gw_sim.h"
+
+/**********************************************************************************/
+/* macro definitions */
+/**********************************************************************************/
+#define W25N_SIM_MAGIC                  (0x4E353257UL) /* "W25N" */
+#define W25N_SIM_FORMAT                 (2)
+
+#define W25N_SIM_CMD_RESET              0xFF
+#define W25N_SIM_CMD_JEDEC_ID           0x9F
+#define W25N_SIM_CMD_RD_REG             0x0F
+#define W25N_SIM_CMD_WR_REG             0x1F
+#define W25N_SIM_CMD_WR_ENABLE          0x06
+#define W25N_SIM_CMD_WR_DISABLE         0x04
+#define W25N_SIM_CMD_BLOCK_ERASE        0xD8
+#define W25N_SIM_CMD_LD_PRGM_DATA       0x02
+#define W25N_SIM_CMD_RANDM_PRGM_DATA    0x84
+#define W25N_SIM_CMD_PRGM_EXEC          0x10
+#define W25N_SIM_CMD_PAGE_DATA_RD       0x13
+#define W25N_SIM_CMD_RD_DATA            0x03
+#define W25N_SIM_CMD_DIE_SELECT         0xC2
+
+#define W25N_SIM_REG_PROTECT            0xA0
+#define W25N_SIM_REG_CONFIG             0xB0
+#define W25N_SIM_REG_STATUS             0xC0
+
+#define W25N_SIM_STAT_BUSY              (1 << 0)
+#define W25N_SIM_STAT_WEL               (1 << 1)
+#define W25N_SIM_STAT_EFAIL             (1 << 2)
+#define W25N_SIM_STAT_PFAIL             (1 << 3)
+
+/*! Block protect bits, any of them locks the whole array in the simulation */
+#define W25N_SIM_PROTECT_BP             (0x7C)
+/*! Power up values, BUF=1 and ECC-E=1, all blocks protected */
+#define W25N_SIM_CONFIG_DEFAULT         (0x18)
+#define W25N_SIM_PROTECT_DEFAULT        (0x7C)
+
+/*! Chip select of the flash on the Application Board 3.0 */
+#define W25N_SIM_CS_PIN                 NRF_GPIO_PIN_MAP(0, 17)
+
+/**********************************************************************************/
+/* data structure declarations */
+/**********************************************************************************/
+
+/*!
+ * @brief Flash image, the part of the chip that survives a power cut
+ */
+struct w25n_sim_image
+{
+    uint32_t magic;
+    uint32_t format;
+    uint64_t time_ns;
+    struct w25n_sim_stats stats;
+    uint32_t erase_count[W25N_SIM_MAX_DIES * W25N_SIM_BLOCKS];
+    uint8_t nop[W25N_SIM_MAX_DIES * W25N_SIM_PAGES];
+    uint8_t data[W25N_SIM_MAX_DIES * W25N_SIM_PAGES][W25N_SIM_PAGE_SIZE];
+};
+
+/*!
+ * @brief Volatile state of a die, lost at power down
+ */
+struct w25n_sim_die
+{
+    uint8_t buffer[W25N_SIM_PAGE_SIZE];
+    uint8_t reg_protect;
+    uint8_t reg_config;
+    uint8_t reg_status;
+    uint64_t busy_until_ns;
+};
+
+/**********************************************************************************/
+/* static variables */
+/**********************************************************************************/
+static struct w25n_sim_image *image = NULL;
+static int image_fd = -1;
+
+static struct w25n_sim_timing timing = { 25, 250, 2000, 4000000, 3000 };
+
+/* Volatile chip state, the die selected by the last die select gets the commands */
+static struct w25n_sim_die dies[W25N_SIM_MAX_DIES];
+static struct w25n_sim_die *die = &dies[0];
+static uint8_t die_index;
+static uint8_t die_count = 1;
+
+/* Command of the current chip select cycle */
+static uint8_t selected;
+static uint32_t xact_pos;
+static uint8_t xact_cmd[4];
+
+/* Host SPIM and timer */
+static nrfx_spim_evt_handler_t spim_handler;
+static void *spim_context;
+static uint8_t spim_orc;
+static nrfx_timer_event_handler_t timer_handler;
+static void *timer_context;
+static uint8_t timer_running;
+static uint8_t timer_int;
+static uint8_t timer_stop_short;
+static uint32_t timer_cc;
+static uint32_t timer_count;      /* Counter at timer_ref_ns */
+static uint64_t timer_ref_ns;
+
+static uint32_t cut_remaining;
+static uint32_t cut_random;
+
+/**********************************************************************************/
+/* static function declaration */
+/**********************************************************************************/
+static void sim_power_on(void);
+static uint32_t sim_random(void);
+static uint8_t sim_busy(void);
+static void sim_die_power_on(struct w25n_sim_die *chip_die);
+static void sim_power_cut_check(uint32_t page, uint8_t erase);
+static void sim_program(uint32_t page);
+static void sim_erase(uint32_t page);
+static uint32_t timer_counter(void);
+static uint8_t sim_timer_armed(void);
+static uint8_t sim_timer_pending(void);
+static uint64_t sim_timer_due_ns(void);
+static void sim_timer_fire(void);
+static void sim_select(void);
+static void sim_deselect(void);
+static uint8_t sim_byte(uint8_t mosi);
+
+/**********************************************************************************/
+/* functions */
+/**********************************************************************************/
+
+int w25n_sim_open(const char *path, const struct w25n_sim_timing *chip_timing)
+{
+    struct stat st;
+    uint8_t fresh = 1;
+
+    if (chip_timing != NULL)
+        timing = *chip_timing;
+
+    if (path == NULL)
+    {
+        image = mmap(NULL, sizeof(*image), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    }
+    else
+    {
+        image_fd = open(path, O_RDWR | O_CREAT, 0644);
+        if (image_fd < 0)
+            return -1;
+        if ((fstat(image_fd, &st) == 0) && (st.st_size == (off_t)sizeof(*image)))
+            fresh = 0;
+        else if (ftruncate(image_fd, sizeof(*image)) != 0)
+        {
+            close(image_fd);
+            image_fd = -1;
+            return -1;
+        }
+        image = mmap(NULL, sizeof(*image), PROT_READ | PROT_WRITE, MAP_SHARED, image_fd, 0);
+    }
+
+    if (image == MAP_FAILED)
+    {
+        image = NULL;
+        if (image_fd >= 0)
+            close(image_fd);
+        image_fd = -1;
+        return -1;
+    }
+
+    if (fresh || (image->magic != W25N_SIM_MAGIC) || (image->format != W25N_SIM_FORMAT))
+        w25n_sim_reset();
+
+    sim_power_on();
+
+    return 0;
+}
+
+void w25n_sim_close(void)
+{
+    if (image != NULL)
+    {
+        munmap(image, sizeof(*image));
+        image = NULL;
+    }
+    if (image_fd >= 0)
+    {
+        close(image_fd);
+        image_fd = -1;
+    }
+}
+
+void w25n_sim_reset(void)
+{
+    uint8_t idx;
+
+    /* The time starts again from 0, a poll armed by the driver still fires */
+    timer_count = timer_counter();
+    timer_ref_ns = 0;
+
+    /* The pages of dies not in use are never touched, a file image stays sparse */
+    memset(image, 0, offsetof(struct w25n_sim_image, data));
+    memset(image->data, 0xFF, (size_t)die_count * W25N_SIM_PAGES * W25N_SIM_PAGE_SIZE);
+    image->magic = W25N_SIM_MAGIC;
+    image->format = W25N_SIM_FORMAT;
+    for (idx = 0; idx < W25N_SIM_MAX_DIES; idx++)
+    {
+        dies[idx].busy_until_ns = 0;
+    }
+}
+
+uint64_t w25n_sim_time_ns(void)
+{
+    return image->time_ns;
+}
+
+void w25n_sim_idle(uint32_t us)
+{
+    uint64_t end_ns = image->time_ns + (uint64_t)us * 1000;
+
+    /* The timer interrupts of the driver run in the meantime */
+    while (sim_timer_pending() && (sim_timer_due_ns() <= end_ns))
+    {
+        sim_timer_fire();
+    }
+
+    if (image->time_ns < end_ns)
+        image->time_ns = end_ns;
+}
+
+struct w25n_sim_stats *w25n_sim_stats(void)
+{
+    return &image->stats;
+}
+
+void w25n_sim_set_dies(uint8_t count)
+{
+    die_count = ((count > 1) ? W25N_SIM_MAX_DIES : 1);
+    w25n_sim_reset();
+    sim_power_on();
+}
+
+uint8_t w25n_sim_dies(void)
+{
+    return die_count;
+}
+
+uint32_t w25n_sim_erase_count(uint16_t block)
+{
+    return image->erase_count[block];
+}
+
+void w25n_sim_power_cut_after(uint32_t operations, uint32_t seed)
+{
+    cut_remaining = (operations > 0) ? (operations + 1) : 0;
+    cut_random = seed | 1;
+}
+
+/*!
+ * @brief Host SPIM, the chip resets its volatile state when the driver is initialized
+ */
+nrfx_err_t nrfx_spim_init(nrfx_spim_t const * const p_instance,
+                          nrfx_spim_config_t const *p_config,
+                          nrfx_spim_evt_handler_t handler,
+                          void *p_context)
+{
+    (void)p_instance;
+
+    if (image == NULL)
+        return NRFX_ERROR_INTERNAL;
+    if (p_config->frequency != 0)
+        timing.spi_hz = p_config->frequency;
+
+    spim_handler = handler;
+    spim_context = p_context;
+    spim_orc = p_config->orc;
+    selected = 0;
+    sim_power_on();
+    return NRFX_SUCCESS;
+}
+
+void nrfx_spim_uninit(nrfx_spim_t const * const p_instance)
+{
+    (void)p_instance;
+
+    spim_handler = NULL;
+}
+
+nrfx_err_t nrfx_spim_xfer(nrfx_spim_t const * const p_instance,
+                          nrfx_spim_xfer_desc_t const *p_xfer_desc,
+                          uint32_t flags)
+{
+    nrfx_spim_evt_t event;
+    size_t len = MAX(p_xfer_desc->tx_length, p_xfer_desc->rx_length);
+    size_t idx;
+    uint8_t miso;
+
+    (void)p_instance;
+    (void)flags;
+
+    image->stats.spi_transfers++;
+    image->stats.spi_bytes += len;
+    image->time_ns += timing.transfer_ns + ((uint64_t)len * 8 * 1000000000ULL) / timing.spi_hz;
+
+    /* The chip ignores the clock while it is not selected */
+    if (!selected)
+        image->stats.protocol_errors++;
+
+    for (idx = 0; idx < len; idx++)
+    {
+        miso = 0xFF;
+        if (selected)
+            miso = sim_byte((idx < p_xfer_desc->tx_length) ? p_xfer_desc->p_tx_buffer[idx] : spim_orc);
+        if (idx < p_xfer_desc->rx_length)
+            p_xfer_desc->p_rx_buffer[idx] = miso;
+    }
+
+    if (spim_handler != NULL)
+    {
+        event.type = NRFX_SPIM_EVENT_DONE;
+        event.xfer_desc = *p_xfer_desc;
+        spim_handler(&event, spim_context);
+    }
+
+    return NRFX_SUCCESS;
+}
+
+void nrfx_spim_2_irq_handler(void)
+{
+}
+
+void nrf_gpio_pin_set(uint32_t pin_number)
+{
+    if ((pin_number == W25N_SIM_CS_PIN) && selected)
+        sim_deselect();
+}
+
+void nrf_gpio_pin_clear(uint32_t pin_number)
+{
+    if ((pin_number == W25N_SIM_CS_PIN) && !selected)
+        sim_select();
+}
+
+/*!
+ * @brief Host timer at 1 MHz on the simulated time, compare channel 0 only
+ */
+nrfx_err_t nrfx_timer_init(nrfx_timer_t const * const p_instance,
+                           nrfx_timer_config_t const *p_config,
+                           nrfx_timer_event_handler_t timer_event_handler)
+{
+    (void)p_instance;
+
+    timer_handler = timer_event_handler;
+    timer_context = p_config->p_context;
+    timer_running = 0;
+    timer_int = 0;
+    timer_count = 0;
+    return NRFX_SUCCESS;
+}
+
+void nrfx_timer_uninit(nrfx_timer_t const * const p_instance)
+{
+    (void)p_instance;
+
+    timer_running = 0;
+    timer_handler = NULL;
+}
+
+void nrfx_timer_enable(nrfx_timer_t const * const p_instance)
+{
+    nrfx_timer_resume(p_instance);
+}
+
+void nrfx_timer_resume(nrfx_timer_t const * const p_instance)
+{
+    (void)p_instance;
+
+    if (!timer_running)
+    {
+        timer_ref_ns = image->time_ns;
+        timer_running = 1;
+    }
+}
+
+void nrfx_timer_pause(nrfx_timer_t const * const p_instance)
+{
+    (void)p_instance;
+
+    timer_count = timer_counter();
+    timer_ref_ns = image->time_ns;
+    timer_running = 0;
+}
+
+void nrfx_timer_clear(nrfx_timer_t const * const p_instance)
+{
+    (void)p_instance;
+
+    timer_count = 0;
+    timer_ref_ns = image->time_ns;
+}
+
+void nrfx_timer_extended_compare(nrfx_timer_t const * const p_instance,
+                                 nrf_timer_cc_channel_t cc_channel,
+                                 uint32_t cc_value,
+                                 nrf_timer_short_mask_t timer_short_mask,
+                                 bool enable_int)
+{
+    (void)p_instance;
+    (void)cc_channel;
+
+    timer_cc = cc_value;
+    timer_stop_short = (timer_short_mask & NRF_TIMER_SHORT_COMPARE0_STOP_MASK) != 0;
+    timer_int = enable_int;
+}
+
+void nrfx_timer_0_irq_handler(void)
+{
+}
+
+/*!
+ * @brief The MCU sleeps until the compare event, the simulated time jumps to it. An event that
+ *        came during an SPI transfer is pending, it wakes the MCU at once.
+ */
+void __WFE(void)
+{
+    if (!sim_timer_pending())
+    {
+        fprintf(stderr, "w25n_sim: __WFE() without a timer event to wake up\n");
+        abort();
+    }
+
+    sim_timer_fire();
+}
+
+/*!
+ * @brief An interrupt on the compare event is enabled
+ */
+static uint8_t sim_timer_armed(void)
+{
+    return timer_running && timer_int && (timer_handler != NULL);
+}
+
+/*!
+ * @brief The compare event is still to come, or came and its interrupt has not run yet
+ *
+ * A timer with the STOP short stops at the event, while it runs its event has not been handled.
+ */
+static uint8_t sim_timer_pending(void)
+{
+    return sim_timer_armed() && (timer_stop_short || (timer_counter() <= timer_cc));
+}
+
+/*!
+ * @brief Simulated time of the compare event
+ */
+static uint64_t sim_timer_due_ns(void)
+{
+    return timer_ref_ns + (uint64_t)(timer_cc - timer_count) * 1000;
+}
+
+/*!
+ * @brief Advances the simulated time to the compare event and runs the timer interrupt
+ */
+static void sim_timer_fire(void)
+{
+    uint64_t due_ns = sim_timer_due_ns();
+
+    if (image->time_ns < due_ns)
+        image->time_ns = due_ns;
+
+    if (timer_stop_short)
+    {
+        timer_count = timer_cc;
+        timer_ref_ns = image->time_ns;
+        timer_running = 0;
+    }
+
+    timer_handler(NRF_TIMER_EVENT_COMPARE0, timer_context);
+}
+
+/*!
+ * @brief Counter value of the host timer now
+ */
+static uint32_t timer_counter(void)
+{
+    if (!timer_running)
+        return timer_count;
+
+    return timer_count + (uint32_t)((image->time_ns - timer_ref_ns) / 1000);
+}
+
+/*!
+ * @brief Power up state of all dies, die 0 is selected
+ */
+static void sim_power_on(void)
+{
+    uint8_t idx;
+
+    for (idx = 0; idx < W25N_SIM_MAX_DIES; idx++)
+    {
+        sim_die_power_on(&dies[idx]);
+    }
+    die_index = 0;
+    die = &dies[0];
+}
+
+/*!
+ * @brief Power up state of the registers and the data buffer of a die
+ */
+static void sim_die_power_on(struct w25n_sim_die *chip_die)
+{
+    memset(chip_die->buffer, 0xFF, sizeof(chip_die->buffer));
+    chip_die->reg_protect = W25N_SIM_PROTECT_DEFAULT;
+    chip_die->reg_config = W25N_SIM_CONFIG_DEFAULT;
+    chip_die->reg_status = 0;
+    chip_die->busy_until_ns = image->time_ns;
+}
+
+/*!
+ * @brief xorshift32 for the extent of a cut operation
+ */
+static uint32_t sim_random(void)
+{
+    cut_random ^= cut_random << 13;
+    cut_random ^= cut_random >> 17;
+    cut_random ^= cut_random << 5;
+    return cut_random;
+}
+
+/*!
+ * @brief The selected die is busy, the other die may be idle
+ */
+static uint8_t sim_busy(void)
+{
+    return image->time_ns < die->busy_until_ns;
+}
+
+/*!
+ * @brief Stops the process if this program or erase is the one to cut
+ *
+ * A cut program stores a random prefix of the page, a cut erase erases a random number of
+ * the first pages of the block.
+ */
+static void sim_power_cut_check(uint32_t page, uint8_t erase)
+{
+    uint32_t idx, count;
+
+    if ((cut_remaining == 0) || (--cut_remaining > 0))
+        return;
+
+    if (erase)
+    {
+        page -= page % W25N_SIM_PAGES_PER_BLOCK;
+        count = sim_random() % W25N_SIM_PAGES_PER_BLOCK;
+        memset(image->data[page], 0xFF, count * W25N_SIM_PAGE_SIZE);
+        memset(&image->nop[page], 0, count);
+    }
+    else
+    {
+        count = sim_random() % W25N_SIM_PAGE_SIZE;
+        for (idx = 0; idx < count; idx++)
+        {
+            image->data[page][idx] &= die->buffer[idx];
+        }
+    }
+
+    image->stats.power_cuts++;
+    if (image_fd >= 0)
+        (void)msync(image, sizeof(*image), MS_SYNC);
+    _exit(W25N_SIM_POWER_CUT_EXIT);
+}
+
+static void sim_program(uint32_t page)
+{
+    uint8_t *data = image->data[page];
+    uint8_t *buffer = die->buffer;
+    uint32_t idx;
+    uint8_t conflict = 0;
+
+    die->reg_status &= (uint8_t)~(W25N_SIM_STAT_WEL | W25N_SIM_STAT_PFAIL | W25N_SIM_STAT_EFAIL);
+    die->busy_until_ns = image->time_ns + (uint64_t)timing.program_us * 1000;
+
+    if (die->reg_protect & W25N_SIM_PROTECT_BP)
+    {
+        die->reg_status |= W25N_SIM_STAT_PFAIL;
+        return;
+    }
+
+    sim_power_cut_check(page, 0);
+
+    image->stats.page_programs++;
+    if (++image->nop[page] > W25N_SIM_NOP)
+        image->stats.nop_violations++;
+
+    for (idx = 0; idx < W25N_SIM_PAGE_SIZE; idx++)
+    {
+        /* 0xFF in the buffer leaves a byte as it is */
+        if ((buffer[idx] != 0xFF) && (data[idx] != 0xFF) && (buffer[idx] != data[idx]))
+            conflict = 1;
+        data[idx] &= buffer[idx];
+    }
+    if (conflict)
+        image->stats.program_conflicts++;
+}
+
+static void sim_erase(uint32_t page)
+{
+    uint32_t block = page / W25N_SIM_PAGES_PER_BLOCK;
+
+    page = block * W25N_SIM_PAGES_PER_BLOCK;
+
+    die->reg_status &= (uint8_t)~(W25N_SIM_STAT_WEL | W25N_SIM_STAT_PFAIL | W25N_SIM_STAT_EFAIL);
+    die->busy_until_ns = image->time_ns + (uint64_t)timing.erase_us * 1000;
+
+    if (die->reg_protect & W25N_SIM_PROTECT_BP)
+    {
+        die->reg_status |= W25N_SIM_STAT_EFAIL;
+        return;
+    }
+
+    sim_power_cut_check(page, 1);
+
+    image->stats.block_erases++;
+    image->erase_count[block]++;
+    memset(image->data[page], 0xFF, W25N_SIM_PAGES_PER_BLOCK * W25N_SIM_PAGE_SIZE);
+    memset(&image->nop[page], 0, W25N_SIM_PAGES_PER_BLOCK);
+}
+
+/*!
+ * @brief Chip select falls, a new command starts
+ */
+static void sim_select(void)
+{
+    selected = 1;
+    xact_pos = 0;
+}
+
+/*!
+ * @brief Chip select rises, commands without a data phase are executed
+ */
+static void sim_deselect(void)
+{
+    /* Page address within the die, the pages of die 1 follow the ones of die 0 in the image */
+    uint32_t page = (uint32_t)die_index * W25N_SIM_PAGES + (uint16_t)((xact_cmd[2] << 8) | xact_cmd[3]);
+    uint8_t *buffer = die->buffer;
+
+    selected = 0;
+    if (xact_pos == 0)
+        return;
+
+    switch (xact_cmd[0])
+    {
+        case W25N_SIM_CMD_RESET:
+            sim_die_power_on(die);
+            break;
+
+        case W25N_SIM_CMD_DIE_SELECT:
+            if (xact_pos < 2)
+                break;
+            if (xact_cmd[1] < die_count)
+            {
+                die_index = xact_cmd[1];
+                die = &dies[die_index];
+            }
+            else
+                image->stats.protocol_errors++;
+            break;
+
+        case W25N_SIM_CMD_WR_REG:
+            if (xact_pos < 3)
+                break;
+            if (xact_cmd[1] == W25N_SIM_REG_PROTECT)
+                die->reg_protect = xact_cmd[2];
+            else if (xact_cmd[1] == W25N_SIM_REG_CONFIG)
+                die->reg_config = xact_cmd[2];
+            else
+                image->stats.protocol_errors++;
+            break;
+
+        case W25N_SIM_CMD_WR_ENABLE:
+            die->reg_status |= W25N_SIM_STAT_WEL;
+            break;
+
+        case W25N_SIM_CMD_WR_DISABLE:
+            die->reg_status &= (uint8_t)~W25N_SIM_STAT_WEL;
+            break;
+
+        case W25N_SIM_CMD_PAGE_DATA_RD:
+            if (xact_pos < 4)
+                break;
+            memcpy(buffer, image->data[page], W25N_SIM_PAGE_SIZE);
+            die->busy_until_ns = image->time_ns + (uint64_t)timing.read_us * 1000;
+            image->stats.page_reads++;
+            break;
+
+        case W25N_SIM_CMD_PRGM_EXEC:
+        case W25N_SIM_CMD_BLOCK_ERASE:
+            if (xact_pos < 4)
+                break;
+            if (!(die->reg_status & W25N_SIM_STAT_WEL))
+            {
+                image->stats.protocol_errors++;
+                break;
+            }
+            if (xact_cmd[0] == W25N_SIM_CMD_PRGM_EXEC)
+                sim_program(page);
+            else
+                sim_erase(page);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*!
+ * @brief Clocks one byte of the current command
+ *
+ * @param[in] mosi : byte from the host
+ *
+ * @return byte to the host, 0xFF while the chip does not drive the line
+ */
+static uint8_t sim_byte(uint8_t mosi)
+{
+    uint32_t pos = xact_pos++;
+    uint8_t *buffer = die->buffer;
+    uint8_t cmd;
+    uint16_t col;
+    uint8_t value = 0xFF;
+
+    if (pos < sizeof(xact_cmd))
+        xact_cmd[pos] = mosi;
+    cmd = xact_cmd[0];
+
+    if (pos == 0)
+    {
+        if (sim_busy() && (cmd != W25N_SIM_CMD_RD_REG) && (cmd != W25N_SIM_CMD_RESET) &&
+            (cmd != W25N_SIM_CMD_DIE_SELECT))
+        {
+            /* The driver waits for the end of an operation before every command, finish it */
+            image->stats.protocol_errors++;
+            image->time_ns = die->busy_until_ns;
+        }
+
+        switch (cmd)
+        {
+            case W25N_SIM_CMD_LD_PRGM_DATA:
+                memset(buffer, 0xFF, W25N_SIM_PAGE_SIZE);
+                break;
+            case W25N_SIM_CMD_RESET:
+            case W25N_SIM_CMD_JEDEC_ID:
+            case W25N_SIM_CMD_RD_REG:
+            case W25N_SIM_CMD_WR_REG:
+            case W25N_SIM_CMD_WR_ENABLE:
+            case W25N_SIM_CMD_WR_DISABLE:
+            case W25N_SIM_CMD_PAGE_DATA_RD:
+            case W25N_SIM_CMD_RD_DATA:
+            case W25N_SIM_CMD_RANDM_PRGM_DATA:
+            case W25N_SIM_CMD_PRGM_EXEC:
+            case W25N_SIM_CMD_BLOCK_ERASE:
+                break;
+            case W25N_SIM_CMD_DIE_SELECT:
+                /* A W25N01GW does not know the command */
+                if (die_count < 2)
+                    image->stats.protocol_errors++;
+                break;
+            default:
+                image->stats.protocol_errors++;
+                break;
+        }
+        return value;
+    }
+
+    col = (uint16_t)((xact_cmd[1] << 8) | xact_cmd[2]);
+
+    switch (cmd)
+    {
+        case W25N_SIM_CMD_JEDEC_ID:
+            /* Command and one dummy byte, then the ID */
+            if (pos == 2)
+                value = 0xEF;
+            else if (pos == 3)
+                value = (die_count > 1) ? 0xBB : 0xBA;
+            else if (pos == 4)
+                value = 0x21;
+            break;
+
+        case W25N_SIM_CMD_RD_REG:
+            if (pos < 2)
+                break;
+            switch (xact_cmd[1])
+            {
+                case W25N_SIM_REG_PROTECT:
+                    value = die->reg_protect;
+                    break;
+                case W25N_SIM_REG_CONFIG:
+                    value = die->reg_config;
+                    break;
+                case W25N_SIM_REG_STATUS:
+                    value = die->reg_status;
+                    if (sim_busy())
+                    {
+                        value |= W25N_SIM_STAT_BUSY;
+                        if (pos == 2)
+                            image->stats.busy_polls++;
+                    }
+                    break;
+                default:
+                    if (pos == 2)
+                        image->stats.protocol_errors++;
+                    break;
+            }
+            break;
+
+        case W25N_SIM_CMD_RD_DATA:
+            /* Command, column address and one dummy byte, then the data */
+            if (pos < 4)
+                break;
+            col += pos - 4;
+            if (col < W25N_SIM_PAGE_SIZE)
+                value = buffer[col];
+            break;
+
+        case W25N_SIM_CMD_LD_PRGM_DATA:
+        case W25N_SIM_CMD_RANDM_PRGM_DATA:
+            if (pos < 3)
+                break;
+            col += pos - 3;
+            if (col < W25N_SIM_PAGE_SIZE)
+                buffer[col] = mosi;
+            break;
+
+        default:
+            break;
+    }
+
+    return value;
+}
@@ -0,0 +1,154 @@
+/**
+ * Copyright (C) 2019 Bosch Sensortec GmbH
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * @file    w25n01gw_sim.h
+ * @brief   Simulated W25N01GW SPI NAND flash for host builds of FLogFS
+ *
+ * The simulator answers the SPI command stream of the unmodified W25N01GW driver, so
+ * FLogFS and the driver run on the host as they run on the Application Board 3.0.
+ *
+ * - Page data read, program and block erase go through the 2112 byte data buffer as on the
+ *   chip (buffer read mode, ECC off). A program can only clear bits, an erase sets a whole
+ *   block to 0xFF.
+ * - Page read, program and erase set BUSY in the status register for tRD, tPROG and tBERS
+ *   of simulated time. SPI transfers advance the simulated time by the bytes clocked at the
+ *   SPI frequency plus a fixed turnaround. The host timer of the driver runs on the same
+ *   time, __WFE() advances it to the next compare event.
+ * - Erases per block, programs per page since its erase (NOP) and programs that change bytes
+ *   which were already programmed are counted.
+ * - w25n_sim_set_dies() turns the chip into a W25M02GW, two W25N01GW dies behind one chip
+ *   select. The die select command picks the die for the next commands, each die has its own
+ *   data buffer, registers and BUSY, so one die programs or erases while the other one works.
+ * - The flash image is a shared memory map, anonymous or backed by a file, so it survives a
+ *   power cut of the process using it. w25n_sim_power_cut_after() stops the process in the
+ *   middle of a later program or erase, leaving that page or block partially written.
+ *
+ */
+
+#ifndef W25N01GW_SIM_H_
+#define W25N01GW_SIM_H_
+
+/**********************************************************************************/
+/* header includes */
+/**********************************************************************************/
+#include <stdint.h>
+
+/**********************************************************************************/
+/* macro definitions */
+/**********************************************************************************/
+/*! Main array and spare area of a page */
+#define W25N_SIM_PAGE_SIZE              (2048 + 64)
+#define W25N_SIM_PAGES_PER_BLOCK        (64)
+/*! Blocks and pages of one die */
+#define W25N_SIM_BLOCKS                 (1024)
+#define W25N_SIM_PAGES                  (W25N_SIM_PAGES_PER_BLOCK * W25N_SIM_BLOCKS)
+/*! Dies of a W25M02GW */
+#define W25N_SIM_MAX_DIES               (2)
+/*! Partial page programs allowed between two erases */
+#define W25N_SIM_NOP                    (4)
+
+/*! Exit status of a process stopped by a simulated power cut */
+#define W25N_SIM_POWER_CUT_EXIT         (86)
+
+/**********************************************************************************/
+/* data structure declarations */
+/**********************************************************************************/
+
+/*!
+ * @brief Timing of the simulated chip and SPI bus
+ */
+struct w25n_sim_timing
+{
+    uint32_t read_us;           /*< tRD, page data read */
+    uint32_t program_us;        /*< tPROG, program execute */
+    uint32_t erase_us;          /*< tBERS, block erase */
+    uint32_t spi_hz;            /*< SPI clock */
+    uint32_t transfer_ns;       /*< Turnaround of every SPI transfer */
+};
+
+/*!
+ * @brief Operation counters of the simulated chip, kept with the flash image
+ */
+struct w25n_sim_stats
+{
+    uint64_t spi_transfers;
+    uint64_t spi_bytes;
+    uint64_t busy_polls;        /*< Status reads while BUSY */
+    uint64_t page_reads;
+    uint64_t page_programs;
+    uint64_t block_erases;
+    uint64_t nop_violations;    /*< Programs of a page beyond W25N_SIM_NOP */
+    uint64_t program_conflicts; /*< Programs changing already programmed bytes */
+    uint64_t protocol_errors;   /*< Commands while BUSY, program/erase without WEL, unknown commands */
+    uint64_t power_cuts;
+};
+
+/**********************************************************************************/
+/* function declarations */
+/**********************************************************************************/
+/*!
+ * @brief Maps the flash image, a new image is fully erased
+ *
+ * @param[in] path : image file, NULL for an anonymous image lost at exit
+ * @param[in] timing : chip timing, NULL for the data sheet values at 4 MHz
+ *
+ * @return 0 on success, -1 when the image cannot be mapped
+ */
+int w25n_sim_open(const char *path, const struct w25n_sim_timing *timing);
+
+/*!
+ * @brief Unmaps the flash image
+ */
+void w25n_sim_close(void);
+
+/*!
+ * @brief Erases the whole image and clears the statistics, wear and time
+ */
+void w25n_sim_reset(void);
+
+/*!
+ * @brief Simulated time since the image was created or reset, in nanoseconds
+ */
+uint64_t w25n_sim_time_ns(void);
+
+/*!
+ * @brief Advances the simulated time by the MCU doing something else, the chip keeps working
+ *        and the timer interrupts of the driver run
+ *
+ * @param[in] us : idle time in microseconds
+ */
+void w25n_sim_idle(uint32_t us);
+
+/*!
+ * @brief Statistics, shared by all processes using the image
+ */
+struct w25n_sim_stats *w25n_sim_stats(void);
+
+/*!
+ * @brief Sets the dies of the chip, 1 for a W25N01GW and 2 for a W25M02GW, and erases the
+ *        whole image as w25n_sim_reset() does
+ */
+void w25n_sim_set_dies(uint8_t count);
+
+/*!
+ * @brief Dies of the chip
+ */
+uint8_t w25n_sim_dies(void);
+
+/*!
+ * @brief Erase count of a block, the blocks of die 1 follow the ones of die 0
+ */
+uint32_t w25n_sim_erase_count(uint16_t block);
+
+/*!
+ * @brief Stops the process in the middle of a later program or erase
+ *
+ * @param[in] operations : number of program and erase operations to complete first,
+ *                         the next one is cut. 0 disarms the cut.
+ * @param[in] seed : seed for the amount of data the cut operation leaves behind
+ */
+void w25n_sim_power_cut_after(uint32_t operations, uint32_t seed);
+
+#endif /* W25N01GW_SIM_H_ */